@@ -12,6 +12,7 @@
 #include "db/dbformat.h"
 #include "db/filename.h"
 #include "db/merge_helper.h"
+#include "db/range_tombstone.h"
 #include "db/table_cache.h"
 #include "db/version_edit.h"
 #include "rocksdb/db.h"
@@ -20,6 +21,7 @@
 #include "rocksdb/options.h"
 #include "rocksdb/table.h"
 #include "table/block_based_table_builder.h"
+#include "util/rate_limiter.h"
 #include "util/stop_watch.h"
 
 namespace rocksdb {
@@ -36,7 +38,9 @@ TableBuilder* NewTableBuilder(const Options& options,
 
 Status BuildTable(const std::string& dbname, Env* env, const Options& options,
                   const EnvOptions& soptions, TableCache* table_cache,
-                  Iterator* iter, FileMetaData* meta,
+                  Iterator* iter,
+                  const std::vector<RangeTombstone>& range_tombstones,
+                  FileMetaData* meta,
                   const InternalKeyComparator& internal_comparator,
                   const SequenceNumber newest_snapshot,
                   const SequenceNumber earliest_seqno_in_memtable,
@@ -44,6 +48,13 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
   Status s;
   meta->file_size = 0;
   meta->smallest_seqno = meta->largest_seqno = 0;
+  // The age of a file is only recorded when something uses it, so that the
+  // MANIFEST stays readable by older releases otherwise.
+  int64_t creation_time = 0;
+  if (options.periodic_compaction_seconds > 0 &&
+      env->GetCurrentTime(&creation_time).ok()) {
+    meta->creation_time = creation_time;
+  }
   iter->SeekToFirst();
 
   // If the sequence number of the smallest entry in the memtable is
@@ -55,21 +66,29 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
   }
 
   std::string fname = TableFileName(dbname, meta->number);
-  if (iter->Valid()) {
+  const bool has_entries = iter->Valid();
+  if (has_entries || !range_tombstones.empty()) {
     unique_ptr<WritableFile> file;
     s = env->NewWritableFile(fname, &file, soptions);
     if (!s.ok()) {
       return s;
     }
+    if (options.rate_limiter.get() != nullptr) {
+      file.reset(new RateLimitedWritableFile(
+          std::move(file), options.rate_limiter.get(), Env::HIGH,
+          options.statistics.get()));
+    }
 
     TableBuilder* builder =
         NewTableBuilder(options, internal_comparator, file.get(), compression);
 
     // the first key is the smallest key
-    Slice key = iter->key();
-    meta->smallest.DecodeFrom(key);
-    meta->smallest_seqno = GetInternalKeySeqno(key);
-    meta->largest_seqno = meta->smallest_seqno;
+    if (has_entries) {
+      Slice key = iter->key();
+      meta->smallest.DecodeFrom(key);
+      meta->smallest_seqno = GetInternalKeySeqno(key);
+      meta->largest_seqno = meta->smallest_seqno;
+    }
 
     MergeHelper merge(internal_comparator.user_comparator(),
                       options.merge_operator.get(), options.info_log.get(),
@@ -157,10 +176,12 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
       }
 
       // The last key is the largest key
-      meta->largest.DecodeFrom(Slice(prev_key));
-      SequenceNumber seqno = GetInternalKeySeqno(Slice(prev_key));
-      meta->smallest_seqno = std::min(meta->smallest_seqno, seqno);
-      meta->largest_seqno = std::max(meta->largest_seqno, seqno);
+      if (has_entries) {
+        meta->largest.DecodeFrom(Slice(prev_key));
+        SequenceNumber seqno = GetInternalKeySeqno(Slice(prev_key));
+        meta->smallest_seqno = std::min(meta->smallest_seqno, seqno);
+        meta->largest_seqno = std::max(meta->largest_seqno, seqno);
+      }
 
     } else {
       for (; iter->Valid(); iter->Next()) {
@@ -173,11 +194,27 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
       }
     }
 
+    if (!range_tombstones.empty()) {
+      for (const auto& t : range_tombstones) {
+        if (s.ok()) {
+          s = builder->AddRangeTombstone(t);
+        }
+      }
+      ExtendFileRangeToTombstones(range_tombstones, internal_comparator,
+                                  !has_entries, &meta->smallest,
+                                  &meta->largest, &meta->smallest_seqno,
+                                  &meta->largest_seqno);
+      meta->has_range_tombstones = true;
+      meta->range_tombstones =
+          std::make_shared<std::vector<RangeTombstone>>(range_tombstones);
+    }
+
     // Finish and check for builder errors
     if (s.ok()) {
       s = builder->Finish();
       if (s.ok()) {
         meta->file_size = builder->FileSize();
+        meta->marked_for_compaction = builder->NeedCompact();
         assert(meta->file_size > 0);
       }
     } else {
@@ -221,4 +258,31 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
   return s;
 }
 
+void ExtendFileRangeToTombstones(
+    const std::vector<RangeTombstone>& range_tombstones,
+    const InternalKeyComparator& internal_comparator, bool empty,
+    InternalKey* smallest, InternalKey* largest,
+    SequenceNumber* smallest_seqno, SequenceNumber* largest_seqno) {
+  for (const auto& t : range_tombstones) {
+    // Keys sorting before every entry of the tombstone's start and end keys.
+    // The start key sorts after the end key of a tombstone ending where this
+    // one starts, so the ranges of adjacent compaction outputs never meet.
+    InternalKey start(t.start_key, kMaxSequenceNumber, kTypeDeletion);
+    InternalKey end(t.end_key, kMaxSequenceNumber, kValueTypeForSeek);
+    if (empty || internal_comparator.Compare(start, *smallest) < 0) {
+      *smallest = start;
+    }
+    if (empty || internal_comparator.Compare(end, *largest) > 0) {
+      *largest = end;
+    }
+    if (empty) {
+      *smallest_seqno = *largest_seqno = t.seq;
+      empty = false;
+    } else {
+      *smallest_seqno = std::min(*smallest_seqno, t.seq);
+      *largest_seqno = std::max(*largest_seqno, t.seq);
+    }
+  }
+}
+
 }  // namespace rocksdb
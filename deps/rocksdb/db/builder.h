@@ -6,6 +6,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #pragma once
+#include <vector>
 #include "rocksdb/comparator.h"
 #include "rocksdb/status.h"
 #include "rocksdb/types.h"
@@ -15,6 +16,7 @@ namespace rocksdb {
 
 struct Options;
 struct FileMetaData;
+struct RangeTombstone;
 
 class Env;
 struct EnvOptions;
@@ -23,23 +25,36 @@ class TableCache;
 class VersionEdit;
 class TableBuilder;
 class WritableFile;
+class InternalKey;
 
 extern TableBuilder* NewTableBuilder(
     const Options& options, const InternalKeyComparator& internal_comparator,
     WritableFile* file, CompressionType compression_type);
 
-// Build a Table file from the contents of *iter.  The generated file
-// will be named according to meta->number.  On success, the rest of
-// *meta will be filled with metadata about the generated table.
-// If no data is present in *iter, meta->file_size will be set to
-// zero, and no Table file will be produced.
+// Build a Table file from the contents of *iter and "range_tombstones".
+// The generated file will be named according to meta->number.  On success,
+// the rest of *meta will be filled with metadata about the generated table.
+// If neither *iter nor "range_tombstones" has data, meta->file_size will be
+// set to zero, and no Table file will be produced.  The key range of a new
+// level-0 file covers its range tombstones as well, so that the compactions of
+// their keys pick it up.
 extern Status BuildTable(const std::string& dbname, Env* env,
                          const Options& options, const EnvOptions& soptions,
                          TableCache* table_cache, Iterator* iter,
+                         const std::vector<RangeTombstone>& range_tombstones,
                          FileMetaData* meta,
                          const InternalKeyComparator& internal_comparator,
                          const SequenceNumber newest_snapshot,
                          const SequenceNumber earliest_seqno_in_memtable,
                          const CompressionType compression);
 
+// Extend the key range [*smallest, *largest] and the sequence number range
+// [*smallest_seqno, *largest_seqno] of a file to the ranges of
+// "range_tombstones".  If "empty", the file has no ranges to extend yet.
+extern void ExtendFileRangeToTombstones(
+    const std::vector<RangeTombstone>& range_tombstones,
+    const InternalKeyComparator& internal_comparator, bool empty,
+    InternalKey* smallest, InternalKey* largest,
+    SequenceNumber* smallest_seqno, SequenceNumber* largest_seqno);
+
 }  // namespace rocksdb
@@ -20,6 +20,7 @@
 #include "db/table_properties_collector.h"
 #include "util/autovector.h"
 #include "util/hash_skiplist_rep.h"
+#include "util/mutexlock.h"
 
 namespace rocksdb {
 
@@ -115,6 +116,13 @@ ColumnFamilyOptions SanitizeOptions(const InternalKeyComparator* icmp,
   // Add collector to collect internal key statistics
   collector_factories.push_back(
       std::make_shared<InternalKeyPropertiesCollectorFactory>());
+  if (result.deletion_compaction_window > 0 &&
+      result.deletion_compaction_trigger > 0) {
+    collector_factories.push_back(
+        std::make_shared<CompactOnDeletionCollectorFactory>(
+            result.deletion_compaction_window,
+            result.deletion_compaction_trigger));
+  }
 
   return result;
 }
@@ -160,6 +168,39 @@ void SuperVersion::Init(MemTable* new_mem, MemTableListVersion* new_imm,
   imm->Ref();
   current->Ref();
   refs.store(1, std::memory_order_relaxed);
+
+  std::shared_ptr<RangeTombstoneSets> tombstones(new RangeTombstoneSets);
+  imm->AddRangeTombstones(tombstones.get());
+  tombstones->Add(current->range_tombstones());
+  immutable_range_tombstones_.reset();
+  if (!tombstones->empty()) {
+    immutable_range_tombstones_ = std::move(tombstones);
+  }
+}
+
+SequenceNumber SuperVersion::MaxCoveringTombstoneSeq(
+    const Slice& user_key, SequenceNumber snapshot) const {
+  SequenceNumber seq = mem->MaxCoveringTombstoneSeq(user_key, snapshot);
+  if (immutable_range_tombstones_ != nullptr) {
+    seq = std::max(seq, immutable_range_tombstones_->MaxCoveringSeq(
+                            user_key, snapshot));
+  }
+  return seq;
+}
+
+std::shared_ptr<const RangeTombstoneSets> SuperVersion::GetRangeTombstones()
+    const {
+  auto mem_tombstones = mem->GetRangeTombstones();
+  if (mem_tombstones == nullptr || mem_tombstones->empty()) {
+    return immutable_range_tombstones_;
+  }
+  if (immutable_range_tombstones_ == nullptr) {
+    return mem_tombstones;
+  }
+  std::shared_ptr<RangeTombstoneSets> tombstones(
+      new RangeTombstoneSets(*mem_tombstones));
+  tombstones->Add(*immutable_range_tombstones_);
+  return tombstones;
 }
 
 namespace {
@@ -286,7 +327,8 @@ void ColumnFamilyData::SetCurrent(Version* current) {
   current_ = current;
   need_slowdown_for_num_level0_files_ =
       (options_.level0_slowdown_writes_trigger >= 0 &&
-       current_->NumLevelFiles(0) >= options_.level0_slowdown_writes_trigger);
+       current_->NumLevel0SortedRuns() >=
+           options_.level0_slowdown_writes_trigger);
 }
 
 void ColumnFamilyData::CreateNewMemtable() {
@@ -102,6 +102,18 @@ struct SuperVersion {
   void Init(MemTable* new_mem, MemTableListVersion* new_imm,
             Version* new_current);
 
+  // Returns the largest sequence number not greater than snapshot of a range
+  // tombstone in mem, imm or current that covers user_key, or 0 if there is
+  // none. Entries of user_key older than that are deleted.
+  SequenceNumber MaxCoveringTombstoneSeq(const Slice& user_key,
+                                         SequenceNumber snapshot) const;
+
+  // Returns the range tombstones of mem, imm and current, or nullptr if there
+  // are none.  Takes no lock: the tombstones of imm and current are gathered
+  // by Init(), and only mem's, which change with every DeleteRange(), are
+  // added on each call.
+  std::shared_ptr<const RangeTombstoneSets> GetRangeTombstones() const;
+
   // The value of dummy is not actually used. kSVInUse takes its address as a
   // mark in the thread local storage to indicate the SuperVersion is in use
   // by thread. This way, the value of kSVInUse is guaranteed to have no
@@ -110,6 +122,11 @@ struct SuperVersion {
   static int dummy;
   static void* const kSVInUse;
   static void* const kSVObsolete;
+
+ private:
+  // The range tombstones of imm and current, or nullptr if there are none.
+  // Set by Init(); never changes afterwards.
+  std::shared_ptr<const RangeTombstoneSets> immutable_range_tombstones_;
 };
 
 extern ColumnFamilyOptions SanitizeOptions(const InternalKeyComparator* icmp,
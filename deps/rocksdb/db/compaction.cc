@@ -11,6 +11,7 @@
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <algorithm>
 #include <vector>
 
 #include "db/column_family.h"
@@ -39,24 +40,19 @@ Compaction::Compaction(Version* input_version, int level, int out_level,
       cfd_(input_version_->cfd_),
       seek_compaction_(seek_compaction),
       enable_compression_(enable_compression),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0),
+      has_skipped_files_(false),
       base_index_(-1),
       parent_index_(-1),
       score_(0),
       bottommost_level_(false),
       is_full_compaction_(false),
       is_manual_compaction_(false),
-      level_ptrs_(std::vector<size_t>(number_levels_)) {
+      is_periodic_compaction_(false) {
 
   cfd_->Ref();
   input_version_->Ref();
   edit_ = new VersionEdit();
   edit_->SetColumnFamily(cfd_->GetID());
-  for (int i = 0; i < number_levels_; i++) {
-    level_ptrs_[i] = 0;
-  }
 }
 
 Compaction::~Compaction() {
@@ -77,30 +73,126 @@ bool Compaction::IsTrivialMove() const {
   // a very expensive merge later on.
   // If level_== out_level_, the purpose is to force compaction filter to be
   // applied to that level, and thus cannot be a trivia move.
-  return (level_ != out_level_ &&
-          num_input_files(0) == 1 &&
-          num_input_files(1) == 0 &&
-          TotalFileSize(grandparents_) <= max_grandparent_overlap_bytes_);
+  // A file deleted by a range tombstone is not moved either, so that the
+  // compaction can drop it instead, and neither is a file marked for
+  // compaction, so that its deletions can be dropped, nor a file picked by
+  // periodic compaction, which has to be rewritten.
+  if (level_ == out_level_ || is_periodic_compaction_ ||
+      num_input_files(0) != 1 ||
+      num_input_files(1) != 0 ||
+      TotalFileSize(grandparents_) > max_grandparent_overlap_bytes_) {
+    return false;
+  }
+  const FileMetaData* f = inputs_[0][0];
+  if (f->marked_for_compaction) {
+    return false;
+  }
+  const auto& tombstones = input_version_->range_tombstones();
+  return tombstones == nullptr ||
+         tombstones->MinCoveringSeqAbove(f->smallest.user_key(),
+                                         f->largest.user_key(),
+                                         f->largest_seqno) == 0;
 }
 
 void Compaction::AddInputDeletions(VersionEdit* edit) {
   for (int which = 0; which < 2; which++) {
     for (size_t i = 0; i < inputs_[which].size(); i++) {
-      edit->DeleteFile(level_ + which, inputs_[which][i]->number);
+      edit->DeleteFile(which == 0 ? level_ : out_level_,
+                       inputs_[which][i]->number);
+    }
+  }
+}
+
+int Compaction::SkipFilesCoveredByRangeTombstones(
+    const std::vector<SequenceNumber>& snapshots) {
+  const auto& tombstones = input_version_->range_tombstones();
+  if (tombstones == nullptr) {
+    return 0;
+  }
+  int num_skipped = 0;
+  for (int which = 0; which < 2; which++) {
+    files_to_read_[which].clear();
+    for (FileMetaData* f : inputs_[which]) {
+      SequenceNumber seq = tombstones->MinCoveringSeqAbove(
+          f->smallest.user_key(), f->largest.user_key(), f->largest_seqno);
+      if (seq != 0) {
+        // A snapshot in [smallest_seqno, seq) sees some of the file's
+        // entries but not the tombstone.
+        auto it = std::lower_bound(snapshots.begin(), snapshots.end(),
+                                   f->smallest_seqno);
+        if (it == snapshots.end() || *it >= seq) {
+          num_skipped++;
+          continue;
+        }
+      }
+      files_to_read_[which].push_back(f);
     }
   }
+  has_skipped_files_ = num_skipped > 0;
+  return num_skipped;
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+void Compaction::GetRangeTombstonesToKeep(
+    const std::vector<SequenceNumber>& snapshots,
+    std::vector<RangeTombstone>* tombstones) const {
+  for (int which = 0; which < 2; which++) {
+    for (FileMetaData* f : inputs_[which]) {
+      if (f->range_tombstones == nullptr) {
+        continue;
+      }
+      for (const auto& t : *f->range_tombstones) {
+        if (!IsRangeTombstoneApplied(t, snapshots)) {
+          tombstones->push_back(t);
+        }
+      }
+    }
+  }
+}
+
+bool Compaction::IsRangeTombstoneApplied(
+    const RangeTombstone& t,
+    const std::vector<SequenceNumber>& snapshots) const {
+  // A snapshot older than the tombstone keeps the entries it covers.
+  if (!snapshots.empty() && snapshots.front() < t.seq) {
+    return false;
+  }
+  // Every file that may hold an entry covered by the tombstone has to be
+  // an input of this compaction.
+  const Comparator* ucmp = cfd_->user_comparator();
+  for (int lvl = 0; lvl < number_levels_; lvl++) {
+    for (FileMetaData* f : input_version_->files_[lvl]) {
+      if (f->smallest_seqno >= t.seq ||
+          ucmp->Compare(f->smallest.user_key(), t.end_key) >= 0 ||
+          ucmp->Compare(f->largest.user_key(), t.start_key) < 0) {
+        continue;
+      }
+      if (lvl > out_level_ ||
+          (std::find(inputs_[0].begin(), inputs_[0].end(), f) ==
+               inputs_[0].end() &&
+           std::find(inputs_[1].begin(), inputs_[1].end(), f) ==
+               inputs_[1].end())) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Compaction::IsBaseLevelForKey(const Slice& user_key,
+                                   KeyScanState* state) {
   if (cfd_->options()->compaction_style == kCompactionStyleUniversal) {
     return bottommost_level_;
   }
+  std::vector<size_t>& level_ptrs = state->level_ptrs;
+  if (level_ptrs.empty()) {
+    level_ptrs.resize(number_levels_, 0);
+  }
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = cfd_->user_comparator();
-  for (int lvl = level_ + 2; lvl < number_levels_; lvl++) {
+  for (int lvl = out_level_ + 1; lvl < number_levels_; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    for (; level_ptrs_[lvl] < files.size(); ) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    for (; level_ptrs[lvl] < files.size(); ) {
+      FileMetaData* f = files[level_ptrs[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -109,32 +201,32 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      level_ptrs[lvl]++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key,
+                                  KeyScanState* state) {
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &cfd_->internal_comparator();
-  while (grandparent_index_ < grandparents_.size() &&
-      icmp->Compare(internal_key,
-                    grandparents_[grandparent_index_]->largest.Encode()) > 0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+  size_t& index = state->grandparent_index;
+  while (index < grandparents_.size() &&
+      icmp->Compare(internal_key, grandparents_[index]->largest.Encode()) > 0) {
+    if (state->seen_key) {
+      state->overlapped_bytes += grandparents_[index]->file_size;
     }
-    assert(grandparent_index_ + 1 >= grandparents_.size() ||
-           icmp->Compare(grandparents_[grandparent_index_]->largest.Encode(),
-                         grandparents_[grandparent_index_+1]->smallest.Encode())
-                         < 0);
-    grandparent_index_++;
+    assert(index + 1 >= grandparents_.size() ||
+           icmp->Compare(grandparents_[index]->largest.Encode(),
+                         grandparents_[index + 1]->smallest.Encode()) < 0);
+    index++;
   }
-  seen_key_ = true;
+  state->seen_key = true;
 
-  if (overlapped_bytes_ > max_grandparent_overlap_bytes_) {
+  if (state->overlapped_bytes > max_grandparent_overlap_bytes_) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    state->overlapped_bytes = 0;
     return true;
   } else {
     return false;
@@ -44,6 +44,25 @@ class Compaction {
 
   std::vector<FileMetaData*>* inputs(int which) { return &inputs_[which]; }
 
+  // The input files at "level()+which" that have to be read, i.e. inputs()
+  // without the files skipped by SkipFilesCoveredByRangeTombstones().
+  std::vector<FileMetaData*>* files_to_read(int which) {
+    return has_skipped_files_ ? &files_to_read_[which] : &inputs_[which];
+  }
+
+  // Don't read the input files all of whose entries are deleted by a range
+  // tombstone of the input version that every snapshot seeing one of those
+  // entries also sees. The files are still deleted by the compaction.
+  // Returns the number of files skipped.
+  int SkipFilesCoveredByRangeTombstones(
+      const std::vector<SequenceNumber>& snapshots);
+
+  // Store in *tombstones the range tombstones of the input files that the
+  // output has to keep: those that a snapshot predates, or that may cover
+  // entries this compaction does not drop.
+  void GetRangeTombstonesToKeep(const std::vector<SequenceNumber>& snapshots,
+                                std::vector<RangeTombstone>* tombstones) const;
+
   // Maximum size of files to build during this compaction.
   uint64_t MaxOutputFileSize() const { return max_output_file_size_; }
 
@@ -57,14 +76,33 @@ class Compaction {
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
+  // Where a pass over the compaction's keys in ascending order has got to
+  // in the levels below the output level. IsBaseLevelForKey() and
+  // ShouldStopBefore() advance it. Sub-compactions process disjoint key
+  // ranges in parallel, so each keeps its own.
+  struct KeyScanState {
+    KeyScanState()
+        : grandparent_index(0), seen_key(false), overlapped_bytes(0) {}
+
+    // level_ptrs holds indices into input_version_->levels_: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= out_level_ + 1).
+    std::vector<size_t> level_ptrs;
+    size_t grandparent_index;   // Index in grandparents_
+    bool seen_key;              // Some output key has been seen
+    uint64_t overlapped_bytes;  // Bytes of overlap between current output
+                                // and grandparent files
+  };
+
   // Returns true if the information we have available guarantees that
-  // the compaction is producing data in "level+1" for which no data exists
-  // in levels greater than "level+1".
-  bool IsBaseLevelForKey(const Slice& user_key);
+  // the compaction is producing data in the output level for which no data
+  // exists in levels greater than the output level.
+  bool IsBaseLevelForKey(const Slice& user_key, KeyScanState* state);
 
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
-  bool ShouldStopBefore(const Slice& internal_key);
+  bool ShouldStopBefore(const Slice& internal_key, KeyScanState* state);
 
   // Release the input version for the compaction, once the compaction
   // is successful.
@@ -109,18 +147,20 @@ class Compaction {
   bool seek_compaction_;
   bool enable_compression_;
 
-  // Each compaction reads inputs from "level_" and "level_+1"
+  // Each compaction reads inputs from "level_" and "out_level_"
   std::vector<FileMetaData*> inputs_[2];      // The two sets of inputs
 
+  // inputs_ minus the files covered by range tombstones, valid if
+  // has_skipped_files_
+  std::vector<FileMetaData*> files_to_read_[2];
+  bool has_skipped_files_;
+
   // State used to check for number of of overlapping grandparent files
-  // (parent == level_ + 1, grandparent == level_ + 2)
+  // (parent == out_level_, grandparent == out_level_ + 1)
   std::vector<FileMetaData*> grandparents_;
-  size_t grandparent_index_;  // Index in grandparent_starts_
-  bool seen_key_;             // Some output key has been seen
-  uint64_t overlapped_bytes_;  // Bytes of overlap between current output
-                              // and grandparent files
   int base_index_;   // index of the file in files_[level_]
-  int parent_index_; // index of some file with same range in files_[level_+1]
+  int parent_index_; // index of some file with same range in
+                     // files_[out_level_]
   double score_;     // score that was used to pick this compaction.
 
   // Is this compaction creating a file in the bottom most level?
@@ -131,11 +171,9 @@ class Compaction {
   // Is this compaction requested by the client?
   bool is_manual_compaction_;
 
-  // level_ptrs_ holds indices into input_version_->levels_: our state
-  // is that we are positioned at one of the file ranges for each
-  // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
-  std::vector<size_t> level_ptrs_;
+  // Was this compaction picked because its input is older than
+  // periodic_compaction_seconds?
+  bool is_periodic_compaction_;
 
   // mark (or clear) all files that are being compacted
   void MarkFilesBeingCompacted(bool);
@@ -146,6 +184,12 @@ class Compaction {
   // In case of compaction error, reset the nextIndex that is used
   // to pick up the next file to be compacted from files_by_size_
   void ResetNextCompactionIndex();
+
+  // Are all the entries that "t" covers dropped by this compaction, and is
+  // there no snapshot that sees them?
+  bool IsRangeTombstoneApplied(
+      const RangeTombstone& t,
+      const std::vector<SequenceNumber>& snapshots) const;
 };
 
 }  // namespace rocksdb
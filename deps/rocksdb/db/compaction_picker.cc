@@ -9,7 +9,9 @@
 
 #include "db/compaction_picker.h"
 
+#include <algorithm>
 #include <limits>
+#include "rocksdb/compaction_filter.h"
 #include "util/log_buffer.h"
 #include "util/statistics.h"
 
@@ -42,6 +44,17 @@ uint64_t MultiplyCheckOverflow(uint64_t op1, int op2) {
 
 }  // anonymous namespace
 
+bool CanSplitManualCompaction(const Options& options) {
+  // Whether a CompactionFilterV2 is used is only known once its factory is
+  // called, so any factory but the default one counts.
+  return options.parallel_manual_compaction &&
+         options.max_background_compactions > 1 &&
+         options.compaction_filter == nullptr &&
+         (options.compaction_filter_factory_v2 == nullptr ||
+          dynamic_cast<DefaultCompactionFilterFactoryV2*>(
+              options.compaction_filter_factory_v2.get()) != nullptr);
+}
+
 CompactionPicker::CompactionPicker(const Options* options,
                                    const InternalKeyComparator* icmp)
     : compactions_in_progress_(options->num_levels),
@@ -55,7 +68,10 @@ CompactionPicker::CompactionPicker(const Options* options,
   int max_bytes_multiplier = options_->max_bytes_for_level_multiplier;
   for (int i = 0; i < NumberLevels(); i++) {
     if (i == 0 && options_->compaction_style == kCompactionStyleUniversal) {
-      max_file_size_[i] = ULLONG_MAX;
+      max_file_size_[i] =
+          options_->compaction_options_universal.partitioned_runs
+              ? options_->target_file_size_base
+              : ULLONG_MAX;
       level_max_bytes_[i] = options_->max_bytes_for_level_base;
     } else if (i > 1) {
       max_file_size_[i] = MultiplyCheckOverflow(max_file_size_[i - 1],
@@ -185,8 +201,8 @@ bool CompactionPicker::ExpandWhileOverlapping(Compaction* c) {
   }
   if (c->inputs_[0].empty() || FilesInCompaction(c->inputs_[0]) ||
       (c->level() != c->output_level() &&
-       ParentRangeInCompaction(c->input_version_, &smallest, &largest, level,
-                               &parent_index))) {
+       ParentRangeInCompaction(c->input_version_, &smallest, &largest,
+                               c->output_level(), &parent_index))) {
     c->inputs_[0].clear();
     c->inputs_[1].clear();
     return false;
@@ -214,35 +230,38 @@ bool CompactionPicker::FilesInCompaction(std::vector<FileMetaData*>& files) {
 bool CompactionPicker::ParentRangeInCompaction(Version* version,
                                                const InternalKey* smallest,
                                                const InternalKey* largest,
-                                               int level, int* parent_index) {
+                                               int output_level,
+                                               int* parent_index) {
   std::vector<FileMetaData*> inputs;
-  assert(level + 1 < NumberLevels());
+  assert(output_level < NumberLevels());
 
-  version->GetOverlappingInputs(level + 1, smallest, largest, &inputs,
+  version->GetOverlappingInputs(output_level, smallest, largest, &inputs,
                                 *parent_index, parent_index);
   return FilesInCompaction(inputs);
 }
 
-// Populates the set of inputs from "level+1" that overlap with "level".
-// Will also attempt to expand "level" if that doesn't expand "level+1"
+// Populates the set of inputs from the output level that overlap with
+// "level". Will also attempt to expand "level" if that doesn't expand the
+// output level
 // or cause "level" to include a file for compaction that has an overlapping
 // user-key with another file.
 void CompactionPicker::SetupOtherInputs(Compaction* c) {
   // If inputs are empty, then there is nothing to expand.
   // If both input and output levels are the same, no need to consider
-  // files at level "level+1"
+  // files at the output level
   if (c->inputs_[0].empty() || c->level() == c->output_level()) {
     return;
   }
 
   const int level = c->level();
+  const int output_level = c->output_level();
   InternalKey smallest, largest;
 
   // Get the range one last time.
   GetRange(c->inputs_[0], &smallest, &largest);
 
   // Populate the set of next-level files (inputs_[1]) to include in compaction
-  c->input_version_->GetOverlappingInputs(level + 1, &smallest, &largest,
+  c->input_version_->GetOverlappingInputs(output_level, &smallest, &largest,
                                           &c->inputs_[1], c->parent_index_,
                                           &c->parent_index_);
 
@@ -251,7 +270,7 @@ void CompactionPicker::SetupOtherInputs(Compaction* c) {
   GetRange(c->inputs_[0], c->inputs_[1], &all_start, &all_limit);
 
   // See if we can further grow the number of inputs in "level" without
-  // changing the number of "level+1" files we pick up. We also choose NOT
+  // changing the number of output level files we pick up. We also choose NOT
   // to expand if this would cause "level" to include some entries for some
   // user key, while excluding other entries for the same user key. This
   // can happen when one user key spans multiple files.
@@ -270,8 +289,9 @@ void CompactionPicker::SetupOtherInputs(Compaction* c) {
       InternalKey new_start, new_limit;
       GetRange(expanded0, &new_start, &new_limit);
       std::vector<FileMetaData*> expanded1;
-      c->input_version_->GetOverlappingInputs(level + 1, &new_start, &new_limit,
-                                              &expanded1, c->parent_index_,
+      c->input_version_->GetOverlappingInputs(output_level, &new_start,
+                                              &new_limit, &expanded1,
+                                              c->parent_index_,
                                               &c->parent_index_);
       if (expanded1.size() == c->inputs_[1].size() &&
           !FilesInCompaction(expanded1)) {
@@ -294,10 +314,10 @@ void CompactionPicker::SetupOtherInputs(Compaction* c) {
   }
 
   // Compute the set of grandparent files that overlap this compaction
-  // (parent == level+1; grandparent == level+2)
-  if (level + 2 < NumberLevels()) {
-    c->input_version_->GetOverlappingInputs(level + 2, &all_start, &all_limit,
-                                            &c->grandparents_);
+  // (parent == output_level; grandparent == output_level+1)
+  if (output_level + 1 < NumberLevels()) {
+    c->input_version_->GetOverlappingInputs(output_level + 1, &all_start,
+                                            &all_limit, &c->grandparents_);
   }
 }
 
@@ -321,13 +341,22 @@ Compaction* CompactionPicker::CompactRange(Version* version, int input_level,
     return nullptr;
   }
 
+  if (output_level == kCompactToBaseLevel) {
+    output_level = version->base_level();
+  }
+
   // Avoid compacting too much in one shot in case the range is large.
   // But we cannot do this for level-0 since level-0 files can overlap
   // and we must not pick one file and drop another older file if the
   // two files overlap.
+  // When the compaction is split into parallel key ranges, every range gets
+  // as much input as a whole step would get otherwise.
   if (input_level > 0) {
-    const uint64_t limit =
+    uint64_t limit =
         MaxFileSizeForLevel(input_level) * options_->source_compaction_factor;
+    if (CanSplitManualCompaction(*options_)) {
+      limit *= options_->max_background_compactions;
+    }
     uint64_t total = 0;
     for (size_t i = 0; i + 1 < inputs.size(); ++i) {
       uint64_t s = inputs[i]->file_size;
@@ -402,6 +431,65 @@ Compaction* LevelCompactionPicker::PickCompaction(Version* version,
     }
   }
 
+  // Then compact the files marked for compaction by their table properties
+  // collectors, e.g. because they are full of deletions.
+  for (size_t i = 0;
+       c == nullptr && i < version->files_marked_for_compaction_.size(); i++) {
+    level = version->files_marked_for_compaction_[i].first;
+    FileMetaData* f = version->files_marked_for_compaction_[i].second;
+    if (f->being_compacted ||
+        (level == 0 && !compactions_in_progress_[0].empty())) {
+      continue;
+    }
+    const int output_level = OutputLevel(version, level);
+    int parent_index = -1;
+    if (ParentRangeInCompaction(version, &f->smallest, &f->largest,
+                                output_level, &parent_index)) {
+      continue;
+    }
+    c = new Compaction(version, level, output_level,
+                       MaxFileSizeForLevel(output_level),
+                       MaxGrandParentOverlapBytes(level));
+    c->inputs_[0].push_back(f);
+    c->parent_index_ = parent_index;
+    if (ExpandWhileOverlapping(c) == false) {
+      delete c;
+      c = nullptr;
+    }
+  }
+
+  // Then rewrite the files that are older than periodic_compaction_seconds.
+  // Files of the last level are compacted into the last level again.
+  for (size_t i = 0;
+       c == nullptr &&
+       i < version->files_marked_for_periodic_compaction_.size();
+       i++) {
+    level = version->files_marked_for_periodic_compaction_[i].first;
+    FileMetaData* f = version->files_marked_for_periodic_compaction_[i].second;
+    if (f->being_compacted ||
+        (level == 0 && !compactions_in_progress_[0].empty())) {
+      continue;
+    }
+    const int output_level = level == NumberLevels() - 1
+                                 ? level
+                                 : OutputLevel(version, level);
+    int parent_index = -1;
+    if (ParentRangeInCompaction(version, &f->smallest, &f->largest,
+                                output_level, &parent_index)) {
+      continue;
+    }
+    c = new Compaction(version, level, output_level,
+                       MaxFileSizeForLevel(output_level),
+                       MaxGrandParentOverlapBytes(level));
+    c->inputs_[0].push_back(f);
+    c->parent_index_ = parent_index;
+    c->is_periodic_compaction_ = true;
+    if (ExpandWhileOverlapping(c) == false) {
+      delete c;
+      c = nullptr;
+    }
+  }
+
   // Find compactions needed by seeks
   FileMetaData* f = version->file_to_compact_;
   if (c == nullptr && f != nullptr && !f->being_compacted) {
@@ -410,12 +498,14 @@ Compaction* LevelCompactionPicker::PickCompaction(Version* version,
     int parent_index = -1;
 
     // Only allow one level 0 compaction at a time.
-    // Do not pick this file if its parents at level+1 are being compacted.
+    // Do not pick this file if its parents at the output level are being
+    // compacted.
     if (level != 0 || compactions_in_progress_[0].empty()) {
-      if (!ParentRangeInCompaction(version, &f->smallest, &f->largest, level,
-                                   &parent_index)) {
-        c = new Compaction(version, level, level + 1,
-                           MaxFileSizeForLevel(level + 1),
+      const int output_level = OutputLevel(version, level);
+      if (!ParentRangeInCompaction(version, &f->smallest, &f->largest,
+                                   output_level, &parent_index)) {
+        c = new Compaction(version, level, output_level,
+                           MaxFileSizeForLevel(output_level),
                            MaxGrandParentOverlapBytes(level), true);
         c->inputs_[0].push_back(f);
         c->parent_index_ = parent_index;
@@ -448,15 +538,15 @@ Compaction* LevelCompactionPicker::PickCompaction(Version* version,
     // cause the 'smallest' and 'largest' key to get extended to a
     // larger range. So, re-invoke GetRange to get the new key range
     GetRange(c->inputs_[0], &smallest, &largest);
-    if (ParentRangeInCompaction(c->input_version_, &smallest, &largest, level,
-                                &c->parent_index_)) {
+    if (ParentRangeInCompaction(c->input_version_, &smallest, &largest,
+                                c->output_level(), &c->parent_index_)) {
       delete c;
       return nullptr;
     }
     assert(!c->inputs_[0].empty());
   }
 
-  // Setup "level+1" files (inputs_[1])
+  // Setup output level files (inputs_[1])
   SetupOtherInputs(c);
 
   // mark all the files that are being compacted
@@ -471,6 +561,12 @@ Compaction* LevelCompactionPicker::PickCompaction(Version* version,
   return c;
 }
 
+int LevelCompactionPicker::OutputLevel(Version* version, int level) const {
+  // With dynamic level targets the levels above the base level are empty, so
+  // level-0 compacts straight into the base level.
+  return level == 0 ? version->base_level() : level + 1;
+}
+
 Compaction* LevelCompactionPicker::PickCompactionBySize(Version* version,
                                                         int level,
                                                         double score) {
@@ -486,7 +582,9 @@ Compaction* LevelCompactionPicker::PickCompactionBySize(Version* version,
 
   assert(level >= 0);
   assert(level + 1 < NumberLevels());
-  c = new Compaction(version, level, level + 1, MaxFileSizeForLevel(level + 1),
+  const int output_level = OutputLevel(version, level);
+  c = new Compaction(version, level, output_level,
+                     MaxFileSizeForLevel(output_level),
                      MaxGrandParentOverlapBytes(level));
   c->score_ = score;
 
@@ -503,7 +601,8 @@ Compaction* LevelCompactionPicker::PickCompactionBySize(Version* version,
     FileMetaData* f = c->input_version_->files_[level][index];
 
     // check to verify files are arranged in descending size
-    assert((i == file_size.size() - 1) ||
+    assert(options_->compaction_pri != kByLargestSize ||
+           (i == file_size.size() - 1) ||
            (i >= Version::number_of_files_to_sort_ - 1) ||
            (f->file_size >=
             c->input_version_->files_[level][file_size[i + 1]]->file_size));
@@ -519,11 +618,11 @@ Compaction* LevelCompactionPicker::PickCompactionBySize(Version* version,
       nextIndex = i;
     }
 
-    // Do not pick this file if its parents at level+1 are being compacted.
-    // Maybe we can avoid redoing this work in SetupOtherInputs
+    // Do not pick this file if its parents at the output level are being
+    // compacted. Maybe we can avoid redoing this work in SetupOtherInputs
     int parent_index = -1;
     if (ParentRangeInCompaction(c->input_version_, &f->smallest, &f->largest,
-                                level, &parent_index)) {
+                                output_level, &parent_index)) {
       continue;
     }
     c->inputs_[0].push_back(f);
@@ -543,24 +642,25 @@ Compaction* LevelCompactionPicker::PickCompactionBySize(Version* version,
   return c;
 }
 
-// Universal style of compaction. Pick files that are contiguous in
+// Universal style of compaction. Pick sorted runs that are contiguous in
 // time-range to compact.
 //
 Compaction* UniversalCompactionPicker::PickCompaction(Version* version,
                                                       LogBuffer* log_buffer) {
   int level = 0;
   double score = version->compaction_score_[0];
+  const size_t num_runs = version->sorted_runs_.size();
 
-  if ((version->files_[level].size() <
-       (unsigned int)options_->level0_file_num_compaction_trigger)) {
+  if (num_runs < (unsigned int)options_->level0_file_num_compaction_trigger) {
     LogToBuffer(log_buffer, "[%s] Universal: nothing to do\n",
                 version->cfd_->GetName().c_str());
     return nullptr;
   }
   Version::FileSummaryStorage tmp;
-  LogToBuffer(log_buffer, "[%s] Universal: candidate files(%zu): %s\n",
+  LogToBuffer(log_buffer,
+              "[%s] Universal: candidate files(%zu) in %zu sorted runs: %s\n",
               version->cfd_->GetName().c_str(), version->files_[level].size(),
-              version->LevelFileSummary(&tmp, 0));
+              num_runs, version->LevelFileSummary(&tmp, 0));
 
   // Check for size amplification first.
   Compaction* c;
@@ -581,9 +681,10 @@ Compaction* UniversalCompactionPicker::PickCompaction(Version* version,
       // Size amplification and file size ratios are within configured limits.
       // If max read amplification is exceeding configured limits, then force
       // compaction without looking at filesize ratios and try to reduce
-      // the number of files to fewer than level0_file_num_compaction_trigger.
-      unsigned int num_files = version->files_[level].size() -
-                               options_->level0_file_num_compaction_trigger;
+      // the number of sorted runs to fewer than
+      // level0_file_num_compaction_trigger.
+      unsigned int num_files =
+          num_runs - options_->level0_file_num_compaction_trigger;
       if ((c = PickCompactionUniversalReadAmp(
                version, score, UINT_MAX, num_files, log_buffer)) != nullptr) {
         LogToBuffer(log_buffer, "[%s] Universal: compacting for file num\n",
@@ -596,25 +697,21 @@ Compaction* UniversalCompactionPicker::PickCompaction(Version* version,
   }
   assert(c->inputs_[0].size() > 1);
 
-  // validate that all the chosen files are non overlapping in time
-  FileMetaData* newerfile __attribute__((unused)) = nullptr;
-  for (unsigned int i = 0; i < c->inputs_[0].size(); i++) {
+#ifndef NDEBUG
+  // validate that the chosen files whose key ranges overlap are non
+  // overlapping in time
+  const Comparator* ucmp = version->cfd_->user_comparator();
+  for (unsigned int i = 1; i < c->inputs_[0].size(); i++) {
+    FileMetaData* newerfile = c->inputs_[0][i - 1];
     FileMetaData* f = c->inputs_[0][i];
-    assert (f->smallest_seqno <= f->largest_seqno);
-    assert(newerfile == nullptr ||
-           newerfile->smallest_seqno > f->largest_seqno);
-    newerfile = f;
-  }
-
-  // The files are sorted from newest first to oldest last.
-  std::vector<int>& file_by_time = c->input_version_->files_by_size_[level];
-
-  // Is the earliest file part of this compaction?
-  int last_index = file_by_time[file_by_time.size()-1];
-  FileMetaData* last_file = c->input_version_->files_[level][last_index];
-  if (c->inputs_[0][c->inputs_[0].size()-1] == last_file) {
-    c->bottommost_level_ = true;
+    assert(f->smallest_seqno <= f->largest_seqno);
+    assert(newerfile->smallest_seqno > f->largest_seqno ||
+           ucmp->Compare(newerfile->smallest.user_key(),
+                         f->largest.user_key()) > 0 ||
+           ucmp->Compare(f->smallest.user_key(),
+                         newerfile->largest.user_key()) > 0);
   }
+#endif
 
   // update statistics
   MeasureTime(options_->statistics.get(), NUM_FILES_IN_SINGLE_COMPACTION,
@@ -634,9 +731,78 @@ Compaction* UniversalCompactionPicker::PickCompaction(Version* version,
   return c;
 }
 
+void UniversalCompactionPicker::AddSortedRuns(Version* version, size_t first,
+                                              size_t last, Compaction* c,
+                                              LogBuffer* log_buffer) {
+  const std::vector<Version::SortedRun>& runs = version->sorted_runs_;
+  const size_t first_file = runs[first].first;
+  std::vector<FileMetaData*> picked(
+      version->files_[0].begin() + first_file,
+      version->files_[0].begin() + runs[last - 1].last);
+
+  // Is the earliest sorted run part of this compaction? The files that are
+  // left in place below do not overlap any input, so they do not matter.
+  c->bottommost_level_ = (last == runs.size());
+
+  std::vector<bool> left_in_place(picked.size(), false);
+  if (options_->compaction_options_universal.partitioned_runs) {
+    // Leave the files that do not overlap any other picked file in place.
+    // In order of smallest key, a file overlaps an earlier file iff the
+    // largest key so far reaches it, and a later file iff it reaches the
+    // next one.
+    const Comparator* ucmp = version->cfd_->user_comparator();
+    std::vector<size_t> order(picked.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return ucmp->Compare(picked[a]->smallest.user_key(),
+                           picked[b]->smallest.user_key()) < 0;
+    });
+    Slice max_largest;
+    for (size_t k = 0; k < order.size(); k++) {
+      FileMetaData* f = picked[order[k]];
+      bool overlapping =
+          (k > 0 && ucmp->Compare(max_largest, f->smallest.user_key()) >= 0) ||
+          (k + 1 < order.size() &&
+           ucmp->Compare(f->largest.user_key(),
+                         picked[order[k + 1]]->smallest.user_key()) >= 0);
+      if (!overlapping) {
+        left_in_place[order[k]] = true;
+        c->grandparents_.push_back(f);
+      }
+      if (k == 0 || ucmp->Compare(f->largest.user_key(), max_largest) > 0) {
+        max_largest = f->largest.user_key();
+      }
+    }
+    // Cut the output files around the files left in place, so that no
+    // output file overlaps them.
+    if (!c->grandparents_.empty()) {
+      c->max_grandparent_overlap_bytes_ = 0;
+    }
+  }
+
+  for (size_t i = 0; i < picked.size(); i++) {
+    FileMetaData* f = picked[i];
+    if (left_in_place[i]) {
+      LogToBuffer(log_buffer,
+                  "[%s] Universal: Leaving file %lu[%zu] with size %lu in "
+                  "place\n",
+                  version->cfd_->GetName().c_str(), (unsigned long)f->number,
+                  first_file + i, (unsigned long)f->file_size);
+      continue;
+    }
+    c->inputs_[0].push_back(f);
+    LogToBuffer(log_buffer,
+                "[%s] Universal: Picking file %lu[%zu] with size %lu\n",
+                version->cfd_->GetName().c_str(), (unsigned long)f->number,
+                first_file + i, (unsigned long)f->file_size);
+  }
+}
+
 //
-// Consider compaction files based on their size differences with
-// the next file in time order.
+// Consider compaction sorted runs based on their size differences with
+// the next sorted run in time order.
 //
 Compaction* UniversalCompactionPicker::PickCompactionUniversalReadAmp(
     Version* version, double score, unsigned int ratio,
@@ -648,99 +814,99 @@ Compaction* UniversalCompactionPicker::PickCompactionUniversalReadAmp(
   unsigned int max_merge_width =
     options_->compaction_options_universal.max_merge_width;
 
-  // The files are sorted from newest first to oldest last.
-  std::vector<int>& file_by_time = version->files_by_size_[level];
-  FileMetaData* f = nullptr;
+  // The sorted runs are sorted from newest first to oldest last.
+  const std::vector<Version::SortedRun>& runs = version->sorted_runs_;
+  const Version::SortedRun* run = nullptr;
   bool done = false;
   int start_index = 0;
   unsigned int candidate_count = 0;
-  assert(file_by_time.size() == version->files_[level].size());
 
   unsigned int max_files_to_compact = std::min(max_merge_width,
                                        max_number_of_files_to_compact);
   min_merge_width = std::max(min_merge_width, 2U);
 
-  // Considers a candidate file only if it is smaller than the
+  // Considers a candidate run only if it is smaller than the
   // total size accumulated so far.
-  for (unsigned int loop = 0; loop < file_by_time.size(); loop++) {
+  for (unsigned int loop = 0; loop < runs.size(); loop++) {
 
     candidate_count = 0;
 
-    // Skip files that are already being compacted
-    for (f = nullptr; loop < file_by_time.size(); loop++) {
-      int index = file_by_time[loop];
-      f = version->files_[level][index];
+    // Skip runs that are already being compacted
+    for (run = nullptr; loop < runs.size(); loop++) {
+      run = &runs[loop];
 
-      if (!f->being_compacted) {
+      if (!version->SortedRunBeingCompacted(*run)) {
         candidate_count = 1;
         break;
       }
       LogToBuffer(
           log_buffer, "[%s] Universal: file %lu[%d] being compacted, skipping",
-          version->cfd_->GetName().c_str(), (unsigned long)f->number, loop);
-      f = nullptr;
+          version->cfd_->GetName().c_str(),
+          (unsigned long)version->files_[level][run->first]->number, loop);
+      run = nullptr;
     }
 
-    // This file is not being compacted. Consider it as the
+    // This run is not being compacted. Consider it as the
     // first candidate to be compacted.
-    uint64_t candidate_size =  f != nullptr? f->file_size : 0;
-    if (f != nullptr) {
+    uint64_t candidate_size = run != nullptr ? run->size : 0;
+    if (run != nullptr) {
       LogToBuffer(
           log_buffer, "[%s] Universal: Possible candidate file %lu[%d].",
-          version->cfd_->GetName().c_str(), (unsigned long)f->number, loop);
+          version->cfd_->GetName().c_str(),
+          (unsigned long)version->files_[level][run->first]->number, loop);
     }
 
-    // Check if the suceeding files need compaction.
+    // Check if the suceeding runs need compaction.
     for (unsigned int i = loop+1;
-         candidate_count < max_files_to_compact && i < file_by_time.size();
+         candidate_count < max_files_to_compact && i < runs.size();
          i++) {
-      int index = file_by_time[i];
-      FileMetaData* f = version->files_[level][index];
-      if (f->being_compacted) {
+      const Version::SortedRun& next = runs[i];
+      if (version->SortedRunBeingCompacted(next)) {
         break;
       }
-      // Pick files if the total/last candidate file size (increased by the
-      // specified ratio) is still larger than the next candidate file.
-      // candidate_size is the total size of files picked so far with the
+      // Pick runs if the total/last candidate run size (increased by the
+      // specified ratio) is still larger than the next candidate run.
+      // candidate_size is the total size of runs picked so far with the
       // default kCompactionStopStyleTotalSize; with
       // kCompactionStopStyleSimilarSize, it's simply the size of the last
-      // picked file.
+      // picked run.
       uint64_t sz = (candidate_size * (100L + ratio)) /100;
-      if (sz < f->file_size) {
+      if (sz < next.size) {
         break;
       }
       if (options_->compaction_options_universal.stop_style == kCompactionStopStyleSimilarSize) {
-        // Similar-size stopping rule: also check the last picked file isn't
-        // far larger than the next candidate file.
-        sz = (f->file_size * (100L + ratio)) / 100;
+        // Similar-size stopping rule: also check the last picked run isn't
+        // far larger than the next candidate run.
+        sz = (next.size * (100L + ratio)) / 100;
         if (sz < candidate_size) {
-          // If the small file we've encountered begins a run of similar-size
-          // files, we'll pick them up on a future iteration of the outer
+          // If the small run we've encountered begins a series of similar-size
+          // runs, we'll pick them up on a future iteration of the outer
           // loop. If it's some lonely straggler, it'll eventually get picked
           // by the last-resort read amp strategy which disregards size ratios.
           break;
         }
-        candidate_size = f->file_size;
+        candidate_size = next.size;
       } else { // default kCompactionStopStyleTotalSize
-        candidate_size += f->file_size;
+        candidate_size += next.size;
       }
       candidate_count++;
     }
 
-    // Found a series of consecutive files that need compaction.
+    // Found a series of consecutive runs that need compaction.
     if (candidate_count >= (unsigned int)min_merge_width) {
       start_index = loop;
       done = true;
       break;
     } else {
       for (unsigned int i = loop;
-           i < loop + candidate_count && i < file_by_time.size(); i++) {
-       int index = file_by_time[i];
-       FileMetaData* f = version->files_[level][index];
+           i < loop + candidate_count && i < runs.size(); i++) {
+       const Version::SortedRun& skipped = runs[i];
        LogToBuffer(log_buffer,
                    "[%s] Universal: Skipping file %lu[%d] with size %lu %d\n",
-                   version->cfd_->GetName().c_str(), (unsigned long)f->number,
-                   i, (unsigned long)f->file_size, f->being_compacted);
+                   version->cfd_->GetName().c_str(),
+                   (unsigned long)version->files_[level][skipped.first]->number,
+                   i, (unsigned long)skipped.size,
+                   version->SortedRunBeingCompacted(skipped));
       }
     }
   }
@@ -756,9 +922,8 @@ Compaction* UniversalCompactionPicker::PickCompactionUniversalReadAmp(
   if (ratio_to_compress >= 0) {
     uint64_t total_size = version->NumLevelBytes(level);
     uint64_t older_file_size = 0;
-    for (unsigned int i = file_by_time.size() - 1; i >= first_index_after;
-        i--) {
-      older_file_size += version->files_[level][file_by_time[i]]->file_size;
+    for (unsigned int i = runs.size() - 1; i >= first_index_after; i--) {
+      older_file_size += runs[i].size;
       if (older_file_size * 100L >= total_size * (long) ratio_to_compress) {
         enable_compression = false;
         break;
@@ -769,23 +934,14 @@ Compaction* UniversalCompactionPicker::PickCompactionUniversalReadAmp(
       new Compaction(version, level, level, MaxFileSizeForLevel(level),
                      LLONG_MAX, false, enable_compression);
   c->score_ = score;
-
-  for (unsigned int i = start_index; i < first_index_after; i++) {
-    int index = file_by_time[i];
-    FileMetaData* f = c->input_version_->files_[level][index];
-    c->inputs_[0].push_back(f);
-    LogToBuffer(log_buffer,
-                "[%s] Universal: Picking file %lu[%d] with size %lu\n",
-                version->cfd_->GetName().c_str(), (unsigned long)f->number, i,
-                (unsigned long)f->file_size);
-  }
+  AddSortedRuns(version, start_index, first_index_after, c, log_buffer);
   return c;
 }
 
 // Look at overall size amplification. If size amplification
 // exceeeds the configured value, then do a compaction
-// of the candidate files all the way upto the earliest
-// base file (overrides configured values of file-size ratios,
+// of the candidate runs all the way upto the earliest
+// base run (overrides configured values of file-size ratios,
 // min_merge_width and max_merge_width).
 //
 Compaction* UniversalCompactionPicker::PickCompactionUniversalSizeAmp(
@@ -796,59 +952,57 @@ Compaction* UniversalCompactionPicker::PickCompactionUniversalSizeAmp(
   uint64_t ratio = options_->compaction_options_universal.
                      max_size_amplification_percent;
 
-  // The files are sorted from newest first to oldest last.
-  std::vector<int>& file_by_time = version->files_by_size_[level];
-  assert(file_by_time.size() == version->files_[level].size());
+  // The sorted runs are sorted from newest first to oldest last.
+  const std::vector<Version::SortedRun>& runs = version->sorted_runs_;
 
   unsigned int candidate_count = 0;
   uint64_t candidate_size = 0;
   unsigned int start_index = 0;
-  FileMetaData* f = nullptr;
+  const Version::SortedRun* run = nullptr;
 
-  // Skip files that are already being compacted
-  for (unsigned int loop = 0; loop < file_by_time.size() - 1; loop++) {
-    int index = file_by_time[loop];
-    f = version->files_[level][index];
-    if (!f->being_compacted) {
+  // Skip runs that are already being compacted
+  for (unsigned int loop = 0; loop < runs.size() - 1; loop++) {
+    run = &runs[loop];
+    if (!version->SortedRunBeingCompacted(*run)) {
       start_index = loop;         // Consider this as the first candidate.
       break;
     }
     LogToBuffer(log_buffer,
                 "[%s] Universal: skipping file %lu[%d] compacted %s",
-                version->cfd_->GetName().c_str(), (unsigned long)f->number,
+                version->cfd_->GetName().c_str(),
+                (unsigned long)version->files_[level][run->first]->number,
                 loop, " cannot be a candidate to reduce size amp.\n");
-    f = nullptr;
+    run = nullptr;
   }
-  if (f == nullptr) {
-    return nullptr;             // no candidate files
+  if (run == nullptr) {
+    return nullptr;             // no candidate runs
   }
 
   LogToBuffer(log_buffer, "[%s] Universal: First candidate file %lu[%d] %s",
-              version->cfd_->GetName().c_str(), (unsigned long)f->number,
+              version->cfd_->GetName().c_str(),
+              (unsigned long)version->files_[level][run->first]->number,
               start_index, " to reduce size amp.\n");
 
-  // keep adding up all the remaining files
-  for (unsigned int loop = start_index; loop < file_by_time.size() - 1;
-       loop++) {
-    int index = file_by_time[loop];
-    f = version->files_[level][index];
-    if (f->being_compacted) {
+  // keep adding up all the remaining runs
+  for (unsigned int loop = start_index; loop < runs.size() - 1; loop++) {
+    run = &runs[loop];
+    if (version->SortedRunBeingCompacted(*run)) {
       LogToBuffer(
           log_buffer, "[%s] Universal: Possible candidate file %lu[%d] %s.",
-          version->cfd_->GetName().c_str(), (unsigned long)f->number, loop,
+          version->cfd_->GetName().c_str(),
+          (unsigned long)version->files_[level][run->first]->number, loop,
           " is already being compacted. No size amp reduction possible.\n");
       return nullptr;
     }
-    candidate_size += f->file_size;
+    candidate_size += run->size;
     candidate_count++;
   }
   if (candidate_count == 0) {
     return nullptr;
   }
 
-  // size of earliest file
-  int index = file_by_time[file_by_time.size() - 1];
-  uint64_t earliest_file_size = version->files_[level][index]->file_size;
+  // size of earliest run
+  uint64_t earliest_file_size = runs.back().size;
 
   // size amplification = percentage of additional size
   if (candidate_size * 100 < ratio * earliest_file_size) {
@@ -866,7 +1020,7 @@ Compaction* UniversalCompactionPicker::PickCompactionUniversalSizeAmp(
                 version->cfd_->GetName().c_str(), (unsigned long)candidate_size,
                 (unsigned long)earliest_file_size);
   }
-  assert(start_index >= 0 && start_index < file_by_time.size() - 1);
+  assert(start_index >= 0 && start_index < runs.size() - 1);
 
   // create a compaction request
   // We always compact all the files, so always compress.
@@ -874,15 +1028,7 @@ Compaction* UniversalCompactionPicker::PickCompactionUniversalSizeAmp(
       new Compaction(version, level, level, MaxFileSizeForLevel(level),
                      LLONG_MAX, false, true);
   c->score_ = score;
-  for (unsigned int loop = start_index; loop < file_by_time.size(); loop++) {
-    int index = file_by_time[loop];
-    f = c->input_version_->files_[level][index];
-    c->inputs_[0].push_back(f);
-    LogToBuffer(log_buffer,
-                "[%s] Universal: size amp picking file %lu[%d] with size %lu",
-                version->cfd_->GetName().c_str(), (unsigned long)f->number,
-                index, (unsigned long)f->file_size);
-  }
+  AddSortedRuns(version, start_index, runs.size(), c, log_buffer);
   return c;
 }
 
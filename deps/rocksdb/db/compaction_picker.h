@@ -24,6 +24,13 @@ class LogBuffer;
 class Compaction;
 class Version;
 
+// Whether the steps of a manual compaction with "options" are split into
+// key ranges that are compacted in parallel (see
+// DBOptions::parallel_manual_compaction). They are not when a single
+// compaction filter would be called from all ranges at once, or when a
+// CompactionFilterV2 may be used.
+extern bool CanSplitManualCompaction(const Options& options);
+
 class CompactionPicker {
  public:
   CompactionPicker(const Options* options, const InternalKeyComparator* icmp);
@@ -36,6 +43,11 @@ class CompactionPicker {
   virtual Compaction* PickCompaction(Version* version,
                                      LogBuffer* log_buffer) = 0;
 
+  // Passing kCompactToBaseLevel as the output level of CompactRange() compacts
+  // into the level that level-0 currently compacts into (see
+  // level_compaction_dynamic_level_bytes).
+  static const int kCompactToBaseLevel = -2;
+
   // Return a compaction object for compacting the range [begin,end] in
   // the specified level.  Returns nullptr if there is nothing in that
   // level that overlaps the specified range.  Caller should delete
@@ -102,9 +114,10 @@ class CompactionPicker {
   // Returns true if any one of the specified files are being compacted
   bool FilesInCompaction(std::vector<FileMetaData*>& files);
 
-  // Returns true if any one of the parent files are being compacted
+  // Returns true if any one of the files in "output_level" that overlap
+  // [smallest, largest] are being compacted
   bool ParentRangeInCompaction(Version* version, const InternalKey* smallest,
-                               const InternalKey* largest, int level,
+                               const InternalKey* largest, int output_level,
                                int* index);
 
   void SetupOtherInputs(Compaction* c);
@@ -144,6 +157,12 @@ class UniversalCompactionPicker : public CompactionPicker {
   // Pick Universal compaction to limit space amplification.
   Compaction* PickCompactionUniversalSizeAmp(Version* version, double score,
                                              LogBuffer* log_buffer);
+
+  // Add the files of the sorted runs [first, last) of "version" to the
+  // inputs of "c". With partitioned_runs, the files that do not overlap any
+  // other file of these runs are left out.
+  void AddSortedRuns(Version* version, size_t first, size_t last,
+                     Compaction* c, LogBuffer* log_buffer);
 };
 
 class LevelCompactionPicker : public CompactionPicker {
@@ -160,6 +179,9 @@ class LevelCompactionPicker : public CompactionPicker {
   // If level is 0 and there is already a compaction on that level, this
   // function will return nullptr.
   Compaction* PickCompactionBySize(Version* version, int level, double score);
+
+  // Returns the level that a compaction of "level" writes to.
+  int OutputLevel(Version* version, int level) const;
 };
 
 }  // namespace rocksdb
@@ -0,0 +1,333 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <string>
+
+#include "db/db_impl.h"
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/table.h"
+#include "rocksdb/table_properties.h"
+#include "table/cuckoo_table_factory.h"
+#include "utilities/merge_operators.h"
+#include "util/coding.h"
+#include "util/logging.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace rocksdb {
+
+class CuckooTableDBTest {
+ protected:
+  std::string dbname_;
+  Env* env_;
+  DB* db_;
+
+ public:
+  CuckooTableDBTest() : env_(Env::Default()) {
+    dbname_ = test::TmpDir() + "/cuckoo_table_db_test";
+    ASSERT_OK(DestroyDB(dbname_, Options()));
+    db_ = nullptr;
+    Reopen();
+  }
+
+  ~CuckooTableDBTest() {
+    delete db_;
+    ASSERT_OK(DestroyDB(dbname_, Options()));
+  }
+
+  Options CurrentOptions() {
+    Options options;
+    options.table_factory.reset(NewCuckooTableFactory());
+    options.allow_mmap_reads = true;
+    options.create_if_missing = true;
+    return options;
+  }
+
+  DBImpl* dbfull() {
+    return reinterpret_cast<DBImpl*>(db_);
+  }
+
+  void Reopen(Options* options = nullptr) {
+    delete db_;
+    db_ = nullptr;
+    Options opts = options != nullptr ? *options : CurrentOptions();
+    ASSERT_OK(DB::Open(opts, dbname_, &db_));
+  }
+
+  void DestroyAndReopen(Options* options = nullptr) {
+    delete db_;
+    db_ = nullptr;
+    ASSERT_OK(DestroyDB(dbname_, Options()));
+    Reopen(options);
+  }
+
+  Status Put(const Slice& k, const Slice& v) {
+    return db_->Put(WriteOptions(), k, v);
+  }
+
+  Status Delete(const std::string& k) {
+    return db_->Delete(WriteOptions(), k);
+  }
+
+  std::string Get(const std::string& k, const Snapshot* snapshot = nullptr) {
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::string result;
+    Status s = db_->Get(options, k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  int NumTableFilesAtLevel(int level) {
+    std::string property;
+    ASSERT_TRUE(
+        db_->GetProperty("rocksdb.num-files-at-level" + NumberToString(level),
+                         &property));
+    return atoi(property.c_str());
+  }
+
+  // Return the properties of the only table file of the DB.
+  std::shared_ptr<const TableProperties> GetOnlyTableProperties() {
+    TablePropertiesCollection ptc;
+    db_->GetPropertiesOfAllTables(&ptc);
+    ASSERT_EQ(1U, ptc.size());
+    return ptc.begin()->second;
+  }
+};
+
+namespace {
+std::string Key(int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "key_______%06d", i);
+  return std::string(buf);
+}
+
+std::string Uint64Property(const TableProperties& props,
+                           const std::string& name) {
+  Slice raw_val(props.user_collected_properties.at(name));
+  uint64_t val = 0;
+  GetVarint64(&raw_val, &val);
+  return NumberToString(val);
+}
+}  // namespace
+
+TEST(CuckooTableDBTest, Flush) {
+  ASSERT_OK(Put("key1", "v1"));
+  ASSERT_OK(Put("key2", "v2"));
+  ASSERT_OK(Put("key3", "v3"));
+  dbfull()->TEST_FlushMemTable();
+
+  auto props = GetOnlyTableProperties();
+  ASSERT_EQ(3U, props->num_entries);
+  ASSERT_EQ(4U, props->fixed_key_len);
+  ASSERT_EQ("2", Uint64Property(*props, CuckooTablePropertyNames::kValueLength));
+  ASSERT_EQ("0", Uint64Property(*props, CuckooTablePropertyNames::kIsLastLevel));
+
+  ASSERT_EQ("v1", Get("key1"));
+  ASSERT_EQ("v2", Get("key2"));
+  ASSERT_EQ("v3", Get("key3"));
+  ASSERT_EQ("NOT_FOUND", Get("key4"));
+  ASSERT_EQ("NOT_FOUND", Get("key"));
+
+  // The empty buckets hold a key that is not in the table.
+  const std::string empty_key =
+      props->user_collected_properties.at(CuckooTablePropertyNames::kEmptyKey);
+  ASSERT_EQ(4U, empty_key.size());
+  ASSERT_EQ("NOT_FOUND", Get(empty_key));
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("key1", iter->key().ToString());
+  iter->Next();
+  ASSERT_EQ("key2", iter->key().ToString());
+  iter->Next();
+  ASSERT_EQ("key3", iter->key().ToString());
+  ASSERT_EQ("v3", iter->value().ToString());
+  iter->Next();
+  ASSERT_TRUE(!iter->Valid());
+  iter->Seek("key2");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("key2", iter->key().ToString());
+  iter->Prev();
+  ASSERT_EQ("key1", iter->key().ToString());
+  delete iter;
+}
+
+TEST(CuckooTableDBTest, OverwriteAndDelete) {
+  ASSERT_OK(Put("key1", "v1"));
+  ASSERT_OK(Put("key2", "v2"));
+  dbfull()->TEST_FlushMemTable();
+  const Snapshot* snapshot = db_->GetSnapshot();
+
+  ASSERT_OK(Put("key1", "v3"));
+  ASSERT_OK(Delete("key2"));
+  dbfull()->TEST_FlushMemTable();
+
+  ASSERT_EQ("v3", Get("key1"));
+  ASSERT_EQ("NOT_FOUND", Get("key2"));
+  ASSERT_EQ("v1", Get("key1", snapshot));
+  ASSERT_EQ("v2", Get("key2", snapshot));
+  db_->ReleaseSnapshot(snapshot);
+
+  // The deletion is dropped by a compaction to the last level.
+  dbfull()->CompactRange(nullptr, nullptr);
+  ASSERT_EQ("v3", Get("key1"));
+  ASSERT_EQ("NOT_FOUND", Get("key2"));
+}
+
+TEST(CuckooTableDBTest, CompactionIntoLastLevel) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100 << 10;  // 100KB
+  DestroyAndReopen(&options);
+
+  // Enough keys to make insertion displace entries. Two files with
+  // overlapping key ranges make the compaction rewrite them.
+  const int kNumKeys = 20000;
+  for (int parity = 0; parity < 2; parity++) {
+    for (int i = parity; i < kNumKeys; i += 2) {
+      ASSERT_OK(Put(Key(i), Key(i * 7)));
+    }
+    dbfull()->TEST_FlushMemTable();
+  }
+  dbfull()->CompactRange(nullptr, nullptr);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+
+  // The newest entry keeps its sequence number until a later write, here to
+  // another column family. The next compaction into the last level zeroes
+  // all sequence numbers, and its output stores user keys.
+  ColumnFamilyHandle* handle;
+  ASSERT_OK(db_->CreateColumnFamily(ColumnFamilyOptions(), "other", &handle));
+  ASSERT_OK(db_->Put(WriteOptions(), handle, "key", "value"));
+  delete handle;
+  dbfull()->CompactRange(nullptr, nullptr);
+  TablePropertiesCollection ptc;
+  db_->GetPropertiesOfAllTables(&ptc);
+  ASSERT_GT(ptc.size(), 0U);
+  for (const auto& row : ptc) {
+    ASSERT_EQ("1", Uint64Property(*row.second,
+                                  CuckooTablePropertyNames::kIsLastLevel));
+  }
+
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_EQ(Key(i * 7), Get(Key(i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Get(Key(kNumKeys)));
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(kNumKeys, count);
+  delete iter;
+}
+
+TEST(CuckooTableDBTest, VariableLengthValues) {
+  // Values of different lengths cannot be stored in a cuckoo table, so the
+  // file is written as a block-based table.
+  ASSERT_OK(Put("key1", "v1"));
+  ASSERT_OK(Put("key2", "value2"));
+  ASSERT_OK(dbfull()->TEST_FlushMemTable());
+  auto props = GetOnlyTableProperties();
+  ASSERT_EQ(0U, props->user_collected_properties.count(
+                    CuckooTablePropertyNames::kEmptyKey));
+
+  Reopen();
+  ASSERT_EQ("v1", Get("key1"));
+  ASSERT_EQ("value2", Get("key2"));
+  ASSERT_EQ("NOT_FOUND", Get("key3"));
+  ASSERT_OK(Put("key3", "v3"));
+  ASSERT_OK(dbfull()->TEST_FlushMemTable());
+  ASSERT_EQ("v3", Get("key3"));
+}
+
+TEST(CuckooTableDBTest, SeveralEntriesOfAUserKey) {
+  // The older entries kept for the snapshot and the merge operands are
+  // written to a block-based table as well.
+  Options options = CurrentOptions();
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  DestroyAndReopen(&options);
+  ASSERT_OK(Put("key1", "v1"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("key1", "v2"));
+  ASSERT_OK(db_->Merge(WriteOptions(), "key2", "a"));
+  ASSERT_OK(db_->Merge(WriteOptions(), "key2", "b"));
+  ASSERT_OK(dbfull()->TEST_FlushMemTable());
+  ASSERT_EQ("v2", Get("key1"));
+  ASSERT_EQ("v1", Get("key1", snapshot));
+  ASSERT_EQ("a,b", Get("key2"));
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST(CuckooTableDBTest, RequiresMmapReads) {
+  ASSERT_OK(Put("key1", "v1"));
+  dbfull()->TEST_FlushMemTable();
+
+  Options options = CurrentOptions();
+  options.allow_mmap_reads = false;
+  Reopen(&options);
+  std::string value;
+  ASSERT_TRUE(db_->Get(ReadOptions(), "key1", &value).IsNotSupported());
+}
+
+namespace {
+// Opens files that read into the caller's buffer, whatever the options say.
+class CopyingEnv : public EnvWrapper {
+ public:
+  explicit CopyingEnv(Env* target) : EnvWrapper(target) {}
+
+  virtual Status NewRandomAccessFile(const std::string& fname,
+                                     unique_ptr<RandomAccessFile>* result,
+                                     const EnvOptions& options) override {
+    class CopyingFile : public RandomAccessFile {
+     public:
+      explicit CopyingFile(unique_ptr<RandomAccessFile>&& target)
+          : target_(std::move(target)) {}
+      virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                          char* scratch) const override {
+        return target_->Read(offset, n, result, scratch);
+      }
+
+     private:
+      unique_ptr<RandomAccessFile> target_;
+    };
+
+    unique_ptr<RandomAccessFile> file;
+    Status s = target()->NewRandomAccessFile(fname, &file, options);
+    if (s.ok()) {
+      result->reset(new CopyingFile(std::move(file)));
+    }
+    return s;
+  }
+};
+}  // namespace
+
+TEST(CuckooTableDBTest, RequiresReadsInPlace) {
+  ASSERT_OK(Put("key1", "v1"));
+  dbfull()->TEST_FlushMemTable();
+
+  // allow_mmap_reads is set, but the file does not read in place.
+  CopyingEnv env(Env::Default());
+  Options options = CurrentOptions();
+  options.env = &env;
+  Reopen(&options);
+  std::string value;
+  ASSERT_TRUE(db_->Get(ReadOptions(), "key1", &value).IsNotSupported());
+  delete db_;
+  db_ = nullptr;
+}
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  return rocksdb::test::RunAllTests();
+}
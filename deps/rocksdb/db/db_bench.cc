@@ -36,6 +36,8 @@ int main() {
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/perf_context.h"
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/persistent_cache.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
 #include "util/crc32c.h"
@@ -148,6 +150,9 @@ DEFINE_int64(reads, -1, "Number of read operations to do.  "
 
 DEFINE_int32(bloom_locality, 0, "Control bloom filter probes locality");
 
+DEFINE_bool(use_blocked_bloom_filter, false, "Use the cache-line-blocked "
+            "bloom filter policy for SST files");
+
 DEFINE_int64(seed, 0, "Seed base for random number generators. "
              "When 0 it is deterministic.");
 
@@ -197,6 +202,16 @@ DEFINE_int32(max_background_compactions,
              "The maximum number of concurrent background compactions"
              " that can occur in parallel.");
 
+DEFINE_int32(max_subcompactions,
+             rocksdb::Options().max_subcompactions,
+             "The maximum number of threads a single level-0 compaction"
+             " is split into.");
+
+DEFINE_bool(parallel_manual_compaction,
+            rocksdb::Options().parallel_manual_compaction,
+            "Split manual compactions into max_background_compactions"
+            " key ranges that are compacted in parallel.");
+
 DEFINE_int32(max_background_flushes,
              rocksdb::Options().max_background_flushes,
              "The maximum number of concurrent background flushes"
@@ -206,6 +221,26 @@ static rocksdb::CompactionStyle FLAGS_compaction_style_e;
 DEFINE_int32(compaction_style, (int32_t) rocksdb::Options().compaction_style,
              "style of compaction: level-based vs universal");
 
+static rocksdb::CompactionPri FLAGS_compaction_pri_e;
+DEFINE_int32(compaction_pri, (int32_t) rocksdb::Options().compaction_pri,
+             "order in which files of a level are compacted: 0 = largest "
+             "size, 1 = oldest smallest seqno, 2 = min overlapping ratio");
+
+DEFINE_int32(deletion_compaction_window,
+             rocksdb::Options().deletion_compaction_window,
+             "Number of consecutive entries in which deletions are counted"
+             " to mark a table file for compaction. 0 disables marking.");
+
+DEFINE_int32(deletion_compaction_trigger,
+             rocksdb::Options().deletion_compaction_trigger,
+             "Number of deletions within deletion_compaction_window entries"
+             " that marks a table file for compaction.");
+
+DEFINE_uint64(periodic_compaction_seconds,
+              rocksdb::Options().periodic_compaction_seconds,
+              "Compact table files written more than this many seconds ago."
+              " 0 disables periodic compaction.");
+
 DEFINE_int32(universal_size_ratio, 0,
              "Percentage flexibility while comparing file size"
              " (for universal compaction only).");
@@ -223,6 +258,10 @@ DEFINE_int32(universal_compression_size_percent, -1,
              "The percentage of the database to compress for universal "
              "compaction. -1 means compress everything.");
 
+DEFINE_bool(universal_partitioned_runs, false,
+            "Cut universal compaction output into target_file_size_base files"
+            " and count key-disjoint files as a single sorted run.");
+
 DEFINE_int64(cache_size, -1, "Number of bytes to use as a cache of uncompressed"
              "data. Negative means use default settings.");
 
@@ -232,10 +271,26 @@ DEFINE_int32(block_size, rocksdb::Options().block_size,
 DEFINE_int64(compressed_cache_size, -1,
              "Number of bytes to use as a cache of compressed data.");
 
+DEFINE_int64(persistent_cache_size, 0, "Number of bytes to use as a cache"
+             " of data blocks in --persistent_cache_path. 0 means no"
+             " persistent cache.");
+
+DEFINE_string(persistent_cache_path, "", "Directory of the persistent cache,"
+              " e.g. on a local SSD.");
+
 DEFINE_int32(open_files, rocksdb::Options().max_open_files,
              "Maximum number of files to keep open at the same time"
              " (use default if == 0)");
 
+DEFINE_bool(preload_table_files_on_open,
+            rocksdb::Options().preload_table_files_on_open,
+            "Open the live table files when the DB is opened");
+
+DEFINE_int32(max_file_opening_threads,
+             rocksdb::Options().max_file_opening_threads,
+             "Number of threads that open the table files when the DB is"
+             " opened");
+
 DEFINE_int32(bloom_bits, -1, "Bloom filter bits per key. Negative means"
              " use default settings.");
 DEFINE_int32(memtable_bloom_bits, 0, "Bloom filter bits per key for memtable. "
@@ -296,6 +351,10 @@ DEFINE_uint64(max_bytes_for_level_base,  10 * 1048576, "Max bytes for level-1");
 DEFINE_int32(max_bytes_for_level_multiplier, 10,
              "A multiplier to compute max bytes for level-N (N >= 2)");
 
+DEFINE_bool(level_compaction_dynamic_level_bytes,
+            rocksdb::Options().level_compaction_dynamic_level_bytes,
+            "Derive level size targets from the size of the last level");
+
 static std::vector<int> FLAGS_max_bytes_for_level_multiplier_additional_v;
 DEFINE_string(max_bytes_for_level_multiplier_additional, "",
               "A vector that specifies additional fanout per level");
@@ -356,6 +415,8 @@ enum rocksdb::CompressionType StringToCompressionType(const char* ctype) {
     return rocksdb::kLZ4Compression;
   else if (!strcasecmp(ctype, "lz4hc"))
     return rocksdb::kLZ4HCCompression;
+  else if (!strcasecmp(ctype, "zstd"))
+    return rocksdb::kZSTDCompression;
 
   fprintf(stdout, "Cannot parse compression type '%s'\n", ctype);
   return rocksdb::kSnappyCompression; //default value
@@ -368,12 +429,12 @@ static enum rocksdb::CompressionType FLAGS_compression_type_e =
     rocksdb::kSnappyCompression;
 
 DEFINE_int32(compression_level, -1,
-             "Compression level. For zlib this should be -1 for the "
-             "default level, or between 0 and 9.");
+             "Compression level. This should be -1 for the default level, "
+             "or between 0 and 9 for zlib and between 1 and 22 for zstd.");
 
 static bool ValidateCompressionLevel(const char* flagname, int32_t value) {
-  if (value < -1 || value > 9) {
-    fprintf(stderr, "Invalid value for --%s: %d, must be between -1 and 9\n",
+  if (value < -1 || value > 22) {
+    fprintf(stderr, "Invalid value for --%s: %d, must be between -1 and 22\n",
             flagname, value);
     return false;
   }
@@ -383,6 +444,19 @@ static bool ValidateCompressionLevel(const char* flagname, int32_t value) {
 static const bool FLAGS_compression_level_dummy __attribute__((unused)) =
     RegisterFlagValidator(&FLAGS_compression_level, &ValidateCompressionLevel);
 
+static std::vector<int> FLAGS_compression_level_per_level_v;
+DEFINE_string(compression_level_per_level, "",
+              "A comma-separated list of the compression levels of the "
+              "compaction outputs of each level, overriding "
+              "--compression_level");
+
+DEFINE_int32(compression_parallel_threads, 1, "Number of threads that"
+             " compress the data blocks of each table file being built.");
+
+DEFINE_int32(compression_max_dict_bytes, 0, "Maximum size of the dictionary"
+             " sampled from each table file to compress its data blocks with."
+             " Only used with zlib.");
+
 DEFINE_int32(min_level_to_compress, -1, "If non-negative, compression starts"
              " from this level. Levels with number < min_level_to_compress are"
              " not compressed. Otherwise, apply compression_type to "
@@ -455,6 +529,12 @@ DEFINE_bool(mmap_read, rocksdb::EnvOptions().use_mmap_reads,
 DEFINE_bool(mmap_write, rocksdb::EnvOptions().use_mmap_writes,
             "Allow writes to occur via mmap-ing files");
 
+DEFINE_bool(use_direct_reads, rocksdb::Options().use_direct_reads,
+            "Read sst files with O_DIRECT");
+
+DEFINE_bool(use_direct_writes, rocksdb::Options().use_direct_writes,
+            "Write flush and compaction outputs with O_DIRECT");
+
 DEFINE_bool(advise_random_on_open, rocksdb::Options().advise_random_on_open,
             "Advise random access on table file open");
 
@@ -473,6 +553,10 @@ DEFINE_uint64(bytes_per_sync,  rocksdb::Options().bytes_per_sync,
               "Allows OS to incrementally sync files to disk while they are"
               " being written, in the background. Issue one request for every"
               " bytes_per_sync written. 0 turns it off.");
+
+DEFINE_uint64(rate_limiter_bytes_per_sec, 0, "Limit the write rate of flush"
+              " and compaction to this many bytes per second. 0 means no"
+              " limit.");
 DEFINE_bool(filter_deletes, false, " On true, deletes use bloom-filter and drop"
             " the delete if key not present");
 
@@ -526,6 +610,16 @@ DEFINE_string(memtablerep, "skip_list", "");
 DEFINE_int64(hash_bucket_count, 1024 * 1024, "hash bucket count");
 DEFINE_bool(use_plain_table, false, "if use plain table "
             "instead of block-based table format");
+DEFINE_bool(data_block_hash_index, false, "Add a hash map from user keys to "
+            "restart intervals to the data blocks of block based tables, "
+            "used by point lookups");
+DEFINE_bool(bypass_block_cache_for_mmap_reads, false, "With --mmap_read, "
+            "do not look up the data blocks of block based tables in the "
+            "block cache");
+DEFINE_bool(delta_encoded_index, false, "Use delta encoded index blocks "
+            "(kDeltaEncodedBinarySearch) in block based tables");
+DEFINE_int32(index_block_restart_interval, 16, "Number of index entries "
+             "between restart points of delta encoded index blocks");
 
 DEFINE_string(merge_operator, "", "The merge operator to use with the database."
               "If a new merge operator is specified, be sure to use fresh"
@@ -820,6 +914,7 @@ class Benchmark {
  private:
   shared_ptr<Cache> cache_;
   shared_ptr<Cache> compressed_cache_;
+  shared_ptr<PersistentCache> persistent_cache_;
   const FilterPolicy* filter_policy_;
   const SliceTransform* prefix_extractor_;
   DB* db_;
@@ -871,6 +966,9 @@ class Benchmark {
       case rocksdb::kLZ4HCCompression:
         fprintf(stdout, "Compression: lz4hc\n");
         break;
+      case rocksdb::kZSTDCompression:
+        fprintf(stdout, "Compression: zstd\n");
+        break;
     }
 
     switch (FLAGS_rep_factory) {
@@ -942,6 +1040,11 @@ class Benchmark {
                                         strlen(text), &compressed);
           name = "LZ4HC";
           break;
+        case kZSTDCompression:
+          result = port::ZSTD_Compress(Options().compression_opts, text,
+                                       strlen(text), &compressed);
+          name = "ZSTD";
+          break;
         case kNoCompression:
           assert(false); // cannot happen
           break;
@@ -1019,7 +1122,9 @@ class Benchmark {
             NewLRUCache(FLAGS_compressed_cache_size, FLAGS_cache_numshardbits) :
             NewLRUCache(FLAGS_compressed_cache_size)) : nullptr),
     filter_policy_(FLAGS_bloom_bits >= 0
-                   ? NewBloomFilterPolicy(FLAGS_bloom_bits)
+                   ? (FLAGS_use_blocked_bloom_filter
+                      ? NewBlockedBloomFilterPolicy(FLAGS_bloom_bits)
+                      : NewBloomFilterPolicy(FLAGS_bloom_bits))
                    : nullptr),
     prefix_extractor_(NewFixedPrefixTransform(FLAGS_prefix_size)),
     db_(nullptr),
@@ -1453,6 +1558,10 @@ class Benchmark {
         ok = port::LZ4HC_Compress(Options().compression_opts, input.data(),
                                   input.size(), &compressed);
         break;
+      case rocksdb::kZSTDCompression:
+        ok = port::ZSTD_Compress(Options().compression_opts, input.data(),
+                                 input.size(), &compressed);
+        break;
       default:
         ok = false;
       }
@@ -1499,6 +1608,10 @@ class Benchmark {
       ok = port::LZ4HC_Compress(Options().compression_opts, input.data(),
                                 input.size(), &compressed);
       break;
+    case rocksdb::kZSTDCompression:
+      ok = port::ZSTD_Compress(Options().compression_opts, input.data(),
+                               input.size(), &compressed);
+      break;
     default:
       ok = false;
     }
@@ -1534,6 +1647,11 @@ class Benchmark {
             compressed.data(), compressed.size(), &decompress_size);
         ok = uncompressed != nullptr;
         break;
+      case rocksdb::kZSTDCompression:
+        uncompressed = port::ZSTD_Uncompress(
+            compressed.data(), compressed.size(), &decompress_size);
+        ok = uncompressed != nullptr;
+        break;
       default:
         ok = false;
       }
@@ -1555,6 +1673,21 @@ class Benchmark {
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
     options.block_cache_compressed = compressed_cache_;
+    if (FLAGS_persistent_cache_size > 0 && persistent_cache_ == nullptr) {
+      if (FLAGS_persistent_cache_path.empty()) {
+        fprintf(stderr, "--persistent_cache_size needs "
+                "--persistent_cache_path\n");
+        exit(1);
+      }
+      Status s = NewPersistentCache(FLAGS_env, FLAGS_persistent_cache_path,
+                                    FLAGS_persistent_cache_size,
+                                    &persistent_cache_);
+      if (!s.ok()) {
+        fprintf(stderr, "persistent cache: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+    }
+    options.persistent_cache = persistent_cache_;
     if (cache_ == nullptr) {
       options.no_block_cache = true;
     }
@@ -1563,8 +1696,14 @@ class Benchmark {
     options.min_write_buffer_number_to_merge =
       FLAGS_min_write_buffer_number_to_merge;
     options.max_background_compactions = FLAGS_max_background_compactions;
+    options.max_subcompactions = FLAGS_max_subcompactions;
+    options.parallel_manual_compaction = FLAGS_parallel_manual_compaction;
     options.max_background_flushes = FLAGS_max_background_flushes;
     options.compaction_style = FLAGS_compaction_style_e;
+    options.compaction_pri = FLAGS_compaction_pri_e;
+    options.deletion_compaction_window = FLAGS_deletion_compaction_window;
+    options.deletion_compaction_trigger = FLAGS_deletion_compaction_trigger;
+    options.periodic_compaction_seconds = FLAGS_periodic_compaction_seconds;
     options.block_size = FLAGS_block_size;
     options.filter_policy = filter_policy_;
     if (FLAGS_use_plain_table) {
@@ -1574,6 +1713,8 @@ class Benchmark {
     options.memtable_prefix_bloom_bits = FLAGS_memtable_bloom_bits;
     options.bloom_locality = FLAGS_bloom_locality;
     options.max_open_files = FLAGS_open_files;
+    options.preload_table_files_on_open = FLAGS_preload_table_files_on_open;
+    options.max_file_opening_threads = FLAGS_max_file_opening_threads;
     options.statistics = dbstats;
     options.env = FLAGS_env;
     options.disableDataSync = FLAGS_disable_data_sync;
@@ -1585,6 +1726,8 @@ class Benchmark {
     options.max_bytes_for_level_base = FLAGS_max_bytes_for_level_base;
     options.max_bytes_for_level_multiplier =
         FLAGS_max_bytes_for_level_multiplier;
+    options.level_compaction_dynamic_level_bytes =
+        FLAGS_level_compaction_dynamic_level_bytes;
     options.filter_deletes = FLAGS_filter_deletes;
     if ((FLAGS_prefix_size == 0) && (FLAGS_rep_factory == kPrefixHash ||
                                      FLAGS_rep_factory == kHashLinkedList)) {
@@ -1619,17 +1762,28 @@ class Benchmark {
           FLAGS_rep_factory != kHashLinkedList) {
         fprintf(stderr, "Waring: plain table is used with skipList\n");
       }
-      if (!FLAGS_mmap_read && !FLAGS_mmap_write) {
-        fprintf(stderr, "plain table format requires mmap to operate\n");
-        exit(1);
-      }
-
       int bloom_bits_per_key = FLAGS_bloom_bits;
       if (bloom_bits_per_key < 0) {
         bloom_bits_per_key = 0;
       }
       options.table_factory = std::shared_ptr<TableFactory>(
           NewPlainTableFactory(FLAGS_key_size, bloom_bits_per_key, 0.75));
+    } else if (FLAGS_data_block_hash_index || FLAGS_delta_encoded_index ||
+               FLAGS_bypass_block_cache_for_mmap_reads) {
+      BlockBasedTableOptions table_options;
+      table_options.bypass_block_cache_for_mmap_reads =
+          FLAGS_bypass_block_cache_for_mmap_reads;
+      if (FLAGS_data_block_hash_index) {
+        table_options.data_block_index_type =
+            BlockBasedTableOptions::kDataBlockBinaryAndHash;
+      }
+      if (FLAGS_delta_encoded_index) {
+        table_options.index_type =
+            BlockBasedTableOptions::kDeltaEncodedBinarySearch;
+        table_options.index_block_restart_interval =
+            FLAGS_index_block_restart_interval;
+      }
+      options.table_factory.reset(NewBlockBasedTableFactory(table_options));
     }
     if (FLAGS_max_bytes_for_level_multiplier_additional_v.size() > 0) {
       if (FLAGS_max_bytes_for_level_multiplier_additional_v.size() !=
@@ -1648,6 +1802,9 @@ class Benchmark {
       FLAGS_level0_slowdown_writes_trigger;
     options.compression = FLAGS_compression_type_e;
     options.compression_opts.level = FLAGS_compression_level;
+    options.compression_opts.parallel_threads =
+        FLAGS_compression_parallel_threads;
+    options.compression_opts.max_dict_bytes = FLAGS_compression_max_dict_bytes;
     options.WAL_ttl_seconds = FLAGS_wal_ttl_seconds;
     options.WAL_size_limit_MB = FLAGS_wal_size_limit_MB;
     if (FLAGS_min_level_to_compress >= 0) {
@@ -1661,6 +1818,7 @@ class Benchmark {
         options.compression_per_level[i] = FLAGS_compression_type_e;
       }
     }
+    options.compression_level_per_level = FLAGS_compression_level_per_level_v;
     options.disable_seek_compaction = FLAGS_disable_seek_compaction;
     options.delete_obsolete_files_period_micros =
       FLAGS_delete_obsolete_files_period_micros;
@@ -1678,10 +1836,16 @@ class Benchmark {
     options.allow_os_buffer = FLAGS_bufferedio;
     options.allow_mmap_reads = FLAGS_mmap_read;
     options.allow_mmap_writes = FLAGS_mmap_write;
+    options.use_direct_reads = FLAGS_use_direct_reads;
+    options.use_direct_writes = FLAGS_use_direct_writes;
     options.advise_random_on_open = FLAGS_advise_random_on_open;
     options.access_hint_on_compaction_start = FLAGS_compaction_fadvice_e;
     options.use_adaptive_mutex = FLAGS_use_adaptive_mutex;
     options.bytes_per_sync = FLAGS_bytes_per_sync;
+    if (FLAGS_rate_limiter_bytes_per_sec > 0) {
+      options.rate_limiter.reset(
+          NewGenericRateLimiter(FLAGS_rate_limiter_bytes_per_sec));
+    }
 
     // merge operator options
     options.merge_operator = MergeOperators::CreateFromStringId(
@@ -1714,6 +1878,8 @@ class Benchmark {
       options.compaction_options_universal.compression_size_percent =
         FLAGS_universal_compression_size_percent;
     }
+    options.compaction_options_universal.partitioned_runs =
+        FLAGS_universal_partitioned_runs;
 
     if (FLAGS_num_multi_db <= 1) {
       OpenDb(options, FLAGS_db, &db_);
@@ -2566,6 +2732,7 @@ int main(int argc, char** argv) {
   ParseCommandLineFlags(&argc, &argv, true);
 
   FLAGS_compaction_style_e = (rocksdb::CompactionStyle) FLAGS_compaction_style;
+  FLAGS_compaction_pri_e = (rocksdb::CompactionPri) FLAGS_compaction_pri;
   if (FLAGS_statistics) {
     dbstats = rocksdb::CreateDBStatistics();
   }
@@ -2577,6 +2744,13 @@ int main(int argc, char** argv) {
       std::stoi(fanout[j]));
   }
 
+  std::vector<std::string> compression_levels =
+    rocksdb::stringSplit(FLAGS_compression_level_per_level, ',');
+  for (unsigned int j = 0; j < compression_levels.size(); j++) {
+    FLAGS_compression_level_per_level_v.push_back(
+      std::stoi(compression_levels[j]));
+  }
+
   FLAGS_compression_type_e =
     StringToCompressionType(FLAGS_compression_type.c_str());
 
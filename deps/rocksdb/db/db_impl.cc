@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <climits>
 #include <cstdio>
+#include <functional>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
@@ -24,6 +26,7 @@
 #include <vector>
 
 #include "db/builder.h"
+#include "db/compaction_picker.h"
 #include "db/db_iter.h"
 #include "db/dbformat.h"
 #include "db/filename.h"
@@ -64,6 +67,7 @@
 #include "util/log_buffer.h"
 #include "util/mutexlock.h"
 #include "util/perf_context_imp.h"
+#include "util/rate_limiter.h"
 #include "util/stop_watch.h"
 #include "util/sync_point.h"
 
@@ -100,8 +104,22 @@ struct DBImpl::CompactionState {
     uint64_t file_size;
     InternalKey smallest, largest;
     SequenceNumber smallest_seqno, largest_seqno;
+    bool marked_for_compaction;
+    uint64_t creation_time;
+    std::shared_ptr<const std::vector<RangeTombstone>> range_tombstones;
   };
   std::vector<Output> outputs;
+  // The range tombstones of the input files that the output keeps. Every
+  // output file stores their parts from where the previous one stopped up to
+  // the first user key of the next one, so that it covers them without
+  // overlapping the other files of its level. The parts before
+  // range_tombstone_lower are stored already, and the parts from
+  // range_tombstone_limit on belong to another sub-compaction.
+  std::vector<RangeTombstone> range_tombstones;
+  bool has_range_tombstone_lower;
+  std::string range_tombstone_lower;
+  bool has_range_tombstone_limit;
+  std::string range_tombstone_limit;
   std::list<uint64_t> allocated_file_numbers;
 
   // State kept for output being generated
@@ -110,11 +128,46 @@ struct DBImpl::CompactionState {
 
   uint64_t total_bytes;
 
+  // Position of the scan in the levels below the output level
+  Compaction::KeyScanState key_scan_state;
+
+  // Sub-compactions running on their own threads must not flush
+  // memtables; only the thread that owns the compaction does that.
+  bool allow_flush_preemption;
+
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
   explicit CompactionState(Compaction* c)
       : compaction(c),
-        total_bytes(0) {
+        has_range_tombstone_lower(false),
+        has_range_tombstone_limit(false),
+        total_bytes(0),
+        allow_flush_preemption(true) {
+  }
+
+  // Returns the parts of range_tombstones not stored yet that lie before
+  // "limit", or before range_tombstone_limit if "limit" is nullptr.
+  std::vector<RangeTombstone> UnstoredRangeTombstones(
+      const Comparator* ucmp, const Slice* limit) const {
+    Slice default_limit(range_tombstone_limit);
+    if (limit == nullptr && has_range_tombstone_limit) {
+      limit = &default_limit;
+    }
+    std::vector<RangeTombstone> result;
+    for (const auto& t : range_tombstones) {
+      RangeTombstone part = t;
+      if (has_range_tombstone_lower &&
+          ucmp->Compare(part.start_key, range_tombstone_lower) < 0) {
+        part.start_key = range_tombstone_lower;
+      }
+      if (limit != nullptr && ucmp->Compare(part.end_key, *limit) > 0) {
+        part.end_key = limit->ToString();
+      }
+      if (ucmp->Compare(part.start_key, part.end_key) < 0) {
+        result.push_back(std::move(part));
+      }
+    }
+    return result;
   }
 
   // Create a client visible context of this compaction
@@ -293,6 +346,14 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
     result.wal_dir = result.wal_dir.substr(0, result.wal_dir.size() - 1);
   }
 
+  if (result.rate_limiter.get() != nullptr) {
+    // Let the throttled writes reach the disk at the throttled rate,
+    // instead of piling up in the page cache until the next sync.
+    if (result.bytes_per_sync == 0) {
+      result.bytes_per_sync = 1024 * 1024;
+    }
+  }
+
   return result;
 }
 
@@ -317,6 +378,15 @@ CompressionType GetCompressionType(const Options& options, int level,
   }
 }
 
+int GetCompressionLevel(const Options& options, int level) {
+  if (!options.compression_level_per_level.empty()) {
+    const int n = options.compression_level_per_level.size() - 1;
+    return options.compression_level_per_level[std::max(0, std::min(level, n))];
+  } else {
+    return options.compression_opts.level;
+  }
+}
+
 CompressionType GetCompressionFlush(const Options& options) {
   // Compressing memtable flushes might not help unless the sequential load
   // optimization is used for leveled compaction. Otherwise the CPU and
@@ -367,7 +437,7 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname)
       default_interval_to_delete_obsolete_WAL_(600),
       flush_on_destroy_(false),
       delayed_writes_(0),
-      storage_options_(options),
+      storage_options_(options_),
       bg_work_gate_closed_(false),
       refitting_level_(false),
       opened_successfully_(false) {
@@ -1370,7 +1440,14 @@ Status DBImpl::WriteLevel0TableForRecovery(ColumnFamilyData* cfd, MemTable* mem,
   meta.number = versions_->NewFileNumber();
   pending_outputs_.insert(meta.number);
   Iterator* iter = mem->NewIterator(ReadOptions(), true);
-  const SequenceNumber newest_snapshot = snapshots_.GetNewest();
+  // The range tombstones are stored in the table file
+  std::vector<RangeTombstone> range_tombstones;
+  mem->AddRangeTombstonesTo(&range_tombstones);
+  SequenceNumber newest_snapshot = snapshots_.GetNewest();
+  if (!range_tombstones.empty()) {
+    // Purging would merge operands across a range tombstone.
+    newest_snapshot = kMaxSequenceNumber;
+  }
   const SequenceNumber earliest_seqno_in_memtable =
     mem->GetFirstSequenceNumber();
   Log(options_.info_log, "[%s] Level-0 table #%lu: started",
@@ -1380,7 +1457,8 @@ Status DBImpl::WriteLevel0TableForRecovery(ColumnFamilyData* cfd, MemTable* mem,
   {
     mutex_.Unlock();
     s = BuildTable(dbname_, env_, *cfd->options(), storage_options_,
-                   cfd->table_cache(), iter, &meta, cfd->internal_comparator(),
+                   cfd->table_cache(), iter, range_tombstones, &meta,
+                   cfd->internal_comparator(),
                    newest_snapshot, earliest_seqno_in_memtable,
                    GetCompressionFlush(*cfd->options()));
     LogFlush(options_.info_log);
@@ -1400,7 +1478,9 @@ Status DBImpl::WriteLevel0TableForRecovery(ColumnFamilyData* cfd, MemTable* mem,
   if (s.ok() && meta.file_size > 0) {
     edit->AddFile(level, meta.number, meta.file_size,
                   meta.smallest, meta.largest,
-                  meta.smallest_seqno, meta.largest_seqno);
+                  meta.smallest_seqno, meta.largest_seqno,
+                  meta.marked_for_compaction, meta.creation_time,
+                  meta.range_tombstones);
   }
 
   InternalStats::CompactionStats stats;
@@ -1422,7 +1502,16 @@ Status DBImpl::WriteLevel0Table(ColumnFamilyData* cfd,
   *filenumber = meta.number;
   pending_outputs_.insert(meta.number);
 
-  const SequenceNumber newest_snapshot = snapshots_.GetNewest();
+  // The range tombstones are stored in the table file
+  std::vector<RangeTombstone> range_tombstones;
+  for (MemTable* m : mems) {
+    m->AddRangeTombstonesTo(&range_tombstones);
+  }
+  SequenceNumber newest_snapshot = snapshots_.GetNewest();
+  if (!range_tombstones.empty()) {
+    // Purging would merge operands across a range tombstone.
+    newest_snapshot = kMaxSequenceNumber;
+  }
   const SequenceNumber earliest_seqno_in_memtable =
     mems[0]->GetFirstSequenceNumber();
   Version* base = cfd->current();
@@ -1443,7 +1532,8 @@ Status DBImpl::WriteLevel0Table(ColumnFamilyData* cfd,
         cfd->GetName().c_str(), (unsigned long)meta.number);
 
     s = BuildTable(dbname_, env_, *cfd->options(), storage_options_,
-                   cfd->table_cache(), iter, &meta, cfd->internal_comparator(),
+                   cfd->table_cache(), iter, range_tombstones, &meta,
+                   cfd->internal_comparator(),
                    newest_snapshot, earliest_seqno_in_memtable,
                    GetCompressionFlush(*cfd->options()));
     LogFlush(options_.info_log);
@@ -1487,7 +1577,9 @@ Status DBImpl::WriteLevel0Table(ColumnFamilyData* cfd,
     }
     edit->AddFile(level, meta.number, meta.file_size,
                   meta.smallest, meta.largest,
-                  meta.smallest_seqno, meta.largest_seqno);
+                  meta.smallest_seqno, meta.largest_seqno,
+                  meta.marked_for_compaction, meta.creation_time,
+                  meta.range_tombstones);
   }
 
   InternalStats::CompactionStats stats;
@@ -1607,7 +1699,15 @@ Status DBImpl::CompactRange(ColumnFamilyHandle* column_family,
         level == max_level_with_files) {
       s = RunManualCompaction(cfd, level, level, begin, end);
     } else {
-      s = RunManualCompaction(cfd, level, level + 1, begin, end);
+      int output_level = level + 1;
+      if (level == 0 &&
+          cfd->options()->compaction_style == kCompactionStyleLevel &&
+          cfd->options()->level_compaction_dynamic_level_bytes) {
+        // Levels above the base level are kept empty. The base level can
+        // move until the compaction is picked, so resolve it then.
+        output_level = CompactionPicker::kCompactToBaseLevel;
+      }
+      s = RunManualCompaction(cfd, level, output_level, begin, end);
     }
     if (!s.ok()) {
       LogFlush(options_.info_log);
@@ -1632,8 +1732,7 @@ int DBImpl::FindMinimumEmptyLevelFitting(ColumnFamilyData* cfd, int level) {
     // stop if level i is not empty
     if (current->NumLevelFiles(i) > 0) break;
     // stop if level i is too small (cannot fit the level files)
-    if (cfd->compaction_picker()->MaxBytesForLevel(i) <
-        current->NumLevelBytes(level)) {
+    if (current->MaxBytesForLevel(i) < current->NumLevelBytes(level)) {
       break;
     }
 
@@ -1674,6 +1773,13 @@ Status DBImpl::ReFitLevel(ColumnFamilyData* cfd, int level, int target_level) {
     to_level = FindMinimumEmptyLevelFitting(cfd, level);
   }
 
+  if (cfd->options()->compaction_style == kCompactionStyleLevel &&
+      cfd->options()->level_compaction_dynamic_level_bytes &&
+      level >= cfd->current()->base_level()) {
+    // Levels above the base level are kept empty
+    to_level = std::max(to_level, cfd->current()->base_level());
+  }
+
   assert(to_level <= level);
 
   Status status;
@@ -1686,7 +1792,9 @@ Status DBImpl::ReFitLevel(ColumnFamilyData* cfd, int level, int target_level) {
     for (const auto& f : cfd->current()->files_[level]) {
       edit.DeleteFile(level, f->number);
       edit.AddFile(to_level, f->number, f->file_size, f->smallest, f->largest,
-                   f->smallest_seqno, f->largest_seqno);
+                   f->smallest_seqno, f->largest_seqno,
+                   f->marked_for_compaction, f->creation_time,
+                   f->range_tombstones);
     }
     Log(options_.info_log, "[%s] Apply version edit:\n%s",
         cfd->GetName().c_str(), edit.DebugString().data());
@@ -1770,6 +1878,17 @@ Status DBImpl::RunManualCompaction(ColumnFamilyData* cfd, int input_level,
 
   MutexLock l(&mutex_);
 
+  // Remember how much there is to compact so that the progress can be
+  // logged after every step.
+  std::vector<FileMetaData*> inputs;
+  cfd->current()->GetOverlappingInputs(input_level, manual.begin, manual.end,
+                                       &inputs);
+  manual.input_bytes = 0;
+  for (const auto f : inputs) {
+    manual.input_bytes += f->file_size;
+  }
+  manual.compacted_bytes = 0;
+
   // When a manual compaction arrives, temporarily disable scheduling of
   // non-manual compactions and wait until the number of scheduled compaction
   // jobs drops to zero. This is needed to ensure that this manual compaction
@@ -2114,6 +2233,9 @@ Status DBImpl::BackgroundCompaction(bool* madeProgress,
   unique_ptr<Compaction> c;
   InternalKey manual_end_storage;
   InternalKey* manual_end = &manual_end_storage;
+  // The output level of a manual compaction, with kCompactToBaseLevel
+  // resolved
+  int manual_output_level = 0;
   if (is_manual) {
     ManualCompaction* m = manual_compaction_;
     assert(m->in_progress);
@@ -2122,10 +2244,17 @@ Status DBImpl::BackgroundCompaction(bool* madeProgress,
     if (!c) {
       m->done = true;
     }
+    if (c) {
+      manual_output_level = c->output_level();
+    } else if (m->output_level == CompactionPicker::kCompactToBaseLevel) {
+      manual_output_level = m->cfd->current()->base_level();
+    } else {
+      manual_output_level = m->output_level;
+    }
     LogToBuffer(log_buffer,
                 "[%s] Manual compaction from level-%d to level-%d from %s .. "
                 "%s; will stop at %s\n",
-                m->cfd->GetName().c_str(), m->input_level, m->output_level,
+                m->cfd->GetName().c_str(), m->input_level, manual_output_level,
                 (m->begin ? m->begin->DebugString().c_str() : "(begin)"),
                 (m->end ? m->end->DebugString().c_str() : "(end)"),
                 ((m->done || manual_end == nullptr)
@@ -2147,6 +2276,12 @@ Status DBImpl::BackgroundCompaction(bool* madeProgress,
   }
 
   Status status;
+  uint64_t manual_input_bytes = 0;
+  if (is_manual && c) {
+    for (const auto f : *c->inputs(0)) {
+      manual_input_bytes += f->file_size;
+    }
+  }
   if (!c) {
     // Nothing to do
     LogToBuffer(log_buffer, "Compaction nothing to do");
@@ -2155,9 +2290,11 @@ Status DBImpl::BackgroundCompaction(bool* madeProgress,
     assert(c->num_input_files(0) == 1);
     FileMetaData* f = c->input(0, 0);
     c->edit()->DeleteFile(c->level(), f->number);
-    c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
+    c->edit()->AddFile(c->output_level(), f->number, f->file_size,
                        f->smallest, f->largest,
-                       f->smallest_seqno, f->largest_seqno);
+                       f->smallest_seqno, f->largest_seqno,
+                       f->marked_for_compaction, f->creation_time,
+                       f->range_tombstones);
     status = versions_->LogAndApply(c->column_family_data(), c->edit(), &mutex_,
                                     db_directory_.get());
     InstallSuperVersion(c->column_family_data(), deletion_state);
@@ -2165,7 +2302,7 @@ Status DBImpl::BackgroundCompaction(bool* madeProgress,
     Version::LevelSummaryStorage tmp;
     LogToBuffer(log_buffer, "[%s] Moved #%lld to level-%d %lld bytes %s: %s\n",
                 c->column_family_data()->GetName().c_str(),
-                static_cast<unsigned long long>(f->number), c->level() + 1,
+                static_cast<unsigned long long>(f->number), c->output_level(),
                 static_cast<unsigned long long>(f->file_size),
                 status.ToString().c_str(),
                 c->input_version()->LevelSummary(&tmp));
@@ -2200,6 +2337,16 @@ Status DBImpl::BackgroundCompaction(bool* madeProgress,
       m->status = status;
       m->done = true;
     }
+    if (status.ok() && manual_input_bytes > 0) {
+      m->compacted_bytes += manual_input_bytes;
+      LogToBuffer(log_buffer,
+                  "[%s] Manual compaction from level-%d to level-%d: %" PRIu64
+                  " of %" PRIu64 " input bytes done\n",
+                  m->cfd->GetName().c_str(), m->input_level,
+                  manual_output_level,
+                  m->compacted_bytes,
+                  std::max(m->compacted_bytes, m->input_bytes));
+    }
     // For universal compaction:
     //   Because universal compaction always happens at level 0, so one
     //   compaction will pick up all overlapped files. No files will be
@@ -2296,6 +2443,15 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   out.smallest.Clear();
   out.largest.Clear();
   out.smallest_seqno = out.largest_seqno = 0;
+  out.marked_for_compaction = false;
+  out.creation_time = 0;
+  int64_t creation_time = 0;
+  if (compact->compaction->column_family_data()
+              ->options()
+              ->periodic_compaction_seconds > 0 &&
+      env_->GetCurrentTime(&creation_time).ok()) {
+    out.creation_time = creation_time;
+  }
   compact->outputs.push_back(out);
 
   // Make the output file
@@ -2309,13 +2465,22 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
     compact->outfile->SetPreallocationBlockSize(
         1.1 * cfd->compaction_picker()->MaxFileSizeForLevel(
                   compact->compaction->output_level()));
+    if (options_.rate_limiter.get() != nullptr) {
+      compact->outfile.reset(new RateLimitedWritableFile(
+          std::move(compact->outfile), options_.rate_limiter.get(), Env::LOW,
+          options_.statistics.get()));
+    }
 
     CompressionType compression_type =
         GetCompressionType(*cfd->options(), compact->compaction->output_level(),
                            compact->compaction->enable_compression());
+    // The table builders keep their own copy of the options.
+    Options output_options = *cfd->options();
+    output_options.compression_opts.level = GetCompressionLevel(
+        output_options, compact->compaction->output_level());
 
     compact->builder.reset(
-        NewTableBuilder(*cfd->options(), cfd->internal_comparator(),
+        NewTableBuilder(output_options, cfd->internal_comparator(),
                         compact->outfile.get(), compression_type));
   }
   LogFlush(options_.info_log);
@@ -2323,19 +2488,50 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
 }
 
 Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
-                                          Iterator* input) {
+                                          Iterator* input,
+                                          const Slice* next_user_key) {
   assert(compact != nullptr);
   assert(compact->outfile);
   assert(compact->builder != nullptr);
 
-  const uint64_t output_number = compact->current_output()->number;
+  CompactionState::Output* out = compact->current_output();
+  const uint64_t output_number = out->number;
   assert(output_number != 0);
 
   // Check for iterator errors
   Status s = input->status();
+  if (s.ok() && !compact->range_tombstones.empty()) {
+    // Store the range tombstones up to the next output file, and extend the
+    // file's ranges to them as a flush does.
+    ColumnFamilyData* cfd = compact->compaction->column_family_data();
+    std::vector<RangeTombstone> tombstones =
+        compact->UnstoredRangeTombstones(cfd->user_comparator(),
+                                         next_user_key);
+    if (next_user_key != nullptr) {
+      compact->has_range_tombstone_lower = true;
+      compact->range_tombstone_lower = next_user_key->ToString();
+    } else {
+      compact->range_tombstones.clear();
+    }
+    if (!tombstones.empty()) {
+      for (const auto& t : tombstones) {
+        if (s.ok()) {
+          s = compact->builder->AddRangeTombstone(t);
+        }
+      }
+      ExtendFileRangeToTombstones(
+          tombstones, cfd->internal_comparator(),
+          compact->builder->NumEntries() == 0, &out->smallest,
+          &out->largest, &out->smallest_seqno, &out->largest_seqno);
+      out->range_tombstones =
+          std::make_shared<std::vector<RangeTombstone>>(std::move(tombstones));
+    }
+  }
   const uint64_t current_entries = compact->builder->NumEntries();
   if (s.ok()) {
     s = compact->builder->Finish();
+    compact->current_output()->marked_for_compaction =
+        compact->builder->NeedCompact();
   } else {
     compact->builder->Abandon();
   }
@@ -2361,7 +2557,7 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   }
   compact->outfile.reset();
 
-  if (s.ok() && current_entries > 0) {
+  if (s.ok() && (current_entries > 0 || out->range_tombstones != nullptr)) {
     // Verify that the table is usable
     ColumnFamilyData* cfd = compact->compaction->column_family_data();
     FileMetaData meta(output_number, current_bytes);
@@ -2378,6 +2574,21 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   return s;
 }
 
+Status DBImpl::FinishCompactionOutputs(CompactionState* compact,
+                                       Iterator* input) {
+  Status s;
+  if (compact->builder == nullptr &&
+      !compact->UnstoredRangeTombstones(
+          compact->compaction->column_family_data()->user_comparator(),
+          nullptr).empty()) {
+    // No entry is left for the remaining range tombstones to go with
+    s = OpenCompactionOutputFile(compact);
+  }
+  if (s.ok() && compact->builder != nullptr) {
+    s = FinishCompactionOutputFile(compact, input);
+  }
+  return s;
+}
 
 Status DBImpl::InstallCompactionResults(CompactionState* compact,
                                         LogBuffer* log_buffer) {
@@ -2410,7 +2621,8 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact,
     const CompactionState::Output& out = compact->outputs[i];
     compact->compaction->edit()->AddFile(
         compact->compaction->output_level(), out.number, out.file_size,
-        out.smallest, out.largest, out.smallest_seqno, out.largest_seqno);
+        out.smallest, out.largest, out.smallest_seqno, out.largest_seqno,
+        out.marked_for_compaction, out.creation_time, out.range_tombstones);
   }
   return versions_->LogAndApply(compact->compaction->column_family_data(),
                                 compact->compaction->edit(), &mutex_,
@@ -2488,6 +2700,17 @@ Status DBImpl::ProcessKeyValueCompaction(
     kMaxSequenceNumber;
   SequenceNumber visible_in_snapshot = kMaxSequenceNumber;
   ColumnFamilyData* cfd = compact->compaction->column_family_data();
+  const RangeTombstoneSet* range_tombstones =
+      compact->compaction->input_version()->range_tombstones().get();
+  // The output files of universal compaction with partitioned runs share
+  // sequence numbers, so the entries of a user key must not be split across
+  // them. Neither may the output files that store range tombstones, which
+  // reach up to the first user key of the next file. A full output file is
+  // closed before the next user key instead.
+  const bool keep_user_keys_together =
+      (cfd->options()->compaction_style == kCompactionStyleUniversal &&
+       cfd->options()->compaction_options_universal.partitioned_runs) ||
+      !compact->range_tombstones.empty();
   MergeHelper merge(
       cfd->user_comparator(), cfd->options()->merge_operator.get(),
       options_.info_log.get(), cfd->options()->min_partial_merge_operands,
@@ -2508,7 +2731,9 @@ Status DBImpl::ProcessKeyValueCompaction(
     // TODO(icanadi) this currently only checks if flush is necessary on
     // compacting column family. we should also check if flush is necessary on
     // other column families, too
-    imm_micros += CallFlushDuringCompaction(cfd, deletion_state, log_buffer);
+    if (compact->allow_flush_preemption) {
+      imm_micros += CallFlushDuringCompaction(cfd, deletion_state, log_buffer);
+    }
 
     Slice key;
     Slice value;
@@ -2532,9 +2757,29 @@ Status DBImpl::ProcessKeyValueCompaction(
       ++combined_idx;
     }
 
-    if (compact->compaction->ShouldStopBefore(key) &&
-        compact->builder != nullptr) {
-      status = FinishCompactionOutputFile(compact, input);
+    Slice user_key;
+    bool at_new_user_key = false;
+    if (compact->builder != nullptr && key.size() >= 8) {
+      user_key = ExtractUserKey(key);
+      at_new_user_key =
+          cfd->user_comparator()->Compare(
+              user_key, compact->current_output()->largest.user_key()) != 0;
+    }
+    if (compact->compaction->ShouldStopBefore(key,
+                                              &compact->key_scan_state) &&
+        compact->builder != nullptr &&
+        (!keep_user_keys_together || at_new_user_key)) {
+      status = FinishCompactionOutputFile(
+          compact, input, at_new_user_key ? &user_key : nullptr);
+      if (!status.ok()) {
+        break;
+      }
+    }
+    if (keep_user_keys_together && at_new_user_key &&
+        compact->builder != nullptr &&
+        compact->builder->FileSize() >=
+            compact->compaction->MaxOutputFileSize()) {
+      status = FinishCompactionOutputFile(compact, input, &user_key);
       if (!status.ok()) {
         break;
       }
@@ -2600,6 +2845,12 @@ Status DBImpl::ProcessKeyValueCompaction(
         findEarliestVisibleSnapshot(ikey.sequence,
             compact->existing_snapshots,
             &prev_snapshot);
+      // Entries older than range_del_seq are deleted by a range tombstone
+      // that every snapshot seeing them also sees.
+      SequenceNumber range_del_seq =
+          range_tombstones == nullptr
+              ? 0
+              : range_tombstones->MaxCoveringSeq(ikey.user_key, visible);
 
       if (visible_in_snapshot == visible) {
         // If the earliest snapshot is which this key is visible in
@@ -2610,9 +2861,13 @@ Status DBImpl::ProcessKeyValueCompaction(
         assert(last_sequence_for_key >= ikey.sequence);
         drop = true;    // (A)
         RecordTick(options_.statistics.get(), COMPACTION_KEY_DROP_NEWER_ENTRY);
+      } else if (ikey.sequence < range_del_seq) {
+        drop = true;
+        RecordTick(options_.statistics.get(), COMPACTION_KEY_DROP_RANGE_DEL);
       } else if (ikey.type == kTypeDeletion &&
           ikey.sequence <= earliest_snapshot &&
-          compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+          compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                 &compact->key_scan_state)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -2631,7 +2886,7 @@ Status DBImpl::ProcessKeyValueCompaction(
         // optimization in BuildTable.
         int steps = 0;
         merge.MergeUntil(input, prev_snapshot, bottommost_level,
-            options_.statistics.get(), &steps);
+            options_.statistics.get(), &steps, range_del_seq);
         // Skip the Merge ops
         combined_idx = combined_idx - 1 + steps;
 
@@ -2688,9 +2943,14 @@ Status DBImpl::ProcessKeyValueCompaction(
         // Zeroing out the sequence number leads to better compression.
         // If this is the bottommost level (no files in lower levels)
         // and the earliest snapshot is larger than this seqno
-        // then we can squash the seqno to zero.
+        // then we can squash the seqno to zero. Keys within the range of a
+        // range tombstone keep their seqno, which tells whether they were
+        // written after the tombstone.
         if (bottommost_level && ikey.sequence < earliest_snapshot &&
-            ikey.type != kTypeMerge) {
+            ikey.type != kTypeMerge &&
+            (range_tombstones == nullptr ||
+             range_tombstones->MaxCoveringSeq(ikey.user_key,
+                                              kMaxSequenceNumber) == 0)) {
           assert(ikey.type != kTypeDeletion);
           // make a copy because updating in place would cause problems
           // with the priority queue that is managing the input key iterator
@@ -2724,8 +2984,9 @@ Status DBImpl::ProcessKeyValueCompaction(
           std::max(compact->current_output()->largest_seqno, seqno);
 
         // Close output file if it is big enough
-        if (compact->builder->FileSize() >=
-            compact->compaction->MaxOutputFileSize()) {
+        if (!keep_user_keys_together &&
+            compact->builder->FileSize() >=
+                compact->compaction->MaxOutputFileSize()) {
           status = FinishCompactionOutputFile(compact, input);
           if (!status.ok()) {
             break;
@@ -2766,6 +3027,182 @@ Status DBImpl::ProcessKeyValueCompaction(
   return status;
 }
 
+namespace {
+// Iterator over the entries of "iter" whose user key is less than "limit"
+// (all of them if "limit" is nullptr). Does not take ownership of "iter".
+class SubcompactionIterator : public Iterator {
+ public:
+  SubcompactionIterator(Iterator* iter, const Slice* limit,
+                        const Comparator* user_comparator)
+      : iter_(iter), limit_(limit), user_comparator_(user_comparator) {}
+
+  virtual bool Valid() const {
+    return iter_->Valid() &&
+           (limit_ == nullptr ||
+            user_comparator_->Compare(ExtractUserKey(iter_->key()),
+                                      *limit_) < 0);
+  }
+  virtual void SeekToFirst() { iter_->SeekToFirst(); }
+  virtual void SeekToLast() { iter_->SeekToLast(); }
+  virtual void Seek(const Slice& target) { iter_->Seek(target); }
+  virtual void Next() { iter_->Next(); }
+  virtual void Prev() { iter_->Prev(); }
+  virtual Slice key() const { return iter_->key(); }
+  virtual Slice value() const { return iter_->value(); }
+  virtual Status status() const { return iter_->status(); }
+
+ private:
+  Iterator* iter_;
+  const Slice* limit_;
+  const Comparator* user_comparator_;
+};
+
+// The sub-compactions 1..num-1 of a compaction. They are scheduled in the
+// LOW priority pool, and the compaction thread runs the ones no pool thread
+// has started yet itself, so they finish even when every thread of the pool
+// is busy. A pool thread that starts after all of them were taken only
+// touches this queue, which it shares.
+class SubcompactionQueue {
+ public:
+  SubcompactionQueue(std::function<void(size_t)> run, size_t num)
+      : run_(run), num_(num), next_(1), cv_(&mu_), num_done_(1) {}
+
+  static void BGWork(void* arg) {
+    std::shared_ptr<SubcompactionQueue>* queue =
+        static_cast<std::shared_ptr<SubcompactionQueue>*>(arg);
+    (*queue)->RunPending();
+    delete queue;
+  }
+
+  // Runs sub-compactions until none is left to start.
+  void RunPending() {
+    for (size_t i = next_.fetch_add(1); i < num_; i = next_.fetch_add(1)) {
+      run_(i);
+      MutexLock l(&mu_);
+      if (++num_done_ == num_) {
+        cv_.SignalAll();
+      }
+    }
+  }
+
+  void WaitForAll() {
+    MutexLock l(&mu_);
+    while (num_done_ < num_) {
+      cv_.Wait();
+    }
+  }
+
+ private:
+  const std::function<void(size_t)> run_;
+  const size_t num_;
+  std::atomic<size_t> next_;
+  port::Mutex mu_;
+  port::CondVar cv_;
+  size_t num_done_;
+};
+}  // namespace
+
+Status DBImpl::ProcessSubcompactions(
+    const std::vector<std::string>& boundaries,
+    SequenceNumber visible_at_tip,
+    SequenceNumber earliest_snapshot,
+    SequenceNumber latest_snapshot,
+    DeletionState& deletion_state,
+    bool bottommost_level,
+    int64_t& imm_micros,
+    Iterator* input,
+    CompactionState* compact,
+    LogBuffer* log_buffer) {
+  assert(!boundaries.empty());
+  const Comparator* user_comparator =
+      compact->compaction->column_family_data()->user_comparator();
+  const size_t num_subcompactions = boundaries.size() + 1;
+  std::vector<Slice> limits(boundaries.begin(), boundaries.end());
+
+  // Sub-compaction 0 covers the keys below boundaries[0] and reuses
+  // "compact" and "input". Sub-compaction i > 0 covers
+  // [boundaries[i-1], boundaries[i]) with its own state and input.
+  std::vector<std::unique_ptr<CompactionState>> states;
+  std::vector<std::unique_ptr<Iterator>> inputs;
+  std::vector<std::unique_ptr<Iterator>> limited_inputs;
+  states.emplace_back(nullptr);
+  inputs.emplace_back(nullptr);
+  compact->has_range_tombstone_limit = true;
+  compact->range_tombstone_limit = boundaries[0];
+  for (size_t i = 1; i < num_subcompactions; i++) {
+    CompactionState* state = new CompactionState(compact->compaction);
+    state->existing_snapshots = compact->existing_snapshots;
+    state->allow_flush_preemption = false;
+    state->range_tombstones = compact->range_tombstones;
+    state->has_range_tombstone_lower = true;
+    state->range_tombstone_lower = boundaries[i - 1];
+    if (i + 1 < num_subcompactions) {
+      state->has_range_tombstone_limit = true;
+      state->range_tombstone_limit = boundaries[i];
+    }
+    states.emplace_back(state);
+
+    Iterator* iter = versions_->MakeInputIterator(compact->compaction);
+    InternalKey start(boundaries[i - 1], kMaxSequenceNumber,
+                      kValueTypeForSeek);
+    iter->Seek(start.Encode());
+    inputs.emplace_back(iter);
+  }
+  for (size_t i = 0; i < num_subcompactions; i++) {
+    Iterator* iter = (i == 0) ? input : inputs[i].get();
+    const Slice* limit = (i + 1 < num_subcompactions) ? &limits[i] : nullptr;
+    limited_inputs.emplace_back(
+        new SubcompactionIterator(iter, limit, user_comparator));
+  }
+
+  std::vector<Status> statuses(num_subcompactions);
+  std::vector<int64_t> unused_micros(num_subcompactions, 0);
+  auto run = [&](size_t i) {
+    CompactionState* state = (i == 0) ? compact : states[i].get();
+    Iterator* iter = limited_inputs[i].get();
+    int64_t& micros = (i == 0) ? imm_micros : unused_micros[i];
+    Status s = ProcessKeyValueCompaction(
+        visible_at_tip, earliest_snapshot, latest_snapshot, deletion_state,
+        bottommost_level, micros, iter, state, false, log_buffer);
+    if (s.ok()) {
+      s = FinishCompactionOutputs(state, iter);
+    }
+    if (s.ok()) {
+      s = iter->status();
+    }
+    statuses[i] = s;
+  };
+
+  std::shared_ptr<SubcompactionQueue> queue(
+      new SubcompactionQueue(run, num_subcompactions));
+  for (size_t i = 1; i < num_subcompactions; i++) {
+    env_->Schedule(&SubcompactionQueue::BGWork,
+                   new std::shared_ptr<SubcompactionQueue>(queue), Env::LOW);
+  }
+  run(0);
+  queue->RunPending();
+  queue->WaitForAll();
+
+  // Hand the outputs of the other sub-compactions to "compact" so that
+  // they are installed, or cleaned up on failure, together.
+  Status status = statuses[0];
+  for (size_t i = 1; i < num_subcompactions; i++) {
+    CompactionState* state = states[i].get();
+    if (state->builder != nullptr) {
+      state->builder->Abandon();
+      state->builder.reset();
+      state->outfile.reset();
+    }
+    compact->outputs.insert(compact->outputs.end(), state->outputs.begin(),
+                            state->outputs.end());
+    compact->total_bytes += state->total_bytes;
+    if (status.ok()) {
+      status = statuses[i];
+    }
+  }
+  return status;
+}
+
 void DBImpl::CallCompactionFilterV2(CompactionState* compact,
   CompactionFilterV2* compaction_filter_v2) {
   if (compact == nullptr || compaction_filter_v2 == nullptr) {
@@ -2862,6 +3299,17 @@ Status DBImpl::DoCompactionWork(CompactionState* compact,
   // Is this compaction producing files at the bottommost level?
   bool bottommost_level = compact->compaction->BottomMostLevel();
 
+  int num_skipped_files =
+      compact->compaction->SkipFilesCoveredByRangeTombstones(
+          compact->existing_snapshots);
+  if (num_skipped_files > 0) {
+    LogToBuffer(log_buffer,
+                "[%s] Skipping %d input files deleted by range tombstones",
+                cfd->GetName().c_str(), num_skipped_files);
+  }
+  compact->compaction->GetRangeTombstonesToKeep(compact->existing_snapshots,
+                                                &compact->range_tombstones);
+
   // Allocate the output file numbers before we release the lock
   AllocateCompactionOutputFileNumbers(compact);
 
@@ -3020,25 +3468,51 @@ Status DBImpl::DoCompactionWork(CompactionState* compact,
   }  // checking for compaction filter v2
 
   if (!compaction_filter_v2) {
-    status = ProcessKeyValueCompaction(
-      visible_at_tip,
-      earliest_snapshot,
-      latest_snapshot,
-      deletion_state,
-      bottommost_level,
-      imm_micros,
-      input.get(),
-      compact,
-      false,
-      log_buffer);
+    // Level-0 compactions are split into max_subcompactions key ranges,
+    // manual compactions into max_background_compactions key ranges if
+    // parallel_manual_compaction is set.
+    int max_ranges = 1;
+    if (compact->compaction->level() == 0) {
+      max_ranges = options_.max_subcompactions;
+    }
+    if (compact->compaction->IsManualCompaction() &&
+        CanSplitManualCompaction(*cfd->options())) {
+      max_ranges = std::max(max_ranges, options_.max_background_compactions);
+    }
+    if (cfd->options()->compaction_filter != nullptr) {
+      // A single compaction filter would be called from all the ranges at
+      // once. With compaction_filter_factory, every range gets its own.
+      max_ranges = 1;
+    }
+    std::vector<std::string> boundaries;
+    versions_->GetSubcompactionBoundaries(compact->compaction, max_ranges,
+                                          &boundaries);
+    if (boundaries.empty()) {
+      status = ProcessKeyValueCompaction(
+        visible_at_tip,
+        earliest_snapshot,
+        latest_snapshot,
+        deletion_state,
+        bottommost_level,
+        imm_micros,
+        input.get(),
+        compact,
+        false,
+        log_buffer);
+    } else {
+      status = ProcessSubcompactions(
+          boundaries, visible_at_tip, earliest_snapshot, latest_snapshot,
+          deletion_state, bottommost_level, imm_micros, input.get(), compact,
+          log_buffer);
+    }
   }
 
   if (status.ok() && (shutting_down_.Acquire_Load() || cfd->IsDropped())) {
     status = Status::ShutdownInProgress(
         "Database shutdown or Column family drop during compaction");
   }
-  if (status.ok() && compact->builder != nullptr) {
-    status = FinishCompactionOutputFile(compact, input.get());
+  if (status.ok()) {
+    status = FinishCompactionOutputs(compact, input.get());
   }
   if (status.ok()) {
     status = input->status();
@@ -3146,17 +3620,21 @@ static void CleanupIteratorState(void* arg1, void* arg2) {
 }
 }  // namespace
 
-Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
-                                      ColumnFamilyData* cfd,
-                                      SuperVersion* super_version) {
+Iterator* DBImpl::NewInternalIterator(
+    const ReadOptions& options, ColumnFamilyData* cfd,
+    SuperVersion* super_version,
+    const std::shared_ptr<const RangeTombstoneSets>& range_tombstones,
+    SequenceNumber snapshot) {
   std::vector<Iterator*> iterator_list;
   // Collect iterator for mutable mem
   iterator_list.push_back(super_version->mem->NewIterator(options));
   // Collect all needed child iterators for immutable memtables
-  super_version->imm->AddIterators(options, &iterator_list);
+  super_version->imm->AddIterators(options, &iterator_list, range_tombstones,
+                                   snapshot);
   // Collect iterators for files in L0 - Ln
   super_version->current->AddIterators(options, storage_options_,
-                                       &iterator_list);
+                                       &iterator_list, range_tombstones,
+                                       snapshot);
   Iterator* internal_iter = NewMergingIterator(
       &cfd->internal_comparator(), &iterator_list[0], iterator_list.size());
 
@@ -3237,18 +3715,23 @@ Status DBImpl::GetImpl(const ReadOptions& options,
   // s is both in/out. When in, s could either be OK or MergeInProgress.
   // merge_operands will contain the sequence of merges in the latter case.
   LookupKey lkey(key, snapshot);
+  // Entries older than the newest range tombstone covering the key are
+  // treated as deleted.
+  SequenceNumber range_del_seq = sv->MaxCoveringTombstoneSeq(key, snapshot);
   PERF_TIMER_STOP(get_snapshot_time);
-  if (sv->mem->Get(lkey, value, &s, merge_context, *cfd->options())) {
+  if (sv->mem->Get(lkey, value, &s, merge_context, *cfd->options(),
+                   range_del_seq)) {
     // Done
     RecordTick(options_.statistics.get(), MEMTABLE_HIT);
-  } else if (sv->imm->Get(lkey, value, &s, merge_context, *cfd->options())) {
+  } else if (sv->imm->Get(lkey, value, &s, merge_context, *cfd->options(),
+                          range_del_seq)) {
     // Done
     RecordTick(options_.statistics.get(), MEMTABLE_HIT);
   } else {
     PERF_TIMER_START(get_from_output_files_time);
 
     sv->current->Get(options, lkey, value, &s, &merge_context, &stats,
-                     value_found);
+                     value_found, range_del_seq);
     have_stat_update = true;
     PERF_TIMER_STOP(get_from_output_files_time);
     RecordTick(options_.statistics.get(), MEMTABLE_MISS);
@@ -3327,8 +3810,9 @@ std::vector<Status> DBImpl::MultiGet(
   }
   mutex_.Unlock();
 
-  // Contain a list of merge operations if merge occurs.
-  MergeContext merge_context;
+  // Contain a list of merge operations if merge occurs. Each key needs its
+  // own since the keys that miss the memtables are looked up together.
+  std::vector<MergeContext> merge_contexts(keys.size());
 
   // Note: this always resizes the values array
   size_t num_keys = keys.size();
@@ -3337,38 +3821,79 @@ std::vector<Status> DBImpl::MultiGet(
 
   // Keep track of bytes that we read for statistics-recording later
   uint64_t bytes_read = 0;
-  PERF_TIMER_STOP(get_snapshot_time);
 
-  // For each of the given keys, apply the entire "get" process as follows:
-  // First look in the memtable, then in the immutable memtable (if any).
-  // s is both in/out. When in, s could either be OK or MergeInProgress.
-  // merge_operands will contain the sequence of merges in the latter case.
+  // Sort the keys by column family and then by user key, so that each
+  // column family's sst files are visited in key order and keys that share
+  // a file or a data block are looked up together.
+  std::vector<size_t> sorted_index(num_keys);
   for (size_t i = 0; i < num_keys; ++i) {
-    merge_context.Clear();
-    Status& s = stat_list[i];
-    std::string* value = &(*values)[i];
+    sorted_index[i] = i;
+  }
+  std::sort(sorted_index.begin(), sorted_index.end(),
+            [&](size_t a, size_t b) {
+    auto cfd_a = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[a])
+                     ->cfd();
+    auto cfd_b = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[b])
+                     ->cfd();
+    if (cfd_a->GetID() != cfd_b->GetID()) {
+      return cfd_a->GetID() < cfd_b->GetID();
+    }
+    return cfd_a->user_comparator()->Compare(keys[a], keys[b]) < 0;
+  });
+  std::vector<std::unique_ptr<LookupKey>> lookup_keys(num_keys);
+  PERF_TIMER_STOP(get_snapshot_time);
 
-    LookupKey lkey(keys[i], snapshot);
-    auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[i]);
+  // For each of the given keys, first look in the memtable, then in the
+  // immutable memtable (if any). s is both in/out. When in, s could either be
+  // OK or MergeInProgress. merge_operands will contain the sequence of merges
+  // in the latter case. The keys found in neither are then looked up in the
+  // sst files of their column family as one batch.
+  std::vector<Version::MultiGetKey> batch;
+  for (size_t pos = 0; pos < num_keys;) {
+    auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(
+        column_family[sorted_index[pos]]);
     auto mgd_iter = multiget_cf_data.find(cfh->cfd()->GetID());
     assert(mgd_iter != multiget_cf_data.end());
     auto mgd = mgd_iter->second;
     auto super_version = mgd->super_version;
     auto cfd = mgd->cfd;
-    if (super_version->mem->Get(lkey, value, &s, merge_context,
-                                *cfd->options())) {
-      // Done
-    } else if (super_version->imm->Get(lkey, value, &s, merge_context,
-                                       *cfd->options())) {
-      // Done
-    } else {
-      super_version->current->Get(options, lkey, value, &s, &merge_context,
-                                  &mgd->stats);
+
+    batch.clear();
+    for (; pos < num_keys; ++pos) {
+      size_t i = sorted_index[pos];
+      if (reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[i])
+              ->cfd() != cfd) {
+        break;
+      }
+      Status& s = stat_list[i];
+      std::string* value = &(*values)[i];
+
+      lookup_keys[i].reset(new LookupKey(keys[i], snapshot));
+      SequenceNumber range_del_seq =
+          super_version->MaxCoveringTombstoneSeq(keys[i], snapshot);
+      if (super_version->mem->Get(*lookup_keys[i], value, &s,
+                                  merge_contexts[i], *cfd->options(),
+                                  range_del_seq)) {
+        // Done
+      } else if (super_version->imm->Get(*lookup_keys[i], value, &s,
+                                         merge_contexts[i], *cfd->options(),
+                                         range_del_seq)) {
+        // Done
+      } else {
+        batch.push_back({lookup_keys[i].get(), value, &s, &merge_contexts[i],
+                         range_del_seq});
+      }
+    }
+
+    if (!batch.empty()) {
+      super_version->current->MultiGet(options, batch, &mgd->stats);
       mgd->have_stat_update = true;
     }
+  }
 
-    if (s.ok()) {
-      bytes_read += value->size();
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (stat_list[i].ok()) {
+      bytes_read += (*values)[i].size();
     }
   }
 
@@ -3523,14 +4048,15 @@ Iterator* DBImpl::NewIterator(const ReadOptions& options,
     SuperVersion* sv = nullptr;
     sv = cfd->GetReferencedSuperVersion(&mutex_);
 
-    iter = NewInternalIterator(options, cfd, sv);
-
     auto snapshot =
         options.snapshot != nullptr
             ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
             : latest_snapshot;
+    auto range_tombstones = sv->GetRangeTombstones();
+    iter = NewInternalIterator(options, cfd, sv, range_tombstones, snapshot);
     iter = NewDBIterator(env_, *cfd->options(),
-                         cfd->user_comparator(), iter, snapshot);
+                         cfd->user_comparator(), iter, snapshot,
+                         range_tombstones);
   }
 
   return iter;
@@ -3576,9 +4102,12 @@ Status DBImpl::NewIterators(
               ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
               : latest_snapshot;
 
-      auto iter = NewInternalIterator(options, cfd, super_versions[i]);
+      auto range_tombstones = super_versions[i]->GetRangeTombstones();
+      auto iter = NewInternalIterator(options, cfd, super_versions[i],
+                                      range_tombstones, snapshot);
       iter = NewDBIterator(env_, *cfd->options(),
-                           cfd->user_comparator(), iter, snapshot);
+                           cfd->user_comparator(), iter, snapshot,
+                           range_tombstones);
       iterators->push_back(iter);
     }
   }
@@ -3628,8 +4157,22 @@ Status DBImpl::Delete(const WriteOptions& options,
   return DB::Delete(options, column_family, key);
 }
 
+Status DBImpl::DeleteRange(const WriteOptions& options,
+                           ColumnFamilyHandle* column_family,
+                           const Slice& begin_key, const Slice& end_key) {
+  return DB::DeleteRange(options, column_family, begin_key, end_key);
+}
+
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   PERF_TIMER_AUTO(write_pre_and_post_process_time);
+  if (my_batch != nullptr) {
+    // Reject the batch before it reaches the log: the flush of its range
+    // tombstones would fail and stop all writes.
+    Status s = CheckRangeDeletionsSupported(my_batch);
+    if (!s.ok()) {
+      return s;
+    }
+  }
   Writer w(&mutex_);
   w.batch = my_batch;
   w.sync = options.sync;
@@ -3809,6 +4352,28 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
 
 // REQUIRES: Writer list must be non-empty
 // REQUIRES: First writer must have a non-nullptr batch
+Status DBImpl::CheckRangeDeletionsSupported(const WriteBatch* batch) {
+  std::vector<uint32_t> column_family_ids;
+  Status s = WriteBatchInternal::GetRangeDeletionColumnFamilies(
+      batch, &column_family_ids);
+  // A corrupted batch fails when it is applied
+  if (!s.ok() || column_family_ids.empty()) {
+    return Status::OK();
+  }
+  MutexLock l(&mutex_);
+  for (uint32_t id : column_family_ids) {
+    auto cfd = versions_->GetColumnFamilySet()->GetColumnFamily(id);
+    // Missing column families are handled when the batch is applied
+    if (cfd != nullptr &&
+        !cfd->options()->table_factory->SupportsRangeTombstones()) {
+      return Status::NotSupported(
+          "the table format of column family " + cfd->GetName() +
+          " cannot store range tombstones");
+    }
+  }
+  return Status::OK();
+}
+
 void DBImpl::BuildBatchGroup(Writer** last_writer,
                              autovector<WriteBatch*>* write_batch_group) {
   assert(!writers_.empty());
@@ -3915,7 +4480,7 @@ Status DBImpl::MakeRoomForWrite(
       // this delay hands over some CPU to the compaction thread in
       // case it is sharing the same core as the writer.
       uint64_t slowdown =
-          SlowdownAmount(cfd->current()->NumLevelFiles(0),
+          SlowdownAmount(cfd->current()->NumLevel0SortedRuns(),
                          cfd->options()->level0_slowdown_writes_trigger,
                          cfd->options()->level0_stop_writes_trigger);
       mutex_.Unlock();
@@ -3956,7 +4521,7 @@ Status DBImpl::MakeRoomForWrite(
                  STALL_MEMTABLE_COMPACTION_MICROS, stall);
       cfd->internal_stats()->RecordWriteStall(
           InternalStats::MEMTABLE_COMPACTION, stall);
-    } else if (cfd->current()->NumLevelFiles(0) >=
+    } else if (cfd->current()->NumLevel0SortedRuns() >=
                cfd->options()->level0_stop_writes_trigger) {
       // There are too many level-0 files.
       DelayLoggingAndReset();
@@ -4362,6 +4927,14 @@ Status DB::Delete(const WriteOptions& opt, ColumnFamilyHandle* column_family,
   return Write(opt, &batch);
 }
 
+Status DB::DeleteRange(const WriteOptions& opt,
+                       ColumnFamilyHandle* column_family,
+                       const Slice& begin_key, const Slice& end_key) {
+  WriteBatch batch;
+  batch.DeleteRange(column_family, begin_key, end_key);
+  return Write(opt, &batch);
+}
+
 Status DB::Merge(const WriteOptions& opt, ColumnFamilyHandle* column_family,
                  const Slice& key, const Slice& value) {
   WriteBatch batch;
@@ -4404,6 +4977,15 @@ Status DB::Open(const DBOptions& db_options, const std::string& dbname,
   *dbptr = nullptr;
   handles->clear();
 
+  if (db_options.use_direct_reads && db_options.allow_mmap_reads) {
+    return Status::InvalidArgument(
+        "use_direct_reads and allow_mmap_reads are mutually exclusive");
+  }
+  if (db_options.use_direct_writes && db_options.allow_mmap_writes) {
+    return Status::InvalidArgument(
+        "use_direct_writes and allow_mmap_writes are mutually exclusive");
+  }
+
   size_t max_write_buffer_size = 0;
   for (auto cf : column_families) {
     max_write_buffer_size =
@@ -57,6 +57,10 @@ class DBImpl : public DB {
   using DB::Delete;
   virtual Status Delete(const WriteOptions& options,
                         ColumnFamilyHandle* column_family, const Slice& key);
+  using DB::DeleteRange;
+  virtual Status DeleteRange(const WriteOptions& options,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key, const Slice& end_key);
   using DB::Write;
   virtual Status Write(const WriteOptions& options, WriteBatch* updates);
   using DB::Get;
@@ -183,6 +187,9 @@ class DBImpl : public DB {
   // get total level0 file size. Only for testing.
   uint64_t TEST_GetLevel0TotalSize();
 
+  // Number of range tombstones stored in the files of the current version.
+  int TEST_NumRangeTombstones(ColumnFamilyHandle* column_family = nullptr);
+
   void TEST_SetDefaultTimeToCheck(uint64_t default_interval_to_delete_obsolete_WAL)
   {
     default_interval_to_delete_obsolete_WAL_ = default_interval_to_delete_obsolete_WAL;
@@ -277,8 +284,13 @@ class DBImpl : public DB {
   unique_ptr<VersionSet> versions_;
   const DBOptions options_;
 
-  Iterator* NewInternalIterator(const ReadOptions&, ColumnFamilyData* cfd,
-                                SuperVersion* super_version);
+  // Child iterators whose entries are all covered by a tombstone of
+  // range_tombstones visible at snapshot skip past its end key.
+  Iterator* NewInternalIterator(
+      const ReadOptions&, ColumnFamilyData* cfd, SuperVersion* super_version,
+      const std::shared_ptr<const RangeTombstoneSets>& range_tombstones =
+          nullptr,
+      SequenceNumber snapshot = kMaxSequenceNumber);
 
  private:
   friend class DB;
@@ -336,6 +348,10 @@ class DBImpl : public DB {
   void BuildBatchGroup(Writer** last_writer,
                        autovector<WriteBatch*>* write_batch_group);
 
+  // Returns NotSupported if batch deletes a range of a column family whose
+  // table format cannot store range tombstones. REQUIRES: mutex not held
+  Status CheckRangeDeletionsSupported(const WriteBatch* batch);
+
   // Force current memtable contents to be flushed.
   Status FlushMemTable(ColumnFamilyData* cfd, const FlushOptions& options);
 
@@ -384,12 +400,34 @@ class DBImpl : public DB {
     bool is_compaction_v2,
     LogBuffer* log_buffer);
 
+  // Split the work of ProcessKeyValueCompaction() into the key ranges
+  // separated by "boundaries" and run them on parallel threads. The
+  // outputs of all ranges are collected in "compact".
+  Status ProcessSubcompactions(
+    const std::vector<std::string>& boundaries,
+    SequenceNumber visible_at_tip,
+    SequenceNumber earliest_snapshot,
+    SequenceNumber latest_snapshot,
+    DeletionState& deletion_state,
+    bool bottommost_level,
+    int64_t& imm_micros,
+    Iterator* input,
+    CompactionState* compact,
+    LogBuffer* log_buffer);
+
   // Call compaction_filter_v2->Filter() on kv-pairs in compact
   void CallCompactionFilterV2(CompactionState* compact,
     CompactionFilterV2* compaction_filter_v2);
 
   Status OpenCompactionOutputFile(CompactionState* compact);
-  Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
+  // The output file stores the range tombstones kept by the compaction up
+  // to next_user_key, the first user key of the next output file, or up to
+  // the end of the compaction's key range if it is nullptr.
+  Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input,
+                                    const Slice* next_user_key = nullptr);
+  // Finishes the open output file, and stores the range tombstones that no
+  // output file got in one of their own.
+  Status FinishCompactionOutputs(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact,
                                   LogBuffer* log_buffer);
   void AllocateCompactionOutputFileNumbers(CompactionState* compact);
@@ -516,6 +554,8 @@ class DBImpl : public DB {
     const InternalKey* begin;   // nullptr means beginning of key range
     const InternalKey* end;     // nullptr means end of key range
     InternalKey tmp_storage;    // Used to keep track of compaction progress
+    uint64_t input_bytes;       // size of the input level files in the range
+    uint64_t compacted_bytes;   // size of the input level files compacted
   };
   ManualCompaction* manual_compaction_;
 
@@ -620,4 +660,8 @@ CompressionType GetCompressionType(const Options& options, int level,
 // Determine compression type for L0 file written by memtable flush.
 CompressionType GetCompressionFlush(const Options& options);
 
+// Determine the compression level of an output file of the given level,
+// from options.compression_level_per_level or options.compression_opts.
+int GetCompressionLevel(const Options& options, int level);
+
 }  // namespace rocksdb
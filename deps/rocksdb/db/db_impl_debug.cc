@@ -20,6 +20,27 @@ uint64_t DBImpl::TEST_GetLevel0TotalSize() {
   return default_cf_handle_->cfd()->current()->NumLevelBytes(0);
 }
 
+int DBImpl::TEST_NumRangeTombstones(ColumnFamilyHandle* column_family) {
+  ColumnFamilyData* cfd;
+  if (column_family == nullptr) {
+    cfd = default_cf_handle_->cfd();
+  } else {
+    auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family);
+    cfd = cfh->cfd();
+  }
+  MutexLock l(&mutex_);
+  Version* current = cfd->current();
+  int count = 0;
+  for (int level = 0; level < current->NumberLevels(); level++) {
+    for (const auto& f : current->files_[level]) {
+      if (f->range_tombstones != nullptr) {
+        count += static_cast<int>(f->range_tombstones->size());
+      }
+    }
+  }
+  return count;
+}
+
 Iterator* DBImpl::TEST_NewInternalIterator(ColumnFamilyHandle* column_family) {
   ColumnFamilyData* cfd;
   if (column_family == nullptr) {
@@ -62,12 +62,14 @@ Status DBImplReadOnly::Get(const ReadOptions& options,
   SuperVersion* super_version = cfd->GetSuperVersion();
   MergeContext merge_context;
   LookupKey lkey(key, snapshot);
+  SequenceNumber range_del_seq =
+      super_version->MaxCoveringTombstoneSeq(key, snapshot);
   if (super_version->mem->Get(lkey, value, &s, merge_context,
-                              *cfd->options())) {
+                              *cfd->options(), range_del_seq)) {
   } else {
     Version::GetStats stats;
     super_version->current->Get(options, lkey, value, &s, &merge_context,
-                                &stats);
+                                &stats, nullptr, range_del_seq);
   }
   return s;
 }
@@ -78,12 +80,15 @@ Iterator* DBImplReadOnly::NewIterator(const ReadOptions& options,
   auto cfd = cfh->cfd();
   SuperVersion* super_version = cfd->GetSuperVersion()->Ref();
   SequenceNumber latest_snapshot = versions_->LastSequence();
-  Iterator* internal_iter = NewInternalIterator(options, cfd, super_version);
-  return NewDBIterator(
-      env_, *cfd->options(), cfd->user_comparator(), internal_iter,
-      (options.snapshot != nullptr
-           ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
-           : latest_snapshot));
+  SequenceNumber snapshot =
+      options.snapshot != nullptr
+          ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
+          : latest_snapshot;
+  auto range_tombstones = super_version->GetRangeTombstones();
+  Iterator* internal_iter = NewInternalIterator(
+      options, cfd, super_version, range_tombstones, snapshot);
+  return NewDBIterator(env_, *cfd->options(), cfd->user_comparator(),
+                       internal_iter, snapshot, range_tombstones);
 }
 
 Status DB::OpenForReadOnly(const Options& options, const std::string& dbname,
@@ -66,6 +66,12 @@ class DBImplReadOnly : public DBImpl {
                         ColumnFamilyHandle* column_family, const Slice& key) {
     return Status::NotSupported("Not supported operation in read only mode.");
   }
+  using DBImpl::DeleteRange;
+  virtual Status DeleteRange(const WriteOptions& options,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key, const Slice& end_key) {
+    return Status::NotSupported("Not supported operation in read only mode.");
+  }
   virtual Status Write(const WriteOptions& options, WriteBatch* updates) {
     return Status::NotSupported("Not supported operation in read only mode.");
   }
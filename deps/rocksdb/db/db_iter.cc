@@ -58,7 +58,8 @@ class DBIter: public Iterator {
   };
 
   DBIter(Env* env, const Options& options,
-         const Comparator* cmp, Iterator* iter, SequenceNumber s)
+         const Comparator* cmp, Iterator* iter, SequenceNumber s,
+         std::shared_ptr<const RangeTombstoneSets> range_tombstones)
       : env_(env),
         logger_(options.info_log.get()),
         user_comparator_(cmp),
@@ -68,7 +69,8 @@ class DBIter: public Iterator {
         direction_(kForward),
         valid_(false),
         current_entry_is_merged_(false),
-        statistics_(options.statistics.get()) {
+        statistics_(options.statistics.get()),
+        range_tombstones_(std::move(range_tombstones)) {
     RecordTick(statistics_, NO_ITERATORS, 1);
     max_skip_ = options.max_sequential_skip_in_iterations;
   }
@@ -107,6 +109,16 @@ class DBIter: public Iterator {
   bool ParseKey(ParsedInternalKey* key);
   void MergeValuesNewToOld();
 
+  // The type of ikey, or kTypeDeletion if a range tombstone deletes it.
+  inline ValueType EffectiveType(const ParsedInternalKey& ikey) const {
+    if (range_tombstones_ != nullptr &&
+        ikey.sequence <
+            range_tombstones_->MaxCoveringSeq(ikey.user_key, sequence_)) {
+      return kTypeDeletion;
+    }
+    return ikey.type;
+  }
+
   inline void ClearSavedValue() {
     if (saved_value_.capacity() > 1048576) {
       std::string empty;
@@ -131,6 +143,7 @@ class DBIter: public Iterator {
   bool current_entry_is_merged_;
   Statistics* statistics_;
   uint64_t max_skip_;
+  std::shared_ptr<const RangeTombstoneSets> range_tombstones_;
 
   // No copying allowed
   DBIter(const DBIter&);
@@ -207,7 +220,7 @@ void DBIter::FindNextUserEntryInternal(bool skipping) {
         PERF_COUNTER_ADD(internal_key_skipped_count, 1);
       } else {
         skipping = false;
-        switch (ikey.type) {
+        switch (EffectiveType(ikey)) {
           case kTypeDeletion:
             // Arrange to skip all upcoming entries for this key since
             // they are hidden by this deletion.
@@ -281,14 +294,15 @@ void DBIter::MergeValuesNewToOld() {
       break;
     }
 
-    if (kTypeDeletion == ikey.type) {
+    const ValueType type = EffectiveType(ikey);
+    if (kTypeDeletion == type) {
       // hit a delete with the same user key, stop right here
       // iter_ is positioned after delete
       iter_->Next();
       break;
     }
 
-    if (kTypeValue == ikey.type) {
+    if (kTypeValue == type) {
       // hit a put, merge the put value with operands and store the
       // final result in saved_value_. We are done!
       // ignore corruption if there is any.
@@ -300,7 +314,7 @@ void DBIter::MergeValuesNewToOld() {
       return;
     }
 
-    if (kTypeMerge == ikey.type) {
+    if (kTypeMerge == type) {
       // hit a merge, add the value as an operand and run associative merge.
       // when complete, add result to operands and continue.
       const Slice& value = iter_->value();
@@ -366,7 +380,7 @@ void DBIter::FindPrevUserEntry() {
           // We encountered a non-deleted value in entries for previous keys,
           break;
         }
-        value_type = ikey.type;
+        value_type = EffectiveType(ikey);
         if (value_type == kTypeDeletion) {
           saved_key_.Clear();
           ClearSavedValue();
@@ -468,9 +482,10 @@ Iterator* NewDBIterator(
     const Options& options,
     const Comparator *user_key_comparator,
     Iterator* internal_iter,
-    const SequenceNumber& sequence) {
+    const SequenceNumber& sequence,
+    std::shared_ptr<const RangeTombstoneSets> range_tombstones) {
   return new DBIter(env, options, user_key_comparator,
-                    internal_iter, sequence);
+                    internal_iter, sequence, std::move(range_tombstones));
 }
 
 }  // namespace rocksdb
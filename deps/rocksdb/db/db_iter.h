@@ -9,19 +9,23 @@
 
 #pragma once
 #include <stdint.h>
+#include <memory>
 #include "rocksdb/db.h"
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
 
 namespace rocksdb {
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys. Entries covered by one of "range_tombstones"
+// are treated as deleted.
 extern Iterator* NewDBIterator(
     Env* env,
     const Options& options,
     const Comparator *user_key_comparator,
     Iterator* internal_iter,
-    const SequenceNumber& sequence);
+    const SequenceNumber& sequence,
+    std::shared_ptr<const RangeTombstoneSets> range_tombstones = nullptr);
 
 }  // namespace rocksdb
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <iostream>
 #include <set>
+#include <thread>
 #include <unistd.h>
 #include <unordered_set>
 
@@ -24,6 +25,8 @@
 #include "rocksdb/env.h"
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/perf_context.h"
+#include "rocksdb/persistent_cache.h"
+#include "rocksdb/rate_limiter.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/table.h"
@@ -35,6 +38,7 @@
 #include "utilities/merge_operators.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/persistent_cache.h"
 #include "util/statistics.h"
 #include "util/testharness.h"
 #include "util/sync_point.h"
@@ -72,6 +76,12 @@ static bool LZ4HCCompressionSupported(const CompressionOptions &options) {
   return port::LZ4HC_Compress(options, in.data(), in.size(), &out);
 }
 
+static bool ZSTDCompressionSupported(const CompressionOptions &options) {
+  std::string out;
+  Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  return port::ZSTD_Compress(options, in.data(), in.size(), &out);
+}
+
 static std::string RandomString(Random *rnd, int len) {
   std::string r;
   test::RandomString(rnd, len, &r);
@@ -130,7 +140,10 @@ class SpecialEnv : public EnvWrapper {
 
   anon::AtomicCounter sleep_counter_;
 
-  explicit SpecialEnv(Env* base) : EnvWrapper(base) {
+  // Seconds added to the time returned by GetCurrentTime()
+  std::atomic<int64_t> addon_time_;
+
+  explicit SpecialEnv(Env* base) : EnvWrapper(base), addon_time_(0) {
     delay_sstable_sync_.Release_Store(nullptr);
     no_space_.Release_Store(nullptr);
     non_writable_.Release_Store(nullptr);
@@ -285,6 +298,14 @@ class SpecialEnv : public EnvWrapper {
     sleep_counter_.Increment();
     target()->SleepForMicroseconds(micros);
   }
+
+  virtual Status GetCurrentTime(int64_t* unix_time) {
+    Status s = target()->GetCurrentTime(unix_time);
+    if (s.ok()) {
+      *unix_time += addon_time_.load();
+    }
+    return s;
+  }
 };
 
 class DBTest {
@@ -317,6 +338,8 @@ class DBTest {
     kCompressedBlockCache,
     kInfiniteMaxOpenFiles,
     kxxHashChecksum,
+    kBlockBasedTableWithDataBlockHashIndex,
+    kBlockBasedTableWithDeltaEncodedIndex,
     kEnd
   };
   int option_config_;
@@ -517,6 +540,21 @@ class DBTest {
         options.prefix_extractor.reset(NewNoopTransform());
         break;
       }
+      case kBlockBasedTableWithDataBlockHashIndex: {
+        BlockBasedTableOptions table_options;
+        table_options.data_block_index_type =
+            BlockBasedTableOptions::kDataBlockBinaryAndHash;
+        options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+        break;
+      }
+      case kBlockBasedTableWithDeltaEncodedIndex: {
+        BlockBasedTableOptions table_options;
+        table_options.index_type =
+            BlockBasedTableOptions::kDeltaEncodedBinarySearch;
+        table_options.index_block_restart_interval = 4;
+        options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+        break;
+      }
       default:
         break;
     }
@@ -1198,6 +1236,57 @@ TEST(DBTest, GetPropertiesOfAllTablesTest) {
   VerifyTableProperties(db_, 10 + 11 + 12 + 13);
 }
 
+TEST(DBTest, PreloadTableFilesOnOpen) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.disable_auto_compactions = true;
+  options.max_mem_compaction_level = 0;
+  DestroyAndReopen(&options);
+  const int kNumFiles = 12;
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_OK(Put(Key(i), "val"));
+    ASSERT_OK(Flush());
+  }
+  ASSERT_EQ(kNumFiles, NumTableFilesAtLevel(0));
+
+  // Without preloading, the files are opened by the first reads.
+  options.statistics = rocksdb::CreateDBStatistics();
+  Reopen(&options);
+  ASSERT_EQ(0, TestGetTickerCount(options, NO_FILE_OPENS));
+  ASSERT_EQ("val", Get(Key(0)));
+  ASSERT_EQ(1, TestGetTickerCount(options, NO_FILE_OPENS));
+
+  // All the files are opened by DB::Open and the reads find them in the
+  // table cache.
+  options.preload_table_files_on_open = true;
+  options.max_file_opening_threads = 4;
+  options.statistics = rocksdb::CreateDBStatistics();
+  Reopen(&options);
+  ASSERT_EQ(kNumFiles, TestGetTickerCount(options, NO_FILE_OPENS));
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_EQ("val", Get(Key(i)));
+  }
+  ASSERT_EQ(kNumFiles, TestGetTickerCount(options, NO_FILE_OPENS));
+
+  // No more files are opened than the table cache holds.
+  options.max_open_files = 20;
+  options.statistics = rocksdb::CreateDBStatistics();
+  Reopen(&options);
+  ASSERT_EQ(10, TestGetTickerCount(options, NO_FILE_OPENS));
+
+  // With an unlimited table cache the files are opened anyway, on all the
+  // threads.
+  options.max_open_files = -1;
+  options.preload_table_files_on_open = false;
+  options.statistics = rocksdb::CreateDBStatistics();
+  Reopen(&options);
+  ASSERT_EQ(kNumFiles, TestGetTickerCount(options, NO_FILE_OPENS));
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_EQ("val", Get(Key(i)));
+  }
+  ASSERT_EQ(kNumFiles, TestGetTickerCount(options, NO_FILE_OPENS));
+}
+
 TEST(DBTest, LevelLimitReopen) {
   Options options = CurrentOptions();
   CreateAndReopenWithCF({"pikachu"}, &options);
@@ -2653,66 +2742,805 @@ TEST(DBTest, RecoverWithLargeLog) {
   } while (ChangeCompactOptions());
 }
 
-TEST(DBTest, CompactionsGenerateMultipleFiles) {
-  Options options;
-  options.write_buffer_size = 100000000;        // Large write buffer
-  options = CurrentOptions(options);
-  CreateAndReopenWithCF({"pikachu"}, &options);
+TEST(DBTest, CompactionsGenerateMultipleFiles) {
+  Options options;
+  options.write_buffer_size = 100000000;        // Large write buffer
+  options = CurrentOptions(options);
+  CreateAndReopenWithCF({"pikachu"}, &options);
+
+  Random rnd(301);
+
+  // Write 8MB (80 values, each 100K)
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
+  std::vector<std::string> values;
+  for (int i = 0; i < 80; i++) {
+    values.push_back(RandomString(&rnd, 100000));
+    ASSERT_OK(Put(1, Key(i), values[i]));
+  }
+
+  // Reopening moves updates to level-0
+  ReopenWithColumnFamilies({"default", "pikachu"}, &options);
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr, handles_[1]);
+
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
+  ASSERT_GT(NumTableFilesAtLevel(1, 1), 1);
+  for (int i = 0; i < 80; i++) {
+    ASSERT_EQ(Get(1, Key(i)), values[i]);
+  }
+}
+
+TEST(DBTest, CompactionTrigger) {
+  Options options;
+  options.write_buffer_size = 100<<10; //100KB
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.level0_file_num_compaction_trigger = 3;
+  options = CurrentOptions(options);
+  CreateAndReopenWithCF({"pikachu"}, &options);
+
+  Random rnd(301);
+
+  for (int num = 0; num < options.level0_file_num_compaction_trigger - 1;
+       num++) {
+    std::vector<std::string> values;
+    // Write 120KB (12 values, each 10K)
+    for (int i = 0; i < 12; i++) {
+      values.push_back(RandomString(&rnd, 10000));
+      ASSERT_OK(Put(1, Key(i), values[i]));
+    }
+    dbfull()->TEST_WaitForFlushMemTable(handles_[1]);
+    ASSERT_EQ(NumTableFilesAtLevel(0, 1), num + 1);
+  }
+
+  //generate one more file in level-0, and should trigger level-0 compaction
+  std::vector<std::string> values;
+  for (int i = 0; i < 12; i++) {
+    values.push_back(RandomString(&rnd, 10000));
+    ASSERT_OK(Put(1, Key(i), values[i]));
+  }
+  dbfull()->TEST_WaitForCompact();
+
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(1, 1), 1);
+}
+
+TEST(DBTest, Subcompactions) {
+  Options options;
+  options.write_buffer_size = 10 << 20;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.disable_auto_compactions = true;
+  options.max_subcompactions = 4;
+  options = CurrentOptions(options);
+  CreateAndReopenWithCF({"pikachu"}, &options);
+
+  // Four overlapping level-0 files, each covering a different window of
+  // the key space, with deletes in the newer ones.
+  Random rnd(301);
+  std::map<std::string, std::string> expected;
+  for (int file = 0; file < 4; file++) {
+    for (int i = file * 20; i < file * 20 + 40; i++) {
+      if (file > 0 && i % 7 == 0) {
+        ASSERT_OK(Delete(1, Key(i)));
+        expected.erase(Key(i));
+      } else {
+        expected[Key(i)] = RandomString(&rnd, 1000);
+        ASSERT_OK(Put(1, Key(i), expected[Key(i)]));
+      }
+    }
+    ASSERT_OK(Flush(1));
+  }
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 4);
+
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr, handles_[1]);
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
+  // Every key range got its own output file.
+  ASSERT_GT(NumTableFilesAtLevel(1, 1), 1);
+  ASSERT_LE(NumTableFilesAtLevel(1, 1), 4);
+
+  Iterator* iter = db_->NewIterator(ReadOptions(), handles_[1]);
+  auto expected_iter = expected.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++expected_iter) {
+    ASSERT_TRUE(expected_iter != expected.end());
+    ASSERT_EQ(expected_iter->first, iter->key().ToString());
+    ASSERT_EQ(expected_iter->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(expected_iter == expected.end());
+  ASSERT_OK(iter->status());
+  delete iter;
+
+  ReopenWithColumnFamilies({"default", "pikachu"}, &options);
+  for (int i = 0; i < 100; i++) {
+    auto it = expected.find(Key(i));
+    ASSERT_EQ(it == expected.end() ? "NOT_FOUND" : it->second, Get(1, Key(i)));
+  }
+}
+
+namespace {
+// Records the threads that compaction filters are called on, and how many
+// calls ran at the same time at most.
+class ThreadRecordingFilter : public CompactionFilter {
+ public:
+  ThreadRecordingFilter() : num_running_(0), max_running_(0) {}
+
+  virtual bool Filter(int level, const Slice& key, const Slice& value,
+                      std::string* new_value, bool* value_changed) const
+      override {
+    {
+      MutexLock l(&mutex_);
+      threads_.insert(std::this_thread::get_id());
+      max_running_ = std::max(max_running_, ++num_running_);
+    }
+    MutexLock l(&mutex_);
+    num_running_--;
+    return false;
+  }
+
+  virtual const char* Name() const override {
+    return "ThreadRecordingFilter";
+  }
+
+  size_t NumThreads() const {
+    MutexLock l(&mutex_);
+    return threads_.size();
+  }
+
+  size_t MaxRunning() const {
+    MutexLock l(&mutex_);
+    return max_running_;
+  }
+
+  void Reset() {
+    MutexLock l(&mutex_);
+    threads_.clear();
+    max_running_ = 0;
+  }
+
+ private:
+  mutable port::Mutex mutex_;
+  mutable std::set<std::thread::id> threads_;
+  mutable size_t num_running_;
+  mutable size_t max_running_;
+};
+
+// Forwards to another filter.
+class ForwardingFilter : public CompactionFilter {
+ public:
+  explicit ForwardingFilter(const CompactionFilter* target)
+      : target_(target) {}
+
+  virtual bool Filter(int level, const Slice& key, const Slice& value,
+                      std::string* new_value, bool* value_changed) const
+      override {
+    return target_->Filter(level, key, value, new_value, value_changed);
+  }
+
+  virtual const char* Name() const override { return "ForwardingFilter"; }
+
+ private:
+  const CompactionFilter* target_;
+};
+
+// Gives every compaction a filter of its own, forwarding to "target".
+class ForwardingFilterFactory : public CompactionFilterFactory {
+ public:
+  explicit ForwardingFilterFactory(const CompactionFilter* target)
+      : target_(target) {}
+
+  virtual std::unique_ptr<CompactionFilter> CreateCompactionFilter(
+      const CompactionFilter::Context& context) override {
+    return std::unique_ptr<CompactionFilter>(new ForwardingFilter(target_));
+  }
+
+  virtual const char* Name() const override {
+    return "ForwardingFilterFactory";
+  }
+
+ private:
+  const CompactionFilter* target_;
+};
+}  // namespace
+
+TEST(DBTest, ParallelManualCompaction) {
+  // 0: not parallel, 1: parallel, 2: parallel but with a single
+  // compaction_filter, which is never called from several threads at once.
+  for (int mode = 0; mode < 3; mode++) {
+    const bool parallel = mode > 0;
+    ThreadRecordingFilter filter;
+    Options options;
+    options.create_if_missing = true;
+    options.num_levels = 3;
+    options.max_mem_compaction_level = 0;
+    options.disable_auto_compactions = true;
+    options.target_file_size_base = 20 << 10;
+    if (mode == 2) {
+      options.compaction_filter = &filter;
+    } else {
+      options.compaction_filter_factory =
+          std::make_shared<ForwardingFilterFactory>(&filter);
+    }
+    options.max_background_compactions = 4;
+    env_->SetBackgroundThreads(4, Env::LOW);
+    options.parallel_manual_compaction = parallel;
+    options = CurrentOptions(options);
+    DestroyAndReopen(&options);
+
+    Random rnd(301);
+    std::map<std::string, std::string> expected;
+    for (int i = 0; i < 200; i++) {
+      expected[Key(i)] = RandomString(&rnd, 1000);
+      ASSERT_OK(Put(Key(i), expected[Key(i)]));
+    }
+    ASSERT_OK(Flush());
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    ASSERT_GT(NumTableFilesAtLevel(1), 4);
+
+    // One step of the manual compaction from level-1 to level-2 covers
+    // several input files, which are compacted on several threads.
+    filter.Reset();
+    dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+    ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+    ASSERT_GT(NumTableFilesAtLevel(2), 4);
+    if (mode == 1) {
+      ASSERT_GT(filter.NumThreads(), 1U);
+    } else {
+      ASSERT_EQ(filter.MaxRunning(), 1U);
+    }
+
+    for (const auto& kv : expected) {
+      ASSERT_EQ(kv.second, Get(kv.first));
+    }
+  }
+}
+
+TEST(DBTest, ParallelManualCompactionStepSize) {
+  // With a single compaction_filter, the steps of a manual compaction are
+  // not split into key ranges, so they take no more input than usual.
+  ThreadRecordingFilter filter;
+  Options options;
+  options.create_if_missing = true;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.disable_auto_compactions = true;
+  options.compression = kNoCompression;
+  options.target_file_size_base = 20 << 10;
+  // Every step writes its output to a file of its own
+  options.target_file_size_multiplier = 100;
+  options.compaction_filter = &filter;
+  options.max_background_compactions = 4;
+  options.parallel_manual_compaction = true;
+  options = CurrentOptions(options);
+  DestroyAndReopen(&options);
+
+  Random rnd(301);
+  for (int i = 0; i < 200; i++) {
+    ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+  }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  const int level1_files = NumTableFilesAtLevel(1);
+  ASSERT_GT(level1_files, 4);
+
+  // A step takes one or two level-1 files, not four times as many.
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_GE(NumTableFilesAtLevel(2) * 2, level1_files);
+}
+
+TEST(DBTest, DynamicLevelBytes) {
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 64 << 10;
+  options.level0_file_num_compaction_trigger = 2;
+  options.num_levels = 5;
+  options.target_file_size_base = 64 << 10;
+  options.max_bytes_for_level_base = 256 << 10;
+  options.max_bytes_for_level_multiplier = 4;
+  options.compression = kNoCompression;
+  options.level_compaction_dynamic_level_bytes = true;
+  options = CurrentOptions(options);
+  DestroyAndReopen(&options);
+
+  // About 2MB of data. With static targets (L1 256KB, L2 1MB, L3 4MB) none
+  // of it would reach the last level.
+  Random rnd(301);
+  std::map<std::string, std::string> expected;
+  for (int i = 0; i < 2000; i++) {
+    std::string key = Key(rnd.Uniform(1000000));
+    expected[key] = RandomString(&rnd, 1000);
+    ASSERT_OK(Put(key, expected[key]));
+  }
+  dbfull()->TEST_WaitForFlushMemTable();
+  dbfull()->TEST_WaitForCompact();
+
+  std::vector<uint64_t> level_bytes(options.num_levels, 0);
+  std::vector<LiveFileMetaData> metadata;
+  db_->GetLiveFilesMetaData(&metadata);
+  for (const auto& file : metadata) {
+    level_bytes[file.level] += file.size;
+  }
+  // Levels above the base level stay empty, and the last level holds most
+  // of the data.
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_GT(NumTableFilesAtLevel(4), 0);
+  ASSERT_LT(level_bytes[1] + level_bytes[2] + level_bytes[3], level_bytes[4]);
+
+  // A manual compaction compacts level-0 into the base level as well.
+  ASSERT_OK(Put(Key(0), "v"));
+  expected[Key(0)] = "v";
+  ASSERT_OK(Flush());
+  dbfull()->CompactRange(nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(2), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(3), 0);
+
+  // Moving the files to a level above the base level stops at the base
+  // level.
+  dbfull()->CompactRange(nullptr, nullptr, true, 1);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_GT(NumTableFilesAtLevel(2), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(4), 0);
+
+  Reopen(&options);
+  for (const auto& kv : expected) {
+    ASSERT_EQ(kv.second, Get(kv.first));
+  }
+}
+
+TEST(DBTest, CompactionPri) {
+  // Level-1 holds an older 60KB file that overlaps level-2 and a newer
+  // 40KB file that overlaps nothing. Level-1 only has room for one of them,
+  // and compaction_pri decides which one is compacted.
+  const CompactionPri kPris[] = {kByLargestSize, kOldestSmallestSeqFirst,
+                                 kMinOverlappingRatio};
+  const char* kRemainingKey[] = {"key000200", "key000200", "key000000"};
+  for (int p = 0; p < 3; p++) {
+    Options options;
+    options.create_if_missing = true;
+    options.num_levels = 3;
+    options.max_mem_compaction_level = 0;
+    options.compression = kNoCompression;
+    options.max_bytes_for_level_base = 80 << 10;
+    options.disable_auto_compactions = true;
+    options.compaction_pri = kPris[p];
+    DestroyAndReopen(&options);
+
+    Random rnd(301);
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+    }
+    ASSERT_OK(Flush());
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+    ASSERT_EQ(NumTableFilesAtLevel(2), 1);
+
+    for (int i = 0; i < 60; i++) {
+      ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+    }
+    ASSERT_OK(Flush());
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    for (int i = 200; i < 240; i++) {
+      ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+    }
+    ASSERT_OK(Flush());
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    ASSERT_EQ(NumTableFilesAtLevel(1), 2);
+
+    options.disable_auto_compactions = false;
+    Reopen(&options);
+    dbfull()->TEST_WaitForCompact();
+    ASSERT_EQ(NumTableFilesAtLevel(1), 1);
+
+    std::vector<LiveFileMetaData> metadata;
+    db_->GetLiveFilesMetaData(&metadata);
+    for (const auto& file : metadata) {
+      if (file.level == 1) {
+        ASSERT_EQ(kRemainingKey[p], file.smallestkey);
+      }
+    }
+  }
+}
+
+TEST(DBTest, DeletionTriggeredCompaction) {
+  for (int marking = 0; marking < 2; marking++) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.num_levels = 3;
+    options.max_mem_compaction_level = 0;
+    options.disable_auto_compactions = true;
+    if (marking) {
+      options.deletion_compaction_window = 10;
+      options.deletion_compaction_trigger = 5;
+    }
+    DestroyAndReopen(&options);
+
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(Put(Key(i), "v1"));
+    }
+    ASSERT_OK(Flush());
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    ASSERT_EQ(NumTableFilesAtLevel(1), 1);
+
+    for (int i = 0; i < 50; i++) {
+      ASSERT_OK(Delete(Key(i)));
+    }
+    ASSERT_OK(Put(Key(200), "v2"));
+    ASSERT_OK(Flush());
+    ASSERT_EQ(NumTableFilesAtLevel(0), 1);
+
+    std::vector<std::vector<FileMetaData>> metadata;
+    dbfull()->TEST_GetFilesMetaData(db_->DefaultColumnFamily(), &metadata);
+    ASSERT_EQ(1U, metadata[0].size());
+    ASSERT_EQ(marking != 0, metadata[0][0].marked_for_compaction);
+    ASSERT_TRUE(!metadata[1][0].marked_for_compaction);
+
+    // Level-0 is far from its compaction trigger, so only the marked file
+    // gets compacted. The mark survives the reopen.
+    options.disable_auto_compactions = false;
+    Reopen(&options);
+    dbfull()->TEST_WaitForCompact();
+    if (marking) {
+      ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+      ASSERT_EQ("[ ]", AllEntriesFor(Key(10)));
+    } else {
+      ASSERT_EQ(NumTableFilesAtLevel(0), 1);
+      ASSERT_EQ("[ DEL, v1 ]", AllEntriesFor(Key(10)));
+    }
+    ASSERT_EQ("NOT_FOUND", Get(Key(10)));
+    ASSERT_EQ("v1", Get(Key(50)));
+    ASSERT_EQ("v2", Get(Key(200)));
+  }
+}
+
+TEST(DBTest, DeleteRange) {
+  do {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("b", "vb"));
+    ASSERT_OK(Put("c", "vc"));
+    ASSERT_OK(Put("d", "vd"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_OK(db_->DeleteRange(WriteOptions(), "b", "d"));
+    ASSERT_OK(Put("c", "vc2"));
+
+    for (int i = 0; i < 3; i++) {
+      ASSERT_EQ("va", Get("a"));
+      ASSERT_EQ("NOT_FOUND", Get("b"));
+      ASSERT_EQ("vc2", Get("c"));
+      ASSERT_EQ("vd", Get("d"));
+      ASSERT_EQ("(a->va)(c->vc2)(d->vd)", Contents());
+      ASSERT_EQ("vb", Get("b", snapshot));
+      ASSERT_EQ("vc", Get("c", snapshot));
+      if (i == 0) {
+        ASSERT_OK(Flush());
+      } else if (i == 1) {
+        // Write the same keys and tombstone again after a reopen.
+        db_->ReleaseSnapshot(snapshot);
+        Reopen(&options);
+        ASSERT_OK(db_->DeleteRange(WriteOptions(), "c", "c"));
+        ASSERT_OK(Put("b", "vb"));
+        ASSERT_OK(Put("c", "vc"));
+        snapshot = db_->GetSnapshot();
+        ASSERT_OK(db_->DeleteRange(WriteOptions(), "b", "d"));
+        ASSERT_OK(Put("c", "vc2"));
+      }
+    }
+    db_->ReleaseSnapshot(snapshot);
+
+    // Recover the tombstone from the log.
+    Reopen(&options);
+    ASSERT_EQ("NOT_FOUND", Get("b"));
+    ASSERT_EQ("(a->va)(c->vc2)(d->vd)", Contents());
+  } while (ChangeCompactOptions());
+}
+
+TEST(DBTest, DeleteRangeMerge) {
+  Options options = CurrentOptions();
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+  ASSERT_OK(db_->Merge(WriteOptions(), "k", "a"));
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), "j", "l"));
+  ASSERT_OK(db_->Merge(WriteOptions(), "k", "b"));
+  ASSERT_EQ("b", Get("k"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("b", Get("k"));
+  ASSERT_OK(db_->Merge(WriteOptions(), "k", "c"));
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ("b,c", Get("k"));
+}
+
+TEST(DBTest, DeleteRangeManyTombstones) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  DestroyAndReopen(&options);
+
+  // Overlapping tombstones interleaved with writes, in the memtable and then
+  // split between the memtable and a table file.
+  Random rnd(301);
+  std::map<std::string, std::string> expected;
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 300; i++) {
+      if (rnd.OneIn(3)) {
+        int begin = rnd.Uniform(100);
+        int end = begin + rnd.Uniform(10);
+        ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(begin), Key(end)));
+        expected.erase(expected.lower_bound(Key(begin)),
+                       expected.lower_bound(Key(end)));
+      } else {
+        std::string key = Key(rnd.Uniform(100));
+        expected[key] = RandomString(&rnd, 10);
+        ASSERT_OK(Put(key, expected[key]));
+      }
+      if (i % 50 == 49) {
+        for (int k = 0; k < 100; k++) {
+          auto it = expected.find(Key(k));
+          ASSERT_EQ(it == expected.end() ? "NOT_FOUND" : it->second,
+                    Get(Key(k)));
+        }
+        Iterator* iter = db_->NewIterator(ReadOptions());
+        auto it = expected.begin();
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+          ASSERT_TRUE(it != expected.end());
+          ASSERT_EQ(it->first, iter->key().ToString());
+          ASSERT_EQ(it->second, iter->value().ToString());
+        }
+        ASSERT_TRUE(it == expected.end());
+        delete iter;
+      }
+    }
+    ASSERT_OK(Flush());
+  }
+}
+
+TEST(DBTest, DeleteRangeCompaction) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.disable_auto_compactions = true;
+  options.statistics = rocksdb::CreateDBStatistics();
+  DestroyAndReopen(&options);
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), "v1"));
+  }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 1);
+
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(10), Key(20)));
+  ASSERT_OK(Put(Key(15), "v2"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ(1, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("NOT_FOUND", Get(Key(10)));
+  ASSERT_EQ("v2", Get(Key(15)));
+  ASSERT_EQ("v1", Get(Key(20)));
+
+  // The compaction drops the covered keys, and the tombstone is no longer
+  // needed afterwards.
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(9, TestGetTickerCount(options, COMPACTION_KEY_DROP_RANGE_DEL));
+  ASSERT_EQ("[ ]", AllEntriesFor(Key(10)));
+  ASSERT_EQ("[ v2 ]", AllEntriesFor(Key(15)));
+  ASSERT_EQ(0, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("NOT_FOUND", Get(Key(10)));
+  ASSERT_EQ("v2", Get(Key(15)));
+  ASSERT_EQ("v1", Get(Key(20)));
+
+  // A tombstone is read back from its table file after a reopen, and is kept
+  // until it is obsolete.
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(50), Key(60)));
+  Reopen(&options);
+  ASSERT_EQ(1, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("NOT_FOUND", Get(Key(55)));
+  Reopen(&options);
+  ASSERT_EQ(1, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("NOT_FOUND", Get(Key(55)));
+  ASSERT_EQ("v1", Get(Key(60)));
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ("[ ]", AllEntriesFor(Key(55)));
+  ASSERT_EQ(0, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("v1", Get(Key(60)));
+}
+
+TEST(DBTest, DeleteRangeKeptByCompaction) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(&options);
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), "v1"));
+  }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(2), 1);
+
+  // The level-2 keys are not part of the compaction, so the tombstones move
+  // to level 1 in an output file that holds no keys.
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(10), Key(20)));
+  ASSERT_OK(Flush());
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(15), Key(25)));
+  ASSERT_OK(Flush());
+  ASSERT_EQ(NumTableFilesAtLevel(0), 2);
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 1);
+  ASSERT_EQ(2, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("NOT_FOUND", Get(Key(10)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(24)));
+  Reopen(&options);
+  ASSERT_EQ(2, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("NOT_FOUND", Get(Key(10)));
+  ASSERT_EQ("NOT_FOUND", Get(Key(24)));
+  ASSERT_EQ("v1", Get(Key(25)));
+
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ(0, dbfull()->TEST_NumRangeTombstones());
+  ASSERT_EQ("[ ]", AllEntriesFor(Key(15)));
+  ASSERT_EQ("v1", Get(Key(25)));
+}
+
+TEST(DBTest, DeleteRangeSplitAcrossOutputs) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.disable_auto_compactions = true;
+  options.target_file_size_base = 20 * 1024;
+  options.compression = kNoCompression;
+  DestroyAndReopen(&options);
 
   Random rnd(301);
-
-  // Write 8MB (80 values, each 100K)
-  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
-  std::vector<std::string> values;
-  for (int i = 0; i < 80; i++) {
-    values.push_back(RandomString(&rnd, 100000));
-    ASSERT_OK(Put(1, Key(i), values[i]));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
   }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_GT(NumTableFilesAtLevel(2), 1);
 
-  // Reopening moves updates to level-0
-  ReopenWithColumnFamilies({"default", "pikachu"}, &options);
-  dbfull()->TEST_CompactRange(0, nullptr, nullptr, handles_[1]);
+  // The keys written after the tombstone survive the compaction to level 1,
+  // and so does the tombstone, which still covers the level-2 keys.
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(0), Key(100)));
+  for (int i = 0; i < 100; i += 2) {
+    ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+  }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_GT(NumTableFilesAtLevel(1), 1);
+
+  // Every level-1 file covers its own part of the tombstone.
+  std::vector<std::vector<FileMetaData>> metadata;
+  dbfull()->TEST_GetFilesMetaData(db_->DefaultColumnFamily(), &metadata);
+  const InternalKeyComparator icmp(options.comparator);
+  std::string covered_until = Key(0);
+  for (const auto& f : metadata[1]) {
+    ASSERT_TRUE(f.range_tombstones != nullptr);
+    ASSERT_EQ(1U, f.range_tombstones->size());
+    const RangeTombstone& t = (*f.range_tombstones)[0];
+    ASSERT_EQ(covered_until, t.start_key);
+    ASSERT_LE(icmp.Compare(f.smallest, InternalKey(t.start_key,
+                                                   kMaxSequenceNumber,
+                                                   kTypeDeletion)),
+              0);
+    ASSERT_GE(icmp.Compare(f.largest, InternalKey(t.end_key,
+                                                  kMaxSequenceNumber,
+                                                  kValueTypeForSeek)),
+              0);
+    covered_until = t.end_key;
+  }
+  ASSERT_EQ(Key(100), covered_until);
+  ASSERT_EQ(NumTableFilesAtLevel(1), dbfull()->TEST_NumRangeTombstones());
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(i % 2 == 0, Get(Key(i)) != "NOT_FOUND");
+  }
+  Reopen(&options);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(i % 2 == 0, Get(Key(i)) != "NOT_FOUND");
+  }
 
-  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
-  ASSERT_GT(NumTableFilesAtLevel(1, 1), 1);
-  for (int i = 0; i < 80; i++) {
-    ASSERT_EQ(Get(1, Key(i)), values[i]);
+  // Once the level-2 keys are gone, so is the tombstone.
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ(0, dbfull()->TEST_NumRangeTombstones());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(i % 2 == 0, Get(Key(i)) != "NOT_FOUND");
   }
 }
 
-TEST(DBTest, CompactionTrigger) {
-  Options options;
-  options.write_buffer_size = 100<<10; //100KB
+TEST(DBTest, DeleteRangeIteratorSkipsCoveredKeys) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
   options.num_levels = 3;
   options.max_mem_compaction_level = 0;
-  options.level0_file_num_compaction_trigger = 3;
-  options = CurrentOptions(options);
-  CreateAndReopenWithCF({"pikachu"}, &options);
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(&options);
 
-  Random rnd(301);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), "v1"));
+  }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 1);
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(10), Key(90)));
+  ASSERT_OK(Put(Key(50), "v2"));
 
-  for (int num = 0; num < options.level0_file_num_compaction_trigger - 1;
-       num++) {
-    std::vector<std::string> values;
-    // Write 120KB (12 values, each 10K)
-    for (int i = 0; i < 12; i++) {
-      values.push_back(RandomString(&rnd, 10000));
-      ASSERT_OK(Put(1, Key(i), values[i]));
+  for (int i = 0; i < 2; i++) {
+    // The level-1 file seeks past the covered keys instead of yielding them
+    // one by one.
+    SetPerfLevel(kEnableCount);
+    perf_context.Reset();
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      count++;
     }
-    dbfull()->TEST_WaitForFlushMemTable(handles_[1]);
-    ASSERT_EQ(NumTableFilesAtLevel(0, 1), num + 1);
+    ASSERT_EQ(21, count);
+    ASSERT_LT(perf_context.internal_delete_skipped_count, 10U);
+    iter->Seek(Key(20));
+    ASSERT_EQ(IterStatus(iter), Key(50) + "->v2");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), Key(90) + "->v1");
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), Key(50) + "->v2");
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), Key(9) + "->v1");
+    delete iter;
+    SetPerfLevel(kDisable);
+    ASSERT_OK(Flush());
   }
+}
 
-  //generate one more file in level-0, and should trigger level-0 compaction
-  std::vector<std::string> values;
-  for (int i = 0; i < 12; i++) {
-    values.push_back(RandomString(&rnd, 10000));
-    ASSERT_OK(Put(1, Key(i), values[i]));
+TEST(DBTest, DeleteRangeSkipsCoveredFiles) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.disable_auto_compactions = true;
+  options.statistics = rocksdb::CreateDBStatistics();
+  DestroyAndReopen(&options);
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put(Key(i), "v1"));
   }
-  dbfull()->TEST_WaitForCompact();
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 1);
 
-  ASSERT_EQ(NumTableFilesAtLevel(0, 1), 0);
-  ASSERT_EQ(NumTableFilesAtLevel(1, 1), 1);
+  // A snapshot older than the tombstone keeps the file alive.
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), Key(0), Key(100)));
+  ASSERT_OK(Put(Key(100), "v2"));
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(2), 1);
+  ASSERT_EQ("v1", Get(Key(50), snapshot));
+  ASSERT_EQ("NOT_FOUND", Get(Key(50)));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Without the snapshot the level-2 file is dropped without being read.
+  ASSERT_OK(Put(Key(50), "v3"));
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 1);
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(2), 1);
+  ASSERT_EQ(0, TestGetTickerCount(options, COMPACTION_KEY_DROP_RANGE_DEL));
+  ASSERT_EQ("[ ]", AllEntriesFor(Key(10)));
+  ASSERT_EQ("[ v3 ]", AllEntriesFor(Key(50)));
+  ASSERT_EQ("(" + Key(50) + "->v3)(" + Key(100) + "->v2)", Contents());
+  ASSERT_EQ(0, dbfull()->TEST_NumRangeTombstones());
 }
 
 // This is a static filter used for filtering
@@ -3020,6 +3848,73 @@ TEST(DBTest, UniversalCompactionOptions) {
   }
 }
 
+TEST(DBTest, UniversalCompactionPartitionedRuns) {
+  Options options;
+  options.compaction_style = kCompactionStyleUniversal;
+  options.write_buffer_size = 100<<10; //100KB
+  options.level0_file_num_compaction_trigger = 4;
+  options.num_levels = 1;
+  options.compaction_options_universal.partitioned_runs = true;
+  options = CurrentOptions(options);
+  CreateAndReopenWithCF({"pikachu"}, &options);
+
+  Random rnd(301);
+  std::map<int, std::string> values;
+
+  // Files with disjoint key ranges form a single sorted run, so writing
+  // keys in order never triggers a compaction.
+  const int kNumFiles = 8;
+  for (int num = 0; num < kNumFiles; num++) {
+    // Write 110KB (11 values, each 10K)
+    for (int i = 0; i < 11; i++) {
+      int key_idx = num * 11 + i;
+      values[key_idx] = RandomString(&rnd, 10000);
+      ASSERT_OK(Put(1, Key(key_idx), values[key_idx]));
+    }
+    dbfull()->TEST_WaitForFlushMemTable(handles_[1]);
+  }
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), kNumFiles);
+
+  // Overwrite the keys of the first file until a size amplification
+  // compaction is triggered. Only the files holding those keys are
+  // rewritten, the others stay where they are.
+  options.compaction_options_universal.max_size_amplification_percent = 10;
+  ReopenWithColumnFamilies({"default", "pikachu"}, &options);
+  for (int num = 0; num < 3; num++) {
+    for (int i = 0; i < 11; i++) {
+      values[i] = RandomString(&rnd, 10000);
+      ASSERT_OK(Put(1, Key(i), values[i]));
+    }
+    dbfull()->TEST_WaitForFlushMemTable(handles_[1]);
+  }
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_EQ(NumTableFilesAtLevel(0, 1), kNumFiles);
+
+  for (const auto& kv : values) {
+    ASSERT_EQ(kv.second, Get(1, Key(kv.first)));
+  }
+
+  // The run is read as one concatenated level
+  Iterator* iter = db_->NewIterator(ReadOptions(), handles_[1]);
+  auto expected = values.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++expected) {
+    ASSERT_TRUE(expected != values.end());
+    ASSERT_EQ(Key(expected->first), iter->key().ToString());
+    ASSERT_EQ(expected->second, iter->value().ToString());
+  }
+  ASSERT_TRUE(expected == values.end());
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    --expected;
+    ASSERT_EQ(Key(expected->first), iter->key().ToString());
+  }
+  ASSERT_TRUE(expected == values.begin());
+  iter->Seek(Key(50));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(values[50], iter->value().ToString());
+  delete iter;
+}
+
 TEST(DBTest, UniversalCompactionStopStyleSimilarSize) {
   Options options = CurrentOptions();
   options.compaction_style = kCompactionStyleUniversal;
@@ -3310,6 +4205,66 @@ TEST(DBTest, UniversalCompactionCompressRatio2) {
 }
 #endif
 
+TEST(DBTest, PersistentCache) {
+  std::vector<CompressionType> compression_types = {kNoCompression};
+  if (ZlibCompressionSupported(CompressionOptions())) {
+    compression_types.push_back(kZlibCompression);
+  }
+  for (auto compression : compression_types) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.statistics = rocksdb::CreateDBStatistics();
+    options.compression = compression;
+    // Without a block cache in memory, every data block read goes to the
+    // persistent cache.
+    options.no_block_cache = true;
+    options.block_cache = nullptr;
+    std::shared_ptr<PersistentCache> persistent_cache;
+    ASSERT_OK(NewPersistentCache(Env::Default(),
+                                 test::TmpDir() + "/db_test_persistent_cache",
+                                 16 << 20, &persistent_cache));
+    options.persistent_cache = persistent_cache;
+    DestroyAndReopen(&options);
+
+    Random rnd(301);
+    std::vector<std::string> values;
+    std::string str;
+    for (int i = 0; i < 100; i++) {
+      test::CompressibleString(&rnd, 0.5, 1000, &str);
+      values.push_back(str);
+      ASSERT_OK(Put(Key(i), values[i]));
+    }
+    ASSERT_OK(Flush());
+
+    // The first round reads each data block from the table file once, the
+    // second round finds all of them in the persistent cache.
+    for (int round = 0; round < 2; round++) {
+      for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(values[i], Get(Key(i)));
+      }
+    }
+    const long misses = TestGetTickerCount(options, PERSISTENT_CACHE_MISS);
+    ASSERT_GT(misses, 0);
+    ASSERT_GE(TestGetTickerCount(options, PERSISTENT_CACHE_HIT), 200 - misses);
+    static_cast<LogPersistentCache*>(persistent_cache.get())
+        ->TEST_WaitForPendingWrites();
+    ASSERT_GT(persistent_cache->GetUsage(), 0U);
+
+    // Compressed blocks found in the persistent cache refill the compressed
+    // block cache.
+    if (compression != kNoCompression) {
+      options.block_cache_compressed = NewLRUCache(8 << 20);
+      Reopen(&options);
+      for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 100; i++) {
+          ASSERT_EQ(values[i], Get(Key(i)));
+        }
+      }
+      ASSERT_GT(TestGetTickerCount(options, BLOCK_CACHE_COMPRESSED_HIT), 0);
+    }
+  }
+}
+
 TEST(DBTest, ConvertCompactionStyle) {
   Random rnd(301);
   int max_key_level_insert = 200;
@@ -3467,6 +4422,10 @@ bool MinLevelToCompress(CompressionType& type, Options& options, int wbits,
                  CompressionOptions(wbits, lev, strategy))) {
     type = kLZ4HCCompression;
     fprintf(stderr, "using lz4hc\n");
+  } else if (ZSTDCompressionSupported(
+                 CompressionOptions(wbits, lev, strategy))) {
+    type = kZSTDCompression;
+    fprintf(stderr, "using zstd\n");
   } else {
     fprintf(stderr, "skipping test, compression disabled\n");
     return false;
@@ -3524,6 +4483,36 @@ TEST(DBTest, MinLevelToCompress2) {
   MinLevelHelper(this, options);
 }
 
+TEST(DBTest, CompressionLevelPerLevel) {
+  if (!ZlibCompressionSupported(CompressionOptions())) {
+    return;
+  }
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.compression = kZlibCompression;
+  options.max_mem_compaction_level = 0;
+  uint64_t sizes[2];
+  for (int i = 0; i < 2; i++) {
+    // zlib level 0 does not compress, so the level-1 outputs of the second
+    // round are written uncompressed. Flushes keep using the default level.
+    options.compression_level_per_level = {9, i == 0 ? 9 : 0};
+    DestroyAndReopen(&options);
+    Random rnd(301);
+    std::string value;
+    for (int k = 0; k < 1000; k++) {
+      test::CompressibleString(&rnd, 0.5, 1000, &value);
+      ASSERT_OK(Put(Key(k), value));
+    }
+    ASSERT_OK(Flush());
+    ASSERT_EQ(NumTableFilesAtLevel(0), 1);
+    dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+    ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+    ASSERT_GT(NumTableFilesAtLevel(1), 0);
+    sizes[i] = Size("", Key(1000));
+  }
+  ASSERT_GT(sizes[1], sizes[0] * 3 / 2);
+}
+
 TEST(DBTest, RepeatedWritesToSameKey) {
   do {
     Options options;
@@ -3873,6 +4862,67 @@ TEST(DBTest, CompactionFilterDeletesAll) {
   delete itr;
 }
 
+TEST(DBTest, PeriodicCompaction) {
+  KeepFilter filter;
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.env = env_;
+  options.num_levels = 3;
+  options.max_mem_compaction_level = 0;
+  options.compaction_filter = &filter;
+  std::vector<std::vector<FileMetaData>> metadata;
+
+  // Without periodic compaction, no age is recorded.
+  DestroyAndReopen(&options);
+  ASSERT_OK(Put(Key(0), "v0"));
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  dbfull()->TEST_GetFilesMetaData(db_->DefaultColumnFamily(), &metadata);
+  ASSERT_EQ(metadata[1][0].creation_time, 0U);
+
+  options.periodic_compaction_seconds = 1000;
+  DestroyAndReopen(&options);
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(Put(Key(i), "v1"));
+  }
+  ASSERT_OK(Flush());
+  dbfull()->TEST_CompactRange(0, nullptr, nullptr);
+  dbfull()->TEST_CompactRange(1, nullptr, nullptr);
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+  ASSERT_OK(Put(Key(20), "v2"));
+  ASSERT_OK(Flush());
+  ASSERT_EQ("1,0,1", FilesPerLevel());
+
+  dbfull()->TEST_GetFilesMetaData(db_->DefaultColumnFamily(), &metadata);
+  ASSERT_GT(metadata[0][0].creation_time, 0U);
+  ASSERT_GT(metadata[2][0].creation_time, 0U);
+
+  // Nothing is old enough yet.
+  cfilter_count = 0;
+  Reopen(&options);
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_EQ("1,0,1", FilesPerLevel());
+  ASSERT_EQ(cfilter_count, 0);
+
+  // Both files expire. The level-0 file is compacted into level-1 and the
+  // file of the last level is rewritten in place, so the compaction filter
+  // sees every key.
+  env_->addon_time_ += 2000;
+  Reopen(&options);
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_EQ("0,1,1", FilesPerLevel());
+  ASSERT_EQ(cfilter_count, 11);
+
+  // The rewritten files are new again and are left alone.
+  Reopen(&options);
+  dbfull()->TEST_WaitForCompact();
+  ASSERT_EQ(cfilter_count, 11);
+  ASSERT_EQ("v1", Get(Key(5)));
+  ASSERT_EQ("v2", Get(Key(20)));
+  env_->addon_time_ = 0;
+}
+
 TEST(DBTest, CompactionFilterWithValueChange) {
   do {
     Options options;
@@ -6157,6 +7207,13 @@ class ModelDB: public DB {
     batch.Delete(cf, key);
     return Write(o, &batch);
   }
+  using DB::DeleteRange;
+  virtual Status DeleteRange(const WriteOptions& o, ColumnFamilyHandle* cf,
+                             const Slice& begin_key, const Slice& end_key) {
+    WriteBatch batch;
+    batch.DeleteRange(cf, begin_key, end_key);
+    return Write(o, &batch);
+  }
   using DB::Get;
   virtual Status Get(const ReadOptions& options, ColumnFamilyHandle* cf,
                      const Slice& key, std::string* value) {
@@ -6231,6 +7288,12 @@ class ModelDB: public DB {
       virtual void Delete(const Slice& key) {
         map_->erase(key.ToString());
       }
+      virtual void DeleteRange(const Slice& begin_key, const Slice& end_key) {
+        if (begin_key.compare(end_key) < 0) {
+          map_->erase(map_->lower_bound(begin_key.ToString()),
+                      map_->lower_bound(end_key.ToString()));
+        }
+      }
     };
     Handler handler;
     handler.map_ = &map_;
@@ -6529,6 +7592,56 @@ TEST(DBTest, MultiGetSimple) {
   } while (ChangeCompactOptions());
 }
 
+TEST(DBTest, MultiGetFromFiles) {
+  do {
+    CreateAndReopenWithCF({"pikachu"});
+    Random rnd(301);
+    // Spread the keys over the memtable, level-0 files and the compacted
+    // levels, with overwrites and deletes in the newer layers.
+    for (int i = 0; i < 200; i++) {
+      ASSERT_OK(Put(i % 2, Key(i), RandomString(&rnd, 100)));
+    }
+    dbfull()->CompactRange(handles_[0], nullptr, nullptr);
+    dbfull()->CompactRange(handles_[1], nullptr, nullptr);
+    for (int i = 0; i < 200; i += 3) {
+      ASSERT_OK(Put(i % 2, Key(i), RandomString(&rnd, 100)));
+    }
+    ASSERT_OK(Flush(0));
+    ASSERT_OK(Flush(1));
+    for (int i = 0; i < 200; i += 7) {
+      ASSERT_OK(Delete(i % 2, Key(i)));
+    }
+    ASSERT_OK(Flush(0));
+    ASSERT_OK(Flush(1));
+    for (int i = 0; i < 200; i += 11) {
+      ASSERT_OK(Put(i % 2, Key(i), RandomString(&rnd, 100)));
+    }
+
+    // Ask for the keys in random order, each from both column families,
+    // including keys that were never written and duplicates.
+    std::vector<std::string> key_data;
+    std::vector<ColumnFamilyHandle*> cfs;
+    for (int i = 0; i < 500; i++) {
+      key_data.push_back(Key(rnd.Uniform(250)));
+      cfs.push_back(handles_[rnd.Uniform(2)]);
+    }
+    std::vector<Slice> keys(key_data.begin(), key_data.end());
+    std::vector<std::string> values;
+    std::vector<Status> s = db_->MultiGet(ReadOptions(), cfs, keys, &values);
+    ASSERT_EQ(values.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      int cf = cfs[i] == handles_[0] ? 0 : 1;
+      std::string expected = Get(cf, key_data[i]);
+      if (expected == "NOT_FOUND") {
+        ASSERT_TRUE(s[i].IsNotFound());
+      } else {
+        ASSERT_OK(s[i]);
+        ASSERT_EQ(expected, values[i]);
+      }
+    }
+  } while (ChangeOptions());
+}
+
 TEST(DBTest, MultiGetEmpty) {
   do {
     CreateAndReopenWithCF({"pikachu"});
@@ -6557,6 +7670,90 @@ TEST(DBTest, MultiGetEmpty) {
   } while (ChangeCompactOptions());
 }
 
+TEST(DBTest, DirectIO) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_mmap_reads = true;
+  options.use_direct_reads = true;
+  ASSERT_TRUE(TryReopen(&options).IsInvalidArgument());
+  options.allow_mmap_reads = false;
+  options.allow_mmap_writes = true;
+  options.use_direct_writes = true;
+  ASSERT_TRUE(TryReopen(&options).IsInvalidArgument());
+  options.allow_mmap_writes = false;
+
+  {
+    // Skip if the file system of the test directory rejects O_DIRECT
+    EnvOptions env_options(options);
+    unique_ptr<WritableFile> file;
+    Status s = env_->NewWritableFile(dbname_ + "/direct_io_probe", &file,
+                                     env_options);
+    if (!s.ok()) {
+      fprintf(stderr, "Direct I/O is not available: %s, skipping\n",
+              s.ToString().c_str());
+      return;
+    }
+    ASSERT_OK(file->Close());
+    ASSERT_OK(env_->DeleteFile(dbname_ + "/direct_io_probe"));
+  }
+
+  DestroyAndReopen(&options);
+  Random rnd(301);
+  std::map<std::string, std::string> expected;
+  for (int i = 0; i < 1000; i++) {
+    std::string key = Key(rnd.Uniform(2000));
+    expected[key] = RandomString(&rnd, 1 + rnd.Uniform(2000));
+    ASSERT_OK(Put(key, expected[key]));
+    if (i % 300 == 299) {
+      ASSERT_OK(Flush());
+    }
+  }
+  dbfull()->CompactRange(nullptr, nullptr);
+  ASSERT_OK(Flush());
+
+  for (int reopen = 0; reopen < 2; reopen++) {
+    for (const auto& kv : expected) {
+      ASSERT_EQ(kv.second, Get(kv.first));
+    }
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    auto it = expected.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+      ASSERT_TRUE(it != expected.end());
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(it == expected.end());
+    delete iter;
+    Reopen(&options);
+  }
+}
+
+TEST(DBTest, RateLimiting) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.write_buffer_size = 100 << 10;  // 100KB
+  options.level0_file_num_compaction_trigger = 2;
+  options.statistics = rocksdb::CreateDBStatistics();
+  options.rate_limiter.reset(NewGenericRateLimiter(1 << 20));  // 1MB/s
+  DestroyAndReopen(&options);
+
+  Random rnd(301);
+  for (int i = 0; i < 500; i++) {
+    ASSERT_OK(Put(Key(i % 250), RandomString(&rnd, 1000)));
+  }
+  dbfull()->TEST_WaitForFlushMemTable();
+  dbfull()->TEST_WaitForCompact();
+
+  // Both flush and compaction output went through the rate limiter.
+  ASSERT_GT(options.rate_limiter->GetTotalBytesThrough(Env::HIGH), 0);
+  ASSERT_GT(options.rate_limiter->GetTotalBytesThrough(Env::LOW), 0);
+  ASSERT_EQ(options.rate_limiter->GetTotalBytesThrough(),
+            options.rate_limiter->GetTotalBytesThrough(Env::HIGH) +
+                options.rate_limiter->GetTotalBytesThrough(Env::LOW));
+  ASSERT_GT(TestGetTickerCount(options, RATE_LIMITER_THROTTLED_BYTES), 0);
+}
+
 namespace {
 void PrefixScanInit(DBTest *dbtest) {
   char buf[100];
@@ -17,7 +17,8 @@ namespace rocksdb {
 
 uint64_t PackSequenceAndType(uint64_t seq, ValueType t) {
   assert(seq <= kMaxSequenceNumber);
-  assert(t <= kValueTypeForSeek);
+  // Range tombstones are stored with their own type in table files.
+  assert(t <= kValueTypeForSeek || t == kTypeRangeDeletion);
   return (seq << 8) | t;
 }
 
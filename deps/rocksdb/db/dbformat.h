@@ -38,6 +38,8 @@ enum ValueType : unsigned char {
   kTypeColumnFamilyDeletion = 0x4,
   kTypeColumnFamilyValue = 0x5,
   kTypeColumnFamilyMerge = 0x6,
+  kTypeRangeDeletion = 0x7,
+  kTypeColumnFamilyRangeDeletion = 0x8,
   kMaxValue = 0x7F
 };
 
@@ -159,7 +159,7 @@ bool InternalStats::GetProperty(DBPropertyType property_type,
                    "%9lu\n",
                    level, files, current->NumLevelBytes(level) / 1048576.0,
                    current->NumLevelBytes(level) /
-                       cfd->compaction_picker()->MaxBytesForLevel(level),
+                       current->MaxBytesForLevel(level),
                    compaction_stats_[level].micros / 1e6,
                    bytes_read / 1048576.0,
                    compaction_stats_[level].bytes_written / 1048576.0,
@@ -44,11 +44,13 @@ MemTable::MemTable(const InternalKeyComparator& cmp, const Options& options)
       flush_completed_(false),
       file_number_(0),
       first_seqno_(0),
+      largest_seqno_(0),
       mem_next_logfile_number_(0),
       locks_(options.inplace_update_support ? options.inplace_update_num_locks
                                             : 0),
       prefix_extractor_(options.prefix_extractor.get()),
-      should_flush_(ShouldFlushNow()) {
+      should_flush_(ShouldFlushNow()),
+      has_range_tombstones_(false) {
   // if should_flush_ == true without an entry inserted, something must have
   // gone wrong already.
   assert(!should_flush_);
@@ -284,10 +286,73 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   if (first_seqno_ == 0) {
     first_seqno_ = s;
   }
+  largest_seqno_ = std::max(largest_seqno_, s);
 
   should_flush_ = ShouldFlushNow();
 }
 
+void MemTable::AddRangeTombstone(SequenceNumber seq, const Slice& begin_key,
+                                 const Slice& end_key) {
+  range_tombstone_list_.emplace_back(begin_key, end_key, seq);
+  const Comparator* ucmp = comparator_.comparator.user_comparator();
+  std::shared_ptr<const RangeTombstoneSet> set =
+      std::make_shared<const RangeTombstoneSet>(
+          ucmp, std::vector<RangeTombstone>(1, range_tombstone_list_.back()));
+  size_t num_tombstones = 1;
+  while (!range_tombstone_sets_.empty() &&
+         range_tombstone_sets_.back().second <= num_tombstones) {
+    num_tombstones += range_tombstone_sets_.back().second;
+    set = std::make_shared<const RangeTombstoneSet>(
+        ucmp,
+        std::vector<const RangeTombstoneSet*>{
+            range_tombstone_sets_.back().first.get(), set.get()},
+        std::vector<RangeTombstone>());
+    range_tombstone_sets_.pop_back();
+  }
+  range_tombstone_sets_.emplace_back(std::move(set), num_tombstones);
+
+  std::shared_ptr<RangeTombstoneSets> tombstones(new RangeTombstoneSets);
+  for (const auto& entry : range_tombstone_sets_) {
+    tombstones->Add(entry.first);
+  }
+  std::atomic_store(&range_tombstones_,
+                    std::shared_ptr<const RangeTombstoneSets>(tombstones));
+  has_range_tombstones_.store(true, std::memory_order_release);
+
+  assert(first_seqno_ == 0 || seq > first_seqno_);
+  if (first_seqno_ == 0) {
+    first_seqno_ = seq;
+  }
+}
+
+std::shared_ptr<const RangeTombstoneSets> MemTable::GetRangeTombstones()
+    const {
+  if (!has_range_tombstones_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return std::atomic_load(&range_tombstones_);
+}
+
+void MemTable::AddRangeTombstonesTo(
+    std::vector<RangeTombstone>* tombstones) const {
+  // Only called once the memtable is no longer written to
+  const Comparator* ucmp = comparator_.comparator.user_comparator();
+  for (const auto& t : range_tombstone_list_) {
+    if (ucmp->Compare(t.start_key, t.end_key) < 0) {
+      tombstones->push_back(t);
+    }
+  }
+}
+
+SequenceNumber MemTable::MaxCoveringTombstoneSeq(
+    const Slice& user_key, SequenceNumber snapshot) const {
+  auto tombstones = GetRangeTombstones();
+  if (tombstones == nullptr) {
+    return 0;
+  }
+  return tombstones->MaxCoveringSeq(user_key, snapshot);
+}
+
 // Callback from MemTable::Get()
 namespace {
 
@@ -304,6 +369,7 @@ struct Saver {
   Logger* logger;
   Statistics* statistics;
   bool inplace_update_support;
+  SequenceNumber range_del_seq;
 };
 }  // namespace
 
@@ -329,7 +395,11 @@ static bool SaveValue(void* arg, const char* entry) {
           Slice(key_ptr, key_length - 8), s->key->user_key()) == 0) {
     // Correct user key
     const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
-    switch (static_cast<ValueType>(tag & 0xff)) {
+    ValueType type = static_cast<ValueType>(tag & 0xff);
+    if ((tag >> 8) < s->range_del_seq) {
+      type = kTypeDeletion;
+    }
+    switch (type) {
       case kTypeValue: {
         if (s->inplace_update_support) {
           s->mem->GetLock(s->key->user_key())->ReadLock();
@@ -389,7 +459,8 @@ static bool SaveValue(void* arg, const char* entry) {
 }
 
 bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
-                   MergeContext& merge_context, const Options& options) {
+                   MergeContext& merge_context, const Options& options,
+                   SequenceNumber range_del_seq) {
   PERF_TIMER_AUTO(get_from_memtable_time);
 
   Slice user_key = key.user_key();
@@ -413,6 +484,7 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
     saver.logger = options.info_log.get();
     saver.inplace_update_support = options.inplace_update_support;
     saver.statistics = options.statistics.get();
+    saver.range_del_seq = range_del_seq;
     table_->Get(key, &saver, SaveValue);
   }
 
@@ -452,7 +524,12 @@ void MemTable::Update(SequenceNumber seq,
         Slice(key_ptr, key_length - 8), lkey.user_key()) == 0) {
       // Correct user key
       const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
-      switch (static_cast<ValueType>(tag & 0xff)) {
+      ValueType type = static_cast<ValueType>(tag & 0xff);
+      if ((tag >> 8) < MaxCoveringTombstoneSeq(lkey.user_key(), seq)) {
+        // the previous value was removed by DeleteRange()
+        type = kTypeDeletion;
+      }
+      switch (type) {
         case kTypeValue: {
           Slice prev_value = GetLengthPrefixedSlice(key_ptr + key_length);
           uint32_t prev_size = prev_value.size();
@@ -511,7 +588,12 @@ bool MemTable::UpdateCallback(SequenceNumber seq,
         Slice(key_ptr, key_length - 8), lkey.user_key()) == 0) {
       // Correct user key
       const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
-      switch (static_cast<ValueType>(tag & 0xff)) {
+      ValueType type = static_cast<ValueType>(tag & 0xff);
+      if ((tag >> 8) < MaxCoveringTombstoneSeq(lkey.user_key(), seq)) {
+        // the previous value was removed by DeleteRange()
+        type = kTypeDeletion;
+      }
+      switch (type) {
         case kTypeValue: {
           Slice prev_value = GetLengthPrefixedSlice(key_ptr + key_length);
           uint32_t  prev_size = prev_value.size();
@@ -8,10 +8,13 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #pragma once
+#include <atomic>
 #include <string>
 #include <memory>
 #include <deque>
+#include <vector>
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
 #include "db/skiplist.h"
 #include "db/version_edit.h"
 #include "rocksdb/db.h"
@@ -87,6 +90,24 @@ class MemTable {
            const Slice& key,
            const Slice& value);
 
+  // Add a tombstone deleting every key in [begin_key, end_key) that was
+  // written with a sequence number smaller than seq.
+  void AddRangeTombstone(SequenceNumber seq, const Slice& begin_key,
+                         const Slice& end_key);
+
+  // Returns the range tombstones added to this memtable, or nullptr if there
+  // are none.  Takes no lock.
+  std::shared_ptr<const RangeTombstoneSets> GetRangeTombstones() const;
+
+  // Appends the range tombstones added to this memtable to *tombstones.
+  // Tombstones with an empty range delete nothing and are left out.
+  void AddRangeTombstonesTo(std::vector<RangeTombstone>* tombstones) const;
+
+  // Returns the largest sequence number not greater than snapshot of a range
+  // tombstone in this memtable that covers user_key, or 0 if there is none.
+  SequenceNumber MaxCoveringTombstoneSeq(const Slice& user_key,
+                                         SequenceNumber snapshot) const;
+
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, store a NotFound() error
   // in *status and return true.
@@ -95,8 +116,11 @@ class MemTable {
   //   prepend the current merge operand to *operands.
   //   store MergeInProgress in s, and return false.
   // Else, return false.
+  // Entries with a sequence number smaller than range_del_seq are treated as
+  // deletions; see RangeTombstoneSet::MaxCoveringSeq().
   bool Get(const LookupKey& key, std::string* value, Status* s,
-           MergeContext& merge_context, const Options& options);
+           MergeContext& merge_context, const Options& options,
+           SequenceNumber range_del_seq = 0);
 
   // Attempts to update the new_value inplace, else does normal Add
   // Pseudocode
@@ -138,6 +162,10 @@ class MemTable {
   // into the memtable
   SequenceNumber GetFirstSequenceNumber() { return first_seqno_; }
 
+  // Returns the largest sequence number of the entries in the memtable, not
+  // counting its range tombstones.
+  SequenceNumber GetLargestSequenceNumber() const { return largest_seqno_; }
+
   // Returns the next active logfile number when this memtable is about to
   // be flushed to storage
   uint64_t GetNextLogNumber() { return mem_next_logfile_number_; }
@@ -195,6 +223,9 @@ class MemTable {
   // The sequence number of the kv that was inserted first
   SequenceNumber first_seqno_;
 
+  // The largest sequence number of the entries
+  SequenceNumber largest_seqno_;
+
   // The log files earlier than this number can be deleted.
   uint64_t mem_next_logfile_number_;
 
@@ -210,6 +241,21 @@ class MemTable {
 
   // a flag indicating if a memtable has met the criteria to flush
   bool should_flush_;
+
+  // Range tombstones added by DeleteRange().  Only the single writer of the
+  // memtable changes them.  AddRangeTombstone() appends a set with the new
+  // tombstone to range_tombstone_sets_ and merges it with the sets before it
+  // that hold no more tombstones than it does, so a tombstone is fragmented
+  // again only O(log n) times and readers check O(log n) sets.  The sets are
+  // published with std::atomic_store() so that readers take no lock, and
+  // has_range_tombstones_ lets them skip even that in the common case of no
+  // tombstones.
+  std::vector<RangeTombstone> range_tombstone_list_;
+  // The sets and the number of tombstones each was built from
+  std::vector<std::pair<std::shared_ptr<const RangeTombstoneSet>, size_t>>
+      range_tombstone_sets_;
+  std::shared_ptr<const RangeTombstoneSets> range_tombstones_;
+  std::atomic<bool> has_range_tombstones_;
 };
 
 extern const char* EncodeKey(std::string* scratch, const Slice& target);
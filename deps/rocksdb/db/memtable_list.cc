@@ -5,6 +5,7 @@
 //
 #include "db/memtable_list.h"
 
+#include <algorithm>
 #include <string>
 #include "rocksdb/db.h"
 #include "db/memtable.h"
@@ -62,19 +63,33 @@ int MemTableList::size() const {
 // Operands stores the list of merge operations to apply, so far.
 bool MemTableListVersion::Get(const LookupKey& key, std::string* value,
                               Status* s, MergeContext& merge_context,
-                              const Options& options) {
+                              const Options& options,
+                              SequenceNumber range_del_seq) {
   for (auto& memtable : memlist_) {
-    if (memtable->Get(key, value, s, merge_context, options)) {
+    if (memtable->Get(key, value, s, merge_context, options, range_del_seq)) {
       return true;
     }
   }
   return false;
 }
 
-void MemTableListVersion::AddIterators(const ReadOptions& options,
-                                       std::vector<Iterator*>* iterator_list) {
+void MemTableListVersion::AddRangeTombstones(RangeTombstoneSets* sets) const {
+  for (auto& memtable : memlist_) {
+    auto tombstones = memtable->GetRangeTombstones();
+    if (tombstones != nullptr) {
+      sets->Add(*tombstones);
+    }
+  }
+}
+
+void MemTableListVersion::AddIterators(
+    const ReadOptions& options, std::vector<Iterator*>* iterator_list,
+    const std::shared_ptr<const RangeTombstoneSets>& range_tombstones,
+    SequenceNumber snapshot) {
   for (auto& m : memlist_) {
-    iterator_list->push_back(m->NewIterator(options));
+    iterator_list->push_back(NewRangeTombstoneSkippingIterator(
+        m->NewIterator(options), range_tombstones, snapshot,
+        m->GetLargestSequenceNumber()));
   }
 }
 
@@ -44,10 +44,21 @@ class MemTableListVersion {
   // Search all the memtables starting from the most recent one.
   // Return the most recent value found, if any.
   bool Get(const LookupKey& key, std::string* value, Status* s,
-           MergeContext& merge_context, const Options& options);
+           MergeContext& merge_context, const Options& options,
+           SequenceNumber range_del_seq = 0);
 
+  // Appends the range tombstones of the memtables to *sets, most recent
+  // memtable first.
+  void AddRangeTombstones(RangeTombstoneSets* sets) const;
+
+  // If range_tombstones is not nullptr, the iterators skip the ranges of
+  // their memtable that its tombstones visible at snapshot delete as a
+  // whole; see NewRangeTombstoneSkippingIterator().
   void AddIterators(const ReadOptions& options,
-                    std::vector<Iterator*>* iterator_list);
+                    std::vector<Iterator*>* iterator_list,
+                    const std::shared_ptr<const RangeTombstoneSets>&
+                        range_tombstones = nullptr,
+                    SequenceNumber snapshot = kMaxSequenceNumber);
 
   uint64_t GetTotalNumEntries() const;
 
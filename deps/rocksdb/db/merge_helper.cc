@@ -21,7 +21,8 @@ namespace rocksdb {
 //       operands_ stores the list of merge operands encountered while merging.
 //       keys_[i] corresponds to operands_[i] for each i.
 void MergeHelper::MergeUntil(Iterator* iter, SequenceNumber stop_before,
-                             bool at_bottom, Statistics* stats, int* steps) {
+                             bool at_bottom, Statistics* stats, int* steps,
+                             SequenceNumber range_del_seq) {
   // Get a copy of the internal key, before it's invalidated by iter->Next()
   // Also maintain the list of merge operands seen.
   keys_.clear();
@@ -70,6 +71,11 @@ void MergeHelper::MergeUntil(Iterator* iter, SequenceNumber stop_before,
 
     // At this point we are guaranteed that we need to process this key.
 
+    if (ikey.sequence < range_del_seq) {
+      // deleted by a range tombstone
+      ikey.type = kTypeDeletion;
+    }
+
     if (kTypeDeletion == ikey.type) {
       // hit a delete
       //   => merge nullptr with operands_
@@ -46,9 +46,11 @@ class MergeHelper {
   //                   0 means no restriction
   // at_bottom:   (IN) true if the iterator covers the bottem level, which means
   //                   we could reach the start of the history of this user key.
+  // range_del_seq: (IN) entries with a smaller sequence number are deleted by
+  //                     a range tombstone and are treated like a Delete.
   void MergeUntil(Iterator* iter, SequenceNumber stop_before = 0,
                   bool at_bottom = false, Statistics* stats = nullptr,
-                  int* steps = nullptr);
+                  int* steps = nullptr, SequenceNumber range_del_seq = 0);
 
   // Query the merge result
   // These are valid until the next MergeUntil call
@@ -270,10 +270,12 @@ TEST(PlainTableDBTest, Flush) {
         ASSERT_EQ(1U, ptc.size());
         auto row = ptc.begin();
         auto tp = row->second;
-        ASSERT_EQ(total_order ? "4" : "12", (tp->user_collected_properties).at(
-                                                "plain_table_hash_table_size"));
-        ASSERT_EQ(total_order ? "9" : "0", (tp->user_collected_properties).at(
-                                               "plain_table_sub_index_size"));
+        ASSERT_EQ(total_order ? "4" : "12",
+                  (tp->user_collected_properties).at(
+                      "rocksdb.plain.hash.table.size"));
+        ASSERT_EQ(total_order ? "9" : "0",
+                  (tp->user_collected_properties).at(
+                      "rocksdb.plain.sub.index.size"));
 
         ASSERT_EQ("v3", Get("1000000000000foo"));
         ASSERT_EQ("v2", Get("0000000000000bar"));
@@ -282,6 +284,24 @@ TEST(PlainTableDBTest, Flush) {
   }
 }
 
+TEST(PlainTableDBTest, DeleteRangeNotSupported) {
+  ASSERT_OK(Put("1000000000000foo", "v1"));
+  ASSERT_TRUE(dbfull()->DeleteRange(WriteOptions(), "1000000000000foo",
+                                    "1000000000000fop").IsNotSupported());
+  WriteBatch batch;
+  batch.Put("0000000000000bar", "v2");
+  batch.DeleteRange("1000000000000foo", "1000000000000fop");
+  ASSERT_TRUE(dbfull()->Write(WriteOptions(), &batch).IsNotSupported());
+
+  // Nothing of the rejected batch is applied, and the DB stays writable.
+  ASSERT_EQ("NOT_FOUND", Get("0000000000000bar"));
+  ASSERT_OK(dbfull()->TEST_FlushMemTable());
+  ASSERT_OK(Put("0000000000000bar", "v2"));
+  ASSERT_OK(dbfull()->TEST_FlushMemTable());
+  ASSERT_EQ("v1", Get("1000000000000foo"));
+  ASSERT_EQ("v2", Get("0000000000000bar"));
+}
+
 TEST(PlainTableDBTest, Flush2) {
   for (size_t huge_page_tlb_size = 0; huge_page_tlb_size <= 2 * 1024 * 1024;
        huge_page_tlb_size += 2 * 1024 * 1024) {
@@ -494,6 +514,215 @@ TEST(PlainTableDBTest, IteratorLargeKeys) {
   delete iter;
 }
 
+TEST(PlainTableDBTest, NonMmapReads) {
+  for (int total_order = 0; total_order <= 1; total_order++) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.allow_mmap_reads = false;
+    if (total_order) {
+      options.prefix_extractor.reset();
+      options.table_factory.reset(NewTotalOrderPlainTableFactory(0, 10, 4));
+    } else {
+      options.table_factory.reset(NewPlainTableFactory(16, 10, 0.75, 4));
+    }
+    DestroyAndReopen(&options);
+
+    // Values of up to 10KB, so that rows straddle the read buffers and some
+    // do not fit in one.
+    const int kNumKeys = 500;
+    Random rnd(301);
+    std::vector<std::string> values;
+    for (int i = 0; i < kNumKeys; i++) {
+      char key[20];
+      snprintf(key, sizeof(key), "%08d%08d", i / 50, i);
+      std::string value;
+      test::RandomString(&rnd, i % 10 == 0 ? 10000 : i, &value);
+      values.push_back(value);
+      ASSERT_OK(Put(key, value));
+    }
+    dbfull()->TEST_FlushMemTable();
+
+    // Reopen to build the index from the file again.
+    for (int reopen = 0; reopen <= 1; reopen++) {
+      for (int i = 0; i < kNumKeys; i++) {
+        char key[20];
+        snprintf(key, sizeof(key), "%08d%08d", i / 50, i);
+        ASSERT_EQ(values[i], Get(key));
+      }
+      ASSERT_EQ("NOT_FOUND", Get("0000000300000001"));
+
+      Iterator* iter = dbfull()->NewIterator(ReadOptions());
+      iter->Seek("0000000100000000");
+      for (int i = 50; i < kNumKeys; i++) {
+        ASSERT_TRUE(iter->Valid());
+        char key[20];
+        snprintf(key, sizeof(key), "%08d%08d", i / 50, i);
+        ASSERT_EQ(key, iter->key().ToString());
+        ASSERT_EQ(values[i], iter->value().ToString());
+        iter->Next();
+        if (!total_order && i % 50 == 49) {
+          // Prefix seek only iterates within a prefix.
+          break;
+        }
+      }
+      ASSERT_OK(iter->status());
+      delete iter;
+      Reopen(&options);
+    }
+  }
+}
+
+namespace {
+// Counts the bytes read from a file.
+class CountingRandomAccessFile : public RandomAccessFile {
+ public:
+  CountingRandomAccessFile(unique_ptr<RandomAccessFile>&& target,
+                           uint64_t* bytes_read)
+      : target_(std::move(target)), bytes_read_(bytes_read) {}
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const override {
+    *bytes_read_ += n;
+    return target_->Read(offset, n, result, scratch);
+  }
+
+ private:
+  unique_ptr<RandomAccessFile> target_;
+  uint64_t* bytes_read_;
+};
+}  // namespace
+
+TEST(PlainTableDBTest, PersistedIndexAndBloom) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_mmap_reads = false;
+  options.table_factory.reset(NewPlainTableFactory(16, 10, 0.75, 3));
+  DestroyAndReopen(&options);
+  for (int i = 0; i < 1000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "%08d%08d", i / 10, i);
+    ASSERT_OK(Put(key, std::string(100, 'a' + i % 26)));
+  }
+  dbfull()->TEST_FlushMemTable();
+
+  TablePropertiesCollection ptc;
+  ASSERT_OK(reinterpret_cast<DB*>(dbfull())->GetPropertiesOfAllTables(&ptc));
+  ASSERT_EQ(1U, ptc.size());
+  auto props = ptc.begin()->second;
+  ASSERT_GT(props->index_size, 0U);
+  ASSERT_GT(props->filter_size, 0U);
+  ASSERT_EQ(std::string(options.prefix_extractor->Name()),
+            props->user_collected_properties.at(
+                PlainTablePropertyNames::kPrefixExtractorName));
+
+  std::vector<LiveFileMetaData> metadata;
+  dbfull()->GetLiveFilesMetaData(&metadata);
+  ASSERT_EQ(1U, metadata.size());
+  const std::string fname = dbfull()->GetName() + metadata[0].name;
+  Env* env = dbfull()->GetEnv();
+  uint64_t file_size = 0;
+  ASSERT_OK(env->GetFileSize(fname, &file_size));
+
+  // A reader with the prefix extractor of the file loads its index and bloom
+  // filter instead of reading all of its rows; one with another prefix
+  // extractor has to read them.
+  for (int same_prefix_extractor = 1; same_prefix_extractor >= 0;
+       same_prefix_extractor--) {
+    Options reader_options = options;
+    if (!same_prefix_extractor) {
+      reader_options.prefix_extractor.reset(NewFixedPrefixTransform(4));
+    }
+    unique_ptr<RandomAccessFile> file;
+    ASSERT_OK(env->NewRandomAccessFile(fname, &file, EnvOptions()));
+    uint64_t bytes_read = 0;
+    file.reset(new CountingRandomAccessFile(std::move(file), &bytes_read));
+    unique_ptr<TableReader> table_reader;
+    InternalKeyComparator icomp(options.comparator);
+    ASSERT_OK(options.table_factory->NewTableReader(
+        reader_options, EnvOptions(), icomp, std::move(file), file_size,
+        &table_reader));
+    if (same_prefix_extractor) {
+      ASSERT_LT(bytes_read, props->data_size);
+    } else {
+      ASSERT_GE(bytes_read, props->data_size);
+    }
+
+    Reopen(&reader_options);
+    for (int i = 0; i < 1000; i += 7) {
+      char key[20];
+      snprintf(key, sizeof(key), "%08d%08d", i / 10, i);
+      ASSERT_EQ(std::string(100, 'a' + i % 26), Get(key));
+    }
+    ASSERT_EQ("NOT_FOUND", Get("0000000100000001"));
+    ASSERT_EQ("NOT_FOUND", Get("1000000000000000"));
+  }
+}
+
+TEST(PlainTableDBTest, PagesInBlockCache) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_mmap_reads = false;
+  options.table_factory.reset(NewPlainTableFactory(16, 10, 0.75, 3));
+  DestroyAndReopen(&options);
+  for (int i = 0; i < 1000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "%08d%08d", i / 10, i);
+    ASSERT_OK(Put(key, std::string(100, 'a' + i % 26)));
+  }
+  dbfull()->TEST_FlushMemTable();
+
+  std::vector<LiveFileMetaData> metadata;
+  dbfull()->GetLiveFilesMetaData(&metadata);
+  ASSERT_EQ(1U, metadata.size());
+  const std::string fname = dbfull()->GetName() + metadata[0].name;
+  Env* env = dbfull()->GetEnv();
+  uint64_t file_size = 0;
+  ASSERT_OK(env->GetFileSize(fname, &file_size));
+
+  // Scans that fill the block cache read the file once, the others every
+  // time.
+  for (int fill_cache = 1; fill_cache >= 0; fill_cache--) {
+    Options reader_options = options;
+    reader_options.block_cache = NewLRUCache(1 << 20);
+    unique_ptr<RandomAccessFile> file;
+    ASSERT_OK(env->NewRandomAccessFile(fname, &file, EnvOptions()));
+    uint64_t bytes_read = 0;
+    file.reset(new CountingRandomAccessFile(std::move(file), &bytes_read));
+    unique_ptr<TableReader> table_reader;
+    InternalKeyComparator icomp(options.comparator);
+    ASSERT_OK(options.table_factory->NewTableReader(
+        reader_options, EnvOptions(), icomp, std::move(file), file_size,
+        &table_reader));
+
+    ReadOptions ro;
+    ro.fill_cache = fill_cache;
+    uint64_t bytes_read_by_scan = 0;
+    for (int scan = 0; scan < 2; scan++) {
+      const uint64_t bytes_read_before = bytes_read;
+      unique_ptr<Iterator> iter(table_reader->NewIterator(ro));
+      int count = 0;
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        count++;
+      }
+      ASSERT_OK(iter->status());
+      ASSERT_EQ(1000, count);
+      if (scan == 0) {
+        bytes_read_by_scan = bytes_read - bytes_read_before;
+        ASSERT_GT(bytes_read_by_scan, 0U);
+      } else if (fill_cache) {
+        ASSERT_EQ(bytes_read_before, bytes_read);
+      } else {
+        ASSERT_EQ(bytes_read_by_scan, bytes_read - bytes_read_before);
+      }
+    }
+    if (fill_cache) {
+      ASSERT_GT(reader_options.block_cache->GetUsage(), 0U);
+    } else {
+      ASSERT_EQ(0U, reader_options.block_cache->GetUsage());
+    }
+  }
+}
+
 // A test comparator which compare two strings in this way:
 // (1) first compare prefix of 8 bytes in alphabet order,
 // (2) if two strings share the same prefix, sort the other part of the string
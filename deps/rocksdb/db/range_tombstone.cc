@@ -0,0 +1,306 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "db/range_tombstone.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <set>
+#include "rocksdb/comparator.h"
+#include "rocksdb/iterator.h"
+
+namespace rocksdb {
+
+RangeTombstoneSet::RangeTombstoneSet(
+    const Comparator* user_comparator,
+    const std::vector<RangeTombstone>& tombstones)
+    : ucmp_(user_comparator) {
+  std::vector<Piece> pieces;
+  pieces.reserve(tombstones.size());
+  for (const auto& t : tombstones) {
+    pieces.push_back(Piece{t.start_key, t.end_key, &t.seq, 1});
+  }
+  BuildFragments(&pieces);
+}
+
+RangeTombstoneSet::RangeTombstoneSet(
+    const Comparator* user_comparator,
+    const std::vector<const RangeTombstoneSet*>& sets,
+    const std::vector<RangeTombstone>& tombstones)
+    : ucmp_(user_comparator) {
+  std::vector<Piece> pieces;
+  for (const auto* set : sets) {
+    for (const auto& f : set->fragments_) {
+      pieces.push_back(
+          Piece{f.start_key, f.end_key, f.seqs.data(), f.seqs.size()});
+    }
+  }
+  for (const auto& t : tombstones) {
+    pieces.push_back(Piece{t.start_key, t.end_key, &t.seq, 1});
+  }
+  BuildFragments(&pieces);
+}
+
+void RangeTombstoneSet::BuildFragments(std::vector<Piece>* pieces) {
+  pieces->erase(std::remove_if(pieces->begin(), pieces->end(),
+                               [this](const Piece& p) {
+                                 return ucmp_->Compare(p.start_key,
+                                                       p.end_key) >= 0;
+                               }),
+                pieces->end());
+  std::sort(pieces->begin(), pieces->end(),
+            [this](const Piece& a, const Piece& b) {
+              return ucmp_->Compare(a.start_key, b.start_key) < 0;
+            });
+
+  // The pieces covering the current position, the one ending first on top,
+  // and the sequence numbers of their tombstones.
+  auto ends_later = [this](const Piece* a, const Piece* b) {
+    return ucmp_->Compare(a->end_key, b->end_key) > 0;
+  };
+  std::priority_queue<const Piece*, std::vector<const Piece*>,
+                      decltype(ends_later)> active(ends_later);
+  std::multiset<SequenceNumber, std::greater<SequenceNumber>> active_seqs;
+
+  size_t i = 0;
+  Slice pos;
+  while (i < pieces->size() || !active.empty()) {
+    if (active.empty()) {
+      pos = (*pieces)[i].start_key;
+    }
+    for (; i < pieces->size() &&
+               ucmp_->Compare((*pieces)[i].start_key, pos) == 0;
+         i++) {
+      const Piece& p = (*pieces)[i];
+      active.push(&p);
+      active_seqs.insert(p.seqs, p.seqs + p.n);
+    }
+
+    // Nothing starts or ends strictly between pos and next, so [pos, next)
+    // is covered by exactly the active tombstones.
+    Slice next = active.top()->end_key;
+    if (i < pieces->size() &&
+        ucmp_->Compare((*pieces)[i].start_key, next) < 0) {
+      next = (*pieces)[i].start_key;
+    }
+    std::vector<SequenceNumber> seqs;
+    for (SequenceNumber seq : active_seqs) {
+      if (seqs.empty() || seqs.back() != seq) {
+        seqs.push_back(seq);
+      }
+    }
+    if (!fragments_.empty() && fragments_.back().seqs == seqs &&
+        ucmp_->Compare(fragments_.back().end_key, pos) == 0) {
+      fragments_.back().end_key.assign(next.data(), next.size());
+    } else {
+      Fragment fragment;
+      fragment.start_key.assign(pos.data(), pos.size());
+      fragment.end_key.assign(next.data(), next.size());
+      fragment.seqs = std::move(seqs);
+      fragments_.push_back(std::move(fragment));
+    }
+
+    while (!active.empty() &&
+           ucmp_->Compare(active.top()->end_key, next) <= 0) {
+      const Piece* p = active.top();
+      active.pop();
+      for (size_t j = 0; j < p->n; j++) {
+        active_seqs.erase(active_seqs.find(p->seqs[j]));
+      }
+    }
+    pos = next;
+  }
+}
+
+std::vector<RangeTombstoneSet::Fragment>::const_iterator
+RangeTombstoneSet::FindFragment(const Slice& user_key) const {
+  return std::upper_bound(fragments_.begin(), fragments_.end(), user_key,
+                          [this](const Slice& key, const Fragment& f) {
+                            return ucmp_->Compare(key, f.end_key) < 0;
+                          });
+}
+
+SequenceNumber RangeTombstoneSet::MaxCoveringSeq(
+    const Slice& user_key, SequenceNumber snapshot) const {
+  Slice next;
+  return MaxCoveringSeq(user_key, snapshot, &next);
+}
+
+SequenceNumber RangeTombstoneSet::MaxCoveringSeq(const Slice& user_key,
+                                                 SequenceNumber snapshot,
+                                                 Slice* next) const {
+  auto it = FindFragment(user_key);
+  if (it == fragments_.end()) {
+    *next = Slice();
+    return 0;
+  }
+  if (ucmp_->Compare(user_key, it->start_key) < 0) {
+    *next = it->start_key;
+    return 0;
+  }
+  *next = it->end_key;
+  for (SequenceNumber seq : it->seqs) {
+    if (seq <= snapshot) {
+      return seq;
+    }
+  }
+  return 0;
+}
+
+SequenceNumber RangeTombstoneSet::MinCoveringSeqAbove(
+    const Slice& smallest, const Slice& largest,
+    SequenceNumber min_seq) const {
+  auto it = FindFragment(smallest);
+  if (it == fragments_.end() || ucmp_->Compare(smallest, it->start_key) < 0) {
+    return 0;
+  }
+  // A tombstone covers the range iff its sequence number appears in every
+  // fragment of a gapless run of fragments spanning the range.
+  std::vector<SequenceNumber> seqs;
+  for (SequenceNumber seq : it->seqs) {
+    if (seq > min_seq) {
+      seqs.push_back(seq);
+    }
+  }
+  while (!seqs.empty() && ucmp_->Compare(largest, it->end_key) >= 0) {
+    auto prev = it++;
+    if (it == fragments_.end() ||
+        ucmp_->Compare(prev->end_key, it->start_key) != 0) {
+      return 0;
+    }
+    std::vector<SequenceNumber> common;
+    std::set_intersection(seqs.begin(), seqs.end(), it->seqs.begin(),
+                          it->seqs.end(), std::back_inserter(common),
+                          std::greater<SequenceNumber>());
+    seqs.swap(common);
+  }
+  return seqs.empty() ? 0 : seqs.back();
+}
+
+void RangeTombstoneSets::Add(std::shared_ptr<const RangeTombstoneSet> set) {
+  if (set != nullptr && !set->empty()) {
+    sets_.push_back(std::move(set));
+  }
+}
+
+void RangeTombstoneSets::Add(const RangeTombstoneSets& other) {
+  sets_.insert(sets_.end(), other.sets_.begin(), other.sets_.end());
+}
+
+SequenceNumber RangeTombstoneSets::MaxCoveringSeq(
+    const Slice& user_key, SequenceNumber snapshot) const {
+  SequenceNumber seq = 0;
+  for (const auto& set : sets_) {
+    seq = std::max(seq, set->MaxCoveringSeq(user_key, snapshot));
+  }
+  return seq;
+}
+
+SequenceNumber RangeTombstoneSets::MaxCoveringSeq(const Slice& user_key,
+                                                  SequenceNumber snapshot,
+                                                  Slice* next) const {
+  SequenceNumber seq = 0;
+  *next = Slice();
+  for (const auto& set : sets_) {
+    Slice set_next;
+    seq = std::max(seq, set->MaxCoveringSeq(user_key, snapshot, &set_next));
+    if (!set_next.empty() &&
+        (next->empty() || set->user_comparator()->Compare(set_next, *next) <
+                              0)) {
+      *next = set_next;
+    }
+  }
+  return seq;
+}
+
+namespace {
+
+class RangeTombstoneSkippingIterator : public Iterator {
+ public:
+  RangeTombstoneSkippingIterator(
+      Iterator* iter, std::shared_ptr<const RangeTombstoneSets> tombstones,
+      SequenceNumber snapshot, SequenceNumber largest_seqno)
+      : iter_(iter),
+        tombstones_(std::move(tombstones)),
+        snapshot_(snapshot),
+        largest_seqno_(largest_seqno),
+        clean_(false) {}
+  virtual ~RangeTombstoneSkippingIterator() { delete iter_; }
+
+  virtual bool Valid() const { return iter_->Valid(); }
+  virtual void SeekToFirst() {
+    clean_ = false;
+    iter_->SeekToFirst();
+    SkipDeletedRanges();
+  }
+  virtual void SeekToLast() {
+    clean_ = false;
+    iter_->SeekToLast();
+  }
+  virtual void Seek(const Slice& target) {
+    clean_ = false;
+    iter_->Seek(target);
+  }
+  virtual void Next() {
+    iter_->Next();
+    SkipDeletedRanges();
+  }
+  virtual void Prev() {
+    clean_ = false;
+    iter_->Prev();
+  }
+  virtual Slice key() const { return iter_->key(); }
+  virtual Slice value() const { return iter_->value(); }
+  virtual Status status() const { return iter_->status(); }
+
+ private:
+  void SkipDeletedRanges() {
+    while (iter_->Valid()) {
+      Slice user_key = ExtractUserKey(iter_->key());
+      if (clean_ &&
+          (clean_until_.empty() ||
+           tombstones_->user_comparator()->Compare(user_key, clean_until_) <
+               0)) {
+        return;
+      }
+      Slice next;
+      if (tombstones_->MaxCoveringSeq(user_key, snapshot_, &next) <=
+          largest_seqno_) {
+        // No entry before "next" is deleted by a range as a whole.
+        clean_ = true;
+        clean_until_ = next;
+        return;
+      }
+      clean_ = false;
+      InternalKey target(next, kMaxSequenceNumber, kValueTypeForSeek);
+      iter_->Seek(target.Encode());
+    }
+  }
+
+  Iterator* const iter_;
+  const std::shared_ptr<const RangeTombstoneSets> tombstones_;
+  const SequenceNumber snapshot_;
+  const SequenceNumber largest_seqno_;
+  // If clean_, no range before clean_until_ (or none at all if it is empty)
+  // needs to be skipped from the current position on.
+  bool clean_;
+  Slice clean_until_;
+};
+
+}  // namespace
+
+Iterator* NewRangeTombstoneSkippingIterator(
+    Iterator* iter, std::shared_ptr<const RangeTombstoneSets> tombstones,
+    SequenceNumber snapshot, SequenceNumber largest_seqno) {
+  if (tombstones == nullptr || tombstones->empty()) {
+    return iter;
+  }
+  return new RangeTombstoneSkippingIterator(iter, std::move(tombstones),
+                                            snapshot, largest_seqno);
+}
+
+}  // namespace rocksdb
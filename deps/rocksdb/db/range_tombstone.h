@@ -0,0 +1,151 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// A range tombstone deletes every key in the user key range
+// [start_key, end_key) that was written with a sequence number smaller than
+// the tombstone's own sequence number.  Tombstones are written through
+// DB::DeleteRange() and live in the memtable until it is flushed.  A flush
+// stores them in the range deletion meta block of the table file it writes,
+// and compaction carries them over to its output until every key they cover
+// has been removed.
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "db/dbformat.h"
+
+namespace rocksdb {
+
+class Comparator;
+class Iterator;
+
+struct RangeTombstone {
+  std::string start_key;  // inclusive
+  std::string end_key;    // exclusive
+  SequenceNumber seq;
+
+  RangeTombstone() : seq(0) {}
+  RangeTombstone(const Slice& start, const Slice& end, SequenceNumber s)
+      : start_key(start.data(), start.size()),
+        end_key(end.data(), end.size()),
+        seq(s) {}
+};
+
+// An immutable, searchable collection of range tombstones.  The tombstones
+// are split into non-overlapping fragments so that the newest tombstone
+// covering a key can be found with a single binary search.
+//
+// Thread-safe: all methods are const.
+class RangeTombstoneSet {
+ public:
+  // Tombstones with an empty range (start_key >= end_key) are ignored.
+  RangeTombstoneSet(const Comparator* user_comparator,
+                    const std::vector<RangeTombstone>& tombstones);
+
+  // Builds the union of the tombstones of "sets" and "tombstones" without
+  // fragmenting the tombstones of "sets" again.
+  RangeTombstoneSet(const Comparator* user_comparator,
+                    const std::vector<const RangeTombstoneSet*>& sets,
+                    const std::vector<RangeTombstone>& tombstones);
+
+  bool empty() const { return fragments_.empty(); }
+
+  const Comparator* user_comparator() const { return ucmp_; }
+
+  // Returns the largest sequence number not greater than "snapshot" of a
+  // tombstone covering "user_key", or 0 if there is none.  An entry for
+  // "user_key" with sequence number s is deleted for readers at "snapshot"
+  // iff s < MaxCoveringSeq(user_key, snapshot).
+  SequenceNumber MaxCoveringSeq(const Slice& user_key,
+                                SequenceNumber snapshot) const;
+
+  // Same as above, but also stores in *next the first user key after
+  // "user_key" for which the result may differ, or an empty slice if there
+  // is none.  *next points into this set.
+  SequenceNumber MaxCoveringSeq(const Slice& user_key, SequenceNumber snapshot,
+                                Slice* next) const;
+
+  // Returns the smallest sequence number greater than "min_seq" of a single
+  // tombstone that covers the whole user key range [smallest, largest], or 0
+  // if there is none.
+  SequenceNumber MinCoveringSeqAbove(const Slice& smallest,
+                                     const Slice& largest,
+                                     SequenceNumber min_seq) const;
+
+ private:
+  struct Fragment {
+    std::string start_key;
+    std::string end_key;
+    std::vector<SequenceNumber> seqs;  // sorted in descending order
+  };
+
+  // A range covered by the tombstones with sequence numbers seqs[0, n).
+  struct Piece {
+    Slice start_key;
+    Slice end_key;
+    const SequenceNumber* seqs;
+    size_t n;
+  };
+
+  // Fills fragments_ from "pieces" with a sweep over their boundaries.
+  void BuildFragments(std::vector<Piece>* pieces);
+
+  // Returns the first fragment whose end key is after "user_key".
+  std::vector<Fragment>::const_iterator FindFragment(
+      const Slice& user_key) const;
+
+  const Comparator* const ucmp_;
+  std::vector<Fragment> fragments_;  // sorted and non-overlapping
+};
+
+// The range tombstones of several sources, e.g. a memtable, the immutable
+// memtables and the files of a version, each kept in its own sets.  They
+// are checked one set after another instead of being merged into one, so
+// that a source can change its sets without touching the others.
+class RangeTombstoneSets {
+ public:
+  RangeTombstoneSets() {}
+
+  // Appends "set" unless it is nullptr or empty.  All sets must use the same
+  // user comparator.
+  void Add(std::shared_ptr<const RangeTombstoneSet> set);
+
+  // Appends the sets of "other".
+  void Add(const RangeTombstoneSets& other);
+
+  bool empty() const { return sets_.empty(); }
+
+  // Requires: !empty()
+  const Comparator* user_comparator() const {
+    return sets_[0]->user_comparator();
+  }
+
+  // The largest of RangeTombstoneSet::MaxCoveringSeq() over all sets.
+  SequenceNumber MaxCoveringSeq(const Slice& user_key,
+                                SequenceNumber snapshot) const;
+
+  // Same as above; *next is the smallest of the next keys of all sets.
+  SequenceNumber MaxCoveringSeq(const Slice& user_key, SequenceNumber snapshot,
+                                Slice* next) const;
+
+ private:
+  std::vector<std::shared_ptr<const RangeTombstoneSet>> sets_;
+};
+
+// Returns an iterator over the entries of "iter" that, while moving forward,
+// seeks past every range of "tombstones" that deletes all of them.  All
+// entries of "iter" must have sequence numbers not greater than
+// "largest_seqno", so a range whose newest tombstone visible at "snapshot"
+// is newer than "largest_seqno" holds no live entry of "iter".  Seek() and
+// backward moves are passed through unchanged, so the result still behaves
+// as "iter" does inside a merging iterator.
+//
+// Takes ownership of "iter".
+extern Iterator* NewRangeTombstoneSkippingIterator(
+    Iterator* iter, std::shared_ptr<const RangeTombstoneSets> tombstones,
+    SequenceNumber snapshot, SequenceNumber largest_seqno);
+
+}  // namespace rocksdb
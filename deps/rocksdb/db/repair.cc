@@ -233,8 +233,11 @@ class Repairer {
     meta.number = next_file_number_++;
     ReadOptions ro;
     Iterator* iter = mem->NewIterator(ro, true /* enforce_total_order */);
+    std::vector<RangeTombstone> range_tombstones;
+    mem->AddRangeTombstonesTo(&range_tombstones);
     status = BuildTable(dbname_, env_, options_, storage_options_, table_cache_,
-                        iter, &meta, icmp_, 0, 0, kNoCompression);
+                        iter, range_tombstones, &meta, icmp_, 0, 0,
+                        kNoCompression);
     delete iter;
     delete mem->Unref();
     delete cf_mems_default;
@@ -307,6 +310,21 @@ class Repairer {
         status = iter->status();
       }
       delete iter;
+
+      if (status.ok()) {
+        status = table_cache_->GetRangeTombstones(
+            storage_options_, icmp_, dummy_meta, &t->meta.range_tombstones);
+      }
+      if (status.ok() && t->meta.range_tombstones != nullptr) {
+        t->meta.smallest_seqno = t->min_sequence;
+        t->meta.largest_seqno = t->max_sequence;
+        ExtendFileRangeToTombstones(
+            *t->meta.range_tombstones, icmp_, empty, &t->meta.smallest,
+            &t->meta.largest, &t->meta.smallest_seqno,
+            &t->meta.largest_seqno);
+        t->min_sequence = t->meta.smallest_seqno;
+        t->max_sequence = t->meta.largest_seqno;
+      }
     }
     Log(options_.info_log, "Table #%llu: %d entries %s",
         (unsigned long long) t->meta.number,
@@ -341,7 +359,9 @@ class Repairer {
       const TableInfo& t = tables_[i];
       edit_->AddFile(0, t.meta.number, t.meta.file_size,
                     t.meta.smallest, t.meta.largest,
-                    t.min_sequence, t.max_sequence);
+                    t.min_sequence, t.max_sequence,
+                    false /* marked_for_compaction */, 0 /* creation_time */,
+                    t.meta.range_tombstones);
     }
 
     //fprintf(stderr, "NewDescriptor:\n%s\n", edit_.DebugString().c_str());
@@ -162,6 +162,45 @@ Status TableCache::Get(const ReadOptions& options,
   }
   return s;
 }
+
+void TableCache::MultiGet(const ReadOptions& options,
+                          const InternalKeyComparator& internal_comparator,
+                          const FileMetaData& file_meta, size_t num_keys,
+                          const Slice* keys, void* const* args,
+                          bool (*saver)(void*, const ParsedInternalKey&,
+                                        const Slice&, bool),
+                          bool* table_io, void (*mark_key_may_exist)(void*),
+                          Status* statuses) {
+  TableReader* t = file_meta.table_reader;
+  Status s;
+  Cache::Handle* handle = nullptr;
+  if (!t) {
+    s = FindTable(storage_options_, internal_comparator, file_meta.number,
+                  file_meta.file_size, &handle, table_io,
+                  options.read_tier == kBlockCacheTier);
+    if (s.ok()) {
+      t = GetTableReaderFromHandle(handle);
+    }
+  }
+  if (s.ok()) {
+    t->MultiGet(options, num_keys, keys, args, saver, mark_key_may_exist,
+                statuses);
+    if (handle != nullptr) {
+      ReleaseHandle(handle);
+    }
+  } else if (options.read_tier && s.IsIncomplete()) {
+    // Couldnt find Table in cache but treat as kFound if no_io set
+    for (size_t i = 0; i < num_keys; ++i) {
+      (*mark_key_may_exist)(args[i]);
+      statuses[i] = Status::OK();
+    }
+  } else {
+    for (size_t i = 0; i < num_keys; ++i) {
+      statuses[i] = s;
+    }
+  }
+}
+
 Status TableCache::GetTableProperties(
     const EnvOptions& toptions,
     const InternalKeyComparator& internal_comparator,
@@ -190,6 +229,32 @@ Status TableCache::GetTableProperties(
   return s;
 }
 
+Status TableCache::GetRangeTombstones(
+    const EnvOptions& toptions,
+    const InternalKeyComparator& internal_comparator,
+    const FileMetaData& file_meta,
+    std::shared_ptr<const std::vector<RangeTombstone>>* tombstones) {
+  Status s;
+  auto table_reader = file_meta.table_reader;
+  // table already been pre-loaded?
+  if (table_reader) {
+    *tombstones = table_reader->GetRangeTombstones();
+    return s;
+  }
+
+  Cache::Handle* table_handle = nullptr;
+  s = FindTable(toptions, internal_comparator, file_meta.number,
+                file_meta.file_size, &table_handle);
+  if (!s.ok()) {
+    return s;
+  }
+  assert(table_handle);
+  auto table = GetTableReaderFromHandle(table_handle);
+  *tombstones = table->GetRangeTombstones();
+  ReleaseHandle(table_handle);
+  return s;
+}
+
 void TableCache::Evict(Cache* cache, uint64_t file_number) {
   cache->Erase(GetSliceForFileNumber(&file_number));
 }
@@ -11,6 +11,7 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 #include "db/dbformat.h"
@@ -56,6 +57,18 @@ class TableCache {
                                    const Slice&, bool),
              bool* table_io, void (*mark_key_may_exist)(void*) = nullptr);
 
+  // Batched version of Get(). keys[0,num_keys-1] must be sorted by internal
+  // key; the result of looking up keys[i] is reported to args[i] and
+  // statuses[i].
+  void MultiGet(const ReadOptions& options,
+                const InternalKeyComparator& internal_comparator,
+                const FileMetaData& file_meta, size_t num_keys,
+                const Slice* keys, void* const* args,
+                bool (*handle_result)(void*, const ParsedInternalKey&,
+                                      const Slice&, bool),
+                bool* table_io, void (*mark_key_may_exist)(void*),
+                Status* statuses);
+
   // Evict any entry for the specified file number
   static void Evict(Cache* cache, uint64_t file_number);
 
@@ -80,6 +93,15 @@ class TableCache {
                             std::shared_ptr<const TableProperties>* properties,
                             bool no_io = false);
 
+  // Get the range tombstones stored in a given table.
+  // @returns: `tombstones` will be reset on success, to nullptr if the table
+  //            has none.
+  Status GetRangeTombstones(
+      const EnvOptions& toptions,
+      const InternalKeyComparator& internal_comparator,
+      const FileMetaData& file_meta,
+      std::shared_ptr<const std::vector<RangeTombstone>>* tombstones);
+
   // Release the handle from a cache
   void ReleaseHandle(Cache::Handle* handle);
 
@@ -5,6 +5,7 @@
 
 #include "db/table_properties_collector.h"
 
+#include <algorithm>
 #include "db/dbformat.h"
 #include "util/coding.h"
 
@@ -45,6 +46,48 @@ InternalKeyPropertiesCollector::GetReadableProperties() const {
 }
 
 
+const size_t CompactOnDeletionCollector::kMaxBuckets;
+
+CompactOnDeletionCollector::CompactOnDeletionCollector(size_t window_size,
+                                                       size_t deletion_trigger)
+    : deletion_trigger_(deletion_trigger) {
+  assert(window_size > 0);
+  size_t num_buckets = std::min(window_size, kMaxBuckets);
+  bucket_size_ = (window_size + num_buckets - 1) / num_buckets;
+  deletions_in_bucket_.resize(num_buckets, 0);
+}
+
+Status CompactOnDeletionCollector::Add(const Slice& key, const Slice& value) {
+  if (need_compaction_) {
+    return Status::OK();
+  }
+  ParsedInternalKey ikey;
+  if (!ParseInternalKey(key, &ikey)) {
+    return Status::InvalidArgument("Invalid internal key");
+  }
+
+  if (entries_in_current_bucket_ == bucket_size_) {
+    // Move on to the next bucket, which drops the oldest one from the window.
+    current_bucket_ = (current_bucket_ + 1) % deletions_in_bucket_.size();
+    assert(deletions_in_window_ >= deletions_in_bucket_[current_bucket_]);
+    deletions_in_window_ -= deletions_in_bucket_[current_bucket_];
+    deletions_in_bucket_[current_bucket_] = 0;
+    entries_in_current_bucket_ = 0;
+  }
+  entries_in_current_bucket_++;
+
+  if (ikey.type == ValueType::kTypeDeletion) {
+    deletions_in_bucket_[current_bucket_]++;
+    deletions_in_window_++;
+    if (deletions_in_window_ >= deletion_trigger_) {
+      need_compaction_ = true;
+    }
+  }
+
+  return Status::OK();
+}
+
+
 Status UserKeyTablePropertiesCollector::Add(
     const Slice& key, const Slice& value) {
   ParsedInternalKey ikey;
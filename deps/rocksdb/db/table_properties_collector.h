@@ -48,6 +48,67 @@ class InternalKeyPropertiesCollectorFactory
   }
 };
 
+// Marks a table for compaction if any "window_size" consecutive entries in it
+// contain at least "deletion_trigger" deletions. Iterators have to skip over
+// every deletion marker, so long runs of them make seeks slow until a
+// compaction drops them.
+//
+// The window slides one bucket of entries at a time, so up to a bucket's
+// worth of entries may fall outside of it.
+class CompactOnDeletionCollector : public TablePropertiesCollector {
+ public:
+  CompactOnDeletionCollector(size_t window_size, size_t deletion_trigger);
+
+  virtual Status Add(const Slice& key, const Slice& value) override;
+
+  virtual Status Finish(UserCollectedProperties* properties) override {
+    return Status::OK();
+  }
+
+  virtual const char* Name() const override {
+    return "CompactOnDeletionCollector";
+  }
+
+  UserCollectedProperties GetReadableProperties() const override {
+    return UserCollectedProperties();
+  }
+
+  virtual bool NeedCompact() const override { return need_compaction_; }
+
+ private:
+  static const size_t kMaxBuckets = 128;
+
+  // The number of deletions among the entries of each bucket, used as a
+  // ring buffer.
+  std::vector<size_t> deletions_in_bucket_;
+  size_t bucket_size_;
+  size_t current_bucket_ = 0;
+  size_t entries_in_current_bucket_ = 0;
+  size_t deletions_in_window_ = 0;
+  const size_t deletion_trigger_;
+  bool need_compaction_ = false;
+};
+
+class CompactOnDeletionCollectorFactory
+    : public TablePropertiesCollectorFactory {
+ public:
+  CompactOnDeletionCollectorFactory(size_t window_size,
+                                    size_t deletion_trigger)
+      : window_size_(window_size), deletion_trigger_(deletion_trigger) {}
+
+  virtual TablePropertiesCollector* CreateTablePropertiesCollector() {
+    return new CompactOnDeletionCollector(window_size_, deletion_trigger_);
+  }
+
+  virtual const char* Name() const override {
+    return "CompactOnDeletionCollectorFactory";
+  }
+
+ private:
+  const size_t window_size_;
+  const size_t deletion_trigger_;
+};
+
 // When rocksdb creates a new table, it will encode all "user keys" into
 // "internal keys", which contains meta information of a given entry.
 //
@@ -69,6 +130,10 @@ class UserKeyTablePropertiesCollector : public TablePropertiesCollector {
 
   UserCollectedProperties GetReadableProperties() const override;
 
+  virtual bool NeedCompact() const override {
+    return collector_->NeedCompact();
+  }
+
  protected:
   std::unique_ptr<TablePropertiesCollector> collector_;
 };
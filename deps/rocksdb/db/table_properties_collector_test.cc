@@ -3,6 +3,7 @@
 //  LICENSE file in the root directory of this source tree. An additional grant
 //  of patent rights can be found in the PATENTS file in the same directory.
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -306,6 +307,72 @@ TEST(TablePropertiesTest, InternalKeyPropertiesCollector) {
   );
 }
 
+namespace {
+// Returns whether a CompactOnDeletionCollector with the given window and
+// trigger marks a table of "num_entries" entries, where entry i is a deletion
+// iff is_deletion(i).
+bool CompactOnDeletion(size_t window_size, size_t deletion_trigger,
+                       int num_entries,
+                       const std::function<bool(int)>& is_deletion) {
+  CompactOnDeletionCollector collector(window_size, deletion_trigger);
+  for (int i = 0; i < num_entries; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "key%08d", i);
+    InternalKey ikey(key, i,
+                     is_deletion(i) ? ValueType::kTypeDeletion
+                                    : ValueType::kTypeValue);
+    ASSERT_OK(collector.Add(ikey.Encode(), "val"));
+  }
+  UserCollectedProperties properties;
+  ASSERT_OK(collector.Finish(&properties));
+  return collector.NeedCompact();
+}
+}  // namespace
+
+TEST(TablePropertiesTest, CompactOnDeletionCollector) {
+  // At most 4 deletions in any 10 consecutive entries.
+  ASSERT_TRUE(!CompactOnDeletion(10, 5, 1000,
+                                 [](int i) { return i % 3 == 0; }));
+  ASSERT_TRUE(CompactOnDeletion(10, 4, 1000,
+                                [](int i) { return i % 3 == 0; }));
+  // Spread out deletions don't trigger, a run of them does.
+  ASSERT_TRUE(!CompactOnDeletion(1000, 100, 100000,
+                                 [](int i) { return i % 20 == 0; }));
+  ASSERT_TRUE(CompactOnDeletion(1000, 100, 100000, [](int i) {
+    return i % 20 == 0 || (i >= 50000 && i < 50100);
+  }));
+  ASSERT_TRUE(!CompactOnDeletion(1000, 100, 100000, [](int i) {
+    return i % 20 == 0 || (i >= 50000 && i < 50030);
+  }));
+
+  // The table builders report the collector's decision.
+  std::shared_ptr<TableFactory> table_factories[] = {
+      std::make_shared<BlockBasedTableFactory>(),
+      std::make_shared<PlainTableFactory>(8, 8, 0)};
+  for (const auto& table_factory : table_factories) {
+    for (int num_deletions = 2; num_deletions <= 3; num_deletions++) {
+      Options options;
+      test::PlainInternalKeyComparator pikc(options.comparator);
+      options.table_factory = table_factory;
+      options.table_properties_collector_factories = {
+          std::make_shared<CompactOnDeletionCollectorFactory>(4, 3)};
+      std::unique_ptr<TableBuilder> builder;
+      std::unique_ptr<FakeWritableFile> writable;
+      MakeBuilder(options, pikc, &writable, &builder);
+      for (int i = 0; i < 8; i++) {
+        char key[9];
+        snprintf(key, sizeof(key), "key%05d", i);
+        bool deletion = i >= 4 && i < 4 + num_deletions;
+        InternalKey ikey(key, 0, deletion ? ValueType::kTypeDeletion
+                                          : ValueType::kTypeValue);
+        builder->Add(ikey.Encode(), "val");
+      }
+      ASSERT_OK(builder->Finish());
+      ASSERT_EQ(num_deletions == 3, builder->NeedCompact());
+    }
+  }
+}
+
 }  // namespace rocksdb
 
 int main(int argc, char** argv) {
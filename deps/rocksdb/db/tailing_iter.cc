@@ -152,24 +152,29 @@ void TailingIterator::Cleanup() {
 void TailingIterator::CreateIterators() {
   Cleanup();
   super_version_= cfd_->GetReferencedSuperVersion(&(db_->mutex_));
+  // Both iterators honor all range tombstones, as a key may be in one of them
+  // and its tombstone in the other
+  auto range_tombstones = super_version_->GetRangeTombstones();
 
   Iterator* mutable_iter = super_version_->mem->NewIterator(read_options_);
   // create a DBIter that only uses memtable content; see NewIterator()
   mutable_.reset(
       NewDBIterator(env_, *cfd_->options(), cfd_->user_comparator(),
-                    mutable_iter, kMaxSequenceNumber));
+                    mutable_iter, kMaxSequenceNumber, range_tombstones));
 
   std::vector<Iterator*> list;
-  super_version_->imm->AddIterators(read_options_, &list);
+  super_version_->imm->AddIterators(read_options_, &list, range_tombstones,
+                                    kMaxSequenceNumber);
   super_version_->current->AddIterators(
-      read_options_, *cfd_->soptions(), &list);
+      read_options_, *cfd_->soptions(), &list, range_tombstones,
+      kMaxSequenceNumber);
   Iterator* immutable_iter =
       NewMergingIterator(&cfd_->internal_comparator(), &list[0], list.size());
 
   // create a DBIter that only uses memtable content; see NewIterator()
   immutable_.reset(
       NewDBIterator(env_, *cfd_->options(), cfd_->user_comparator(),
-                    immutable_iter, kMaxSequenceNumber));
+                    immutable_iter, kMaxSequenceNumber, range_tombstones));
 
   current_ = nullptr;
   is_prev_set_ = false;
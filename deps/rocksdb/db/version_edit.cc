@@ -30,6 +30,7 @@ enum Tag {
 
   // these are new formats divergent from open source leveldb
   kNewFile2             = 100,  // store smallest & largest seqno
+  kNewFile3             = 103,  // kNewFile2 followed by NewFileCustomTags
 
   kColumnFamily         = 200,  // specify column family for version edit
   kColumnFamilyAdd      = 201,
@@ -37,6 +38,20 @@ enum Tag {
   kMaxColumnFamily      = 203,
 };
 
+// The optional fields of a kNewFile3 entry. Each one is followed by a
+// length-prefixed value, so that readers can skip the ones they don't know.
+// Fields that change how the file must be read have
+// kCustomTagNonSafeIgnoreMask set; a reader that doesn't know such a field
+// must fail instead of skipping it.
+enum NewFileCustomTag {
+  kTerminate            = 1,  // the last field
+  kMarkedForCompaction  = 2,  // empty value
+  kCreationTime         = 3,  // varint64 seconds since the epoch
+
+  kCustomTagNonSafeIgnoreMask = 1 << 6,
+  kHasRangeTombstones   = kCustomTagNonSafeIgnoreMask | 4,  // empty value
+};
+
 void VersionEdit::Clear() {
   comparator_.clear();
   max_level_ = 0;
@@ -93,7 +108,10 @@ void VersionEdit::EncodeTo(std::string* dst) const {
 
   for (size_t i = 0; i < new_files_.size(); i++) {
     const FileMetaData& f = new_files_[i].second;
-    PutVarint32(dst, kNewFile2);
+    const bool has_custom_fields =
+        f.marked_for_compaction || f.creation_time != 0 ||
+        f.has_range_tombstones;
+    PutVarint32(dst, has_custom_fields ? kNewFile3 : kNewFile2);
     PutVarint32(dst, new_files_[i].first);  // level
     PutVarint64(dst, f.number);
     PutVarint64(dst, f.file_size);
@@ -101,6 +119,23 @@ void VersionEdit::EncodeTo(std::string* dst) const {
     PutLengthPrefixedSlice(dst, f.largest.Encode());
     PutVarint64(dst, f.smallest_seqno);
     PutVarint64(dst, f.largest_seqno);
+    if (has_custom_fields) {
+      if (f.marked_for_compaction) {
+        PutVarint32(dst, kMarkedForCompaction);
+        PutLengthPrefixedSlice(dst, Slice());
+      }
+      if (f.creation_time != 0) {
+        std::string value;
+        PutVarint64(&value, f.creation_time);
+        PutVarint32(dst, kCreationTime);
+        PutLengthPrefixedSlice(dst, value);
+      }
+      if (f.has_range_tombstones) {
+        PutVarint32(dst, kHasRangeTombstones);
+        PutLengthPrefixedSlice(dst, Slice());
+      }
+      PutVarint32(dst, kTerminate);
+    }
   }
 
   // 0 is default and does not need to be explicitly written
@@ -129,6 +164,43 @@ static bool GetInternalKey(Slice* input, InternalKey* dst) {
   }
 }
 
+// Reads the custom fields of a kNewFile3 entry up to kTerminate.
+static bool GetNewFileCustomFields(Slice* input, FileMetaData* f,
+                                   const char** msg) {
+  uint32_t custom_tag;
+  Slice value;
+  while (GetVarint32(input, &custom_tag)) {
+    if (custom_tag == kTerminate) {
+      return true;
+    }
+    if (!GetLengthPrefixedSlice(input, &value)) {
+      return false;
+    }
+    switch (custom_tag) {
+      case kMarkedForCompaction:
+        f->marked_for_compaction = true;
+        break;
+      case kCreationTime:
+        if (!GetVarint64(&value, &f->creation_time)) {
+          return false;
+        }
+        break;
+      case kHasRangeTombstones:
+        f->has_range_tombstones = true;
+        break;
+      default:
+        if (custom_tag & kCustomTagNonSafeIgnoreMask) {
+          // Written by a newer version that requires it to be understood
+          *msg = "new-file3 entry: unknown required field";
+          return false;
+        }
+        // Written by a newer version; safe to ignore
+        break;
+    }
+  }
+  return false;
+}
+
 bool VersionEdit::GetLevel(Slice* input, int* level, const char** msg) {
   uint32_t v;
   if (GetVarint32(input, &v)) {
@@ -245,17 +317,22 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
         break;
 
       case kNewFile2:
+      case kNewFile3:
+        f.marked_for_compaction = false;
+        f.creation_time = 0;
+        f.has_range_tombstones = false;
         if (GetLevel(&input, &level, &msg) &&
             GetVarint64(&input, &f.number) &&
             GetVarint64(&input, &f.file_size) &&
             GetInternalKey(&input, &f.smallest) &&
             GetInternalKey(&input, &f.largest) &&
             GetVarint64(&input, &f.smallest_seqno) &&
-            GetVarint64(&input, &f.largest_seqno) ) {
+            GetVarint64(&input, &f.largest_seqno) &&
+            (tag == kNewFile2 || GetNewFileCustomFields(&input, &f, &msg))) {
           new_files_.push_back(std::make_pair(level, f));
         } else {
           if (!msg) {
-            msg = "new-file2 entry";
+            msg = tag == kNewFile2 ? "new-file2 entry" : "new-file3 entry";
           }
         }
         break;
@@ -343,6 +420,12 @@ std::string VersionEdit::DebugString(bool hex_key) const {
     r.append(f.smallest.DebugString(hex_key));
     r.append(" .. ");
     r.append(f.largest.DebugString(hex_key));
+    if (f.marked_for_compaction) {
+      r.append(" marked for compaction");
+    }
+    if (f.has_range_tombstones) {
+      r.append(" with range tombstones");
+    }
   }
   r.append("\n  ColumnFamily: ");
   AppendNumberTo(&r, column_family_);
@@ -8,12 +8,14 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #pragma once
+#include <memory>
 #include <set>
 #include <utility>
 #include <vector>
 #include <string>
 #include "rocksdb/cache.h"
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
 
 namespace rocksdb {
 
@@ -29,6 +31,14 @@ struct FileMetaData {
   bool being_compacted;       // Is this file undergoing compaction?
   SequenceNumber smallest_seqno;// The smallest seqno in this file
   SequenceNumber largest_seqno; // The largest seqno in this file
+  bool marked_for_compaction; // Should be compacted as soon as possible
+  uint64_t creation_time;     // Seconds since the epoch, 0 if unknown
+  // Does the table store range tombstones?  Recorded in the MANIFEST, so
+  // that only these tables are read when a version is recovered.
+  bool has_range_tombstones;
+  // The range tombstones of the table, loaded from its range deletion meta
+  // block; nullptr if it has none.
+  std::shared_ptr<const std::vector<RangeTombstone>> range_tombstones;
 
   // Needs to be disposed when refs becomes 0.
   Cache::Handle* table_reader_handle;
@@ -41,6 +51,9 @@ struct FileMetaData {
         number(number),
         file_size(file_size),
         being_compacted(false),
+        marked_for_compaction(false),
+        creation_time(0),
+        has_range_tombstones(false),
         table_reader_handle(nullptr),
         table_reader(nullptr) {}
   FileMetaData() : FileMetaData(0, 0) {}
@@ -86,7 +99,11 @@ class VersionEdit {
                const InternalKey& smallest,
                const InternalKey& largest,
                const SequenceNumber& smallest_seqno,
-               const SequenceNumber& largest_seqno) {
+               const SequenceNumber& largest_seqno,
+               bool marked_for_compaction = false,
+               uint64_t creation_time = 0,
+               std::shared_ptr<const std::vector<RangeTombstone>>
+                   range_tombstones = nullptr) {
     assert(smallest_seqno <= largest_seqno);
     FileMetaData f;
     f.number = file;
@@ -95,6 +112,10 @@ class VersionEdit {
     f.largest = largest;
     f.smallest_seqno = smallest_seqno;
     f.largest_seqno = largest_seqno;
+    f.marked_for_compaction = marked_for_compaction;
+    f.creation_time = creation_time;
+    f.has_range_tombstones = range_tombstones != nullptr;
+    f.range_tombstones = std::move(range_tombstones);
     new_files_.push_back(std::make_pair(level, f));
   }
 
@@ -34,7 +34,9 @@ TEST(VersionEditTest, EncodeDecode) {
                  InternalKey("foo", kBig + 500 + i, kTypeValue),
                  InternalKey("zoo", kBig + 600 + i, kTypeDeletion),
                  kBig + 500 + i,
-                 kBig + 600 + i);
+                 kBig + 600 + i,
+                 i % 2 == 0 /* marked_for_compaction */,
+                 i < 2 ? 0 : kBig + 800 + i /* creation_time */);
     edit.DeleteFile(4, kBig + 700 + i);
   }
 
@@ -45,6 +47,50 @@ TEST(VersionEditTest, EncodeDecode) {
   TestEncodeDecode(edit);
 }
 
+TEST(VersionEditTest, RangeTombstones) {
+  auto tombstones = std::make_shared<std::vector<RangeTombstone>>();
+  tombstones->emplace_back("a", "c", 5);
+  VersionEdit edit;
+  edit.AddFile(0, 7, 100, InternalKey("a", 5, kTypeValue),
+               InternalKey("c", kMaxSequenceNumber, kValueTypeForSeek), 5, 5,
+               false /* marked_for_compaction */, 0 /* creation_time */,
+               tombstones);
+  TestEncodeDecode(edit);
+
+  // Only the presence of the tombstones is recorded; they stay in the table.
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  VersionEdit parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  ASSERT_TRUE(parsed.DebugString().find("with range tombstones") !=
+              std::string::npos);
+}
+
+TEST(VersionEditTest, UnknownNewFileFields) {
+  VersionEdit edit;
+  edit.AddFile(3, 300, 400, InternalKey("foo", 500, kTypeValue),
+               InternalKey("zoo", 600, kTypeDeletion), 500, 600,
+               true /* marked_for_compaction */, 0 /* creation_time */);
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  // The entry ends with the marked-for-compaction field, its empty value
+  // and the terminating field.
+  ASSERT_GE(encoded.size(), 3U);
+  const size_t field_pos = encoded.size() - 3;
+  ASSERT_EQ(2, encoded[field_pos]);
+
+  // Fields a reader doesn't know are skipped...
+  encoded[field_pos] = 5;
+  VersionEdit parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+
+  // ...unless they are marked as required.
+  encoded[field_pos] = (1 << 6) | 5;
+  VersionEdit parsed2;
+  Status s = parsed2.DecodeFrom(encoded);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
 TEST(VersionEditTest, ColumnFamilyTest) {
   VersionEdit edit;
   edit.SetColumnFamily(2);
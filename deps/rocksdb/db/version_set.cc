@@ -14,7 +14,10 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include <atomic>
 #include <climits>
+#include <limits>
+#include <thread>
 #include <unordered_map>
 #include <stdio.h>
 
@@ -159,6 +162,7 @@ struct EncodedFileMetaData {
   uint64_t number;   // file number
   uint64_t file_size;   // file size
   TableReader* table_reader;   // cached table reader
+  SequenceNumber largest_seqno;   // largest sequence number in the file
 };
 }  // namespace
 
@@ -207,6 +211,7 @@ class Version::LevelFileNumIterator : public Iterator {
     current_value_.number = file_meta->number;
     current_value_.file_size = file_meta->file_size;
     current_value_.table_reader = file_meta->table_reader;
+    current_value_.largest_seqno = file_meta->largest_seqno;
     return Slice(reinterpret_cast<const char*>(&current_value_),
                  sizeof(EncodedFileMetaData));
   }
@@ -220,14 +225,19 @@ class Version::LevelFileNumIterator : public Iterator {
 
 class Version::LevelFileIteratorState : public TwoLevelIteratorState {
  public:
+  // If range_tombstones is not nullptr, the iterators of the files skip the
+  // ranges its tombstones visible at snapshot delete as a whole.
   LevelFileIteratorState(TableCache* table_cache,
     const ReadOptions& read_options, const EnvOptions& env_options,
     const InternalKeyComparator& icomparator, bool for_compaction,
-    bool prefix_enabled)
+    bool prefix_enabled,
+    std::shared_ptr<const RangeTombstoneSets> range_tombstones = nullptr,
+    SequenceNumber snapshot = kMaxSequenceNumber)
     : TwoLevelIteratorState(prefix_enabled),
       table_cache_(table_cache), read_options_(read_options),
       env_options_(env_options), icomparator_(icomparator),
-      for_compaction_(for_compaction) {}
+      for_compaction_(for_compaction),
+      range_tombstones_(std::move(range_tombstones)), snapshot_(snapshot) {}
 
   Iterator* NewSecondaryIterator(const Slice& meta_handle) override {
     if (meta_handle.size() != sizeof(EncodedFileMetaData)) {
@@ -238,9 +248,11 @@ class Version::LevelFileIteratorState : public TwoLevelIteratorState {
           reinterpret_cast<const EncodedFileMetaData*>(meta_handle.data());
       FileMetaData meta(encoded_meta->number, encoded_meta->file_size);
       meta.table_reader = encoded_meta->table_reader;
-      return table_cache_->NewIterator(read_options_, env_options_,
-          icomparator_, meta, nullptr /* don't need reference to table*/,
-          for_compaction_);
+      return NewRangeTombstoneSkippingIterator(
+          table_cache_->NewIterator(read_options_, env_options_,
+              icomparator_, meta, nullptr /* don't need reference to table*/,
+              for_compaction_),
+          range_tombstones_, snapshot_, encoded_meta->largest_seqno);
     }
   }
 
@@ -254,6 +266,8 @@ class Version::LevelFileIteratorState : public TwoLevelIteratorState {
   const EnvOptions& env_options_;
   const InternalKeyComparator& icomparator_;
   bool for_compaction_;
+  std::shared_ptr<const RangeTombstoneSets> range_tombstones_;
+  SequenceNumber snapshot_;
 };
 
 Status Version::GetPropertiesOfAllTables(TablePropertiesCollection* props) {
@@ -309,13 +323,32 @@ Status Version::GetPropertiesOfAllTables(TablePropertiesCollection* props) {
   return Status::OK();
 }
 
-void Version::AddIterators(const ReadOptions& read_options,
-                           const EnvOptions& soptions,
-                           std::vector<Iterator*>* iters) {
-  // Merge all level zero files together since they may overlap
-  for (const FileMetaData* file : files_[0]) {
-    iters->push_back(cfd_->table_cache()->NewIterator(
-        read_options, soptions, cfd_->internal_comparator(), *file));
+void Version::AddIterators(
+    const ReadOptions& read_options, const EnvOptions& soptions,
+    std::vector<Iterator*>* iters,
+    const std::shared_ptr<const RangeTombstoneSets>& range_tombstones,
+    SequenceNumber snapshot) {
+  // Merge all level zero files together since they may overlap. The files
+  // of a partitioned sorted run do not, and are concatenated like a level.
+  size_t next_run = 0;
+  for (size_t i = 0; i < files_[0].size();) {
+    if (next_run < level0_runs_.size() && level0_runs_[next_run].first == i) {
+      const Level0Run& run = level0_runs_[next_run++];
+      iters->push_back(NewTwoLevelIterator(new LevelFileIteratorState(
+          cfd_->table_cache(), read_options, soptions,
+          cfd_->internal_comparator(), false /* for_compaction */,
+          cfd_->options()->prefix_extractor != nullptr, range_tombstones,
+          snapshot),
+        new LevelFileNumIterator(cfd_->internal_comparator(), &run.files)));
+      i = run.last;
+      continue;
+    }
+    iters->push_back(NewRangeTombstoneSkippingIterator(
+        cfd_->table_cache()->NewIterator(read_options, soptions,
+                                         cfd_->internal_comparator(),
+                                         *files_[0][i]),
+        range_tombstones, snapshot, files_[0][i]->largest_seqno));
+    i++;
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
@@ -326,7 +359,8 @@ void Version::AddIterators(const ReadOptions& read_options,
       iters->push_back(NewTwoLevelIterator(new LevelFileIteratorState(
           cfd_->table_cache(), read_options, soptions,
           cfd_->internal_comparator(), false /* for_compaction */,
-          cfd_->options()->prefix_extractor != nullptr),
+          cfd_->options()->prefix_extractor != nullptr, range_tombstones,
+          snapshot),
         new LevelFileNumIterator(cfd_->internal_comparator(), &files_[level])));
     }
   }
@@ -353,6 +387,7 @@ struct Saver {
   Logger* logger;
   bool didIO;    // did we do any disk io?
   Statistics* statistics;
+  SequenceNumber range_del_seq;  // entries older than this are deleted
 };
 }
 
@@ -381,7 +416,11 @@ static bool SaveValue(void* arg, const ParsedInternalKey& parsed_key,
   s->didIO = didIO;
   if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
     // Key matches. Process it
-    switch (parsed_key.type) {
+    ValueType type = parsed_key.type;
+    if (parsed_key.sequence < s->range_del_seq) {
+      type = kTypeDeletion;
+    }
+    switch (type) {
       case kTypeValue:
         if (kNotFound == s->state) {
           s->state = kFound;
@@ -485,6 +524,7 @@ Version::Version(ColumnFamilyData* cfd, VersionSet* vset,
       file_to_compact_level_(-1),
       compaction_score_(num_levels_),
       compaction_level_(num_levels_),
+      base_level_(1),
       version_number_(version_number),
       file_indexer_(num_levels_, cfd == nullptr ?  nullptr
           : cfd->internal_comparator().user_comparator()) {
@@ -496,7 +536,8 @@ void Version::Get(const ReadOptions& options,
                   Status* status,
                   MergeContext* merge_context,
                   GetStats* stats,
-                  bool* value_found) {
+                  bool* value_found,
+                  SequenceNumber range_del_seq) {
   Slice ikey = k.internal_key();
   Slice user_key = k.user_key();
 
@@ -512,6 +553,7 @@ void Version::Get(const ReadOptions& options,
   saver.logger = info_log_;
   saver.didIO = false;
   saver.statistics = db_statistics_;
+  saver.range_del_seq = range_del_seq;
 
   stats->seek_file = nullptr;
   stats->seek_file_level = -1;
@@ -579,8 +621,22 @@ void Version::Get(const ReadOptions& options,
     FileMetaData* prev_file = nullptr;
 #endif
 
+    size_t next_run = 0;
     for (int32_t i = start_index; i < num_files;) {
       FileMetaData* f = files[i];
+      int32_t next_index = i + 1;
+      if (level == 0 && next_run < level0_runs_.size() &&
+          level0_runs_[next_run].first == static_cast<size_t>(i)) {
+        // Only one file of a partitioned sorted run can hold the key
+        const Level0Run& run = level0_runs_[next_run++];
+        next_index = static_cast<int32_t>(run.last);
+        size_t index = FindFile(cfd_->internal_comparator(), run.files, ikey);
+        if (index == run.files.size()) {
+          i = next_index;
+          continue;
+        }
+        f = run.files[index];
+      }
       // Check if key is within a file's range. If search left bound and right
       // bound point to the same find, we are sure key falls in range.
       assert(level == 0 || i == start_index ||
@@ -601,7 +657,7 @@ void Version::Get(const ReadOptions& options,
       // Key falls out of current file's range
       if (cmp_smallest < 0 || cmp_largest > 0) {
         if (level == 0) {
-          ++i;
+          i = next_index;
           continue;
         } else {
           break;
@@ -669,7 +725,7 @@ void Version::Get(const ReadOptions& options,
       if (level > 0 && cmp_largest < 0) {
         break;
       } else {
-        ++i;
+        i = next_index;
       }
     }
   }
@@ -692,6 +748,197 @@ void Version::Get(const ReadOptions& options,
   }
 }
 
+void Version::MultiGet(const ReadOptions& options,
+                       const std::vector<MultiGetKey>& keys,
+                       GetStats* stats) {
+  const size_t num_keys = keys.size();
+  std::vector<Saver> savers(num_keys);
+  std::vector<bool> done(num_keys, false);
+  std::vector<FileMetaData*> last_file_read(num_keys, nullptr);
+  std::vector<int> last_file_read_level(num_keys, -1);
+  // Keys that still have to be looked up in the lower levels, in user key
+  // order.
+  std::vector<size_t> pending;
+  for (size_t k = 0; k < num_keys; ++k) {
+    assert(keys[k].status->ok() || keys[k].status->IsMergeInProgress());
+    Saver& saver = savers[k];
+    saver.state = keys[k].status->ok() ? kNotFound : kMerge;
+    saver.ucmp = user_comparator_;
+    saver.user_key = keys[k].key->user_key();
+    saver.value_found = nullptr;
+    saver.value = keys[k].value;
+    saver.merge_operator = merge_operator_;
+    saver.merge_context = keys[k].merge_context;
+    saver.logger = info_log_;
+    saver.didIO = false;
+    saver.statistics = db_statistics_;
+    saver.range_del_seq = keys[k].range_del_seq;
+    pending.push_back(k);
+  }
+
+  stats->seek_file = nullptr;
+  stats->seek_file_level = -1;
+
+  // The keys of "pending" that may be in the file being looked at
+  std::vector<size_t> batch;
+  std::vector<Slice> batch_keys;
+  std::vector<void*> batch_savers;
+  std::vector<Status> batch_status;
+
+  // Looks up all keys of "batch" in "f" and updates their state the same
+  // way Get() does after each file.
+  auto get_from_file = [&](FileMetaData* f, int level) {
+    batch_keys.clear();
+    batch_savers.clear();
+    for (size_t k : batch) {
+      batch_keys.push_back(keys[k].key->internal_key());
+      batch_savers.push_back(&savers[k]);
+    }
+    batch_status.resize(batch.size());
+    bool tableIO = false;
+    table_cache_->MultiGet(options, *internal_comparator_, *f, batch.size(),
+                           &batch_keys[0], &batch_savers[0], SaveValue,
+                           &tableIO, MarkKeyMayExist, &batch_status[0]);
+    for (size_t j = 0; j < batch.size(); ++j) {
+      const size_t k = batch[j];
+      Saver& saver = savers[k];
+      if (!batch_status[j].ok()) {
+        *keys[k].status = batch_status[j];
+        done[k] = true;
+        continue;
+      }
+
+      if (last_file_read[k] != nullptr && stats->seek_file == nullptr) {
+        // We have had more than one seek for this read.  Charge the 1st file.
+        stats->seek_file = last_file_read[k];
+        stats->seek_file_level = last_file_read_level[k];
+      }
+      if (saver.didIO || tableIO) {
+        last_file_read[k] = f;
+        last_file_read_level[k] = level;
+      }
+
+      switch (saver.state) {
+        case kNotFound:
+        case kMerge:
+          break;  // Keep searching in other files
+        case kFound:
+          *keys[k].status = Status::OK();
+          done[k] = true;
+          break;
+        case kDeleted:
+          *keys[k].status = Status::NotFound();
+          done[k] = true;
+          break;
+        case kCorrupt:
+          *keys[k].status =
+              Status::Corruption("corrupted key for ", saver.user_key);
+          done[k] = true;
+          break;
+      }
+    }
+  };
+
+  for (int level = 0; level < num_levels_ && !pending.empty(); ++level) {
+    const std::vector<FileMetaData*>& files = files_[level];
+    if (files.empty()) {
+      continue;
+    }
+
+    if (level == 0) {
+      // Level-0 files may overlap each other. Look at all of them, newest
+      // to oldest, like Get().
+      for (FileMetaData* f : files) {
+        batch.clear();
+        for (size_t k : pending) {
+          const Slice user_key = keys[k].key->user_key();
+          if (!done[k] &&
+              user_comparator_->Compare(user_key, f->smallest.user_key()) >=
+                  0 &&
+              user_comparator_->Compare(user_key, f->largest.user_key()) <=
+                  0) {
+            batch.push_back(k);
+          }
+        }
+        if (!batch.empty()) {
+          get_from_file(f, level);
+        }
+      }
+    } else {
+      // Files are sorted and disjoint, and so are the keys: walk both in
+      // step, binary searching past the files that no key falls into.
+      std::vector<size_t> carry;
+      size_t next = 0;
+      uint32_t i = FindFile(*internal_comparator_, files,
+                            keys[pending[0]].key->internal_key());
+      while (i < files.size() && (next < pending.size() || !carry.empty())) {
+        FileMetaData* f = files[i];
+        batch.swap(carry);
+        carry.clear();
+        for (; next < pending.size(); ++next) {
+          const size_t k = pending[next];
+          const Slice user_key = keys[k].key->user_key();
+          if (user_comparator_->Compare(user_key, f->largest.user_key()) > 0) {
+            break;
+          }
+          if (user_comparator_->Compare(user_key, f->smallest.user_key()) >=
+              0) {
+            batch.push_back(k);
+          }
+        }
+
+        if (!batch.empty()) {
+          get_from_file(f, level);
+          // The entries of a user key may continue in the next file of the
+          // level if it is this file's largest key.
+          for (size_t k : batch) {
+            if (!done[k] &&
+                user_comparator_->Compare(keys[k].key->user_key(),
+                                          f->largest.user_key()) == 0) {
+              carry.push_back(k);
+            }
+          }
+          ++i;
+        } else if (next < pending.size()) {
+          i = FindFileInRange(*internal_comparator_, files,
+                              keys[pending[next]].key->internal_key(), i + 1,
+                              files.size());
+        } else {
+          break;
+        }
+      }
+    }
+
+    size_t remaining = 0;
+    for (size_t k : pending) {
+      if (!done[k]) {
+        pending[remaining++] = k;
+      }
+    }
+    pending.resize(remaining);
+  }
+
+  for (size_t k : pending) {
+    Saver& saver = savers[k];
+    if (kMerge == saver.state) {
+      // merge_operands are in saver and we hit the beginning of the key
+      // history do a final merge of nullptr and operands;
+      if (merge_operator_->FullMerge(saver.user_key, nullptr,
+                                     saver.merge_context->GetOperands(),
+                                     keys[k].value, info_log_)) {
+        *keys[k].status = Status::OK();
+      } else {
+        RecordTick(db_statistics_, NUMBER_MERGE_FAILURES);
+        *keys[k].status = Status::Corruption(
+            "could not perform end-of-key merge for ", saver.user_key);
+      }
+    } else {
+      *keys[k].status = Status::NotFound();  // Use an empty error message
+                                             // for speed
+    }
+  }
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != nullptr) {
@@ -705,15 +952,95 @@ bool Version::UpdateStats(const GetStats& stats) {
   return false;
 }
 
+void Version::CalculateBaseBytes() {
+  const Options* options = cfd_->options();
+  const uint64_t base_bytes_max = options->max_bytes_for_level_base;
+  const uint64_t multiplier =
+      std::max(options->max_bytes_for_level_multiplier, 2);
+  const uint64_t base_bytes_min = base_bytes_max / multiplier;
+
+  // Levels above the base level are kept empty, so their score is always 0.
+  level_max_bytes_.assign(NumberLevels(), ULLONG_MAX);
+
+  int first_non_empty_level = -1;
+  uint64_t max_level_size = 0;
+  for (int level = 1; level < NumberLevels(); level++) {
+    const uint64_t level_size = TotalFileSize(files_[level]);
+    if (level_size > 0 && first_non_empty_level == -1) {
+      first_non_empty_level = level;
+    }
+    max_level_size = std::max(max_level_size, level_size);
+  }
+
+  if (max_level_size == 0) {
+    // No data below level-0 yet: compact level-0 straight into the last
+    // level.
+    base_level_ = NumberLevels() - 1;
+    return;
+  }
+
+  // The size the first non-empty level would have if the largest level
+  // were the last one and every level were exactly "multiplier" times the
+  // size of the level above it.
+  uint64_t cur_level_size = max_level_size;
+  for (int level = NumberLevels() - 2; level >= first_non_empty_level;
+       level--) {
+    cur_level_size /= multiplier;
+  }
+
+  // Move the base level up while it would be larger than
+  // max_bytes_for_level_base. Data that already sits above the computed base
+  // level keeps the base level there until it has been compacted down.
+  uint64_t base_level_size;
+  base_level_ = first_non_empty_level;
+  if (cur_level_size <= base_bytes_min) {
+    base_level_size = base_bytes_min + 1;
+  } else {
+    while (base_level_ > 1 && cur_level_size > base_bytes_max) {
+      base_level_--;
+      cur_level_size /= multiplier;
+    }
+    base_level_size = std::min(cur_level_size, base_bytes_max);
+  }
+
+  uint64_t level_size = base_level_size;
+  for (int level = base_level_; level < NumberLevels(); level++) {
+    if (level > base_level_ &&
+        level_size <= ULLONG_MAX / multiplier) {
+      level_size *= multiplier;
+    }
+    // Never let a level's target drop below max_bytes_for_level_base, or
+    // level-0 would be starved in favor of tiny levels further down.
+    level_max_bytes_[level] = std::max(level_size, base_bytes_max);
+  }
+}
+
+double Version::MaxBytesForLevel(int level) const {
+  assert(level >= 0);
+  assert(level < NumberLevels());
+  if (!level_max_bytes_.empty()) {
+    return level_max_bytes_[level];
+  }
+  return cfd_->compaction_picker()->MaxBytesForLevel(level);
+}
+
 void Version::ComputeCompactionScore(
     std::vector<uint64_t>& size_being_compacted) {
   double max_score = 0;
   int max_score_level = 0;
 
-  int num_levels_to_check =
-      (cfd_->options()->compaction_style != kCompactionStyleUniversal)
-          ? NumberLevels() - 1
-          : 1;
+  if (cfd_->options()->compaction_style == kCompactionStyleLevel &&
+      cfd_->options()->level_compaction_dynamic_level_bytes) {
+    CalculateBaseBytes();
+  }
+
+  const bool universal =
+      cfd_->options()->compaction_style == kCompactionStyleUniversal;
+  if (universal) {
+    UpdateSortedRuns();
+  }
+
+  int num_levels_to_check = !universal ? NumberLevels() - 1 : 1;
 
   for (int level = 0; level < num_levels_to_check; level++) {
     double score;
@@ -729,10 +1056,19 @@ void Version::ComputeCompactionScore(
       // file size is small (perhaps because of a small write-buffer
       // setting, or very high compression ratios, or lots of
       // overwrites/deletions).
+      // With universal compaction, sorted runs are counted instead.
       int numfiles = 0;
-      for (unsigned int i = 0; i < files_[level].size(); i++) {
-        if (!files_[level][i]->being_compacted) {
-          numfiles++;
+      if (universal) {
+        for (const auto& run : sorted_runs_) {
+          if (!SortedRunBeingCompacted(run)) {
+            numfiles++;
+          }
+        }
+      } else {
+        for (unsigned int i = 0; i < files_[level].size(); i++) {
+          if (!files_[level][i]->being_compacted) {
+            numfiles++;
+          }
         }
       }
 
@@ -749,8 +1085,7 @@ void Version::ComputeCompactionScore(
       // Compute the ratio of current size to size limit.
       const uint64_t level_bytes =
           TotalFileSize(files_[level]) - size_being_compacted[level];
-      score = static_cast<double>(level_bytes) /
-              cfd_->compaction_picker()->MaxBytesForLevel(level);
+      score = static_cast<double>(level_bytes) / MaxBytesForLevel(level);
       if (max_score < score) {
         max_score = score;
         max_score_level = level;
@@ -778,6 +1113,144 @@ void Version::ComputeCompactionScore(
       }
     }
   }
+
+  // Files marked for compaction that can be compacted into the next level
+  files_marked_for_compaction_.clear();
+  if (cfd_->options()->compaction_style == kCompactionStyleLevel) {
+    for (int level = 0; level < NumberLevels() - 1; level++) {
+      for (FileMetaData* f : files_[level]) {
+        if (f->marked_for_compaction && !f->being_compacted) {
+          files_marked_for_compaction_.push_back(std::make_pair(level, f));
+        }
+      }
+    }
+  }
+
+  // Files that are older than periodic_compaction_seconds, in any level
+  files_marked_for_periodic_compaction_.clear();
+  const uint64_t period = cfd_->options()->periodic_compaction_seconds;
+  int64_t now = 0;
+  if (cfd_->options()->compaction_style == kCompactionStyleLevel &&
+      period > 0 && cfd_->options()->env->GetCurrentTime(&now).ok()) {
+    for (int level = 0; level < NumberLevels(); level++) {
+      for (FileMetaData* f : files_[level]) {
+        if (f->creation_time != 0 && !f->being_compacted &&
+            static_cast<uint64_t>(now) >= f->creation_time + period) {
+          files_marked_for_periodic_compaction_.push_back(
+              std::make_pair(level, f));
+        }
+      }
+    }
+  }
+}
+
+void Version::UpdateSortedRuns() {
+  sorted_runs_.clear();
+  const std::vector<FileMetaData*>& files = files_[0];
+  const bool partitioned =
+      cfd_->options()->compaction_options_universal.partitioned_runs;
+
+  // The files are sorted newest first. A run can only end where all newer
+  // files hold newer sequence numbers than all older files; the output
+  // files of a partitioned compaction and the files it left in place share
+  // a range of sequence numbers and have to stay in the same run.
+  std::vector<SequenceNumber> older_largest_seqno(files.size() + 1, 0);
+  for (size_t i = files.size(); i > 0; i--) {
+    older_largest_seqno[i - 1] =
+        std::max(older_largest_seqno[i], files[i - 1]->largest_seqno);
+  }
+
+  // The key ranges of the files of the current run, by smallest key
+  const Comparator* ucmp = user_comparator_;
+  auto less = [ucmp](const Slice& a, const Slice& b) {
+    return ucmp->Compare(a, b) < 0;
+  };
+  std::map<Slice, Slice, decltype(less)> ranges(less);
+  auto overlaps_run = [&](const FileMetaData* f) {
+    auto it = ranges.upper_bound(f->largest.user_key());
+    return it != ranges.begin() &&
+           ucmp->Compare((--it)->second, f->smallest.user_key()) >= 0;
+  };
+
+  SequenceNumber newer_smallest_seqno = kMaxSequenceNumber;
+  size_t group_first = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    newer_smallest_seqno =
+        std::min(newer_smallest_seqno, files[i]->smallest_seqno);
+    if (i + 1 < files.size() &&
+        newer_smallest_seqno <= older_largest_seqno[i + 1]) {
+      continue;
+    }
+    // Files [group_first, i] go into the same run. They join the current
+    // run if none of them overlaps it.
+    bool join = partitioned && !sorted_runs_.empty();
+    for (size_t j = group_first; join && j <= i; j++) {
+      join = !overlaps_run(files[j]);
+    }
+    if (!join) {
+      sorted_runs_.push_back(SortedRun{group_first, group_first, 0});
+      ranges.clear();
+    }
+    SortedRun& run = sorted_runs_.back();
+    for (size_t j = group_first; j <= i; j++) {
+      run.size += files[j]->file_size;
+      if (partitioned) {
+        ranges.insert(std::make_pair(files[j]->smallest.user_key(),
+                                     files[j]->largest.user_key()));
+      }
+    }
+    run.last = i + 1;
+    group_first = i + 1;
+  }
+}
+
+bool Version::SortedRunBeingCompacted(const SortedRun& run) const {
+  for (size_t i = run.first; i < run.last; i++) {
+    if (files_[0][i]->being_compacted) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Version::UpdateLevel0Runs() {
+  level0_runs_.clear();
+  if (cfd_->options()->compaction_style != kCompactionStyleUniversal ||
+      !cfd_->options()->compaction_options_universal.partitioned_runs) {
+    return;
+  }
+  const InternalKeyComparator* icmp = internal_comparator_;
+  for (const auto& run : sorted_runs_) {
+    if (run.last - run.first < 2) {
+      continue;
+    }
+    Level0Run level0_run{run.first, run.last,
+                         std::vector<FileMetaData*>(
+                             files_[0].begin() + run.first,
+                             files_[0].begin() + run.last)};
+    std::vector<FileMetaData*>& files = level0_run.files;
+    std::sort(files.begin(), files.end(),
+              [icmp](const FileMetaData* a, const FileMetaData* b) {
+      return icmp->Compare(a->smallest, b->smallest) < 0;
+    });
+    // A user key must not span two files of the run, or a binary search
+    // would only find one of them.
+    bool disjoint = true;
+    for (size_t i = 1; disjoint && i < files.size(); i++) {
+      disjoint = user_comparator_->Compare(files[i - 1]->largest.user_key(),
+                                           files[i]->smallest.user_key()) < 0;
+    }
+    if (disjoint) {
+      level0_runs_.push_back(std::move(level0_run));
+    }
+  }
+}
+
+int Version::NumLevel0SortedRuns() const {
+  if (cfd_->options()->compaction_style == kCompactionStyleUniversal) {
+    return sorted_runs_.size();
+  }
+  return NumLevelFiles(0);
 }
 
 namespace {
@@ -789,19 +1262,56 @@ bool CompareSizeDescending(const Version::Fsize& first,
   return (first.file->file_size > second.file->file_size);
 }
 // A static compator used to sort files based on their seqno
-// In universal style : descending seqno
+// In universal style : descending seqno, the order of files_[0]
 bool CompareSeqnoDescending(const Version::Fsize& first,
                             const Version::Fsize& second) {
-  if (first.file->smallest_seqno > second.file->smallest_seqno) {
-    assert(first.file->largest_seqno > second.file->largest_seqno);
-    return true;
-  }
-  assert(first.file->largest_seqno <= second.file->largest_seqno);
-  return false;
+  return NewestFirstBySeqNo(first.file, second.file);
+}
+// A static compator used to sort files based on their smallest seqno
+// In kOldestSmallestSeqFirst mode: ascending smallest seqno
+bool CompareSmallestSeqnoAscending(const Version::Fsize& first,
+                                   const Version::Fsize& second) {
+  return (first.file->smallest_seqno < second.file->smallest_seqno);
 }
 
 } // anonymous namespace
 
+void Version::ComputeOverlappingRatios(int level,
+                                       std::vector<uint64_t>* ratios) {
+  // Level-0 compacts into the base level, every other level into the next.
+  const int next_level = (level == 0) ? base_level_ : level + 1;
+  const std::vector<FileMetaData*>& files = files_[level];
+  const std::vector<FileMetaData*>& next_files = files_[next_level];
+
+  ratios->resize(files.size());
+  size_t next_index = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    const FileMetaData* f = files[i];
+    // Files in levels > 0 are sorted and do not overlap, so the scan of the
+    // next level can resume where the previous file's scan started.
+    // Level-0 files may overlap each other, so restart it for them.
+    if (level == 0) {
+      next_index = 0;
+    }
+    while (next_index < next_files.size() &&
+           user_comparator_->Compare(next_files[next_index]->largest.user_key(),
+                                     f->smallest.user_key()) < 0) {
+      next_index++;
+    }
+    uint64_t overlapping_bytes = 0;
+    for (size_t j = next_index;
+         j < next_files.size() &&
+         user_comparator_->Compare(next_files[j]->smallest.user_key(),
+                                   f->largest.user_key()) <= 0;
+         j++) {
+      overlapping_bytes += next_files[j]->file_size;
+    }
+    // Scaled by 1024 to keep some precision in integer arithmetic.
+    (*ratios)[i] =
+        overlapping_bytes * 1024 / std::max<uint64_t>(f->file_size, 1);
+  }
+}
+
 void Version::UpdateFilesBySize() {
   // No need to sort the highest level because it is never compacted.
   int max_level =
@@ -821,7 +1331,8 @@ void Version::UpdateFilesBySize() {
       temp[i].file = files[i];
     }
 
-    // sort the top number_of_files_to_sort_ based on file size
+    // sort the top number_of_files_to_sort_ in the order they should be
+    // compacted
     if (cfd_->options()->compaction_style == kCompactionStyleUniversal) {
       int num = temp.size();
       std::partial_sort(temp.begin(), temp.begin() + num, temp.end(),
@@ -831,8 +1342,26 @@ void Version::UpdateFilesBySize() {
       if (num > (int)temp.size()) {
         num = temp.size();
       }
-      std::partial_sort(temp.begin(), temp.begin() + num, temp.end(),
-                        CompareSizeDescending);
+      switch (cfd_->options()->compaction_pri) {
+        case kByLargestSize:
+          std::partial_sort(temp.begin(), temp.begin() + num, temp.end(),
+                            CompareSizeDescending);
+          break;
+        case kOldestSmallestSeqFirst:
+          std::partial_sort(temp.begin(), temp.begin() + num, temp.end(),
+                            CompareSmallestSeqnoAscending);
+          break;
+        case kMinOverlappingRatio: {
+          std::vector<uint64_t> ratios;
+          ComputeOverlappingRatios(level, &ratios);
+          std::partial_sort(temp.begin(), temp.begin() + num, temp.end(),
+                            [&ratios](const Fsize& first, const Fsize& second) {
+                              return ratios[first.index] <
+                                     ratios[second.index];
+                            });
+          break;
+        }
+      }
     }
     assert(temp.size() == files.size());
 
@@ -860,7 +1389,8 @@ bool Version::Unref() {
 }
 
 bool Version::NeedsCompaction() const {
-  if (file_to_compact_ != nullptr) {
+  if (file_to_compact_ != nullptr || !files_marked_for_compaction_.empty() ||
+      !files_marked_for_periodic_compaction_.empty()) {
     return true;
   }
   // In universal compaction case, this check doesn't really
@@ -901,6 +1431,12 @@ int Version::PickLevelForMemTableOutput(
     InternalKey limit(largest_user_key, 0, static_cast<ValueType>(0));
     std::vector<FileMetaData*> overlaps;
     int max_mem_compact_level = cfd_->options()->max_mem_compaction_level;
+    // Levels above the base level must stay empty when level targets are
+    // dynamic, so flushes never skip level-0.
+    if (cfd_->options()->compaction_style == kCompactionStyleLevel &&
+        cfd_->options()->level_compaction_dynamic_level_bytes) {
+      max_mem_compact_level = 0;
+    }
     while (max_mem_compact_level > 0 && level < max_mem_compact_level) {
       if (OverlapInLevel(level + 1, &smallest_user_key, &largest_user_key)) {
         break;
@@ -1344,7 +1880,14 @@ class VersionSet::Builder {
         if (level == 0) {
           assert(level_zero_cmp_(f1, f2));
           if (cfd_->options()->compaction_style == kCompactionStyleUniversal) {
-            assert(f1->largest_seqno > f2->largest_seqno);
+            // Files with overlapping key ranges must not share sequence
+            // numbers. Files of a partitioned sorted run may. A file whose
+            // range tombstones end at the first user key of the next file
+            // ends right before that key's entries.
+            const InternalKeyComparator& icmp = cfd_->internal_comparator();
+            assert(f1->smallest_seqno > f2->largest_seqno ||
+                   icmp.Compare(f1->smallest, f2->largest) > 0 ||
+                   icmp.Compare(f2->smallest, f1->largest) > 0);
           }
         } else {
           assert(level_nonzero_cmp_(f1, f2));
@@ -1484,25 +2027,146 @@ class VersionSet::Builder {
     CheckConsistency(v);
 
     v->file_indexer_.UpdateIndex(v->files_);
+
+    SaveRangeTombstonesTo(v);
   }
 
-  void LoadTableHandlers() {
+  // Store in v->range_tombstones_ the range tombstones of the files of v.
+  // The tombstones of base_ are only fragmented again if files storing some
+  // were deleted; files that merely moved to another level don't count.
+  void SaveRangeTombstonesTo(Version* v) {
+    std::set<uint64_t> deleted_tombstone_files;
+    std::vector<const FileMetaData*> added_tombstone_files;
+    for (int level = 0; level < base_->NumberLevels(); level++) {
+      const auto& deleted_files = levels_[level].deleted_files;
+      for (const auto& f : base_->files_[level]) {
+        if (f->has_range_tombstones && deleted_files.count(f->number) > 0) {
+          deleted_tombstone_files.insert(f->number);
+        }
+      }
+    }
+    for (int level = 0; level < base_->NumberLevels(); level++) {
+      const auto& deleted_files = levels_[level].deleted_files;
+      for (const auto& f : *levels_[level].added_files) {
+        if (f->has_range_tombstones && deleted_files.count(f->number) == 0 &&
+            deleted_tombstone_files.erase(f->number) == 0) {
+          added_tombstone_files.push_back(f);
+        }
+      }
+    }
+    const bool deleted_tombstones = !deleted_tombstone_files.empty();
+    if (!deleted_tombstones && added_tombstone_files.empty()) {
+      v->range_tombstones_ = base_->range_tombstones_;
+      return;
+    }
+
+    std::vector<const RangeTombstoneSet*> sets;
+    std::vector<RangeTombstone> tombstones;
+    auto add_file = [&tombstones](const FileMetaData* f) {
+      // Only files listed by the MANIFEST dump are not loaded
+      if (f->range_tombstones != nullptr) {
+        tombstones.insert(tombstones.end(), f->range_tombstones->begin(),
+                          f->range_tombstones->end());
+      }
+    };
+    if (deleted_tombstones) {
+      for (int level = 0; level < v->NumberLevels(); level++) {
+        for (const auto& f : v->files_[level]) {
+          if (f->has_range_tombstones) {
+            add_file(f);
+          }
+        }
+      }
+    } else {
+      if (base_->range_tombstones_ != nullptr) {
+        sets.push_back(base_->range_tombstones_.get());
+      }
+      for (const auto& f : added_tombstone_files) {
+        add_file(f);
+      }
+    }
+    std::shared_ptr<const RangeTombstoneSet> range_tombstones(
+        new RangeTombstoneSet(cfd_->user_comparator(), sets, tombstones));
+    if (!range_tombstones->empty()) {
+      v->range_tombstones_ = std::move(range_tombstones);
+    }
+  }
+
+  // Read the range tombstones of the added files that store some and were
+  // not deleted again, unless they are loaded already.
+  Status LoadRangeTombstones() {
+    for (int level = 0; level < base_->NumberLevels(); level++) {
+      const auto& deleted_files = levels_[level].deleted_files;
+      for (auto& f : *levels_[level].added_files) {
+        if (!f->has_range_tombstones || f->range_tombstones != nullptr ||
+            deleted_files.count(f->number) > 0) {
+          continue;
+        }
+        Status s = cfd_->table_cache()->GetRangeTombstones(
+            base_->vset_->storage_options_, cfd_->internal_comparator(), *f,
+            &f->range_tombstones);
+        if (!s.ok()) {
+          return s;
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  // Open the table files added to the builder, which reads their footers,
+  // indexes and filters, on up to max_threads threads. If pin_readers, the
+  // files stay open as long as they live, through their FileMetaData;
+  // otherwise they are only left in the table cache. At most max_files
+  // files are opened. Returns the number of files opened.
+  size_t LoadTableHandlers(int max_threads, bool pin_readers,
+                           size_t max_files) {
+    std::vector<FileMetaData*> files_meta;
     for (int level = 0; level < cfd_->NumberLevels(); level++) {
       for (auto& file_meta : *(levels_[level].added_files)) {
+        if (files_meta.size() >= max_files) {
+          break;
+        }
         assert (!file_meta->table_reader_handle);
+        files_meta.push_back(file_meta);
+      }
+    }
+
+    std::atomic<size_t> next_file(0);
+    auto load = [&]() {
+      for (size_t i = next_file.fetch_add(1); i < files_meta.size();
+           i = next_file.fetch_add(1)) {
+        FileMetaData* file_meta = files_meta[i];
+        Cache::Handle* handle = nullptr;
         bool table_io;
         cfd_->table_cache()->FindTable(
             base_->vset_->storage_options_, cfd_->internal_comparator(),
-            file_meta->number, file_meta->file_size,
-            &file_meta->table_reader_handle, &table_io, false);
-        if (file_meta->table_reader_handle != nullptr) {
+            file_meta->number, file_meta->file_size, &handle, &table_io,
+            false);
+        if (handle == nullptr) {
+          // Reads open the file again, and report the error
+          continue;
+        }
+        if (pin_readers) {
           // Load table_reader
+          file_meta->table_reader_handle = handle;
           file_meta->table_reader =
-              cfd_->table_cache()->GetTableReaderFromHandle(
-                  file_meta->table_reader_handle);
+              cfd_->table_cache()->GetTableReaderFromHandle(handle);
+        } else {
+          cfd_->table_cache()->ReleaseHandle(handle);
         }
       }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1;
+         i < max_threads && i < static_cast<int>(files_meta.size()); i++) {
+      threads.emplace_back(load);
     }
+    load();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return files_meta.size();
   }
 
   void MaybeAddFile(Version* v, int level, FileMetaData* f) {
@@ -1668,8 +2332,10 @@ Status VersionSet::LogAndApply(ColumnFamilyData* column_family_data,
 
     if (!edit->IsColumnFamilyManipulation() && options_->max_open_files == -1) {
       // unlimited table cache. Pre-load table handle now.
-      // Need to do it out of the mutex.
-      builder->LoadTableHandlers();
+      // Need to do it out of the mutex. A flush or compaction only adds a few
+      // files, which are opened on this thread; max_file_opening_threads is
+      // for DB::Open.
+      builder->LoadTableHandlers(1, true, std::numeric_limits<size_t>::max());
     }
 
     // This is fine because everything inside of this block is serialized --
@@ -1692,6 +2358,7 @@ Status VersionSet::LogAndApply(ColumnFamilyData* column_family_data,
       // and is best called outside the mutex.
       v->ComputeCompactionScore(size_being_compacted);
       v->UpdateFilesBySize();
+      v->UpdateLevel0Runs();
     }
 
     // Write new record to MANIFEST log
@@ -2091,6 +2758,23 @@ Status VersionSet::Recover(
   }
 
   if (s.ok()) {
+    for (auto cfd : *column_family_set_) {
+      auto builders_iter = builders.find(cfd->GetID());
+      assert(builders_iter != builders.end());
+      s = builders_iter->second->LoadRangeTombstones();
+      if (!s.ok()) {
+        break;
+      }
+    }
+  }
+
+  if (s.ok()) {
+    // Files preloaded into a limited table cache are not pinned, so only
+    // open as many as it holds.
+    size_t files_to_preload = 0;
+    if (options_->preload_table_files_on_open) {
+      files_to_preload = std::max(options_->max_open_files - 10, 0);
+    }
     for (auto cfd : *column_family_set_) {
       auto builders_iter = builders.find(cfd->GetID());
       assert(builders_iter != builders.end());
@@ -2099,7 +2783,11 @@ Status VersionSet::Recover(
       if (options_->max_open_files == -1) {
       // unlimited table cache. Pre-load table handle now.
       // Need to do it out of the mutex.
-        builder->LoadTableHandlers();
+        builder->LoadTableHandlers(options_->max_file_opening_threads, true,
+                                   std::numeric_limits<size_t>::max());
+      } else if (files_to_preload > 0) {
+        files_to_preload -= builder->LoadTableHandlers(
+            options_->max_file_opening_threads, false, files_to_preload);
       }
 
       Version* v = new Version(cfd, this, current_version_number_++);
@@ -2110,6 +2798,7 @@ Status VersionSet::Recover(
       cfd->compaction_picker()->SizeBeingCompacted(size_being_compacted);
       v->ComputeCompactionScore(size_being_compacted);
       v->UpdateFilesBySize();
+      v->UpdateLevel0Runs();
       AppendVersion(cfd, v);
     }
 
@@ -2522,7 +3211,10 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
                        f->smallest,
                        f->largest,
                        f->smallest_seqno,
-                       f->largest_seqno);
+                       f->largest_seqno,
+                       f->marked_for_compaction,
+                       f->creation_time,
+                       f->range_tombstones);
         }
       }
       edit.SetLogNumber(cfd->GetLogNumber());
@@ -2590,20 +3282,88 @@ uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
       } else {
         // "ikey" falls in the range for this table.  Add the
         // approximate offset of "ikey" within the table.
-        TableReader* table_reader_ptr;
-        Iterator* iter = v->cfd_->table_cache()->NewIterator(
-            ReadOptions(), storage_options_, v->cfd_->internal_comparator(),
-            *(files[i]), &table_reader_ptr);
-        if (table_reader_ptr != nullptr) {
-          result += table_reader_ptr->ApproximateOffsetOf(ikey.Encode());
-        }
-        delete iter;
+        result += ApproximateOffsetInFile(v, *files[i], ikey);
       }
     }
   }
   return result;
 }
 
+uint64_t VersionSet::ApproximateOffsetInFile(Version* v, const FileMetaData& f,
+                                             const InternalKey& ikey) {
+  uint64_t result = 0;
+  TableReader* table_reader_ptr;
+  Iterator* iter = v->cfd_->table_cache()->NewIterator(
+      ReadOptions(), storage_options_, v->cfd_->internal_comparator(), f,
+      &table_reader_ptr);
+  if (table_reader_ptr != nullptr) {
+    result = table_reader_ptr->ApproximateOffsetOf(ikey.Encode());
+  }
+  delete iter;
+  return result;
+}
+
+void VersionSet::GetSubcompactionBoundaries(
+    Compaction* c, int max_ranges, std::vector<std::string>* boundaries) {
+  boundaries->clear();
+  if (max_ranges <= 1) {
+    return;
+  }
+  Version* v = c->input_version();
+  const Comparator* user_cmp = c->column_family_data()->user_comparator();
+
+  // The edges of the input files are the candidate split points.
+  std::vector<Slice> candidates;
+  uint64_t total_size = 0;
+  for (int which = 0; which < 2; which++) {
+    for (const auto file : *c->inputs(which)) {
+      candidates.push_back(file->smallest.user_key());
+      candidates.push_back(file->largest.user_key());
+      total_size += file->file_size;
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [user_cmp](const Slice& a, const Slice& b) {
+              return user_cmp->Compare(a, b) < 0;
+            });
+  candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                               [user_cmp](const Slice& a, const Slice& b) {
+                                 return user_cmp->Compare(a, b) == 0;
+                               }),
+                   candidates.end());
+
+  // Walk the candidates in order and cut wherever the input data before
+  // the candidate reaches the next multiple of total_size / max_ranges.
+  // The first candidate is the smallest key, so it cannot separate ranges.
+  const uint64_t range_size = total_size / max_ranges;
+  if (range_size == 0) {
+    return;
+  }
+  uint64_t next_cut = range_size;
+  for (size_t k = 1; k < candidates.size() &&
+                     boundaries->size() + 1 < static_cast<size_t>(max_ranges);
+       k++) {
+    const Slice& key = candidates[k];
+    InternalKey ikey(key, kMaxSequenceNumber, kValueTypeForSeek);
+    uint64_t offset = 0;
+    for (int which = 0; which < 2; which++) {
+      for (const auto file : *c->inputs(which)) {
+        if (user_cmp->Compare(file->largest.user_key(), key) < 0) {
+          offset += file->file_size;
+        } else if (user_cmp->Compare(file->smallest.user_key(), key) < 0) {
+          offset += ApproximateOffsetInFile(v, *file, ikey);
+        }
+      }
+    }
+    if (offset >= next_cut && offset < total_size) {
+      boundaries->push_back(key.ToString());
+      while (next_cut <= offset) {
+        next_cut += range_size;
+      }
+    }
+  }
+}
+
 void VersionSet::AddLiveFiles(std::vector<uint64_t>* live_list) {
   // pre-calculate space requirement
   int64_t total_files = 0;
@@ -2647,9 +3407,9 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   Iterator** list = new Iterator*[space];
   int num = 0;
   for (int which = 0; which < 2; which++) {
-    if (!c->inputs(which)->empty()) {
+    if (!c->files_to_read(which)->empty()) {
       if (c->level() + which == 0) {
-        for (const auto& file : *c->inputs(which)) {
+        for (const auto& file : *c->files_to_read(which)) {
           list[num++] = cfd->table_cache()->NewIterator(
               read_options, storage_options_compactions_,
               cfd->internal_comparator(), *file, nullptr,
@@ -2662,7 +3422,7 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
               cfd->internal_comparator(), true /* for_compaction */,
               false /* prefix enabled */),
             new Version::LevelFileNumIterator(cfd->internal_comparator(),
-                                              c->inputs(which)));
+                                              c->files_to_read(which)));
       }
     }
   }
@@ -2702,8 +3462,8 @@ bool VersionSet::VerifyCompactionFileConsistency(Compaction* c) {
       return false; // input files non existant in current version
     }
   }
-  // verify level+1 files
-  level++;
+  // verify output level files
+  level = c->output_level();
   for (int i = 0; i < c->num_input_files(1); i++) {
     uint64_t number = c->input(1,i)->number;
 
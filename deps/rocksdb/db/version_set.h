@@ -76,9 +76,15 @@ class Version {
  public:
   // Append to *iters a sequence of iterators that will
   // yield the contents of this Version when merged together.
+  // If range_tombstones is not nullptr, the iterators skip the ranges of
+  // each file that its tombstones visible at snapshot delete as a whole;
+  // see NewRangeTombstoneSkippingIterator().
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   void AddIterators(const ReadOptions&, const EnvOptions& soptions,
-                    std::vector<Iterator*>* iters);
+                    std::vector<Iterator*>* iters,
+                    const std::shared_ptr<const RangeTombstoneSets>&
+                        range_tombstones = nullptr,
+                    SequenceNumber snapshot = kMaxSequenceNumber);
 
   // Lookup the value for key.  If found, store it in *val and
   // return OK.  Else return a non-OK status.  Fills *stats.
@@ -88,9 +94,28 @@ class Version {
     FileMetaData* seek_file;
     int seek_file_level;
   };
+  // Entries with a sequence number smaller than range_del_seq are treated
+  // as deletions; see RangeTombstoneSet::MaxCoveringSeq().
   void Get(const ReadOptions&, const LookupKey& key, std::string* val,
            Status* status, MergeContext* merge_context, GetStats* stats,
-           bool* value_found = nullptr);
+           bool* value_found = nullptr, SequenceNumber range_del_seq = 0);
+
+  // One key of a MultiGet() batch. "status" and "merge_context" are in/out
+  // exactly like the corresponding arguments of Get().
+  struct MultiGetKey {
+    const LookupKey* key;
+    std::string* value;
+    Status* status;
+    MergeContext* merge_context;
+    SequenceNumber range_del_seq;
+  };
+  // Batched version of Get(). "keys" must be sorted by user key. The levels
+  // are walked once for the whole batch, and all keys that fall into the
+  // same file are handed to its table reader together, so that keys that
+  // share a data block only read it once.
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, const std::vector<MultiGetKey>& keys,
+                GetStats* stats);
 
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
@@ -119,6 +144,32 @@ class Version {
   // See field declaration
   int MaxCompactionScoreLevel() const { return max_compaction_score_level_; }
 
+  // Returns the target size of the specified level. With
+  // level_compaction_dynamic_level_bytes the targets are derived from the
+  // shape of this version by ComputeCompactionScore(); otherwise they are the
+  // static targets of the compaction picker.
+  double MaxBytesForLevel(int level) const;
+
+  // Returns the level that level-0 files are compacted into. This is always
+  // 1 unless level_compaction_dynamic_level_bytes is set.
+  int base_level() const { return base_level_; }
+
+  // Returns the range tombstones stored in the files of this version, or
+  // nullptr if there are none.
+  const std::shared_ptr<const RangeTombstoneSet>& range_tombstones() const {
+    return range_tombstones_;
+  }
+
+  // Returns the largest sequence number not greater than snapshot of a range
+  // tombstone of this version that covers user_key, or 0 if there is none.
+  SequenceNumber MaxCoveringTombstoneSeq(const Slice& user_key,
+                                         SequenceNumber snapshot) const {
+    if (range_tombstones_ == nullptr) {
+      return 0;
+    }
+    return range_tombstones_->MaxCoveringSeq(user_key, snapshot);
+  }
+
   void GetOverlappingInputs(
       int level,
       const InternalKey* begin,         // nullptr means before all keys
@@ -168,6 +219,12 @@ class Version {
   // REQUIRES: lock is held
   int NumLevelFiles(int level) const { return files_[level].size(); }
 
+  // Returns the number of sorted runs in level-0. With universal compaction
+  // and CompactionOptionsUniversal::partitioned_runs several level-0 files
+  // can form a single sorted run; otherwise every level-0 file is one.
+  // REQUIRES: lock is held
+  int NumLevel0SortedRuns() const;
+
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
@@ -224,10 +281,46 @@ class Version {
   bool PrefixMayMatch(const ReadOptions& options, Iterator* level_iter,
                       const Slice& internal_prefix) const;
 
-  // Sort all files for this version based on their file size and
-  // record results in files_by_size_. The largest files are listed first.
+  // Sort all files for this version in the order they should be compacted
+  // (see Options::compaction_pri) and record results in files_by_size_.
   void UpdateFilesBySize();
 
+  // A sorted run of universal compaction: the level-0 files
+  // files_[0][first, last), whose key ranges do not overlap.
+  struct SortedRun {
+    size_t first;
+    size_t last;
+    uint64_t size;
+  };
+
+  // Group the level-0 files into sorted_runs_. Universal compaction only.
+  void UpdateSortedRuns();
+
+  // Returns true if a file of "run" is being compacted.
+  bool SortedRunBeingCompacted(const SortedRun& run) const;
+
+  // A partitioned sorted run of more than one level-0 file,
+  // files_[0][first, last), with its files in increasing key order so that
+  // reads can binary search it like a level > 0.
+  struct Level0Run {
+    size_t first;
+    size_t last;
+    std::vector<FileMetaData*> files;
+  };
+
+  // Build level0_runs_ from sorted_runs_. Must be called before the version
+  // is installed, since readers access level0_runs_ without the mutex.
+  void UpdateLevel0Runs();
+
+  // Store in (*ratios)[i] the size of the files in the next level that
+  // overlap files_[level][i], relative to the size of that file (x1024).
+  // Used by kMinOverlappingRatio.
+  void ComputeOverlappingRatios(int level, std::vector<uint64_t>* ratios);
+
+  // Derive base_level_ and level_max_bytes_ backward from the size of the
+  // largest non-zero level. See level_compaction_dynamic_level_bytes.
+  void CalculateBaseBytes();
+
   ColumnFamilyData* cfd_;  // ColumnFamilyData to which this Version belongs
   const InternalKeyComparator* internal_comparator_;
   const Comparator* user_comparator_;
@@ -246,11 +339,19 @@ class Version {
   std::vector<FileMetaData*>* files_;
 
   // A list for the same set of files that are stored in files_,
-  // but files in each level are now sorted based on file
-  // size. The file with the largest size is at the front.
+  // but files in each level are now sorted in the order they should be
+  // compacted (by default, the file with the largest size is at the front).
   // This vector stores the index of the file from files_.
   std::vector<std::vector<int>> files_by_size_;
 
+  // With universal compaction, the sorted runs of level-0, newest first.
+  // Computed by ComputeCompactionScore().
+  std::vector<SortedRun> sorted_runs_;
+
+  // The partitioned sorted runs of sorted_runs_ that reads treat as a
+  // single concatenated file, in files_[0] order.
+  std::vector<Level0Run> level0_runs_;
+
   // An index into files_by_size_ that specifies the first
   // file that is not yet compacted
   std::vector<int> next_file_to_compact_by_size_;
@@ -266,6 +367,16 @@ class Version {
   FileMetaData* file_to_compact_;
   int file_to_compact_level_;
 
+  // The files outside of the last level whose table properties collectors
+  // asked for them to be compacted, with their levels. Computed by
+  // ComputeCompactionScore().
+  std::vector<std::pair<int, FileMetaData*>> files_marked_for_compaction_;
+
+  // The files written more than periodic_compaction_seconds ago, with their
+  // levels. Computed by ComputeCompactionScore().
+  std::vector<std::pair<int, FileMetaData*>>
+      files_marked_for_periodic_compaction_;
+
   // Level that should be compacted next and its compaction score.
   // Score < 1 means compaction is not strictly needed.  These fields
   // are initialized by Finalize().
@@ -276,6 +387,16 @@ class Version {
   double max_compaction_score_; // max score in l1 to ln-1
   int max_compaction_score_level_; // level on which max score occurs
 
+  // Level that level-0 compactions write to, and the per-level targets
+  // computed by CalculateBaseBytes(). level_max_bytes_ is empty when the
+  // static targets of the compaction picker are in effect.
+  int base_level_;
+  std::vector<uint64_t> level_max_bytes_;
+
+  // The range tombstones of all the files in files_, nullptr if there are
+  // none.
+  std::shared_ptr<const RangeTombstoneSet> range_tombstones_;
+
   // A version number that uniquely represents this version. This is
   // used for debugging and logging purposes only.
   uint64_t version_number_;
@@ -399,6 +520,14 @@ class VersionSet {
   // The caller should delete the iterator when no longer needed.
   Iterator* MakeInputIterator(Compaction* c);
 
+  // Split the key range of compaction "c" into at most "max_ranges" ranges
+  // holding about the same amount of input data, for sub-compactions. The
+  // user keys that separate the ranges are stored in ascending order in
+  // *boundaries; range i covers [boundaries[i-1], boundaries[i]). Stores
+  // nothing if the inputs cannot be split.
+  void GetSubcompactionBoundaries(Compaction* c, int max_ranges,
+                                  std::vector<std::string>* boundaries);
+
   // Add all files listed in any live version to *live.
   void AddLiveFiles(std::vector<uint64_t>* live_list);
 
@@ -441,6 +570,11 @@ class VersionSet {
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
+  // Return the approximate offset of "key" within the table file "f",
+  // which must contain the key in its range.
+  uint64_t ApproximateOffsetInFile(Version* v, const FileMetaData& f,
+                                   const InternalKey& key);
+
   void AppendVersion(ColumnFamilyData* column_family_data, Version* v);
 
   bool ManifestContains(uint64_t manifest_file_number,
@@ -15,9 +15,11 @@
 //    kTypeValue varstring varstring
 //    kTypeMerge varstring varstring
 //    kTypeDeletion varstring
+//    kTypeRangeDeletion varstring varstring
 //    kTypeColumnFamilyValue varint32 varstring varstring
 //    kTypeColumnFamilyMerge varint32 varstring varstring
 //    kTypeColumnFamilyDeletion varint32 varstring varstring
+//    kTypeColumnFamilyRangeDeletion varint32 varstring varstring
 // varstring :=
 //    len: varint32
 //    data: uint8[len]
@@ -62,6 +64,12 @@ void WriteBatch::Handler::Delete(const Slice& key) {
   throw std::runtime_error("Handler::Delete not implemented!");
 }
 
+void WriteBatch::Handler::DeleteRange(const Slice& begin_key,
+                                      const Slice& end_key) {
+  // you need to either implement DeleteRange or DeleteRangeCF
+  throw std::runtime_error("Handler::DeleteRange not implemented!");
+}
+
 void WriteBatch::Handler::LogData(const Slice& blob) {
   // If the user has not specified something to do with blobs, then we ignore
   // them.
@@ -122,6 +130,20 @@ Status WriteBatch::Iterate(Handler* handler) const {
           return Status::Corruption("bad WriteBatch Delete");
         }
         break;
+      case kTypeColumnFamilyRangeDeletion:
+        if (!GetVarint32(&input, &column_family)) {
+          return Status::Corruption("bad WriteBatch DeleteRange");
+        }
+      // intentional fallthrough
+      case kTypeRangeDeletion:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          s = handler->DeleteRangeCF(column_family, key, value);
+          found++;
+        } else {
+          return Status::Corruption("bad WriteBatch DeleteRange");
+        }
+        break;
       case kTypeColumnFamilyMerge:
         if (!GetVarint32(&input, &column_family)) {
           return Status::Corruption("bad WriteBatch Merge");
@@ -236,6 +258,26 @@ void WriteBatch::Delete(ColumnFamilyHandle* column_family, const Slice& key) {
   WriteBatchInternal::Delete(this, GetColumnFamilyID(column_family), key);
 }
 
+void WriteBatchInternal::DeleteRange(WriteBatch* b, uint32_t column_family_id,
+                                     const Slice& begin_key,
+                                     const Slice& end_key) {
+  WriteBatchInternal::SetCount(b, WriteBatchInternal::Count(b) + 1);
+  if (column_family_id == 0) {
+    b->rep_.push_back(static_cast<char>(kTypeRangeDeletion));
+  } else {
+    b->rep_.push_back(static_cast<char>(kTypeColumnFamilyRangeDeletion));
+    PutVarint32(&b->rep_, column_family_id);
+  }
+  PutLengthPrefixedSlice(&b->rep_, begin_key);
+  PutLengthPrefixedSlice(&b->rep_, end_key);
+}
+
+void WriteBatch::DeleteRange(ColumnFamilyHandle* column_family,
+                             const Slice& begin_key, const Slice& end_key) {
+  WriteBatchInternal::DeleteRange(this, GetColumnFamilyID(column_family),
+                                  begin_key, end_key);
+}
+
 void WriteBatchInternal::Merge(WriteBatch* b, uint32_t column_family_id,
                                const Slice& key, const Slice& value) {
   WriteBatchInternal::SetCount(b, WriteBatchInternal::Count(b) + 1);
@@ -463,6 +505,19 @@ class MemTableInserter : public WriteBatch::Handler {
     sequence_++;
     return Status::OK();
   }
+
+  virtual Status DeleteRangeCF(uint32_t column_family_id,
+                               const Slice& begin_key, const Slice& end_key) {
+    Status seek_status;
+    if (!SeekToColumnFamily(column_family_id, &seek_status)) {
+      ++sequence_;
+      return seek_status;
+    }
+    MemTable* mem = cf_mems_->GetMemTable();
+    mem->AddRangeTombstone(sequence_, begin_key, end_key);
+    sequence_++;
+    return Status::OK();
+  }
 };
 }  // namespace
 
@@ -475,6 +530,41 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b,
   return b->Iterate(&inserter);
 }
 
+namespace {
+class RangeDeletionColumnFamilyCollector : public WriteBatch::Handler {
+ public:
+  explicit RangeDeletionColumnFamilyCollector(
+      std::vector<uint32_t>* column_family_ids)
+      : column_family_ids_(column_family_ids) {}
+
+  virtual Status PutCF(uint32_t column_family_id, const Slice& key,
+                       const Slice& value) {
+    return Status::OK();
+  }
+  virtual Status MergeCF(uint32_t column_family_id, const Slice& key,
+                         const Slice& value) {
+    return Status::OK();
+  }
+  virtual Status DeleteCF(uint32_t column_family_id, const Slice& key) {
+    return Status::OK();
+  }
+  virtual Status DeleteRangeCF(uint32_t column_family_id,
+                               const Slice& begin_key, const Slice& end_key) {
+    column_family_ids_->push_back(column_family_id);
+    return Status::OK();
+  }
+
+ private:
+  std::vector<uint32_t>* column_family_ids_;
+};
+}  // namespace
+
+Status WriteBatchInternal::GetRangeDeletionColumnFamilies(
+    const WriteBatch* b, std::vector<uint32_t>* column_family_ids) {
+  RangeDeletionColumnFamilyCollector collector(column_family_ids);
+  return b->Iterate(&collector);
+}
+
 void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
   assert(contents.size() >= kHeader);
   b->rep_.assign(contents.data(), contents.size());
@@ -8,6 +8,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #pragma once
+#include <vector>
 #include "rocksdb/types.h"
 #include "rocksdb/write_batch.h"
 #include "rocksdb/db.h"
@@ -74,6 +75,9 @@ class WriteBatchInternal {
   static void Delete(WriteBatch* batch, uint32_t column_family_id,
                      const Slice& key);
 
+  static void DeleteRange(WriteBatch* batch, uint32_t column_family_id,
+                          const Slice& begin_key, const Slice& end_key);
+
   static void Merge(WriteBatch* batch, uint32_t column_family_id,
                     const Slice& key, const Slice& value);
 
@@ -118,6 +122,11 @@ class WriteBatchInternal {
                            const bool dont_filter_deletes = true);
 
   static void Append(WriteBatch* dst, const WriteBatch* src);
+
+  // Appends the column family id of every range deletion in batch to
+  // *column_family_ids.
+  static Status GetRangeDeletionColumnFamilies(
+      const WriteBatch* batch, std::vector<uint32_t>* column_family_ids);
 };
 
 }  // namespace rocksdb
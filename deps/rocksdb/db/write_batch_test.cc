@@ -67,6 +67,17 @@ static std::string PrintContents(WriteBatch* b) {
     state.append(NumberToString(ikey.sequence));
   }
   delete iter;
+  std::vector<RangeTombstone> tombstones;
+  mem->AddRangeTombstonesTo(&tombstones);
+  for (const auto& t : tombstones) {
+    state.append("DeleteRange(");
+    state.append(t.start_key);
+    state.append(", ");
+    state.append(t.end_key);
+    state.append(")@");
+    state.append(NumberToString(t.seq));
+    count++;
+  }
   if (!s.ok()) {
     state.append(s.ToString());
   } else if (count != WriteBatchInternal::Count(b)) {
@@ -100,6 +111,20 @@ TEST(WriteBatchTest, Multiple) {
   ASSERT_EQ(3, batch.Count());
 }
 
+TEST(WriteBatchTest, DeleteRange) {
+  WriteBatch batch;
+  batch.Put(Slice("foo"), Slice("bar"));
+  batch.DeleteRange(Slice("baz"), Slice("foo"));
+  batch.Put(Slice("baz"), Slice("boo"));
+  WriteBatchInternal::SetSequence(&batch, 100);
+  ASSERT_EQ(100U, WriteBatchInternal::Sequence(&batch));
+  ASSERT_EQ(3, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ("Put(baz, boo)@102"
+            "Put(foo, bar)@100"
+            "DeleteRange(baz, foo)@101",
+            PrintContents(&batch));
+}
+
 TEST(WriteBatchTest, Corruption) {
   WriteBatch batch;
   batch.Put(Slice("foo"), Slice("bar"));
@@ -178,6 +203,17 @@ namespace {
       }
       return Status::OK();
     }
+    virtual Status DeleteRangeCF(uint32_t column_family_id,
+                                 const Slice& begin_key, const Slice& end_key) {
+      if (column_family_id == 0) {
+        seen += "DeleteRange(" + begin_key.ToString() + ", " +
+                end_key.ToString() + ")";
+      } else {
+        seen += "DeleteRangeCF(" + std::to_string(column_family_id) + ", " +
+                begin_key.ToString() + ", " + end_key.ToString() + ")";
+      }
+      return Status::OK();
+    }
   };
 }
 
@@ -302,6 +338,8 @@ TEST(WriteBatchTest, ColumnFamiliesBatchTest) {
   batch.Merge(&three, Slice("threethree"), Slice("3three"));
   batch.Put(&zero, Slice("foo"), Slice("bar"));
   batch.Merge(Slice("omom"), Slice("nom"));
+  batch.DeleteRange(&two, Slice("twoa"), Slice("twoz"));
+  batch.DeleteRange(Slice("a"), Slice("z"));
 
   TestHandler handler;
   batch.Iterate(&handler);
@@ -312,7 +350,9 @@ TEST(WriteBatchTest, ColumnFamiliesBatchTest) {
       "DeleteCF(8, eightfoo)"
       "MergeCF(3, threethree, 3three)"
       "Put(foo, bar)"
-      "Merge(omom, nom)",
+      "Merge(omom, nom)"
+      "DeleteRangeCF(2, twoa, twoz)"
+      "DeleteRange(a, z)",
       handler.seen);
 }
 
@@ -391,7 +391,8 @@ enum {
   rocksdb_zlib_compression = 2,
   rocksdb_bz2_compression = 3,
   rocksdb_lz4_compression = 4,
-  rocksdb_lz4hc_compression = 5
+  rocksdb_lz4hc_compression = 5,
+  rocksdb_zstd_compression = 6
 };
 extern void rocksdb_options_set_compression(rocksdb_options_t*, int);
 
@@ -180,6 +180,21 @@ class DB {
     return Delete(options, DefaultColumnFamily(), key);
   }
 
+  // Remove the database entries (if any) for all keys in the range
+  // ["begin_key", "end_key"), as ordered by the column family's comparator.
+  // Returns OK on success, and a non-OK status on error.  It is not an error
+  // if no key in the range exists in the database.  The range is recorded
+  // as a single tombstone, so the cost does not depend on the number of keys
+  // it covers; the covered keys are dropped by later compactions.
+  // Note: consider setting options.sync = true.
+  virtual Status DeleteRange(const WriteOptions& options,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key, const Slice& end_key) = 0;
+  virtual Status DeleteRange(const WriteOptions& options,
+                             const Slice& begin_key, const Slice& end_key) {
+    return DeleteRange(options, DefaultColumnFamily(), begin_key, end_key);
+  }
+
   // Merge the database entry for "key" with "value".  Returns OK on success,
   // and a non-OK status on error. The semantics of this operation is
   // determined by the user provided merge_operator when opening DB.
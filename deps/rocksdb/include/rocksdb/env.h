@@ -58,6 +58,14 @@ struct EnvOptions {
    // If true, then use mmap to write data
   bool use_mmap_writes = true;
 
+  // If true, then open random access files with O_DIRECT, so that reads
+  // bypass the OS page cache
+  bool use_direct_reads = false;
+
+  // If true, then open writable files with O_DIRECT, so that writes
+  // bypass the OS page cache
+  bool use_direct_writes = false;
+
   // If true, set the FD_CLOEXEC on open fd.
   bool set_fd_cloexec = true;
 
@@ -268,11 +276,13 @@ class Env {
 
   // OptimizeForLogWrite will create a new EnvOptions object that is a copy of
   // the EnvOptions in the parameters, but is optimized for writing log files.
-  // Default implementation returns the copy of the same object.
+  // Default implementation returns the copy of the same object with direct
+  // writes turned off.
   virtual EnvOptions OptimizeForLogWrite(const EnvOptions& env_options) const;
   // OptimizeForManifestWrite will create a new EnvOptions object that is a copy
   // of the EnvOptions in the parameters, but is optimized for writing manifest
-  // files. Default implementation returns the copy of the same object.
+  // files. Default implementation returns the copy of the same object with
+  // direct writes turned off.
   virtual EnvOptions OptimizeForManifestWrite(const EnvOptions& env_options)
       const;
 
@@ -315,6 +325,18 @@ class SequentialFile {
   }
 };
 
+// One of the reads of a RandomAccessFile::MultiRead() call.
+struct ReadRequest {
+  // Input: read up to "len" bytes starting at "offset" into "scratch"
+  uint64_t offset;
+  size_t len;
+  char* scratch;
+
+  // Output: the data and status, as Read() would have returned them
+  Slice result;
+  Status status;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class RandomAccessFile {
  public:
@@ -353,11 +375,40 @@ class RandomAccessFile {
               // compatibility.
   };
 
+  // Return true if Read() never writes to "scratch" but sets "*result" to
+  // data that stays valid while the file is open, e.g. in a memory mapping
+  // of the file. Read() then accepts a nullptr "scratch".
+  virtual bool ReadsInPlace() const { return false; }
+
 
   enum AccessPattern { NORMAL, RANDOM, SEQUENTIAL, WILLNEED, DONTNEED };
 
   virtual void Hint(AccessPattern pattern) {}
 
+  // Tell the file that "n" bytes starting at "offset" will be read soon, so
+  // that it can start fetching them in the background. Used to have several
+  // reads in flight at once. Returns immediately; the data is read later
+  // with Read() as usual. If the system does not support it, this is a noop.
+  // Returns NotSupported if the file has no cache that prefetched data could
+  // go to, e.g. with direct I/O; callers may then read ahead into a buffer
+  // of their own.
+  virtual Status Prefetch(uint64_t offset, size_t n) {
+    return Status::OK();
+  }
+
+  // Perform the reads described by "reqs[0..num_reqs-1]" and store the
+  // outcome of each in its "result" and "status". Unlike calling Read()
+  // once per request, an implementation may keep all the reads in flight
+  // at the same time. The default implementation calls Read() in turn.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void MultiRead(ReadRequest* reqs, size_t num_reqs) {
+    for (size_t i = 0; i < num_reqs; ++i) {
+      reqs[i].status = Read(reqs[i].offset, reqs[i].len, &reqs[i].result,
+                            reqs[i].scratch);
+    }
+  }
+
   // Remove any kind of caching of data from the offset to offset+length
   // of this file. If the length is 0, then it refers to the end of file.
   // If the system is not caching the file contents, then this is a noop.
@@ -426,6 +477,23 @@ class WritableFile {
     return Status::NotSupported("InvalidateCache not supported.");
   }
 
+  /*
+   * Pre-allocate space for a file.
+   */
+  virtual Status Allocate(off_t offset, off_t len) {
+    return Status::OK();
+  }
+
+  // Sync a file range with disk.
+  // offset is the starting byte of the file range to be synchronized.
+  // nbytes specifies the length of the range to be synchronized.
+  // This asks the OS to initiate flushing the cached data to disk,
+  // without waiting for completion.
+  // Default implementation does nothing.
+  virtual Status RangeSync(off_t offset, off_t nbytes) {
+    return Status::OK();
+  }
+
  protected:
   // PrepareWrite performs any necessary preparation for a write
   // before the write actually occurs.  This allows for pre-allocation
@@ -451,23 +519,6 @@ class WritableFile {
     }
   }
 
-  /*
-   * Pre-allocate space for a file.
-   */
-  virtual Status Allocate(off_t offset, off_t len) {
-    return Status::OK();
-  }
-
-  // Sync a file range with disk.
-  // offset is the starting byte of the file range to be synchronized.
-  // nbytes specifies the length of the range to be synchronized.
-  // This asks the OS to initiate flushing the cached data to disk,
-  // without waiting for completion.
-  // Default implementation does nothing.
-  virtual Status RangeSync(off_t offset, off_t nbytes) {
-    return Status::OK();
-  }
-
  private:
   size_t last_preallocated_block_;
   size_t preallocation_block_size_;
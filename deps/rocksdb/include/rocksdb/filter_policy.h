@@ -69,6 +69,22 @@ class FilterPolicy {
 // trailing spaces in keys.
 extern const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
 
+// Return a new filter policy that uses a cache-line-blocked bloom filter
+// with approximately the specified number of bits per key. All probes for
+// a key are confined to a single 64-byte block of the filter, so a lookup
+// touches one cache line instead of one per probe. The price is a false
+// positive rate that can be slightly higher than NewBloomFilterPolicy()'s
+// for the same number of bits per key.
+//
+// Filters created by this policy are not compatible with the ones created
+// by NewBloomFilterPolicy(); switching between the two on an existing
+// database simply makes the old filters unused until the files are
+// rewritten by compaction.
+//
+// The same restrictions on custom comparators as NewBloomFilterPolicy()
+// apply.
+extern const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key);
+
 }
 
 #endif  // STORAGE_ROCKSDB_INCLUDE_FILTER_POLICY_H_
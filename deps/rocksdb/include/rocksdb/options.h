@@ -30,6 +30,8 @@ enum InfoLogLevel : unsigned char;
 class FilterPolicy;
 class Logger;
 class MergeOperator;
+class PersistentCache;
+class RateLimiter;
 class Snapshot;
 class TableFactory;
 class MemTableRepFactory;
@@ -49,7 +51,8 @@ enum CompressionType : char {
   // NOTE: do not change the values of existing entries, as these are
   // part of the persistent format on disk.
   kNoCompression = 0x0, kSnappyCompression = 0x1, kZlibCompression = 0x2,
-  kBZip2Compression = 0x3, kLZ4Compression = 0x4, kLZ4HCCompression = 0x5
+  kBZip2Compression = 0x3, kLZ4Compression = 0x4, kLZ4HCCompression = 0x5,
+  kZSTDCompression = 0x6
 };
 
 enum CompactionStyle : char {
@@ -57,14 +60,61 @@ enum CompactionStyle : char {
   kCompactionStyleUniversal = 0x1  // Universal compaction style
 };
 
+// In level style compaction, the order in which the files of a level are
+// picked for compaction.
+enum CompactionPri : char {
+  // Larger files first.
+  kByLargestSize = 0x0,
+  // Files whose oldest data is the oldest first. Suits workloads that
+  // update a hot key range, because the cold ranges are pushed down first.
+  kOldestSmallestSeqFirst = 0x1,
+  // Files whose overlapping bytes in the next level, relative to their own
+  // size, are the smallest first. This minimizes write amplification for
+  // random key workloads.
+  kMinOverlappingRatio = 0x2,
+};
+
 // Compression options for different compression algorithms like Zlib
 struct CompressionOptions {
   int window_bits;
   int level;
   int strategy;
-  CompressionOptions() : window_bits(-14), level(-1), strategy(0) {}
+  // Number of threads that compress the data blocks of one block-based
+  // table file. With more than one, the blocks are compressed in the
+  // background while the caller keeps adding keys, and are written to the
+  // file in order as they complete. The threads come from one pool shared
+  // by all table files being written, which has as many threads as the
+  // largest value of this option in use. Not used with the hash index.
+  // Default: 1 (compress on the calling thread)
+  int parallel_threads;
+  // Maximum size of a dictionary that primes the compression of every data
+  // block of a block-based table file, so that small blocks compress about
+  // as well as the whole file would. The builder holds the uncompressed data
+  // blocks back until it has 100 times this many bytes of them or the file
+  // ends, samples the dictionary from them and stores it in a meta block.
+  // The blocks after those are compressed with the dictionary but not
+  // sampled. Held back blocks count at their uncompressed size towards the
+  // file size at which flush and compaction cut their output files, so with
+  // a target_file_size_base below 100 * max_dict_bytes the files come out
+  // smaller than the target by about the compression ratio.
+  // Only used with kZlibCompression and kZSTDCompression. zlib only uses
+  // 2^|window_bits| bytes of a dictionary (16KB with the default
+  // window_bits), so its dictionaries are capped to that size. Not used
+  // with the hash index.
+  // Default: 0 (no dictionary)
+  int max_dict_bytes;
+  CompressionOptions()
+      : window_bits(-14),
+        level(-1),
+        strategy(0),
+        parallel_threads(1),
+        max_dict_bytes(0) {}
   CompressionOptions(int wbits, int _lev, int _strategy)
-      : window_bits(wbits), level(_lev), strategy(_strategy) {}
+      : window_bits(wbits),
+        level(_lev),
+        strategy(_strategy),
+        parallel_threads(1),
+        max_dict_bytes(0) {}
 };
 
 enum UpdateStatus {    // Return status For inplace update callback
@@ -136,7 +186,8 @@ struct ColumnFamilyOptions {
   //
   // If multithreaded compaction is being used, the supplied CompactionFilter
   // instance may be used from different threads concurrently and so should be
-  // thread-safe.
+  // thread-safe. A compaction is not split into sub-compactions (see
+  // max_subcompactions and parallel_manual_compaction) when it is set.
   //
   // Default: nullptr
   const CompactionFilter* compaction_filter;
@@ -201,6 +252,13 @@ struct ColumnFamilyOptions {
   // Default: nullptr
   shared_ptr<Cache> block_cache_compressed;
 
+  // If non-NULL, data blocks that miss the block caches in memory are
+  // looked up in this cache on a faster storage tier, e.g. a local SSD, and
+  // the data blocks read from table files are stored in it. Only used by
+  // block-based tables. See NewPersistentCache().
+  // Default: nullptr
+  shared_ptr<PersistentCache> persistent_cache;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -246,6 +304,15 @@ struct ColumnFamilyOptions {
   // java/C api hard to construct.
   std::vector<CompressionType> compression_per_level;
 
+  // Different levels can use different compression levels as well, e.g. a
+  // fast ZSTD level for the upper levels and a strong one for the last. If
+  // not empty, compaction outputs to level i use compression level
+  // compression_level_per_level[i] instead of compression_opts.level, and
+  // levels past its end use its last entry. Flushes keep using
+  // compression_opts.level, as they keep using 'compression'.
+  // Default: empty
+  std::vector<int> compression_level_per_level;
+
   // different options for compression algorithms
   CompressionOptions compression_opts;
 
@@ -332,6 +399,30 @@ struct ColumnFamilyOptions {
   // by default 'max_bytes_for_level_base' is 10.
   int max_bytes_for_level_multiplier;
 
+  // If true, RocksDB picks the target size of each level dynamically, working
+  // backward from the actual size of the last level instead of forward from
+  // max_bytes_for_level_base. The last level's target is its current size,
+  // and each level above it targets 1/max_bytes_for_level_multiplier of the
+  // level below. Levels whose target would fall below
+  // max_bytes_for_level_base / max_bytes_for_level_multiplier are left empty,
+  // and level-0 is compacted straight into the first level below them (the
+  // "base level"). This keeps space amplification close to
+  // 1 + 1 / (max_bytes_for_level_multiplier - 1) however large the DB is.
+  //
+  // For example, with max_bytes_for_level_base = 10MB, a multiplier of 10,
+  // 7 levels and 50GB in the last level, the level sizes are:
+  //   L1: empty, L2: 5MB, L3: 50MB, L4: 500MB, L5: 5GB, L6: 50GB
+  // L1 would hold 0.5MB, below 10MB / 10, so L2 is the base level and
+  // level-0 files are compacted into it. No target is ever smaller than
+  // max_bytes_for_level_base, so L2 is compacted down once it holds 10MB.
+  //
+  // max_bytes_for_level_multiplier_additional is ignored in this mode, and
+  // memtable flushes always go to level-0 (max_mem_compaction_level is
+  // ignored). Only takes effect with kCompactionStyleLevel.
+  //
+  // Default: false
+  bool level_compaction_dynamic_level_bytes;
+
   // Different max-size multipliers for different levels.
   // These are multiplied by max_bytes_for_level_multiplier to arrive
   // at the max-size of each level.
@@ -421,6 +512,34 @@ struct ColumnFamilyOptions {
   // The compaction style. Default: kCompactionStyleLevel
   CompactionStyle compaction_style;
 
+  // With kCompactionStyleLevel, the order in which the files of a level are
+  // picked for compaction. See CompactionPri.
+  // Default: kByLargestSize
+  CompactionPri compaction_pri;
+
+  // If both are non-zero, a table file is marked for compaction when any
+  // deletion_compaction_window consecutive entries in it contain at least
+  // deletion_compaction_trigger deletions. Iterators have to skip every
+  // deletion marker, so such files make seeks slow. With
+  // kCompactionStyleLevel, marked files are compacted into the next level
+  // whenever no level exceeds its target size.
+  // Default: 0 (disabled)
+  uint32_t deletion_compaction_window;
+  uint32_t deletion_compaction_trigger;
+
+  // With kCompactionStyleLevel, a table file that was written more than
+  // periodic_compaction_seconds ago is compacted once no level exceeds its
+  // target size: into the next level, or in place when the file is in the
+  // last level. This lets compaction filters (e.g. the one of DBWithTTL)
+  // eventually see data that would otherwise never be compacted again. The
+  // age of files is only checked after a flush or compaction and when the DB
+  // is opened.
+  // The age of a file is only recorded in the MANIFEST while this option is
+  // enabled; files written while it was disabled (or by older releases) have
+  // no recorded age and are never picked.
+  // Default: 0 (disabled)
+  uint64_t periodic_compaction_seconds;
+
   // If true, compaction will verify checksum on every read that happens
   // as part of compaction
   // Default: true
@@ -605,6 +724,14 @@ struct DBOptions {
   // Default: Env::Default()
   Env* env;
 
+  // Use to control the write rate of flush and compaction. Flush has
+  // higher priority than compaction. Writes to the WAL and the MANIFEST
+  // are not rate limited.
+  // If rate limiting is enabled, bytes_per_sync is set to 1MB when it
+  // is not set already.
+  // Default: nullptr
+  shared_ptr<RateLimiter> rate_limiter;
+
   // Any internal progress/error information generated by the db will
   // be written to info_log if it is non-nullptr, or to a file stored
   // in the same directory as the DB contents if info_log is nullptr.
@@ -621,6 +748,21 @@ struct DBOptions {
   // Default: 5000
   int max_open_files;
 
+  // If true, DB::Open opens the live table files before it returns, so that
+  // the first reads of the files do not pay for reading their footers,
+  // indexes and filters. The files are left in the table cache, and at most
+  // max_open_files - 10 of them are opened, starting from level 0. When
+  // max_open_files is -1, all the files are opened and kept open anyway.
+  // Default: false
+  bool preload_table_files_on_open;
+
+  // Number of threads DB::Open uses to open the table files when
+  // max_open_files is -1 or preload_table_files_on_open is true. The extra
+  // threads are not taken from the background thread pools. The files that
+  // flushes and compactions write later are opened on their own thread.
+  // Default: 1
+  int max_file_opening_threads;
+
   // Once write-ahead logs exceed this size, we will start forcing the flush of
   // column families whose memtables are backed by the oldest live WAL file
   // (i.e. the ones that are causing all the space amplification). If set to 0
@@ -684,6 +826,27 @@ struct DBOptions {
   // Default: 1
   int max_background_compactions;
 
+  // Maximum number of threads a single level-0 compaction is split into.
+  // The key range of the compaction is cut at input file boundaries into
+  // pieces of about the same size; each piece is compacted into its own
+  // output files, and all outputs are installed together. The pieces are
+  // scheduled in the LOW priority thread pool, so they run in parallel as
+  // far as its threads allow; the compaction's own thread compacts the
+  // pieces that no other thread has started. Every
+  // sub-compaction gets its own filter from compaction_filter_factory. Not
+  // used when compaction_filter or a CompactionFilterV2 is configured.
+  // Default: 1 (no sub-compactions)
+  int max_subcompactions;
+
+  // If true, every step of a manual compaction (DB::CompactRange) is split
+  // into up to max_background_compactions key ranges that are compacted in
+  // parallel like sub-compactions, and each step takes up to
+  // max_background_compactions times as much input as it would otherwise.
+  // The levels of the range are still compacted one after the other. Not
+  // used when compaction_filter or a CompactionFilterV2 is configured.
+  // Default: false
+  bool parallel_manual_compaction;
+
   // Maximum number of concurrent background memtable flush jobs, submitted to
   // the HIGH priority thread pool.
   //
@@ -766,6 +929,17 @@ struct DBOptions {
   // Allow the OS to mmap file for writing. Default: false
   bool allow_mmap_writes;
 
+  // Read sst files with O_DIRECT. Table data then is cached only in the
+  // block cache instead of in both the block cache and the OS page cache.
+  // Cannot be combined with allow_mmap_reads. Default: false
+  bool use_direct_reads;
+
+  // Write the sst files produced by flushes and compactions with O_DIRECT,
+  // so that compaction output does not evict the working set from the OS
+  // page cache. Log and manifest files are still written through the page
+  // cache. Cannot be combined with allow_mmap_writes. Default: false
+  bool use_direct_writes;
+
   // Disable child process inherit open files. Default: true
   bool is_fd_close_on_exec;
 
@@ -910,18 +1084,29 @@ struct ReadOptions {
   // Not supported in ROCKSDB_LITE mode!
   bool tailing;
 
+  // Iterators detect when they read the data blocks of a table file in
+  // order and then prefetch the bytes that follow, since the OS readahead
+  // is disabled by advise_random_on_open. If zero, the readahead window
+  // starts small after a couple of sequential block reads and doubles up
+  // to 256KB. If non-zero, iterators prefetch this many bytes ahead from
+  // the first block they read, which suits long scans over cold data.
+  // Default: 0
+  size_t readahead_size;
+
   ReadOptions()
       : verify_checksums(true),
         fill_cache(true),
         snapshot(nullptr),
         read_tier(kReadAllTier),
-        tailing(false) {}
+        tailing(false),
+        readahead_size(0) {}
   ReadOptions(bool cksum, bool cache)
       : verify_checksums(cksum),
         fill_cache(cache),
         snapshot(nullptr),
         read_tier(kReadAllTier),
-        tailing(false) {}
+        tailing(false),
+        readahead_size(0) {}
 };
 
 // Options that control write operations
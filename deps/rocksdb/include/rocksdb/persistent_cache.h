@@ -0,0 +1,56 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include "rocksdb/env.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
+
+namespace rocksdb {
+
+// A cache of table blocks on a storage tier that is larger than memory and
+// faster than the one the DB lives on, e.g. a local SSD in front of a
+// networked block device. Block-based tables consult it when a data block
+// misses the block caches in memory, and store the blocks they read from
+// their files in it, as they are on disk (compressed or not).
+// A PersistentCache may be shared by several DBs.
+class PersistentCache {
+ public:
+  virtual ~PersistentCache() {}
+
+  // Store the "size" bytes at "data" under "key". The cache may drop the
+  // entry, e.g. when it is larger than the cache can hold or the write
+  // fails, and does not replace an entry that already exists.
+  virtual Status Insert(const Slice& key, const char* data, size_t size) = 0;
+
+  // Look up "key". On success, stores a copy of its data in *data and its
+  // size in *size. Returns NotFound if the key is not in the cache, or
+  // Corruption if its data cannot be read back intact.
+  virtual Status Lookup(const Slice& key, std::unique_ptr<char[]>* data,
+                        size_t* size) = 0;
+
+  // Return a new numeric id, to build the keys of files that have no unique
+  // id of their own.
+  virtual uint64_t NewId() = 0;
+
+  // Number of bytes stored in the cache
+  virtual uint64_t GetUsage() const = 0;
+};
+
+// Create a PersistentCache that keeps up to "capacity" bytes in files under
+// the directory "path" of "env". Entries are appended to a log of files of
+// capacity/8 bytes each, indexed in memory, and the oldest file is dropped
+// when the cache is full. The cache starts out empty: cache files left in
+// "path" by an earlier instance are deleted.
+extern Status NewPersistentCache(Env* env, const std::string& path,
+                                 uint64_t capacity,
+                                 std::shared_ptr<PersistentCache>* cache);
+
+}  // namespace rocksdb
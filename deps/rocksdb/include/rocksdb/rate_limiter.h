@@ -0,0 +1,54 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "rocksdb/env.h"
+
+namespace rocksdb {
+
+class Statistics;
+
+// Controls the rate at which flushes and compactions write to their output
+// files. A single RateLimiter may be shared by several DB instances, so
+// that they stay within a common I/O budget.
+class RateLimiter {
+ public:
+  virtual ~RateLimiter() {}
+
+  // Request permission to write "bytes" bytes, blocking until the budget
+  // allows it. Requests of priority Env::HIGH (flushes) are granted before
+  // waiting requests of priority Env::LOW (compactions). If the caller had
+  // to wait, the bytes are added to RATE_LIMITER_THROTTLED_BYTES in
+  // "stats", which may be nullptr.
+  // REQUIRES: bytes <= GetSingleBurstBytes()
+  virtual void Request(int64_t bytes, Env::Priority pri,
+                       Statistics* stats) = 0;
+
+  // Max bytes that can be granted in a single Request()
+  virtual int64_t GetSingleBurstBytes() const = 0;
+
+  // Total bytes granted to requests of priority "pri", or of all priorities
+  // if "pri" is Env::TOTAL
+  virtual int64_t GetTotalBytesThrough(Env::Priority pri = Env::TOTAL) const
+      = 0;
+};
+
+// Create a token-bucket RateLimiter that grants at most
+// "rate_bytes_per_sec" bytes per second.
+// @refill_period_us: the tokens are refilled every refill_period_us
+//    microseconds, and a single request can get at most the tokens of one
+//    period. A shorter period makes writes smoother, a longer one lets
+//    each write be larger.
+extern RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                          int64_t refill_period_us = 100000);
+
+}  // namespace rocksdb
@@ -125,6 +125,14 @@ enum Tickers {
   NUMBER_SUPERVERSION_ACQUIRES,
   NUMBER_SUPERVERSION_RELEASES,
   NUMBER_SUPERVERSION_CLEANUPS,
+  // Bytes of flush and compaction output that had to wait for the
+  // rate limiter
+  RATE_LIMITER_THROTTLED_BYTES,
+  // Keys dropped during compaction because a range tombstone deleted them
+  COMPACTION_KEY_DROP_RANGE_DEL,
+  // Data block lookups in Options::persistent_cache
+  PERSISTENT_CACHE_HIT,
+  PERSISTENT_CACHE_MISS,
   TICKER_ENUM_MAX
 };
 
@@ -183,6 +191,10 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
     {NUMBER_SUPERVERSION_ACQUIRES, "rocksdb.number.superversion_acquires"},
     {NUMBER_SUPERVERSION_RELEASES, "rocksdb.number.superversion_releases"},
     {NUMBER_SUPERVERSION_CLEANUPS, "rocksdb.number.superversion_cleanups"},
+    {RATE_LIMITER_THROTTLED_BYTES, "rocksdb.rate.limiter.throttled.bytes"},
+    {COMPACTION_KEY_DROP_RANGE_DEL, "rocksdb.compaction.key.drop.range_del"},
+    {PERSISTENT_CACHE_HIT, "rocksdb.persistent.cache.hit"},
+    {PERSISTENT_CACHE_MISS, "rocksdb.persistent.cache.miss"},
 };
 
 /**
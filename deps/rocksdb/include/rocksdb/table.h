@@ -70,10 +70,53 @@ struct BlockBasedTableOptions {
     // The hash index, if enabled, will do the hash lookup when
     // `Options.prefix_extractor` is provided.
     kHashSearch,
+
+    // A binary-search-based index whose blocks are a few times smaller:
+    // keys are prefix-compressed within restart intervals of
+    // `index_block_restart_interval` entries, and an entry other than the
+    // first of its interval stores only the size of its data block, as a
+    // delta to the previous size; the offset follows from the previous
+    // block. Lookups scan up to one restart interval of the index after the
+    // binary search. Files written with it cannot be read by older versions
+    // of RocksDB.
+    kDeltaEncodedBinarySearch,
   };
 
   IndexType index_type = kBinarySearch;
 
+  // Number of index entries between restart points of the index blocks of
+  // kDeltaEncodedBinarySearch. The other index types restart at every entry.
+  int index_block_restart_interval = 16;
+
+  // The index that point lookups use inside a data block.
+  enum DataBlockIndexType : char {
+    // Binary search over the restart points of the block.
+    kDataBlockBinarySearch,
+
+    // Each data block also stores a hash map from its user keys to their
+    // restart intervals, so that Get() goes straight to the right interval.
+    // Iterators still use binary search. Blocks with more than 253 restart
+    // intervals are written without the map. Files written with it cannot be
+    // read by older versions of RocksDB.
+    kDataBlockBinaryAndHash,
+  };
+
+  DataBlockIndexType data_block_index_type = kDataBlockBinarySearch;
+
+  // With kDataBlockBinaryAndHash, the number of user keys per bucket of the
+  // hash map. Lower values make fewer hash collisions, each of which makes a
+  // lookup fall back to binary search, at the cost of one byte per bucket.
+  // Values not greater than 0 are replaced by the default.
+  double data_block_hash_table_util_ratio = 0.75;
+
+  // Blocks of files that are read from a memory mapping (allow_mmap_reads)
+  // and not compressed are used in place and are never put in the block
+  // cache. If true, data blocks of such files are not looked up in the block
+  // caches either, which saves a cache lookup per block read. Compressed
+  // blocks are then uncompressed on every read, so this is meant for tables
+  // written without compression.
+  bool bypass_block_cache_for_mmap_reads = false;
+
   // Use the specified checksum type. Newly created table files will be
   // protected with this checksum type. Old table files will still be readable,
   // even though they have different checksum type.
@@ -96,6 +139,11 @@ extern TableFactory* NewBlockBasedTableFactory(
 // work. Look-up will starts with prefix hash lookup for key prefix. Inside the
 // hash bucket found, a binary search is executed for hash conflicts. Finally,
 // a linear search is used.
+// With Options.allow_mmap_reads the rows are read in place from the mapped
+// files; otherwise each lookup and iterator reads them through a small buffer.
+// The index and the bloom filter are stored in the file, so opening it does
+// not read its rows, unless the file was written with another prefix
+// extractor or without the bloom filter that the reader needs.
 // @user_key_len: plain table has optimization for fix-sized keys, which can be
 //                specified via user_key_len.  Alternatively, you can pass
 //                `kPlainTableVariableLength` if your keys have variable
@@ -143,6 +191,57 @@ extern TableFactory* NewTotalOrderPlainTableFactory(
     int bloom_bits_per_key = 0, size_t index_sparseness = 16,
     size_t huge_page_tlb_size = 0);
 
+// Table Properties that are specific to plain tables.
+struct PlainTablePropertyNames {
+  // The name of the prefix extractor that the index stored in the file was
+  // built with, empty if it was built in total order mode.
+  static const std::string kPrefixExtractorName;
+  // The sizes of the hash table and of the sub index of the index, in bytes.
+  static const std::string kHashTableSize;
+  static const std::string kSubIndexSize;
+  // Options::bloom_locality of the bloom filter stored in the file
+  static const std::string kBloomLocality;
+};
+
+// -- Cuckoo Table
+// A table for column families that are only read with point lookups. The
+// file is a cuckoo hash table of fixed size buckets, each holding one key
+// and its value, so a Get() reads one or two cache lines of the mmapped file
+// and no index. Iterators are supported but sort the whole table when they
+// are created. The table requires Options.allow_mmap_reads and the bytewise
+// comparator. A file can only be a cuckoo table if its keys and its values
+// each have a fixed length and it holds at most one entry per user key and
+// no merge operands. Flushes and compactions write every other file as a
+// block-based table with the default BlockBasedTableOptions, which is read
+// at block-based speed. With snapshots, merge operators or values of varying
+// length, many files may end up that way. DeleteRange() is not supported.
+// @hash_table_ratio: the desired utilization of the hash table:
+//                    number of entries / number of buckets. Lower ratios make
+//                    insertion faster and the files larger.
+// @max_search_depth: the number of displacements tried when the buckets of a
+//                    new key are all full, before another hash function is
+//                    added to the table.
+// @cuckoo_block_size: the number of consecutive buckets that are tried for
+//                     each hash function. A block is read in one go, so keep
+//                     it within a cache line or two.
+extern TableFactory* NewCuckooTableFactory(double hash_table_ratio = 0.9,
+                                           uint32_t max_search_depth = 100,
+                                           uint32_t cuckoo_block_size = 5);
+
+// Table Properties that are specific to cuckoo tables.
+struct CuckooTablePropertyNames {
+  // The key stored in empty buckets. It does not appear in the table.
+  static const std::string kEmptyKey;
+  static const std::string kNumHashFunc;
+  // The number of buckets that hash values map to.
+  static const std::string kHashTableSize;
+  static const std::string kValueLength;
+  // If true, every entry has sequence number 0 and type kTypeValue, and the
+  // buckets hold user keys instead of internal keys.
+  static const std::string kIsLastLevel;
+  static const std::string kCuckooBlockSize;
+};
+
 #endif  // ROCKSDB_LITE
 
 // A base class for table factories.
@@ -201,6 +300,11 @@ class TableFactory {
   virtual TableBuilder* NewTableBuilder(
       const Options& options, const InternalKeyComparator& internal_comparator,
       WritableFile* file, CompressionType compression_type) const = 0;
+
+  // Returns true if the tables of this type can store range tombstones.
+  // DB::DeleteRange() fails on column families whose table factory returns
+  // false.
+  virtual bool SupportsRangeTombstones() const { return false; }
 };
 
 }  // namespace rocksdb
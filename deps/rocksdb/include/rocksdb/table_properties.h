@@ -47,6 +47,8 @@ struct TableProperties {
   uint64_t format_version = 0;
   // If 0, key is variable length. Otherwise number of bytes for each key.
   uint64_t fixed_key_len = 0;
+  // The time the table was created, in seconds since the epoch. 0 if unknown.
+  uint64_t creation_time = 0;
 
   // The name of the filter policy used in this table.
   // If no filter policy is used, `filter_policy_name` will be an empty string.
@@ -72,6 +74,7 @@ struct TablePropertiesNames {
   static const std::string kNumEntries;
   static const std::string kFormatVersion;
   static const std::string kFixedKeyLen;
+  static const std::string kCreationTime;
   static const std::string kFilterPolicy;
 };
 
@@ -104,6 +107,11 @@ class TablePropertiesCollector {
 
   // The name of the properties collector can be used for debugging purpose.
   virtual const char* Name() const = 0;
+
+  // Return true if the table being built should be compacted as soon as
+  // possible, e.g. because it holds too many deletions. Called after
+  // Finish().
+  virtual bool NeedCompact() const { return false; }
 };
 
 // Constructs TablePropertiesCollector. Internals create a new
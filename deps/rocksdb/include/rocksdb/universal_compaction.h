@@ -67,6 +67,16 @@ class CompactionOptionsUniversal {
   // Default: kCompactionStopStyleTotalSize
   CompactionStopStyle stop_style;
 
+  // If true, the output of a compaction is cut into files of
+  // target_file_size_base bytes, and consecutive files whose key ranges do
+  // not overlap count as a single sorted run, so appending data with
+  // increasing keys does not add sorted runs. When runs are compacted, their
+  // files that overlap no other picked file are left in place instead of
+  // being rewritten. The sorted runs, not the files, are counted against
+  // level0_file_num_compaction_trigger and the write stall triggers.
+  // Default: false
+  bool partitioned_runs;
+
   // Default set of parameters
   CompactionOptionsUniversal() :
     size_ratio(1),
@@ -74,7 +84,8 @@ class CompactionOptionsUniversal {
     max_merge_width(UINT_MAX),
     max_size_amplification_percent(200),
     compression_size_percent(-1),
-    stop_style(kCompactionStopStyleTotalSize) {
+    stop_style(kCompactionStopStyleTotalSize),
+    partitioned_runs(false) {
   }
 };
 
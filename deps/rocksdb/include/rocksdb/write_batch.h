@@ -67,6 +67,15 @@ class WriteBatch {
   void Delete(ColumnFamilyHandle* column_family, const Slice& key);
   void Delete(const Slice& key) { Delete(nullptr, key); }
 
+  // Erase every mapping whose key lies in ["begin_key", "end_key") as seen by
+  // the database's comparator.  Keys written after this batch are not
+  // affected.
+  void DeleteRange(ColumnFamilyHandle* column_family, const Slice& begin_key,
+                   const Slice& end_key);
+  void DeleteRange(const Slice& begin_key, const Slice& end_key) {
+    DeleteRange(nullptr, begin_key, end_key);
+  }
+
   // Append a blob of arbitrary size to the records in this batch. The blob will
   // be stored in the transaction log but not in any other file. In particular,
   // it will not be persisted to the SST files. When iterating over this
@@ -126,6 +135,18 @@ class WriteBatch {
           "non-default column family and DeleteCF not implemented");
     }
     virtual void Delete(const Slice& key);
+    // The default implementation of DeleteRange simply throws a runtime
+    // exception.
+    virtual Status DeleteRangeCF(uint32_t column_family_id,
+                                 const Slice& begin_key, const Slice& end_key) {
+      if (column_family_id == 0) {
+        DeleteRange(begin_key, end_key);
+        return Status::OK();
+      }
+      return Status::InvalidArgument(
+          "non-default column family and DeleteRangeCF not implemented");
+    }
+    virtual void DeleteRange(const Slice& begin_key, const Slice& end_key);
     // Continue is called by WriteBatch::Iterate. If it returns false,
     // iteration is halted. Otherwise, it continues iterating. The default
     // implementation always returns true.
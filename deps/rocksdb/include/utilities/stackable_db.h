@@ -69,6 +69,14 @@ class StackableDB : public DB {
     return db_->Delete(wopts, column_family, key);
   }
 
+  using DB::DeleteRange;
+  virtual Status DeleteRange(const WriteOptions& wopts,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key,
+                             const Slice& end_key) override {
+    return db_->DeleteRange(wopts, column_family, begin_key, end_key);
+  }
+
   using DB::Merge;
   virtual Status Merge(const WriteOptions& options,
                        ColumnFamilyHandle* column_family, const Slice& key,
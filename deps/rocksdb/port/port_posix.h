@@ -51,10 +51,15 @@
 #include <lz4hc.h>
 #endif
 
+#if defined(ZSTD)
+#include <zstd.h>
+#endif
+
 #include <stdint.h>
 #include <string>
 #include <string.h>
 #include "rocksdb/options.h"
+#include "rocksdb/slice.h"
 #include "port/atomic_pointer.h"
 
 #ifndef PLATFORM_IS_LITTLE_ENDIAN
@@ -178,8 +183,11 @@ inline bool Snappy_Uncompress(const char* input, size_t length,
 #endif
 }
 
+// If compression_dict is not empty, it is the preset dictionary of the
+// stream, and Zlib_Uncompress() must be given the same one.
 inline bool Zlib_Compress(const CompressionOptions& opts, const char* input,
-                          size_t length, ::std::string* output) {
+                          size_t length, ::std::string* output,
+                          const Slice& compression_dict = Slice()) {
 #ifdef ZLIB
   // The memLevel parameter specifies how much memory should be allocated for
   // the internal compression state.
@@ -195,6 +203,16 @@ inline bool Zlib_Compress(const CompressionOptions& opts, const char* input,
     return false;
   }
 
+  if (compression_dict.size()) {
+    // Initialize the compression library's dictionary
+    st = deflateSetDictionary(&_stream, (Bytef *)compression_dict.data(),
+                              compression_dict.size());
+    if (st != Z_OK) {
+      deflateEnd(&_stream);
+      return false;
+    }
+  }
+
   // Resize output to be the plain data length.
   // This may not be big enough if the compression actually expands data.
   output->resize(length);
@@ -241,7 +259,8 @@ inline bool Zlib_Compress(const CompressionOptions& opts, const char* input,
 }
 
 inline char* Zlib_Uncompress(const char* input_data, size_t input_length,
-    int* decompress_size, int windowBits = -14) {
+    int* decompress_size, const Slice& compression_dict = Slice(),
+    int windowBits = -14) {
 #ifdef ZLIB
   z_stream _stream;
   memset(&_stream, 0, sizeof(z_stream));
@@ -255,6 +274,17 @@ inline char* Zlib_Uncompress(const char* input_data, size_t input_length,
     return nullptr;
   }
 
+  // A raw stream takes its dictionary up front. Streams with a zlib header
+  // ask for it with Z_NEED_DICT below.
+  if (compression_dict.size() && windowBits < 0) {
+    st = inflateSetDictionary(&_stream, (Bytef *)compression_dict.data(),
+                              compression_dict.size());
+    if (st != Z_OK) {
+      inflateEnd(&_stream);
+      return nullptr;
+    }
+  }
+
   _stream.next_in = (Bytef *)input_data;
   _stream.avail_in = input_length;
 
@@ -273,6 +303,13 @@ inline char* Zlib_Uncompress(const char* input_data, size_t input_length,
   //while(_stream.next_in != nullptr && _stream.avail_in != 0) {
   while (!done) {
     int st = inflate(&_stream, Z_SYNC_FLUSH);
+    if (st == Z_NEED_DICT && compression_dict.size()) {
+      st = inflateSetDictionary(&_stream, (Bytef *)compression_dict.data(),
+                                compression_dict.size());
+      if (st == Z_OK) {
+        continue;
+      }
+    }
     switch (st) {
       case Z_STREAM_END:
         done = true;
@@ -480,6 +517,178 @@ inline bool LZ4HC_Compress(const CompressionOptions &opts, const char* input,
   return false;
 }
 
+// A compression dictionary ZSTD has digested once, so compressing each
+// block with it does not digest the raw dictionary again. Holds nothing
+// without ZSTD.
+class ZSTDCompressionDict {
+ public:
+  ZSTDCompressionDict() : dict_(nullptr) {}
+  ~ZSTDCompressionDict() { Reset(CompressionOptions(), Slice()); }
+
+  // Digest "dict" for compressing at opts.level. An empty dict clears it.
+  void Reset(const CompressionOptions& opts, const Slice& dict) {
+#ifdef ZSTD
+    if (dict_ != nullptr) {
+      ZSTD_freeCDict(static_cast<ZSTD_CDict*>(dict_));
+      dict_ = nullptr;
+    }
+    if (dict.size() > 0) {
+      int level = opts.level == -1 ? 3 : opts.level;
+      dict_ = ZSTD_createCDict(dict.data(), dict.size(), level);
+    }
+#endif
+  }
+
+  // nullptr if no dictionary is held
+  void* get() const { return dict_; }
+
+ private:
+  void* dict_;
+
+  // No copying allowed
+  ZSTDCompressionDict(const ZSTDCompressionDict&);
+  void operator=(const ZSTDCompressionDict&);
+};
+
+// The uncompression counterpart of ZSTDCompressionDict. The dictionary is
+// only digested when the first block compressed with ZSTD asks for it: a
+// table does not record which compression its dictionary is for, and
+// digesting it for, say, a zlib table would only cost time and memory.
+class ZSTDUncompressionDict {
+ public:
+  ZSTDUncompressionDict() : dict_(nullptr) {}
+  ~ZSTDUncompressionDict() { Reset(Slice()); }
+
+  // Digest "dict" on first use; it must stay valid until the next Reset().
+  // An empty dict clears it. Not thread-safe.
+  void Reset(const Slice& dict) {
+#ifdef ZSTD
+    void* digested = dict_.NoBarrier_Load();
+    if (digested != nullptr) {
+      ZSTD_freeDDict(static_cast<ZSTD_DDict*>(digested));
+      dict_.NoBarrier_Store(nullptr);
+    }
+#endif
+    raw_dict_ = dict;
+  }
+
+  // nullptr if no dictionary is held. Thread-safe.
+  void* get() const {
+#ifdef ZSTD
+    void* digested = dict_.Acquire_Load();
+    if (digested == nullptr && raw_dict_.size() > 0) {
+      mutex_.Lock();
+      digested = dict_.NoBarrier_Load();
+      if (digested == nullptr) {
+        digested = ZSTD_createDDict(raw_dict_.data(), raw_dict_.size());
+        dict_.Release_Store(digested);
+      }
+      mutex_.Unlock();
+    }
+    return digested;
+#else
+    return nullptr;
+#endif
+  }
+
+ private:
+  Slice raw_dict_;
+  mutable AtomicPointer dict_;
+  mutable Mutex mutex_;
+
+  // No copying allowed
+  ZSTDUncompressionDict(const ZSTDUncompressionDict&);
+  void operator=(const ZSTDUncompressionDict&);
+};
+
+// opts.level -1, the default, selects level 3, the default of ZSTD. As with
+// zlib, ZSTD_Uncompress() must be given the same compression_dict. If
+// digested_dict holds compression_dict digested, it is used instead, which
+// saves digesting the dictionary for every block.
+inline bool ZSTD_Compress(const CompressionOptions& opts, const char* input,
+                          size_t length, ::std::string* output,
+                          const Slice& compression_dict = Slice(),
+                          const ZSTDCompressionDict* digested_dict = nullptr) {
+#ifdef ZSTD
+  size_t compressBound = ZSTD_compressBound(length);
+  output->resize(8 + compressBound);
+  char *p = const_cast<char *>(output->c_str());
+  memcpy(p, &length, sizeof(length));
+  int level = opts.level == -1 ? 3 : opts.level;
+  size_t outlen;
+  if (compression_dict.size() == 0) {
+    outlen = ZSTD_compress(p + 8, compressBound, input, length, level);
+  } else {
+    ZSTD_CCtx* context = ZSTD_createCCtx();
+    if (context == nullptr) {
+      return false;
+    }
+    if (digested_dict != nullptr && digested_dict->get() != nullptr) {
+      outlen = ZSTD_compress_usingCDict(
+          context, p + 8, compressBound, input, length,
+          static_cast<const ZSTD_CDict*>(digested_dict->get()));
+    } else {
+      outlen = ZSTD_compress_usingDict(context, p + 8, compressBound, input,
+                                       length, compression_dict.data(),
+                                       compression_dict.size(), level);
+    }
+    ZSTD_freeCCtx(context);
+  }
+  if (ZSTD_isError(outlen) || outlen == 0) {
+    return false;
+  }
+  output->resize(8 + outlen);
+  return true;
+#endif
+  return false;
+}
+
+inline char* ZSTD_Uncompress(
+    const char* input_data, size_t input_length, int* decompress_size,
+    const Slice& compression_dict = Slice(),
+    const ZSTDUncompressionDict* digested_dict = nullptr) {
+#ifdef ZSTD
+  if (input_length < 8) {
+    return nullptr;
+  }
+  int output_len;
+  memcpy(&output_len, input_data, sizeof(output_len));
+  if (output_len < 0) {
+    return nullptr;
+  }
+  char *output = new char[output_len];
+  size_t actual_output_length;
+  if (compression_dict.size() == 0) {
+    actual_output_length =
+        ZSTD_decompress(output, output_len, input_data + 8, input_length - 8);
+  } else {
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    if (context == nullptr) {
+      delete[] output;
+      return nullptr;
+    }
+    if (digested_dict != nullptr && digested_dict->get() != nullptr) {
+      actual_output_length = ZSTD_decompress_usingDDict(
+          context, output, output_len, input_data + 8, input_length - 8,
+          static_cast<const ZSTD_DDict*>(digested_dict->get()));
+    } else {
+      actual_output_length = ZSTD_decompress_usingDict(
+          context, output, output_len, input_data + 8, input_length - 8,
+          compression_dict.data(), compression_dict.size());
+    }
+    ZSTD_freeDCtx(context);
+  }
+  if (ZSTD_isError(actual_output_length) ||
+      actual_output_length != static_cast<size_t>(output_len)) {
+    delete[] output;
+    return nullptr;
+  }
+  *decompress_size = output_len;
+  return output;
+#endif
+  return nullptr;
+}
+
 #define CACHE_LINE_SIZE 64U
 
 } // namespace port
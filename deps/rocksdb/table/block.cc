@@ -16,6 +16,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "db/dbformat.h"
 #include "rocksdb/comparator.h"
 #include "table/block_hash_index.h"
 #include "table/format.h"
@@ -26,7 +27,8 @@ namespace rocksdb {
 
 uint32_t Block::NumRestarts() const {
   assert(size_ >= 2*sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t)) &
+         ~kDataBlockHashIndexFlag;
 }
 
 Block::Block(const BlockContents& contents)
@@ -34,9 +36,22 @@ Block::Block(const BlockContents& contents)
       size_(contents.data.size()),
       owned_(contents.heap_allocated),
       cachable_(contents.cachable),
-      compression_type_(contents.compression_type) {
+      compression_type_(contents.compression_type),
+      has_data_block_hash_index_(false),
+      value_delta_encoded_(false) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
+  } else if (compression_type_ != kNoCompression) {
+    // Compressed blocks are only kept to be uncompressed; their restarts
+    // are not known until then.
+    restart_offset_ = 0;
+  } else if (DecodeFixed32(data_ + size_ - sizeof(uint32_t)) &
+             kDataBlockHashIndexFlag) {
+    has_data_block_hash_index_ = data_block_hash_index_.Initialize(
+        data_, size_, NumRestarts(), &restart_offset_);
+    if (!has_data_block_hash_index_) {
+      size_ = 0;
+    }
   } else {
     restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
     if (restart_offset_ > size_ - sizeof(uint32_t)) {
@@ -83,6 +98,29 @@ static inline const char* DecodeEntry(const char* p, const char* limit,
   return p;
 }
 
+// Helper routine: decode the shared and non_shared key bytes of an entry of
+// a block with delta encoded values, which has no value length. Returns a
+// pointer to the key delta, or nullptr if any errors are detected.
+static inline const char* DecodeKeyEntry(const char* p, const char* limit,
+                                         uint32_t* shared,
+                                         uint32_t* non_shared) {
+  if (limit - p < 2) return nullptr;
+  *shared = reinterpret_cast<const unsigned char*>(p)[0];
+  *non_shared = reinterpret_cast<const unsigned char*>(p)[1];
+  if ((*shared | *non_shared) < 128) {
+    // Fast path: both values are encoded in one byte each
+    p += 2;
+  } else {
+    if ((p = GetVarint32Ptr(p, limit, shared)) == nullptr) return nullptr;
+    if ((p = GetVarint32Ptr(p, limit, non_shared)) == nullptr) return nullptr;
+  }
+
+  if (static_cast<uint32_t>(limit - p) < *non_shared) {
+    return nullptr;
+  }
+  return p;
+}
+
 class Block::Iter : public Iterator {
  private:
   const Comparator* const comparator_;
@@ -97,6 +135,13 @@ class Block::Iter : public Iterator {
   Slice value_;
   Status status_;
   BlockHashIndex* hash_index_;
+  const DataBlockHashIndex* data_block_hash_index_;
+  // Set for index blocks with delta encoded block handles. value_ is then
+  // the encoded entry in the block, and decoded_value_ the full encoding of
+  // decoded_handle_, which value() returns.
+  const bool value_delta_encoded_;
+  BlockHandle decoded_handle_;
+  std::string decoded_value_;
 
   inline int Compare(const Slice& a, const Slice& b) const {
     return comparator_->Compare(a, b);
@@ -124,14 +169,18 @@ class Block::Iter : public Iterator {
 
  public:
   Iter(const Comparator* comparator, const char* data, uint32_t restarts,
-       uint32_t num_restarts, BlockHashIndex* hash_index)
+       uint32_t num_restarts, BlockHashIndex* hash_index,
+       const DataBlockHashIndex* data_block_hash_index,
+       bool value_delta_encoded)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
         restart_index_(num_restarts_),
-        hash_index_(hash_index) {
+        hash_index_(hash_index),
+        data_block_hash_index_(data_block_hash_index),
+        value_delta_encoded_(value_delta_encoded) {
     assert(num_restarts_ > 0);
   }
 
@@ -143,7 +192,7 @@ class Block::Iter : public Iterator {
   }
   virtual Slice value() const {
     assert(Valid());
-    return value_;
+    return value_delta_encoded_ ? Slice(decoded_value_) : value_;
   }
 
   virtual void Next() {
@@ -173,6 +222,9 @@ class Block::Iter : public Iterator {
   }
 
   virtual void Seek(const Slice& target) {
+    if (data_block_hash_index_ != nullptr && DataBlockHashSeek(target)) {
+      return;
+    }
     uint32_t index = 0;
     bool ok = hash_index_ ? HashSeek(target, &index)
                           : BinarySeek(target, 0, num_restarts_ - 1, &index);
@@ -222,15 +274,24 @@ class Block::Iter : public Iterator {
     }
 
     // Decode next entry
-    uint32_t shared, non_shared, value_length;
-    p = DecodeEntry(p, limit, &shared, &non_shared, &value_length);
+    uint32_t shared, non_shared, value_length = 0;
+    if (value_delta_encoded_) {
+      p = DecodeKeyEntry(p, limit, &shared, &non_shared);
+    } else {
+      p = DecodeEntry(p, limit, &shared, &non_shared, &value_length);
+    }
     if (p == nullptr || key_.size() < shared) {
       CorruptionError();
       return false;
     } else {
       key_.resize(shared);
       key_.append(p, non_shared);
-      value_ = Slice(p + non_shared, value_length);
+      if (!value_delta_encoded_) {
+        value_ = Slice(p + non_shared, value_length);
+      } else if (!DecodeValueDelta(p + non_shared, shared)) {
+        CorruptionError();
+        return false;
+      }
       while (restart_index_ + 1 < num_restarts_ &&
              GetRestartPoint(restart_index_ + 1) < current_) {
         ++restart_index_;
@@ -238,6 +299,23 @@ class Block::Iter : public Iterator {
       return true;
     }
   }
+  // Decode the block handle of an entry of a block with delta encoded values
+  // starting at "p". Entries that share a prefix with the previous key store
+  // the handle relative to the previous one, which is in decoded_handle_.
+  bool DecodeValueDelta(const char* p, uint32_t shared) {
+    Slice input(p, data_ + restarts_ - p);
+    Status s = shared == 0
+                   ? decoded_handle_.DecodeFrom(&input)
+                   : decoded_handle_.DecodeDeltaFrom(&input, decoded_handle_);
+    if (!s.ok()) {
+      return false;
+    }
+    value_ = Slice(p, input.data() - p);
+    decoded_value_.clear();
+    decoded_handle_.EncodeTo(&decoded_value_);
+    return true;
+  }
+
   // Binary search in restart array to find the first restart point
   // with a key >= target
   bool BinarySeek(const Slice& target, uint32_t left, uint32_t right,
@@ -249,8 +327,11 @@ class Block::Iter : public Iterator {
       uint32_t region_offset = GetRestartPoint(mid);
       uint32_t shared, non_shared, value_length;
       const char* key_ptr =
-          DecodeEntry(data_ + region_offset, data_ + restarts_, &shared,
-                      &non_shared, &value_length);
+          value_delta_encoded_
+              ? DecodeKeyEntry(data_ + region_offset, data_ + restarts_,
+                               &shared, &non_shared)
+              : DecodeEntry(data_ + region_offset, data_ + restarts_, &shared,
+                            &non_shared, &value_length);
       if (key_ptr == nullptr || (shared != 0)) {
         CorruptionError();
         return false;
@@ -285,9 +366,33 @@ class Block::Iter : public Iterator {
     auto right = restart_index->first_index + restart_index->num_blocks - 1;
     return BinarySeek(target, left, right, index);
   }
+
+  // Seek for a point lookup with the data block hash index. Returns false if
+  // the index cannot tell the restart interval of the target's user key.
+  bool DataBlockHashSeek(const Slice& target) {
+    uint8_t entry = data_block_hash_index_->Lookup(ExtractUserKey(target));
+    if (entry == kCollision) {
+      return false;
+    }
+    if (entry == kNoEntry) {
+      // The user key is not in the block. Scanning the last restart interval
+      // stops at a larger user key, which ends the lookup, or at the end of
+      // the block, which moves it on to the next block as a binary search
+      // would have.
+      entry = num_restarts_ - 1;
+    } else if (entry >= num_restarts_) {
+      CorruptionError();
+      return true;
+    }
+    SeekToRestartPoint(entry);
+    while (ParseNextKey() && Compare(key_, target) < 0) {
+      // Keep skipping
+    }
+    return true;
+  }
 };
 
-Iterator* Block::NewIterator(const Comparator* cmp) {
+Iterator* Block::NewIterator(const Comparator* cmp, bool point_lookup) {
   if (size_ < 2*sizeof(uint32_t)) {
     return NewErrorIterator(Status::Corruption("bad block contents"));
   }
@@ -296,7 +401,11 @@ Iterator* Block::NewIterator(const Comparator* cmp) {
     return NewEmptyIterator();
   } else {
     return new Iter(cmp, data_, restart_offset_, num_restarts,
-                    hash_index_.get());
+                    hash_index_.get(),
+                    point_lookup && has_data_block_hash_index_
+                        ? &data_block_hash_index_
+                        : nullptr,
+                    value_delta_encoded_);
   }
 }
 
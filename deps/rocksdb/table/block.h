@@ -13,6 +13,7 @@
 
 #include "rocksdb/iterator.h"
 #include "rocksdb/options.h"
+#include "table/data_block_hash_index.h"
 
 namespace rocksdb {
 
@@ -39,9 +40,20 @@ class Block {
   // NOTE: for the hash based lookup, if a key prefix doesn't match any key,
   // the iterator will simply be set as "invalid", rather than returning
   // the key that is just pass the target key.
-  Iterator* NewIterator(const Comparator* comparator);
+  //
+  // If `point_lookup` is true and the block has a data block hash index, Seek()
+  // looks up the user key of the target in it to find the restart interval.
+  // The iterator is then positioned for Get() only: if the user key is not
+  // in the block, it may stop at any later key or at the end of the block.
+  Iterator* NewIterator(const Comparator* comparator,
+                        bool point_lookup = false);
   void SetBlockHashIndex(BlockHashIndex* hash_index);
 
+  // Mark the block as an index block built with use_value_delta_encoding,
+  // whose values are BlockHandles. Its iterators decode the handles and
+  // return their full encoding as value().
+  void SetValueDeltaEncoded() { value_delta_encoded_ = true; }
+
  private:
   const char* data_;
   size_t size_;
@@ -50,6 +62,9 @@ class Block {
   bool cachable_;
   CompressionType compression_type_;
   std::unique_ptr<BlockHashIndex> hash_index_;
+  bool has_data_block_hash_index_;
+  DataBlockHashIndex data_block_hash_index_;
+  bool value_delta_encoded_;
 
   // No copying allowed
   Block(const Block&);
@@ -12,13 +12,20 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
 
 #include "rocksdb/cache.h"
 #include "rocksdb/comparator.h"
@@ -38,6 +45,7 @@
 
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
 #include "util/stop_watch.h"
 #include "util/xxhash.h"
 
@@ -45,6 +53,8 @@ namespace rocksdb {
 
 extern const std::string kHashIndexPrefixesBlock;
 extern const std::string kHashIndexPrefixesMetadataBlock;
+extern const std::string kCompressionDictBlock;
+extern const std::string kRangeDelBlock;
 namespace {
 
 typedef BlockBasedTableOptions::IndexType IndexType;
@@ -113,11 +123,23 @@ class IndexBuilder {
 //  2. Shorten the key length for index block. Other than honestly using the
 //     last key in the data block as the index key, we instead find a shortest
 //     substitute key that serves the same function.
+//
+// With use_value_delta_encoding, the index block is built with restart
+// intervals of index_block_restart_interval entries, and a block handle that
+// follows the previous one in the file is stored as a delta to it, see
+// BlockHandle::EncodeDeltaTo().
 class ShortenedIndexBuilder : public IndexBuilder {
  public:
-  explicit ShortenedIndexBuilder(const Comparator* comparator)
+  explicit ShortenedIndexBuilder(const Comparator* comparator,
+                                 int index_block_restart_interval = 1,
+                                 bool use_value_delta_encoding = false)
       : IndexBuilder(comparator),
-        index_block_builder_(1 /* block_restart_interval == 1 */, comparator) {}
+        index_block_builder_(index_block_restart_interval, comparator,
+                             false /* use_data_block_hash_index */,
+                             0.75 /* data_block_hash_table_util_ratio */,
+                             use_value_delta_encoding),
+        use_value_delta_encoding_(use_value_delta_encoding),
+        has_last_handle_(false) {}
 
   virtual void AddIndexEntry(std::string* last_key_in_current_block,
                              const Slice* first_key_in_next_block,
@@ -131,7 +153,18 @@ class ShortenedIndexBuilder : public IndexBuilder {
 
     std::string handle_encoding;
     block_handle.EncodeTo(&handle_encoding);
-    index_block_builder_.Add(*last_key_in_current_block, handle_encoding);
+    if (use_value_delta_encoding_ && has_last_handle_ &&
+        block_handle.IsFollowing(last_handle_)) {
+      std::string delta_encoding;
+      block_handle.EncodeDeltaTo(&delta_encoding, last_handle_);
+      Slice delta_value(delta_encoding);
+      index_block_builder_.Add(*last_key_in_current_block, handle_encoding,
+                               &delta_value);
+    } else {
+      index_block_builder_.Add(*last_key_in_current_block, handle_encoding);
+    }
+    last_handle_ = block_handle;
+    has_last_handle_ = true;
   }
 
   virtual Status Finish(IndexBlocks* index_blocks) {
@@ -145,6 +178,9 @@ class ShortenedIndexBuilder : public IndexBuilder {
 
  private:
   BlockBuilder index_block_builder_;
+  const bool use_value_delta_encoding_;
+  bool has_last_handle_;
+  BlockHandle last_handle_;
 };
 
 // HashIndexBuilder contains a binary-searchable primary index and the
@@ -258,11 +294,17 @@ class HashIndexBuilder : public IndexBuilder {
 
 // Create a index builder based on its type.
 IndexBuilder* CreateIndexBuilder(IndexType type, const Comparator* comparator,
-                                 const SliceTransform* prefix_extractor) {
+                                 const SliceTransform* prefix_extractor,
+                                 int index_block_restart_interval) {
   switch (type) {
     case BlockBasedTableOptions::kBinarySearch: {
       return new ShortenedIndexBuilder(comparator);
     }
+    case BlockBasedTableOptions::kDeltaEncodedBinarySearch: {
+      return new ShortenedIndexBuilder(comparator,
+                                       index_block_restart_interval,
+                                       true /* use_value_delta_encoding */);
+    }
     case BlockBasedTableOptions::kHashSearch: {
       return new HashIndexBuilder(comparator, prefix_extractor);
     }
@@ -281,9 +323,14 @@ bool GoodCompressionRatio(size_t compressed_size, size_t raw_size) {
   return compressed_size < raw_size - (raw_size / 8u);
 }
 
+// compression_dict is only used by the compression types that support a
+// dictionary, the others ignore it. zstd_dict is compression_dict digested
+// by ZSTD, if it was.
 Slice CompressBlock(const Slice& raw,
                     const CompressionOptions& compression_options,
-                    CompressionType* type, std::string* compressed_output) {
+                    CompressionType* type, std::string* compressed_output,
+                    const Slice& compression_dict = Slice(),
+                    const port::ZSTDCompressionDict* zstd_dict = nullptr) {
   if (*type == kNoCompression) {
     return raw;
   }
@@ -300,7 +347,7 @@ Slice CompressBlock(const Slice& raw,
       break;  // fall back to no compression.
     case kZlibCompression:
       if (port::Zlib_Compress(compression_options, raw.data(), raw.size(),
-                              compressed_output) &&
+                              compressed_output, compression_dict) &&
           GoodCompressionRatio(compressed_output->size(), raw.size())) {
         return *compressed_output;
       }
@@ -325,6 +372,14 @@ Slice CompressBlock(const Slice& raw,
           GoodCompressionRatio(compressed_output->size(), raw.size())) {
         return *compressed_output;
       }
+      break;  // fall back to no compression.
+    case kZSTDCompression:
+      if (port::ZSTD_Compress(compression_options, raw.data(), raw.size(),
+                              compressed_output, compression_dict,
+                              zstd_dict) &&
+          GoodCompressionRatio(compressed_output->size(), raw.size())) {
+        return *compressed_output;
+      }
       break;     // fall back to no compression.
     default: {}  // Do not recognize this compression type
   }
@@ -335,6 +390,254 @@ Slice CompressBlock(const Slice& raw,
   return raw;
 }
 
+// The threads that compress the data blocks of all table builders of the
+// process. There are as many as the largest
+// CompressionOptions::parallel_threads any builder was created with, so
+// builders running at the same time share them instead of each starting
+// threads of its own.
+class CompressionThreadPool {
+ public:
+  static CompressionThreadPool* Default() {
+    // Never deleted: its threads run until the process exits
+    static CompressionThreadPool* const pool = new CompressionThreadPool;
+    return pool;
+  }
+
+  // Start threads until there are at least "num_threads"
+  void EnsureThreads(int num_threads) {
+    MutexLock l(&mutex_);
+    for (; num_threads_ < num_threads; num_threads_++) {
+      std::thread(&CompressionThreadPool::Work, this).detach();
+    }
+  }
+
+  void Schedule(std::function<void()> task) {
+    MutexLock l(&mutex_);
+    tasks_.push_back(std::move(task));
+    cv_.Signal();
+  }
+
+ private:
+  CompressionThreadPool() : cv_(&mutex_), num_threads_(0) {}
+
+  void Work() {
+    MutexLock l(&mutex_);
+    while (true) {
+      while (tasks_.empty()) {
+        cv_.Wait();
+      }
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop_front();
+      mutex_.Unlock();
+      task();
+      mutex_.Lock();
+    }
+  }
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  std::deque<std::function<void()>> tasks_;
+  int num_threads_;
+};
+
+// Compresses data blocks on the CompressionThreadPool. The builder pushes
+// the blocks in file order and pops them back in the same order, each one
+// only after its compression has finished. At most 2 * num_threads blocks
+// are in flight at a time.
+class ParallelCompressor {
+ public:
+  // A data block on its way through the compression threads, with what
+  // the builder needs to write it out.
+  struct BlockRep {
+    std::string raw;
+    std::string compressed_output;
+    Slice contents;  // points into raw or compressed_output
+    CompressionType type;
+    bool compressed = false;
+
+    // Keys of the block, for the filter
+    std::vector<std::string> keys;
+    // Last key of the block, and first key of the next block if there is
+    // one, for the index entry
+    std::string last_key;
+    std::string first_key_in_next_block;
+    bool has_next_block = false;
+  };
+
+  // "compression_dict" and "zstd_dict" must not change once a block was
+  // pushed.
+  ParallelCompressor(int num_threads, CompressionType type,
+                     const CompressionOptions& compression_options,
+                     const std::string* compression_dict,
+                     const port::ZSTDCompressionDict* zstd_dict)
+      : type_(type),
+        compression_options_(compression_options),
+        compression_dict_(compression_dict),
+        zstd_dict_(zstd_dict),
+        max_in_flight_(2 * num_threads),
+        cv_(&mutex_),
+        shutdown_(false),
+        num_scheduled_(0),
+        raw_bytes_in_flight_(0) {
+    CompressionThreadPool::Default()->EnsureThreads(num_threads);
+  }
+
+  ~ParallelCompressor() {
+    {
+      // Scheduled compressions of blocks that were not popped are skipped,
+      // but they still hold on to this compressor until they have run.
+      MutexLock l(&mutex_);
+      shutdown_ = true;
+      while (num_scheduled_ > 0) {
+        cv_.Wait();
+      }
+    }
+    for (auto block : in_order_) {
+      delete block;
+    }
+  }
+
+  // Queue "block" for compression. Takes ownership of the block until it
+  // is returned by Pop().
+  void Push(BlockRep* block) {
+    MutexLock l(&mutex_);
+    raw_bytes_in_flight_ += block->raw.size();
+    in_order_.push_back(block);
+    to_compress_.push_back(block);
+    num_scheduled_++;
+    CompressionThreadPool::Default()->Schedule([this]() { CompressNext(); });
+  }
+
+  // Return the oldest block if it has been compressed, or nullptr. If
+  // "wait" is true, waits for its compression, and only returns nullptr
+  // when no block is left. The caller owns the returned block.
+  BlockRep* Pop(bool wait) {
+    MutexLock l(&mutex_);
+    while (!in_order_.empty()) {
+      BlockRep* block = in_order_.front();
+      if (block->compressed) {
+        in_order_.pop_front();
+        raw_bytes_in_flight_ -= block->raw.size();
+        return block;
+      }
+      if (!wait) {
+        break;
+      }
+      cv_.Wait();
+    }
+    return nullptr;
+  }
+
+  // True if the caller should wait for blocks to complete before pushing
+  // more, to bound the memory held by the blocks in flight
+  bool TooManyInFlight() {
+    MutexLock l(&mutex_);
+    return in_order_.size() >= max_in_flight_;
+  }
+
+  // Uncompressed size of the blocks that have not been popped yet
+  uint64_t RawBytesInFlight() {
+    MutexLock l(&mutex_);
+    return raw_bytes_in_flight_;
+  }
+
+ private:
+  // Compresses the oldest block that no thread has taken yet. Runs once
+  // per pushed block.
+  void CompressNext() {
+    MutexLock l(&mutex_);
+    if (!shutdown_) {
+      assert(!to_compress_.empty());
+      BlockRep* block = to_compress_.front();
+      to_compress_.pop_front();
+
+      mutex_.Unlock();
+      block->type = type_;
+      block->contents =
+          CompressBlock(block->raw, compression_options_, &block->type,
+                        &block->compressed_output, *compression_dict_,
+                        zstd_dict_);
+      mutex_.Lock();
+
+      block->compressed = true;
+    }
+    num_scheduled_--;
+    cv_.SignalAll();
+  }
+
+  const CompressionType type_;
+  const CompressionOptions compression_options_;
+  const std::string* compression_dict_;
+  const port::ZSTDCompressionDict* zstd_dict_;
+  const size_t max_in_flight_;
+
+  port::Mutex mutex_;
+  port::CondVar cv_;
+  bool shutdown_;
+  // Blocks not yet popped, in file order
+  std::deque<BlockRep*> in_order_;
+  // Blocks waiting for a compression thread
+  std::deque<BlockRep*> to_compress_;
+  // Compressions scheduled on the pool that have not finished
+  int num_scheduled_;
+  uint64_t raw_bytes_in_flight_;
+};
+
+// The data blocks are held back until this many bytes of them per byte of
+// CompressionOptions::max_dict_bytes are buffered.
+const uint64_t kDictBufferBytesPerDictByte = 100;
+
+// Sample a compression dictionary of at most max_dict_bytes from the
+// buffered data blocks: pieces of kDictSampleLen bytes spread evenly over
+// them.  Only the blocks buffered before the dictionary is needed are
+// sampled, i.e. the first kDictBufferBytesPerDictByte * max_dict_bytes
+// bytes of the file; the blocks after them are compressed with the same
+// dictionary without being sampled.
+std::string SampleCompressionDict(
+    const std::vector<std::unique_ptr<ParallelCompressor::BlockRep>>& blocks,
+    uint64_t total_bytes, size_t max_dict_bytes) {
+  static const size_t kDictSampleLen = 64;
+  std::string dict;
+  const uint64_t num_samples =
+      std::max<uint64_t>(max_dict_bytes / kDictSampleLen, 1);
+  const uint64_t stride =
+      std::max<uint64_t>(total_bytes / num_samples, kDictSampleLen);
+  uint64_t block_offset = 0;
+  uint64_t sample_offset = 0;
+  for (const auto& block : blocks) {
+    const std::string& raw = block->raw;
+    while (sample_offset < block_offset + raw.size() &&
+           dict.size() < max_dict_bytes) {
+      const size_t pos = sample_offset - block_offset;
+      const size_t len = std::min(
+          {kDictSampleLen, raw.size() - pos, max_dict_bytes - dict.size()});
+      dict.append(raw, pos, len);
+      sample_offset += stride;
+    }
+    block_offset += raw.size();
+  }
+  return dict;
+}
+
+// Size of the dictionary to sample for "type": zlib only uses the last
+// 2^|window_bits| bytes of a dictionary, so there is no point in sampling,
+// or buffering data blocks for, more than that.
+size_t MaxDictBytes(CompressionType type, const CompressionOptions& opts) {
+  if (opts.max_dict_bytes <= 0) {
+    return 0;
+  }
+  size_t max_dict_bytes = static_cast<size_t>(opts.max_dict_bytes);
+  if (type == kZlibCompression) {
+    // Raw deflate has negative window bits, gzip adds 16 to them.
+    int bits = std::abs(opts.window_bits) & 15;
+    if (bits == 0) {
+      bits = 15;
+    }
+    max_dict_bytes = std::min(max_dict_bytes, static_cast<size_t>(1) << bits);
+  }
+  return max_dict_bytes;
+}
+
 }  // anonymous namespace
 
 // kBlockBasedTableMagicNumber was picked by running
@@ -416,17 +719,48 @@ struct BlockBasedTableBuilder::Rep {
   std::vector<std::unique_ptr<TablePropertiesCollector>>
       table_properties_collectors;
 
+  // Set if the data blocks are compressed in parallel. The filter keys of
+  // the current data block are then buffered in pending_filter_keys, as
+  // the filter needs the offset the block gets in the file.
+  std::unique_ptr<ParallelCompressor> parallel_compressor;
+  std::vector<std::string> pending_filter_keys;
+
+  // Set while the data blocks are held back in buffered_blocks to sample the
+  // compression dictionary from them. Their filter keys are buffered in
+  // pending_filter_keys too.
+  bool buffer_data_blocks = false;
+  std::vector<std::unique_ptr<ParallelCompressor::BlockRep>> buffered_blocks;
+  uint64_t buffered_bytes = 0;
+  // Largest dictionary worth sampling, see MaxDictBytes()
+  size_t max_dict_bytes = 0;
+  // Dictionary the data blocks are compressed with, empty if none
+  std::string compression_dict;
+  // compression_dict digested by ZSTD once for all the data blocks
+  port::ZSTDCompressionDict zstd_compression_dict;
+  // Written to the range deletion meta block by Finish()
+  std::vector<RangeTombstone> range_tombstones;
+
+  // True if the data blocks are not written out as soon as they are full
+  bool DeferDataBlocks() const {
+    return parallel_compressor != nullptr || buffer_data_blocks;
+  }
+
   Rep(const Options& opt, const InternalKeyComparator& icomparator,
       WritableFile* f, FlushBlockPolicyFactory* flush_block_policy_factory,
       CompressionType compression_type, IndexType index_block_type,
-      ChecksumType checksum_type)
+      ChecksumType checksum_type, bool use_data_block_hash_index,
+      double data_block_hash_table_util_ratio,
+      int index_block_restart_interval)
       : options(opt),
         internal_comparator(icomparator),
         file(f),
-        data_block(options, &internal_comparator),
+        data_block(options.block_restart_interval, &internal_comparator,
+                   use_data_block_hash_index,
+                   data_block_hash_table_util_ratio),
         internal_prefix_transform(options.prefix_extractor.get()),
         index_builder(CreateIndexBuilder(index_block_type, &internal_comparator,
-                                         &this->internal_prefix_transform)),
+                                         &this->internal_prefix_transform,
+                                         index_block_restart_interval)),
         compression_type(compression_type),
         checksum_type(checksum_type),
         filter_block(opt.filter_policy == nullptr
@@ -441,6 +775,26 @@ struct BlockBasedTableBuilder::Rep {
     }
     table_properties_collectors.emplace_back(
         new BlockBasedTablePropertiesCollector(index_block_type));
+    int64_t creation_time = 0;
+    if (options.env->GetCurrentTime(&creation_time).ok()) {
+      props.creation_time = creation_time;
+    }
+    // The hash index relies on seeing the keys and the index entries
+    // interleaved as they are added, so it keeps the sequential path.
+    if (options.compression_opts.parallel_threads > 1 &&
+        compression_type != kNoCompression &&
+        index_block_type != BlockBasedTableOptions::kHashSearch) {
+      parallel_compressor.reset(new ParallelCompressor(
+          options.compression_opts.parallel_threads, compression_type,
+          options.compression_opts, &compression_dict,
+          &zstd_compression_dict));
+    }
+    // The dictionary holds the data blocks back as well.
+    max_dict_bytes = MaxDictBytes(compression_type, options.compression_opts);
+    buffer_data_blocks = max_dict_bytes > 0 &&
+                         (compression_type == kZlibCompression ||
+                          compression_type == kZSTDCompression) &&
+                         index_block_type != BlockBasedTableOptions::kHashSearch;
   }
 };
 
@@ -451,7 +805,11 @@ BlockBasedTableBuilder::BlockBasedTableBuilder(
     : rep_(new Rep(options, internal_comparator, file,
                    table_options.flush_block_policy_factory.get(),
                    compression_type, table_options.index_type,
-                   table_options.checksum)) {
+                   table_options.checksum,
+                   table_options.data_block_index_type ==
+                       BlockBasedTableOptions::kDataBlockBinaryAndHash,
+                   table_options.data_block_hash_table_util_ratio,
+                   table_options.index_block_restart_interval)) {
   if (rep_->filter_block != nullptr) {
     rep_->filter_block->StartBlock(0);
   }
@@ -478,7 +836,10 @@ void BlockBasedTableBuilder::Add(const Slice& key, const Slice& value) {
   }
   r->index_builder->OnKeyAdded(key);
   auto should_flush = r->flush_block_policy->Update(key, value);
-  if (should_flush) {
+  if (should_flush && r->DeferDataBlocks()) {
+    assert(!r->data_block.empty());
+    SubmitBlock(&key);
+  } else if (should_flush) {
     assert(!r->data_block.empty());
     Flush();
 
@@ -496,7 +857,11 @@ void BlockBasedTableBuilder::Add(const Slice& key, const Slice& value) {
   }
 
   if (r->filter_block != nullptr) {
-    r->filter_block->AddKey(key);
+    if (r->DeferDataBlocks()) {
+      r->pending_filter_keys.emplace_back(key.data(), key.size());
+    } else {
+      r->filter_block->AddKey(key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -509,6 +874,13 @@ void BlockBasedTableBuilder::Add(const Slice& key, const Slice& value) {
                                     r->options.info_log.get());
 }
 
+Status BlockBasedTableBuilder::AddRangeTombstone(
+    const RangeTombstone& tombstone) {
+  assert(!rep_->closed);
+  rep_->range_tombstones.push_back(tombstone);
+  return Status::OK();
+}
+
 void BlockBasedTableBuilder::Flush() {
   Rep* r = rep_;
   assert(!r->closed);
@@ -525,14 +897,120 @@ void BlockBasedTableBuilder::Flush() {
   ++r->props.num_data_blocks;
 }
 
+void BlockBasedTableBuilder::SubmitBlock(const Slice* first_key_in_next_block) {
+  Rep* r = rep_;
+  assert(!r->closed);
+  if (!ok()) return;
+  if (r->data_block.empty()) return;
+
+  auto block = new ParallelCompressor::BlockRep();
+  block->raw = r->data_block.Finish().ToString();
+  r->data_block.Reset();
+  block->keys.swap(r->pending_filter_keys);
+  block->last_key = r->last_key;
+  if (first_key_in_next_block != nullptr) {
+    block->first_key_in_next_block = first_key_in_next_block->ToString();
+    block->has_next_block = true;
+  }
+  if (r->buffer_data_blocks) {
+    r->buffered_bytes += block->raw.size();
+    r->buffered_blocks.emplace_back(block);
+    if (r->buffered_bytes >= kDictBufferBytesPerDictByte * r->max_dict_bytes) {
+      WriteBufferedBlocks();
+    }
+    return;
+  }
+  r->parallel_compressor->Push(block);
+  WriteCompressedBlocks(false /* wait_for_all */);
+}
+
+void BlockBasedTableBuilder::WriteBufferedBlocks() {
+  Rep* r = rep_;
+  assert(r->buffer_data_blocks);
+  r->compression_dict =
+      SampleCompressionDict(r->buffered_blocks, r->buffered_bytes,
+                            r->max_dict_bytes);
+  if (r->compression_type == kZSTDCompression) {
+    r->zstd_compression_dict.Reset(r->options.compression_opts,
+                                   r->compression_dict);
+  }
+  r->buffer_data_blocks = false;
+  for (auto& block : r->buffered_blocks) {
+    if (r->parallel_compressor != nullptr) {
+      r->parallel_compressor->Push(block.release());
+      WriteCompressedBlocks(false /* wait_for_all */);
+    } else if (ok()) {
+      block->type = r->compression_type;
+      block->contents =
+          CompressBlock(block->raw, r->options.compression_opts, &block->type,
+                        &block->compressed_output, r->compression_dict,
+                        &r->zstd_compression_dict);
+      Slice next_key(block->first_key_in_next_block);
+      WriteDataBlock(block->contents, block->type, block->keys,
+                     &block->last_key,
+                     block->has_next_block ? &next_key : nullptr);
+    }
+  }
+  r->buffered_blocks.clear();
+  r->buffered_bytes = 0;
+}
+
+void BlockBasedTableBuilder::WriteCompressedBlocks(bool wait_for_all) {
+  Rep* r = rep_;
+  ParallelCompressor* compressor = r->parallel_compressor.get();
+  while (true) {
+    bool wait = wait_for_all || compressor->TooManyInFlight();
+    std::unique_ptr<ParallelCompressor::BlockRep> block(compressor->Pop(wait));
+    if (block == nullptr) {
+      break;
+    }
+    if (!ok()) {
+      // Drop the remaining blocks after an error
+      continue;
+    }
+    Slice next_key(block->first_key_in_next_block);
+    WriteDataBlock(block->contents, block->type, block->keys,
+                   &block->last_key,
+                   block->has_next_block ? &next_key : nullptr);
+  }
+}
+
+void BlockBasedTableBuilder::WriteDataBlock(
+    const Slice& contents, CompressionType type,
+    const std::vector<std::string>& filter_keys, std::string* last_key,
+    const Slice* first_key_in_next_block) {
+  Rep* r = rep_;
+  // Same steps as Flush() followed by the index entry in Add()
+  if (r->filter_block != nullptr) {
+    for (const auto& key : filter_keys) {
+      r->filter_block->AddKey(key);
+    }
+  }
+  BlockHandle handle;
+  WriteRawBlock(contents, type, &handle);
+  if (ok()) {
+    r->status = r->file->Flush();
+  }
+  if (r->filter_block != nullptr) {
+    r->filter_block->StartBlock(r->offset);
+  }
+  r->props.data_size = r->offset;
+  ++r->props.num_data_blocks;
+  if (ok()) {
+    r->index_builder->AddIndexEntry(last_key, first_key_in_next_block,
+                                    handle);
+  }
+}
+
 void BlockBasedTableBuilder::WriteBlock(BlockBuilder* block,
                                         BlockHandle* handle) {
-  WriteBlock(block->Finish(), handle);
+  WriteBlock(block->Finish(), handle, true /* is_data_block */);
   block->Reset();
 }
 
 void BlockBasedTableBuilder::WriteBlock(const Slice& raw_block_contents,
-                                        BlockHandle* handle) {
+                                        BlockHandle* handle,
+                                        bool is_data_block) {
   // File format contains a sequence of blocks where each block has:
   //    block_data: uint8[n]
   //    type: uint8
@@ -543,7 +1021,9 @@ void BlockBasedTableBuilder::WriteBlock(const Slice& raw_block_contents,
   auto type = r->compression_type;
   auto block_contents =
       CompressBlock(raw_block_contents, r->options.compression_opts, &type,
-                    &r->compressed_output);
+                    &r->compressed_output,
+                    is_data_block ? Slice(r->compression_dict) : Slice(),
+                    is_data_block ? &r->zstd_compression_dict : nullptr);
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
 }
@@ -648,7 +1128,20 @@ Status BlockBasedTableBuilder::InsertBlockInCache(const Slice& block_contents,
 Status BlockBasedTableBuilder::Finish() {
   Rep* r = rep_;
   bool empty_data_block = r->data_block.empty();
-  Flush();
+  if (r->DeferDataBlocks()) {
+    // The last data block gets its index entry when it is written out.
+    SubmitBlock(nullptr /* no next data block */);
+    if (r->buffer_data_blocks) {
+      WriteBufferedBlocks();
+    }
+    if (r->parallel_compressor != nullptr) {
+      WriteCompressedBlocks(true /* wait_for_all */);
+      r->parallel_compressor.reset();
+    }
+    empty_data_block = true;
+  } else {
+    Flush();
+  }
   assert(!r->closed);
   r->closed = true;
 
@@ -690,6 +1183,42 @@ Status BlockBasedTableBuilder::Finish() {
     meta_index_builder.Add(item.first, block_handle);
   }
 
+  if (ok() && !r->compression_dict.empty()) {
+    BlockHandle compression_dict_block_handle;
+    WriteRawBlock(r->compression_dict, kNoCompression,
+                  &compression_dict_block_handle);
+    meta_index_builder.Add(kCompressionDictBlock,
+                           compression_dict_block_handle);
+  }
+
+  if (ok() && !r->range_tombstones.empty()) {
+    // The block maps InternalKey(start_key, seq, kTypeRangeDeletion) to
+    // end_key, so it is sorted by the internal key comparator.
+    auto& tombstones = r->range_tombstones;
+    const Comparator* ucmp = r->internal_comparator.user_comparator();
+    std::sort(tombstones.begin(), tombstones.end(),
+              [ucmp](const RangeTombstone& a, const RangeTombstone& b) {
+                int cmp = ucmp->Compare(a.start_key, b.start_key);
+                return cmp != 0 ? cmp < 0 : a.seq > b.seq;
+              });
+    BlockBuilder range_del_block(1 /* block_restart_interval */,
+                                 &r->internal_comparator);
+    for (size_t i = 0; i < tombstones.size(); i++) {
+      if (i > 0 && tombstones[i].seq == tombstones[i - 1].seq &&
+          ucmp->Compare(tombstones[i].start_key,
+                        tombstones[i - 1].start_key) == 0) {
+        continue;  // the same tombstone added twice
+      }
+      InternalKey key(tombstones[i].start_key, tombstones[i].seq,
+                      kTypeRangeDeletion);
+      range_del_block.Add(key.Encode(), tombstones[i].end_key);
+    }
+    BlockHandle range_del_block_handle;
+    WriteRawBlock(range_del_block.Finish(), kNoCompression,
+                  &range_del_block_handle);
+    meta_index_builder.Add(kRangeDelBlock, range_del_block_handle);
+  }
+
   if (ok()) {
     if (r->filter_block != nullptr) {
       // Add mapping from "<filter_block_prefix>.Name" to location
@@ -788,6 +1317,7 @@ Status BlockBasedTableBuilder::Finish() {
 void BlockBasedTableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
+  r->parallel_compressor.reset();
   r->closed = true;
 }
 
@@ -796,7 +1326,24 @@ uint64_t BlockBasedTableBuilder::NumEntries() const {
 }
 
 uint64_t BlockBasedTableBuilder::FileSize() const {
-  return rep_->offset;
+  // Count the blocks still being compressed or held back for the
+  // compression dictionary at their uncompressed size, which is all that is
+  // known of them yet.  A file cut while its blocks are still buffered thus
+  // ends up smaller than the size it was cut at.
+  uint64_t size = rep_->offset + rep_->buffered_bytes;
+  if (rep_->parallel_compressor != nullptr) {
+    size += rep_->parallel_compressor->RawBytesInFlight();
+  }
+  return size;
+}
+
+bool BlockBasedTableBuilder::NeedCompact() const {
+  for (const auto& collector : rep_->table_properties_collectors) {
+    if (collector->NeedCompact()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 const std::string BlockBasedTable::kFilterBlockPrefix = "filter.";
@@ -9,6 +9,8 @@
 
 #pragma once
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 #include "rocksdb/flush_block_policy.h"
 #include "rocksdb/options.h"
@@ -40,6 +42,10 @@ class BlockBasedTableBuilder : public TableBuilder {
   // REQUIRES: Finish(), Abandon() have not been called
   void Add(const Slice& key, const Slice& value) override;
 
+  // Add a range tombstone, written to the range deletion meta block.
+  // REQUIRES: Finish(), Abandon() have not been called
+  Status AddRangeTombstone(const RangeTombstone& tombstone) override;
+
   // Return non-ok iff some error has been detected.
   Status status() const override;
 
@@ -62,17 +68,38 @@ class BlockBasedTableBuilder : public TableBuilder {
   // Finish() call, returns the size of the final generated file.
   uint64_t FileSize() const override;
 
+  bool NeedCompact() const override;
+
  private:
   bool ok() const { return status().ok(); }
   // Call block's Finish() method and then write the finalize block contents to
-  // file.
+  // file. For data blocks, which use the compression dictionary.
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
-  // Directly write block content to the file.
-  void WriteBlock(const Slice& block_contents, BlockHandle* handle);
+  // Directly write block content to the file. Only data blocks are
+  // compressed with the compression dictionary.
+  void WriteBlock(const Slice& block_contents, BlockHandle* handle,
+                  bool is_data_block = false);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
   Status InsertBlockInCache(const Slice& block_contents,
                             const CompressionType type,
                             const BlockHandle* handle);
+  // Parallel compression: hand the current data block to the compression
+  // threads, then write out the blocks whose compression has finished. Or
+  // hold it back for the compression dictionary.
+  void SubmitBlock(const Slice* first_key_in_next_block);
+  // Write the compressed blocks to the file in order, along with their
+  // filter keys and index entries. Waits for the blocks still being
+  // compressed if "wait_for_all" is true, or if too many are in flight.
+  void WriteCompressedBlocks(bool wait_for_all);
+  // Sample the compression dictionary from the data blocks held back for it,
+  // then compress and write them out.
+  void WriteBufferedBlocks();
+  // Write a compressed data block along with its filter keys and its index
+  // entry.
+  void WriteDataBlock(const Slice& contents, CompressionType type,
+                      const std::vector<std::string>& filter_keys,
+                      std::string* last_key,
+                      const Slice* first_key_in_next_block);
   struct Rep;
   class BlockBasedTablePropertiesCollectorFactory;
   class BlockBasedTablePropertiesCollector;
@@ -28,6 +28,13 @@ BlockBasedTableFactory::BlockBasedTableFactory(
     table_options_.flush_block_policy_factory.reset(
         new FlushBlockBySizePolicyFactory());
   }
+  if (table_options_.index_block_restart_interval < 1) {
+    table_options_.index_block_restart_interval = 1;
+  }
+  if (!(table_options_.data_block_hash_table_util_ratio > 0)) {
+    table_options_.data_block_hash_table_util_ratio =
+        BlockBasedTableOptions().data_block_hash_table_util_ratio;
+  }
 }
 
 Status BlockBasedTableFactory::NewTableReader(
@@ -59,5 +66,7 @@ const std::string BlockBasedTablePropertyNames::kIndexType =
 const std::string kHashIndexPrefixesBlock = "rocksdb.hashindex.prefixes";
 const std::string kHashIndexPrefixesMetadataBlock =
     "rocksdb.hashindex.metadata";
+const std::string kCompressionDictBlock = "rocksdb.compression_dict";
+const std::string kRangeDelBlock = "rocksdb.range_del";
 
 }  // namespace rocksdb
@@ -43,11 +43,15 @@ class BlockBasedTableFactory : public TableFactory {
       const Options& options, const InternalKeyComparator& internal_comparator,
       WritableFile* file, CompressionType compression_type) const override;
 
+  bool SupportsRangeTombstones() const override { return true; }
+
  private:
   BlockBasedTableOptions table_options_;
 };
 
 extern const std::string kHashIndexPrefixesBlock;
 extern const std::string kHashIndexPrefixesMetadataBlock;
+extern const std::string kCompressionDictBlock;
+extern const std::string kRangeDelBlock;
 
 }  // namespace rocksdb
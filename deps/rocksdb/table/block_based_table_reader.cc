@@ -9,10 +9,14 @@
 
 #include "table/block_based_table_reader.h"
 
+#include <algorithm>
+#include <limits>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
 
 #include "rocksdb/cache.h"
 #include "rocksdb/comparator.h"
@@ -20,6 +24,7 @@
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/iterator.h"
 #include "rocksdb/options.h"
+#include "rocksdb/persistent_cache.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/table.h"
 #include "rocksdb/table_properties.h"
@@ -39,6 +44,8 @@ namespace rocksdb {
 
 extern const uint64_t kBlockBasedTableMagicNumber;
 extern const std::string kHashIndexPrefixesBlock;
+extern const std::string kCompressionDictBlock;
+extern const std::string kRangeDelBlock;
 extern const std::string kHashIndexPrefixesMetadataBlock;
 using std::unique_ptr;
 
@@ -61,10 +68,13 @@ const size_t kMaxCacheKeyPrefixSize __attribute__((unused)) =
 Status ReadBlockFromFile(RandomAccessFile* file, const Footer& footer,
                          const ReadOptions& options, const BlockHandle& handle,
                          Block** result, Env* env, bool* didIO = nullptr,
-                         bool do_uncompress = true) {
+                         bool do_uncompress = true,
+                         const Slice& compression_dict = Slice(),
+                         const port::ZSTDUncompressionDict* zstd_dict =
+                             nullptr) {
   BlockContents contents;
   Status s = ReadBlockContents(file, footer, options, handle, &contents, env,
-                               do_uncompress);
+                               do_uncompress, compression_dict, zstd_dict);
   if (s.ok()) {
     *result = new Block(contents);
   }
@@ -157,15 +167,21 @@ class BinarySearchIndexReader : public IndexReader {
   // `BinarySearchIndexReader`.
   // On success, index_reader will be populated; otherwise it will remain
   // unmodified.
+  // If value_delta_encoded is true, the index block was built by a
+  // kDeltaEncodedBinarySearch index builder.
   static Status Create(RandomAccessFile* file, const Footer& footer,
                        const BlockHandle& index_handle, Env* env,
                        const Comparator* comparator,
-                       IndexReader** index_reader) {
+                       IndexReader** index_reader,
+                       bool value_delta_encoded = false) {
     Block* index_block = nullptr;
     auto s = ReadBlockFromFile(file, footer, ReadOptions(), index_handle,
                                &index_block, env);
 
     if (s.ok()) {
+      if (value_delta_encoded) {
+        index_block->SetValueDeltaEncoded();
+      }
       *index_reader = new BinarySearchIndexReader(comparator, index_block);
     }
 
@@ -297,6 +313,8 @@ struct BlockBasedTable::Rep {
   size_t cache_key_prefix_size = 0;
   char compressed_cache_key_prefix[kMaxCacheKeyPrefixSize];
   size_t compressed_cache_key_prefix_size = 0;
+  char persistent_cache_key_prefix[kMaxCacheKeyPrefixSize];
+  size_t persistent_cache_key_prefix_size = 0;
 
   // Footer contains the fixed table information
   Footer footer;
@@ -308,11 +326,19 @@ struct BlockBasedTable::Rep {
 
   std::shared_ptr<const TableProperties> table_properties;
   BlockBasedTableOptions::IndexType index_type;
+  bool bypass_block_cache_for_mmap_reads = false;
   // TODO(kailiu) It is very ugly to use internal key in table, since table
   // module should not be relying on db module. However to make things easier
   // and compatible with existing code, we introduce a wrapper that allows
   // block to extract prefix without knowing if a key is internal or not.
   unique_ptr<SliceTransform> internal_prefix_transform;
+  // The dictionary the data blocks are compressed with, empty if none
+  std::string compression_dict;
+  // compression_dict digested by ZSTD once for all the blocks, so it is not
+  // digested again for every block read
+  port::ZSTDUncompressionDict zstd_compression_dict;
+  // Read from the range deletion meta block, nullptr if the table has none
+  std::shared_ptr<const std::vector<RangeTombstone>> range_tombstones;
 };
 
 BlockBasedTable::~BlockBasedTable() {
@@ -358,6 +384,16 @@ void BlockBasedTable::SetupCacheKeyPrefix(Rep* rep) {
                         rep->file.get(), &rep->compressed_cache_key_prefix[0],
                         &rep->compressed_cache_key_prefix_size);
   }
+  if (rep->options.persistent_cache != nullptr) {
+    char* buffer = &rep->persistent_cache_key_prefix[0];
+    size_t size = rep->file->GetUniqueId(buffer, kMaxCacheKeyPrefixSize);
+    if (size == 0) {
+      char* end =
+          EncodeVarint64(buffer, rep->options.persistent_cache->NewId());
+      size = static_cast<size_t>(end - buffer);
+    }
+    rep->persistent_cache_key_prefix_size = size;
+  }
 }
 
 void BlockBasedTable::GenerateCachePrefix(Cache* cc,
@@ -407,6 +443,8 @@ Status BlockBasedTable::Open(const Options& options, const EnvOptions& soptions,
   rep->file = std::move(file);
   rep->footer = footer;
   rep->index_type = table_options.index_type;
+  rep->bypass_block_cache_for_mmap_reads =
+      table_options.bypass_block_cache_for_mmap_reads;
   SetupCacheKeyPrefix(rep);
   unique_ptr<BlockBasedTable> new_table(new BlockBasedTable(rep));
 
@@ -441,6 +479,35 @@ Status BlockBasedTable::Open(const Options& options, const EnvOptions& soptions,
         "Cannot find Properties block from file.");
   }
 
+  // Read the compression dictionary of the data blocks, if there is one
+  BlockHandle compression_dict_handle;
+  if (FindMetaBlock(meta_iter.get(), kCompressionDictBlock,
+                    &compression_dict_handle).ok()) {
+    BlockContents contents;
+    s = ReadBlockContents(rep->file.get(), rep->footer, ReadOptions(),
+                          compression_dict_handle, &contents, options.env,
+                          false /* do_uncompress */);
+    if (!s.ok()) {
+      return s;
+    }
+    rep->compression_dict.assign(contents.data.data(), contents.data.size());
+    if (contents.heap_allocated) {
+      delete[] contents.data.data();
+    }
+    // Only digested if a block compressed with ZSTD is read
+    rep->zstd_compression_dict.Reset(rep->compression_dict);
+  }
+
+  // Read the range tombstones, if there are any
+  BlockHandle range_del_handle;
+  if (FindMetaBlock(meta_iter.get(), kRangeDelBlock, &range_del_handle)
+          .ok()) {
+    s = ReadRangeTombstones(rep, range_del_handle);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
   // Will use block cache for index/filter blocks access?
   if (options.block_cache && table_options.cache_index_and_filter_blocks) {
     // Hack: Call NewIndexIterator() to implicitly add index to the block_cache
@@ -508,6 +575,11 @@ std::shared_ptr<const TableProperties> BlockBasedTable::GetTableProperties()
   return rep_->table_properties;
 }
 
+std::shared_ptr<const std::vector<RangeTombstone>>
+BlockBasedTable::GetRangeTombstones() const {
+  return rep_->range_tombstones;
+}
+
 // Load the meta-block from the file. On success, return the loaded meta block
 // and its iterator.
 Status BlockBasedTable::ReadMetaBlock(
@@ -543,11 +615,46 @@ Status BlockBasedTable::ReadMetaBlock(
   return Status::OK();
 }
 
+Status BlockBasedTable::ReadRangeTombstones(Rep* rep,
+                                            const BlockHandle& handle) {
+  Block* block = nullptr;
+  Status s = ReadBlockFromFile(rep->file.get(), rep->footer, ReadOptions(),
+                               handle, &block, rep->options.env);
+  if (!s.ok()) {
+    return s;
+  }
+  std::unique_ptr<Block> range_del_block(block);
+  std::unique_ptr<Iterator> iter(
+      range_del_block->NewIterator(&rep->internal_comparator));
+  auto tombstones = std::make_shared<std::vector<RangeTombstone>>();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    // ParseInternalKey() rejects the range deletion type, so the key is
+    // decoded here.
+    Slice key = iter->key();
+    if (key.size() < 8) {
+      return Status::Corruption("bad range tombstone key");
+    }
+    uint64_t packed = DecodeFixed64(key.data() + key.size() - 8);
+    if (static_cast<ValueType>(packed & 0xff) != kTypeRangeDeletion) {
+      return Status::Corruption("bad range tombstone type");
+    }
+    tombstones->emplace_back(ExtractUserKey(key), iter->value(), packed >> 8);
+  }
+  if (!iter->status().ok()) {
+    return iter->status();
+  }
+  rep->range_tombstones = std::move(tombstones);
+  return Status::OK();
+}
+
 Status BlockBasedTable::GetDataBlockFromCache(
     const Slice& block_cache_key, const Slice& compressed_block_cache_key,
-    Cache* block_cache, Cache* block_cache_compressed, Statistics* statistics,
-    const ReadOptions& read_options,
-    BlockBasedTable::CachableEntry<Block>* block) {
+    const Slice& persistent_cache_key, Cache* block_cache,
+    Cache* block_cache_compressed, PersistentCache* persistent_cache,
+    Statistics* statistics, const ReadOptions& read_options,
+    BlockBasedTable::CachableEntry<Block>* block,
+    const Slice& compression_dict,
+    const port::ZSTDUncompressionDict* zstd_dict) {
   Status s;
   Block* compressed_block = nullptr;
   Cache::Handle* block_cache_compressed_handle = nullptr;
@@ -568,7 +675,10 @@ Status BlockBasedTable::GetDataBlockFromCache(
   assert(block->cache_handle == nullptr && block->value == nullptr);
 
   if (block_cache_compressed == nullptr) {
-    return s;
+    return GetDataBlockFromPersistentCache(
+        block_cache_key, compressed_block_cache_key, persistent_cache_key,
+        block_cache, nullptr, persistent_cache, statistics, read_options,
+        block, compression_dict, zstd_dict);
   }
 
   assert(!compressed_block_cache_key.empty());
@@ -578,7 +688,10 @@ Status BlockBasedTable::GetDataBlockFromCache(
   // uncompressed cache
   if (block_cache_compressed_handle == nullptr) {
     RecordTick(statistics, BLOCK_CACHE_COMPRESSED_MISS);
-    return s;
+    return GetDataBlockFromPersistentCache(
+        block_cache_key, compressed_block_cache_key, persistent_cache_key,
+        block_cache, block_cache_compressed, persistent_cache, statistics,
+        read_options, block, compression_dict, zstd_dict);
   }
 
   // found compressed block
@@ -590,7 +703,8 @@ Status BlockBasedTable::GetDataBlockFromCache(
   // Retrieve the uncompressed contents into a new buffer
   BlockContents contents;
   s = UncompressBlockContents(compressed_block->data(),
-                              compressed_block->size(), &contents);
+                              compressed_block->size(), &contents,
+                              compression_dict, zstd_dict);
 
   // Insert uncompressed block into block cache
   if (s.ok()) {
@@ -611,20 +725,97 @@ Status BlockBasedTable::GetDataBlockFromCache(
   return s;
 }
 
+// Entries of the persistent cache are the block contents as stored in the
+// file, followed by their compression type like in the block trailer.
+Status BlockBasedTable::GetDataBlockFromPersistentCache(
+    const Slice& block_cache_key, const Slice& compressed_block_cache_key,
+    const Slice& persistent_cache_key, Cache* block_cache,
+    Cache* block_cache_compressed, PersistentCache* persistent_cache,
+    Statistics* statistics, const ReadOptions& read_options,
+    BlockBasedTable::CachableEntry<Block>* block,
+    const Slice& compression_dict,
+    const port::ZSTDUncompressionDict* zstd_dict) {
+  if (persistent_cache == nullptr) {
+    return Status::OK();
+  }
+
+  assert(!persistent_cache_key.empty());
+  std::unique_ptr<char[]> data;
+  size_t size = 0;
+  Status s = persistent_cache->Lookup(persistent_cache_key, &data, &size);
+  if (!s.ok() || size == 0) {
+    // An entry that cannot be read back is a miss as well; the block is
+    // read from the table file instead.
+    RecordTick(statistics, PERSISTENT_CACHE_MISS);
+    return Status::OK();
+  }
+  RecordTick(statistics, PERSISTENT_CACHE_HIT);
+
+  BlockContents contents;
+  const CompressionType type = static_cast<CompressionType>(data[size - 1]);
+  if (type != kNoCompression) {
+    s = UncompressBlockContents(data.get(), size - 1, &contents,
+                                compression_dict, zstd_dict);
+    if (!s.ok()) {
+      return Status::OK();
+    }
+    // Refill the compressed block cache with the block as it is in the
+    // file, like PutDataBlockToCache() does.
+    if (block_cache_compressed != nullptr && read_options.fill_cache) {
+      BlockContents compressed;
+      compressed.data = Slice(data.release(), size - 1);
+      compressed.cachable = true;
+      compressed.heap_allocated = true;
+      compressed.compression_type = type;
+      Block* compressed_block = new Block(compressed);
+      auto cache_handle = block_cache_compressed->Insert(
+          compressed_block_cache_key, compressed_block,
+          compressed_block->size(), &DeleteCachedEntry<Block>);
+      block_cache_compressed->Release(cache_handle);
+    }
+  } else {
+    contents.data = Slice(data.release(), size - 1);
+    contents.cachable = true;
+    contents.heap_allocated = true;
+    contents.compression_type = kNoCompression;
+  }
+
+  block->value = new Block(contents);
+  if (block_cache != nullptr && block->value->cachable() &&
+      read_options.fill_cache) {
+    block->cache_handle =
+        block_cache->Insert(block_cache_key, block->value,
+                            block->value->size(), &DeleteCachedEntry<Block>);
+    RecordTick(statistics, BLOCK_CACHE_ADD);
+  }
+  return Status::OK();
+}
+
 Status BlockBasedTable::PutDataBlockToCache(
     const Slice& block_cache_key, const Slice& compressed_block_cache_key,
-    Cache* block_cache, Cache* block_cache_compressed,
+    const Slice& persistent_cache_key, Cache* block_cache,
+    Cache* block_cache_compressed, PersistentCache* persistent_cache,
     const ReadOptions& read_options, Statistics* statistics,
-    CachableEntry<Block>* block, Block* raw_block) {
+    CachableEntry<Block>* block, Block* raw_block,
+    const Slice& compression_dict,
+    const port::ZSTDUncompressionDict* zstd_dict) {
   assert(raw_block->compression_type() == kNoCompression ||
-         block_cache_compressed != nullptr);
+         block_cache_compressed != nullptr || persistent_cache != nullptr);
+
+  // Store the block as it is in the file in the persistent cache. Failing
+  // to do so only costs a file read later.
+  if (persistent_cache != nullptr) {
+    std::string entry(raw_block->data(), raw_block->size());
+    entry.push_back(static_cast<char>(raw_block->compression_type()));
+    persistent_cache->Insert(persistent_cache_key, entry.data(), entry.size());
+  }
 
   Status s;
   // Retrieve the uncompressed contents into a new buffer
   BlockContents contents;
   if (raw_block->compression_type() != kNoCompression) {
     s = UncompressBlockContents(raw_block->data(), raw_block->size(),
-                                &contents);
+                                &contents, compression_dict, zstd_dict);
   }
   if (!s.ok()) {
     delete raw_block;
@@ -795,13 +986,25 @@ Iterator* BlockBasedTable::NewIndexIterator(const ReadOptions& read_options) {
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
-    const ReadOptions& ro, bool* didIO, const Slice& index_value) {
+    const ReadOptions& ro, bool* didIO, const Slice& index_value,
+    RandomAccessFile* file, bool point_lookup) {
+  if (file == nullptr) {
+    file = rep->file.get();
+  }
   const bool no_io = (ro.read_tier == kBlockCacheTier);
   Cache* block_cache = rep->options.block_cache.get();
   Cache* block_cache_compressed = rep->options.
                                     block_cache_compressed.get();
+  PersistentCache* persistent_cache = rep->options.persistent_cache.get();
   CachableEntry<Block> block;
 
+  // Blocks read in place are used straight from the mapping of the file.
+  if (rep->bypass_block_cache_for_mmap_reads && rep->file->ReadsInPlace()) {
+    block_cache = nullptr;
+    block_cache_compressed = nullptr;
+    persistent_cache = nullptr;
+  }
+
   BlockHandle handle;
   Slice input = index_value;
   // We intentionally allow extra stuff in index_value so that we
@@ -812,13 +1015,16 @@ Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
     return NewErrorIterator(s);
   }
 
-  // If either block cache is enabled, we'll try to read from it.
-  if (block_cache != nullptr || block_cache_compressed != nullptr) {
+  // If any block cache is enabled, we'll try to read from it.
+  if (block_cache != nullptr || block_cache_compressed != nullptr ||
+      persistent_cache != nullptr) {
     Statistics* statistics = rep->options.statistics.get();
     char cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
     char compressed_cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
+    char persistent_cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
     Slice key, /* key to the block cache */
-        ckey /* key to the compressed block cache */;
+        ckey, /* key to the compressed block cache */
+        pkey /* key to the persistent cache */;
 
     // create key for block cache
     if (block_cache != nullptr) {
@@ -832,22 +1038,34 @@ Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
                          compressed_cache_key);
     }
 
-    s = GetDataBlockFromCache(key, ckey, block_cache, block_cache_compressed,
-                      statistics, ro, &block);
+    if (persistent_cache != nullptr) {
+      pkey = GetCacheKey(rep->persistent_cache_key_prefix,
+                         rep->persistent_cache_key_prefix_size, handle,
+                         persistent_cache_key);
+    }
+
+    s = GetDataBlockFromCache(key, ckey, pkey, block_cache,
+                              block_cache_compressed, persistent_cache,
+                              statistics, ro, &block, rep->compression_dict,
+                              &rep->zstd_compression_dict);
 
     if (block.value == nullptr && !no_io && ro.fill_cache) {
       Histograms histogram = READ_BLOCK_GET_MICROS;
       Block* raw_block = nullptr;
       {
         StopWatch sw(rep->options.env, statistics, histogram);
-        s = ReadBlockFromFile(rep->file.get(), rep->footer, ro, handle,
-                              &raw_block, rep->options.env, didIO,
-                              block_cache_compressed == nullptr);
+        s = ReadBlockFromFile(
+            file, rep->footer, ro, handle, &raw_block, rep->options.env, didIO,
+            block_cache_compressed == nullptr && persistent_cache == nullptr,
+            rep->compression_dict, &rep->zstd_compression_dict);
       }
 
       if (s.ok()) {
-        s = PutDataBlockToCache(key, ckey, block_cache, block_cache_compressed,
-                                ro, statistics, &block, raw_block);
+        s = PutDataBlockToCache(key, ckey, pkey, block_cache,
+                                block_cache_compressed, persistent_cache, ro,
+                                statistics, &block, raw_block,
+                                rep->compression_dict,
+                                &rep->zstd_compression_dict);
       }
     }
   }
@@ -858,13 +1076,15 @@ Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
       // Could not read from block_cache and can't do IO
       return NewErrorIterator(Status::Incomplete("no blocking io"));
     }
-    s = ReadBlockFromFile(rep->file.get(), rep->footer, ro, handle,
-                          &block.value, rep->options.env, didIO);
+    s = ReadBlockFromFile(file, rep->footer, ro, handle,
+                          &block.value, rep->options.env, didIO,
+                          true /* do_uncompress */, rep->compression_dict,
+                          &rep->zstd_compression_dict);
   }
 
   Iterator* iter;
   if (block.value != nullptr) {
-    iter = block.value->NewIterator(&rep->internal_comparator);
+    iter = block.value->NewIterator(&rep->internal_comparator, point_lookup);
     if (block.cache_handle != nullptr) {
       iter->RegisterCleanup(&ReleaseCachedEntry, block_cache,
                             block.cache_handle);
@@ -877,16 +1097,127 @@ Iterator* BlockBasedTable::NewDataBlockIterator(Rep* rep,
   return iter;
 }
 
+namespace {
+// The table file as seen by an iterator whose file cannot prefetch (see
+// RandomAccessFile::Prefetch()): the iterator reads ahead into a buffer of
+// its own with ReadAhead(), and the reads that fall in it are served from
+// memory. The rest is read from the file.
+class ReadaheadFile : public RandomAccessFile {
+ public:
+  explicit ReadaheadFile(RandomAccessFile* file)
+      : file_(file), buf_capacity_(0), buf_offset_(0), buf_len_(0) {}
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const override {
+    if (offset >= buf_offset_ && offset + n <= buf_offset_ + buf_len_) {
+      memcpy(scratch, buf_.get() + (offset - buf_offset_), n);
+      *result = Slice(scratch, n);
+      return Status::OK();
+    }
+    return file_->Read(offset, n, result, scratch);
+  }
+
+  // Buffer the "len" bytes at "offset", keeping those that are already
+  // buffered. The others are fetched in chunks with one MultiRead(), so
+  // that the device works on all of them at once.
+  void ReadAhead(uint64_t offset, size_t len) {
+    size_t keep = 0;
+    if (offset >= buf_offset_ && offset < buf_offset_ + buf_len_) {
+      keep = std::min(static_cast<size_t>(buf_offset_ + buf_len_ - offset),
+                      len);
+    }
+    if (buf_capacity_ < len) {
+      std::unique_ptr<char[]> buf(new char[len]);
+      if (keep > 0) {
+        memcpy(buf.get(), buf_.get() + (offset - buf_offset_), keep);
+      }
+      buf_ = std::move(buf);
+      buf_capacity_ = len;
+    } else if (keep > 0) {
+      memmove(buf_.get(), buf_.get() + (offset - buf_offset_), keep);
+    }
+    buf_offset_ = offset;
+    buf_len_ = keep;
+    if (keep == len) {
+      return;
+    }
+
+    std::vector<ReadRequest> reads((len - keep + kChunkSize - 1) /
+                                   kChunkSize);
+    for (size_t i = 0; i < reads.size(); ++i) {
+      const size_t pos = keep + i * kChunkSize;
+      reads[i].offset = offset + pos;
+      reads[i].len = std::min(kChunkSize, len - pos);
+      reads[i].scratch = buf_.get() + pos;
+    }
+    file_->MultiRead(&reads[0], reads.size());
+    // Keep the bytes up to the first failed or short read, e.g. at the end
+    // of the file.
+    for (const auto& read : reads) {
+      if (!read.status.ok()) {
+        break;
+      }
+      if (read.result.data() != read.scratch) {
+        memcpy(read.scratch, read.result.data(), read.result.size());
+      }
+      buf_len_ += read.result.size();
+      if (read.result.size() < read.len) {
+        break;
+      }
+    }
+  }
+
+ private:
+  static const size_t kChunkSize = 32 * 1024;
+
+  RandomAccessFile* file_;
+  std::unique_ptr<char[]> buf_;
+  size_t buf_capacity_;
+  // the buffer holds the buf_len_ bytes of the file at buf_offset_
+  uint64_t buf_offset_;
+  size_t buf_len_;
+};
+
+const size_t ReadaheadFile::kChunkSize;
+}  // namespace
+
+// Iterator readahead starts at this size and doubles with every block read
+// from the file, up to kMaxAutoReadaheadSize, unless
+// ReadOptions::readahead_size asks for a fixed size.
+static const size_t kInitAutoReadaheadSize = 8 * 1024;
+static const size_t kMaxAutoReadaheadSize = 256 * 1024;
+// Number of back-to-back blocks read in file order before readahead kicks
+// in, so that short scans and seeks do not pay for it.
+static const int kMinSequentialReadsForReadahead = 2;
+
 class BlockBasedTable::BlockEntryIteratorState : public TwoLevelIteratorState {
  public:
   BlockEntryIteratorState(BlockBasedTable* table,
       const ReadOptions& read_options, bool* did_io)
     : TwoLevelIteratorState(table->rep_->options.prefix_extractor != nullptr),
-      table_(table), read_options_(read_options), did_io_(did_io) {}
+      table_(table), read_options_(read_options), did_io_(did_io),
+      prev_block_end_(std::numeric_limits<uint64_t>::max()),
+      num_sequential_reads_(0),
+      readahead_size_(read_options.readahead_size > 0
+                          ? read_options.readahead_size
+                          : kInitAutoReadaheadSize),
+      readahead_limit_(0) {}
 
   Iterator* NewSecondaryIterator(const Slice& index_value) override {
-    return NewDataBlockIterator(table_->rep_, read_options_, did_io_,
-                                index_value);
+    bool did_io = false;
+    Iterator* iter = NewDataBlockIterator(table_->rep_, read_options_,
+                                          &did_io, index_value,
+                                          readahead_file_.get());
+    if (did_io_ != nullptr && did_io) {
+      *did_io_ = true;
+    }
+
+    Slice input = index_value;
+    BlockHandle handle;
+    if (handle.DecodeFrom(&input).ok()) {
+      MaybeReadahead(handle, did_io);
+    }
+    return iter;
   }
 
   bool PrefixMayMatch(const Slice& internal_key) override {
@@ -894,11 +1225,71 @@ class BlockBasedTable::BlockEntryIteratorState : public TwoLevelIteratorState {
   }
 
  private:
+  // Tables are opened with POSIX_FADV_RANDOM (advise_random_on_open), which
+  // turns off the kernel's own readahead. Detect that the iterator reads
+  // the data blocks in file order and prefetch the bytes after the current
+  // block ourselves, so that a long scan does not wait on every block.
+  void MaybeReadahead(const BlockHandle& handle, bool did_io) {
+    const uint64_t block_end =
+        handle.offset() + handle.size() + kBlockTrailerSize;
+    if (handle.offset() == prev_block_end_) {
+      ++num_sequential_reads_;
+    } else {
+      // Seek or reverse iteration: start over.
+      num_sequential_reads_ = 0;
+      readahead_limit_ = 0;
+      if (read_options_.readahead_size == 0) {
+        readahead_size_ = kInitAutoReadaheadSize;
+      }
+    }
+    prev_block_end_ = block_end;
+
+    if (!did_io || read_options_.read_tier == kBlockCacheTier) {
+      // Served from the block cache; nothing to prefetch.
+      return;
+    }
+    if (read_options_.readahead_size == 0 &&
+        num_sequential_reads_ < kMinSequentialReadsForReadahead) {
+      return;
+    }
+    if (block_end + readahead_size_ / 2 <= readahead_limit_) {
+      // Still well inside the window that was prefetched last time.
+      return;
+    }
+
+    const uint64_t start = std::max(block_end, readahead_limit_);
+    readahead_limit_ = block_end + readahead_size_;
+    if (readahead_limit_ > start) {
+      RandomAccessFile* file = table_->rep_->file.get();
+      if (readahead_file_ == nullptr &&
+          file->Prefetch(start, readahead_limit_ - start).IsNotSupported() &&
+          !file->ReadsInPlace()) {
+        // Nothing caches the data for us (e.g. direct I/O): buffer it here.
+        readahead_file_.reset(new ReadaheadFile(file));
+      }
+      if (readahead_file_ != nullptr) {
+        readahead_file_->ReadAhead(block_end, readahead_size_);
+      }
+    }
+    if (read_options_.readahead_size == 0) {
+      readahead_size_ = std::min(readahead_size_ * 2, kMaxAutoReadaheadSize);
+    }
+  }
+
   // Don't own table_
   BlockBasedTable* table_;
   const ReadOptions read_options_;
   // Don't own did_io_
   bool* did_io_;
+
+  // State of the sequential access detection; prev_block_end_ is the
+  // largest uint64_t until the first block has been read.
+  uint64_t prev_block_end_;
+  int num_sequential_reads_;
+  size_t readahead_size_;
+  uint64_t readahead_limit_;
+  // Set once the file turns out not to support Prefetch()
+  std::unique_ptr<ReadaheadFile> readahead_file_;
 };
 
 // This will be broken if the user specifies an unusual implementation
@@ -994,9 +1385,28 @@ Status BlockBasedTable::Get(
   Status s;
   Iterator* iiter = NewIndexIterator(read_options);
   auto filter_entry = GetFilter(read_options.read_tier == kBlockCacheTier);
-  FilterBlockReader* filter = filter_entry.value;
+  iiter->Seek(key);
+  s = GetFromDataBlocks(read_options, key, iiter, filter_entry.value,
+                        handle_context, result_handler,
+                        mark_key_may_exist_handler);
+
+  filter_entry.Release(rep_->options.block_cache.get());
+  if (s.ok()) {
+    s = iiter->status();
+  }
+  delete iiter;
+  return s;
+}
+
+Status BlockBasedTable::GetFromDataBlocks(
+    const ReadOptions& read_options, const Slice& key, Iterator* iiter,
+    FilterBlockReader* filter, void* handle_context,
+    bool (*result_handler)(void* handle_context, const ParsedInternalKey& k,
+                           const Slice& v, bool didIO),
+    void (*mark_key_may_exist_handler)(void* handle_context)) {
+  Status s;
   bool done = false;
-  for (iiter->Seek(key); iiter->Valid() && !done; iiter->Next()) {
+  for (; iiter->Valid() && !done; iiter->Next()) {
     Slice handle_value = iiter->value();
 
     BlockHandle handle;
@@ -1014,7 +1424,8 @@ Status BlockBasedTable::Get(
     } else {
       bool didIO = false;
       unique_ptr<Iterator> block_iter(
-          NewDataBlockIterator(rep_, read_options, &didIO, iiter->value()));
+          NewDataBlockIterator(rep_, read_options, &didIO, iiter->value(),
+                               nullptr, true /* point_lookup */));
 
       if (read_options.read_tier && block_iter->status().IsIncomplete()) {
         // couldn't get block from block_cache
@@ -1040,13 +1451,188 @@ Status BlockBasedTable::Get(
       s = block_iter->status();
     }
   }
+  return s;
+}
 
-  filter_entry.Release(rep_->options.block_cache.get());
-  if (s.ok()) {
-    s = iiter->status();
+namespace {
+// The table file as seen by MultiGet(): the blocks that were fetched by one
+// RandomAccessFile::MultiRead() are served from memory, everything else is
+// read from the file.
+class PrereadFile : public RandomAccessFile {
+ public:
+  // reads must be sorted by offset
+  PrereadFile(RandomAccessFile* file, const std::vector<ReadRequest>& reads)
+      : file_(file), reads_(reads) {}
+
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const override {
+    auto it = std::lower_bound(
+        reads_.begin(), reads_.end(), offset,
+        [](const ReadRequest& r, uint64_t o) { return r.offset < o; });
+    if (it != reads_.end() && it->offset == offset && it->len == n &&
+        it->status.ok()) {
+      memcpy(scratch, it->result.data(), it->result.size());
+      *result = Slice(scratch, it->result.size());
+      return Status::OK();
+    }
+    // Not fetched, or fetching failed: let the file report the error
+    return file_->Read(offset, n, result, scratch);
   }
-  delete iiter;
-  return s;
+
+  virtual bool ReadsInPlace() const override {
+    return reads_.empty() && file_->ReadsInPlace();
+  }
+
+ private:
+  RandomAccessFile* file_;
+  const std::vector<ReadRequest>& reads_;
+};
+}  // namespace
+
+void BlockBasedTable::MultiGet(
+    const ReadOptions& read_options, size_t num_keys, const Slice* keys,
+    void* const* handle_contexts,
+    bool (*result_handler)(void* handle_context, const ParsedInternalKey& k,
+                           const Slice& v, bool didIO),
+    void (*mark_key_may_exist_handler)(void* handle_context),
+    Status* statuses) {
+  const bool no_io = read_options.read_tier == kBlockCacheTier;
+  Statistics* statistics = rep_->options.statistics.get();
+  unique_ptr<Iterator> iiter(NewIndexIterator(read_options));
+  auto filter_entry = GetFilter(no_io);
+  FilterBlockReader* filter = filter_entry.value;
+
+  // Find the first candidate data block of every key. Keys are sorted, so
+  // the index iterator only moves forward, and it is not even re-seeked
+  // while the block it points at still covers the next key.
+  std::vector<BlockHandle> handles;
+  std::vector<std::string> index_values;
+  // (key index, position in handles) for the keys that need a data block
+  std::vector<std::pair<size_t, size_t>> lookups;
+  for (size_t i = 0; i < num_keys; ++i) {
+    statuses[i] = Status::OK();
+    if (i == 0 || !iiter->Valid() ||
+        rep_->internal_comparator.Compare(keys[i], iiter->key()) > 0) {
+      iiter->Seek(keys[i]);
+    }
+    if (!iiter->Valid()) {
+      statuses[i] = iiter->status();
+      continue;
+    }
+
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    statuses[i] = handle.DecodeFrom(&handle_value);
+    if (!statuses[i].ok()) {
+      continue;
+    }
+    if (filter != nullptr && !filter->KeyMayMatch(handle.offset(), keys[i])) {
+      RecordTick(statistics, BLOOM_FILTER_USEFUL);
+      continue;
+    }
+    if (handles.empty() || handles.back().offset() != handle.offset()) {
+      handles.push_back(handle);
+      index_values.push_back(iiter->value().ToString());
+    }
+    lookups.push_back(std::make_pair(i, handles.size() - 1));
+  }
+
+  // Fetch all blocks that are not in the block cache with one MultiRead(),
+  // so that the reads overlap instead of waiting for each other one at a
+  // time. Files that read in place have nothing to wait for.
+  std::vector<ReadRequest> reads;
+  std::unique_ptr<char[]> read_buf;
+  if (!no_io && handles.size() > 1 && !rep_->file->ReadsInPlace()) {
+    Cache* block_cache = rep_->options.block_cache.get();
+    std::vector<const BlockHandle*> misses;
+    for (const auto& handle : handles) {
+      if (block_cache != nullptr) {
+        char cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
+        Slice key = GetCacheKey(rep_->cache_key_prefix,
+                                rep_->cache_key_prefix_size, handle,
+                                cache_key);
+        Cache::Handle* cache_handle = block_cache->Lookup(key);
+        if (cache_handle != nullptr) {
+          block_cache->Release(cache_handle);
+          continue;
+        }
+      }
+      misses.push_back(&handle);
+    }
+    if (misses.size() > 1) {
+      size_t total = 0;
+      for (auto handle : misses) {
+        total += handle->size() + kBlockTrailerSize;
+      }
+      read_buf.reset(new char[total]);
+      reads.resize(misses.size());
+      char* scratch = read_buf.get();
+      for (size_t k = 0; k < misses.size(); ++k) {
+        reads[k].offset = misses[k]->offset();
+        reads[k].len = misses[k]->size() + kBlockTrailerSize;
+        reads[k].scratch = scratch;
+        scratch += reads[k].len;
+      }
+      rep_->file->MultiRead(&reads[0], reads.size());
+    }
+  }
+  PrereadFile preread_file(rep_->file.get(), reads);
+
+  // Read every block once and look up all of its keys in it.
+  unique_ptr<Iterator> block_iter;
+  bool didIO = false;
+  for (size_t j = 0; j < lookups.size(); ++j) {
+    const size_t i = lookups[j].first;
+    const size_t b = lookups[j].second;
+    if (j == 0 || b != lookups[j - 1].second) {
+      didIO = false;
+      block_iter.reset(NewDataBlockIterator(rep_, read_options, &didIO,
+                                            index_values[b], &preread_file,
+                                            true /* point_lookup */));
+    }
+
+    if (read_options.read_tier && block_iter->status().IsIncomplete()) {
+      // Same as in Get(): we cannot tell whether the key is there.
+      (*mark_key_may_exist_handler)(handle_contexts[i]);
+      continue;
+    }
+
+    Status s;
+    bool done = false;
+    for (block_iter->Seek(keys[i]); block_iter->Valid(); block_iter->Next()) {
+      ParsedInternalKey parsed_key;
+      if (!ParseInternalKey(block_iter->key(), &parsed_key)) {
+        s = Status::Corruption(Slice());
+      }
+
+      if (!(*result_handler)(handle_contexts[i], parsed_key,
+                             block_iter->value(), didIO)) {
+        done = true;
+        break;
+      }
+    }
+    s = block_iter->status();
+
+    if (!done && s.ok()) {
+      // The entries of this key go on past the end of the block. This is
+      // rare, so just continue the lookup the way Get() does.
+      unique_ptr<Iterator> next_iiter(NewIndexIterator(read_options));
+      next_iiter->Seek(keys[i]);
+      if (next_iiter->Valid()) {
+        next_iiter->Next();
+      }
+      s = GetFromDataBlocks(read_options, keys[i], next_iiter.get(), filter,
+                            handle_contexts[i], result_handler,
+                            mark_key_may_exist_handler);
+      if (s.ok()) {
+        s = next_iiter->status();
+      }
+    }
+    statuses[i] = s;
+  }
+  block_iter.reset();
+
+  filter_entry.Release(rep_->options.block_cache.get());
 }
 
 namespace {
@@ -1097,6 +1683,11 @@ Status BlockBasedTable::CreateIndexReader(IndexReader** index_reader,
       return BinarySearchIndexReader::Create(
           file, footer, footer.index_handle(), env, comparator, index_reader);
     }
+    case BlockBasedTableOptions::kDeltaEncodedBinarySearch: {
+      return BinarySearchIndexReader::Create(
+          file, footer, footer.index_handle(), env, comparator, index_reader,
+          true /* value_delta_encoded */);
+    }
     case BlockBasedTableOptions::kHashSearch: {
       std::unique_ptr<Block> meta_guard;
       std::unique_ptr<Iterator> meta_iter_guard;
@@ -13,6 +13,7 @@
 #include <memory>
 #include <utility>
 #include <string>
+#include <vector>
 
 #include "rocksdb/statistics.h"
 #include "rocksdb/status.h"
@@ -29,6 +30,7 @@ class FilterBlockReader;
 class Footer;
 class InternalKeyComparator;
 class Iterator;
+class PersistentCache;
 class RandomAccessFile;
 class TableCache;
 class TableReader;
@@ -38,6 +40,10 @@ struct EnvOptions;
 struct Options;
 struct ReadOptions;
 
+namespace port {
+class ZSTDUncompressionDict;
+}  // namespace port
+
 using std::unique_ptr;
 
 // A Table is a sorted map from strings to strings.  Tables are
@@ -78,6 +84,16 @@ class BlockBasedTable : public TableReader {
              void (*mark_key_may_exist_handler)(void* handle_context) =
                  nullptr) override;
 
+  // Looks up all keys of a data block with a single read of the block, and
+  // lets the reads of the different blocks of the batch overlap.
+  void MultiGet(const ReadOptions& readOptions, size_t num_keys,
+                const Slice* keys, void* const* handle_contexts,
+                bool (*result_handler)(void* handle_context,
+                                       const ParsedInternalKey& k,
+                                       const Slice& v, bool didIO),
+                void (*mark_key_may_exist_handler)(void* handle_context),
+                Status* statuses) override;
+
   // Given a key, return an approximate byte offset in the file where
   // the data for that key begins (or would begin if the key were
   // present in the file).  The returned value is in terms of file
@@ -96,6 +112,9 @@ class BlockBasedTable : public TableReader {
 
   std::shared_ptr<const TableProperties> GetTableProperties() const override;
 
+  std::shared_ptr<const std::vector<RangeTombstone>> GetRangeTombstones()
+      const override;
+
   ~BlockBasedTable();
 
   bool TEST_filter_block_preloaded() const;
@@ -112,8 +131,12 @@ class BlockBasedTable : public TableReader {
   bool compaction_optimized_;
 
   class BlockEntryIteratorState;
+  // If file is not nullptr, a block that is not in the block cache is read
+  // from it instead of from rep->file. If point_lookup is true, the iterator
+  // is only used to seek to the keys of Get() calls, see Block::NewIterator().
   static Iterator* NewDataBlockIterator(Rep* rep, const ReadOptions& ro,
-      bool* didIO, const Slice& index_value);
+      bool* didIO, const Slice& index_value,
+      RandomAccessFile* file = nullptr, bool point_lookup = false);
 
   // For the following two functions:
   // if `no_io == true`, we will not try to read filter/index from sst file
@@ -130,15 +153,41 @@ class BlockBasedTable : public TableReader {
   //     kBlockCacheTier
   Iterator* NewIndexIterator(const ReadOptions& read_options);
 
-  // Read block cache from block caches (if set): block_cache and
-  // block_cache_compressed.
+  // The data block part of Get(): calls result_handler on the entries of
+  // "key" in the data blocks starting at the current position of "iiter",
+  // until it returns false.
+  Status GetFromDataBlocks(
+      const ReadOptions& read_options, const Slice& key, Iterator* iiter,
+      FilterBlockReader* filter, void* handle_context,
+      bool (*result_handler)(void* handle_context, const ParsedInternalKey& k,
+                             const Slice& v, bool didIO),
+      void (*mark_key_may_exist_handler)(void* handle_context));
+
+  // Read block cache from block caches (if set): block_cache,
+  // block_cache_compressed and persistent_cache, in that order.
   // On success, Status::OK with be returned and @block will be populated with
   // pointer to the block as well as its block handle.
+  // @compression_dict is the dictionary of the data blocks of the table, and
+  // @zstd_dict the same dictionary digested by ZSTD, if it was.
   static Status GetDataBlockFromCache(
       const Slice& block_cache_key, const Slice& compressed_block_cache_key,
-      Cache* block_cache, Cache* block_cache_compressed, Statistics* statistics,
-      const ReadOptions& read_options,
-      BlockBasedTable::CachableEntry<Block>* block);
+      const Slice& persistent_cache_key, Cache* block_cache,
+      Cache* block_cache_compressed, PersistentCache* persistent_cache,
+      Statistics* statistics, const ReadOptions& read_options,
+      BlockBasedTable::CachableEntry<Block>* block,
+      const Slice& compression_dict = Slice(),
+      const port::ZSTDUncompressionDict* zstd_dict = nullptr);
+  // The part of GetDataBlockFromCache() that looks up persistent_cache, after
+  // the block caches in memory missed. A hit is inserted into block_cache,
+  // and into block_cache_compressed if it is compressed.
+  static Status GetDataBlockFromPersistentCache(
+      const Slice& block_cache_key, const Slice& compressed_block_cache_key,
+      const Slice& persistent_cache_key, Cache* block_cache,
+      Cache* block_cache_compressed, PersistentCache* persistent_cache,
+      Statistics* statistics, const ReadOptions& read_options,
+      BlockBasedTable::CachableEntry<Block>* block,
+      const Slice& compression_dict,
+      const port::ZSTDUncompressionDict* zstd_dict);
   // Put a raw block (maybe compressed) to the corresponding block caches.
   // This method will perform decompression against raw_block if needed and then
   // populate the block caches.
@@ -149,9 +198,12 @@ class BlockBasedTable : public TableReader {
   // responsible for releasing its memory if error occurs.
   static Status PutDataBlockToCache(
       const Slice& block_cache_key, const Slice& compressed_block_cache_key,
-      Cache* block_cache, Cache* block_cache_compressed,
+      const Slice& persistent_cache_key, Cache* block_cache,
+      Cache* block_cache_compressed, PersistentCache* persistent_cache,
       const ReadOptions& read_options, Statistics* statistics,
-      CachableEntry<Block>* block, Block* raw_block);
+      CachableEntry<Block>* block, Block* raw_block,
+      const Slice& compression_dict = Slice(),
+      const port::ZSTDUncompressionDict* zstd_dict = nullptr);
 
   // Calls (*handle_result)(arg, ...) repeatedly, starting with the entry found
   // after a call to Seek(key), until handle_result returns false.
@@ -174,6 +226,10 @@ class BlockBasedTable : public TableReader {
       std::unique_ptr<Block>* meta_block,
       std::unique_ptr<Iterator>* iter);
 
+  // Read the range deletion meta block at "handle" into
+  // rep->range_tombstones.
+  static Status ReadRangeTombstones(Rep* rep, const BlockHandle& handle);
+
   // Create the filter from the filter block.
   static FilterBlockReader* ReadFilter(const BlockHandle& filter_handle,
                                        Rep* rep, size_t* filter_size = nullptr);
@@ -26,10 +26,17 @@
 //     value: char[value_length]
 // shared_bytes == 0 for restart points.
 //
+// Blocks built with use_value_delta_encoding leave out value_length: their
+// values must be self-delimiting. An entry with shared_bytes == 0 stores the
+// full value, any other entry the delta value that was added with it.
+//
 // The trailer of the block has the form:
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+// Data blocks built with use_data_block_hash_index carry a hash map from user
+// keys to restart intervals between the restart array and num_restarts, see
+// table/data_block_hash_index.h.
 
 #include "table/block_builder.h"
 
@@ -42,12 +49,18 @@
 namespace rocksdb {
 
 BlockBuilder::BlockBuilder(int block_restart_interval,
-                           const Comparator* comparator)
+                           const Comparator* comparator,
+                           bool use_data_block_hash_index,
+                           double data_block_hash_table_util_ratio,
+                           bool use_value_delta_encoding)
     : block_restart_interval_(block_restart_interval),
       comparator_(comparator),
       restarts_(),
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      use_data_block_hash_index_(use_data_block_hash_index),
+      data_block_hash_index_builder_(data_block_hash_table_util_ratio),
+      use_value_delta_encoding_(use_value_delta_encoding) {
   assert(block_restart_interval_ >= 1);
   restarts_.push_back(0);       // First restart point is at offset 0
 }
@@ -62,11 +75,13 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  data_block_hash_index_builder_.Reset();
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
   return (buffer_.size() +                        // Raw data buffer
           restarts_.size() * sizeof(uint32_t) +   // Restart array
+          data_block_hash_index_builder_.EstimateSize() +  // Hash map
           sizeof(uint32_t));                      // Restart array length
 }
 
@@ -80,29 +95,40 @@ size_t BlockBuilder::EstimateSizeAfterKV(const Slice& key, const Slice& value)
 
   estimate += sizeof(int32_t); // varint for shared prefix length.
   estimate += VarintLength(key.size()); // varint for key length.
-  estimate += VarintLength(value.size()); // varint for value length.
+  if (!use_value_delta_encoding_) {
+    estimate += VarintLength(value.size()); // varint for value length.
+  }
 
   return estimate;
 }
 
 Slice BlockBuilder::Finish() {
+  const bool add_hash_index = use_data_block_hash_index_ && !buffer_.empty() &&
+                              data_block_hash_index_builder_.Valid();
   // Append restart array
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  uint32_t num_restarts = restarts_.size();
+  if (add_hash_index) {
+    data_block_hash_index_builder_.Finish(&buffer_);
+    num_restarts |= kDataBlockHashIndexFlag;
+  }
+  PutFixed32(&buffer_, num_restarts);
   finished_ = true;
   return Slice(buffer_);
 }
 
-void BlockBuilder::Add(const Slice& key, const Slice& value) {
+void BlockBuilder::Add(const Slice& key, const Slice& value,
+                       const Slice* delta_value) {
   Slice last_key_piece(last_key_);
   assert(!finished_);
   assert(counter_ <= block_restart_interval_);
   assert(buffer_.empty() // No values yet?
          || comparator_->Compare(key, last_key_piece) > 0);
   size_t shared = 0;
-  if (counter_ < block_restart_interval_) {
+  if (counter_ < block_restart_interval_ &&
+      (!use_value_delta_encoding_ || delta_value != nullptr)) {
     // See how much sharing to do with previous string
     const size_t min_length = std::min(last_key_piece.size(), key.size());
     while ((shared < min_length) && (last_key_piece[shared] == key[shared])) {
@@ -115,14 +141,29 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
-  // Add "<shared><non_shared><value_size>" to buffer_
-  PutVarint32(&buffer_, shared);
-  PutVarint32(&buffer_, non_shared);
-  PutVarint32(&buffer_, value.size());
+  if (use_value_delta_encoding_) {
+    // Add "<shared><non_shared>" to buffer_, followed by the string delta
+    // and the value, or its delta if the key is not stored in full
+    PutVarint32(&buffer_, shared);
+    PutVarint32(&buffer_, non_shared);
+    buffer_.append(key.data() + shared, non_shared);
+    const Slice& stored_value = shared == 0 ? value : *delta_value;
+    buffer_.append(stored_value.data(), stored_value.size());
+  } else {
+    // Add "<shared><non_shared><value_size>" to buffer_
+    PutVarint32(&buffer_, shared);
+    PutVarint32(&buffer_, non_shared);
+    PutVarint32(&buffer_, value.size());
+
+    // Add string delta to buffer_ followed by value
+    buffer_.append(key.data() + shared, non_shared);
+    buffer_.append(value.data(), value.size());
+  }
 
-  // Add string delta to buffer_ followed by value
-  buffer_.append(key.data() + shared, non_shared);
-  buffer_.append(value.data(), value.size());
+  if (use_data_block_hash_index_) {
+    data_block_hash_index_builder_.Add(ExtractUserKey(key),
+                                       restarts_.size() - 1);
+  }
 
   // Update state
   last_key_.resize(shared);
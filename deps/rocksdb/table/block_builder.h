@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include "rocksdb/slice.h"
+#include "table/data_block_hash_index.h"
 
 namespace rocksdb {
 
@@ -20,7 +21,15 @@ class Comparator;
 
 class BlockBuilder {
  public:
-  BlockBuilder(int block_builder, const Comparator* comparator);
+  // If use_data_block_hash_index is true, the keys must be internal keys and
+  // the block maps their user keys to their restart intervals, see
+  // table/data_block_hash_index.h.
+  // If use_value_delta_encoding is true, the values must be self-delimiting
+  // and the block does not store their lengths; see Add().
+  BlockBuilder(int block_restart_interval, const Comparator* comparator,
+               bool use_data_block_hash_index = false,
+               double data_block_hash_table_util_ratio = 0.75,
+               bool use_value_delta_encoding = false);
   explicit BlockBuilder(const Options& options, const Comparator* comparator);
 
   // Reset the contents as if the BlockBuilder was just constructed.
@@ -28,7 +37,12 @@ class BlockBuilder {
 
   // REQUIRES: Finish() has not been callled since the last call to Reset().
   // REQUIRES: key is larger than any previously added key
-  void Add(const Slice& key, const Slice& value);
+  // With use_value_delta_encoding, delta_value is stored instead of value if
+  // the key shares a prefix with the previous key, i.e. unless the entry is
+  // the first of its restart interval. It encodes the value relative to the
+  // previous one. A nullptr delta_value starts a new restart interval.
+  void Add(const Slice& key, const Slice& value,
+           const Slice* delta_value = nullptr);
 
   // Finish building the block and return a slice that refers to the
   // block contents.  The returned slice will remain valid for the
@@ -56,6 +70,9 @@ class BlockBuilder {
   int                   counter_;   // Number of entries emitted since restart
   bool                  finished_;  // Has Finish() been called?
   std::string           last_key_;
+  const bool            use_data_block_hash_index_;
+  DataBlockHashIndexBuilder data_block_hash_index_builder_;
+  const bool            use_value_delta_encoding_;
 
   // No copying allowed
   BlockBuilder(const BlockBuilder&);
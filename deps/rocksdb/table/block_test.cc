@@ -19,6 +19,8 @@
 #include "table/block_builder.h"
 #include "table/format.h"
 #include "table/block_hash_index.h"
+#include "table/data_block_hash_index.h"
+#include "util/coding.h"
 #include "util/random.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
@@ -235,6 +237,114 @@ TEST(BlockTest, IndexHashWithSharedPrefix) {
   CheckBlockContents(contents, kMaxKey, keys, values);
 }
 
+// Build a data block of internal keys with the data block hash index.
+BlockContents GetDataBlockContents(std::unique_ptr<BlockBuilder>* builder,
+                                   const std::vector<std::string>& keys,
+                                   const std::vector<std::string>& values,
+                                   const InternalKeyComparator* icmp,
+                                   int restart_interval) {
+  builder->reset(new BlockBuilder(restart_interval, icmp,
+                                  true /* use_data_block_hash_index */));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    (*builder)->Add(keys[i], values[i]);
+  }
+
+  BlockContents contents;
+  contents.data = (*builder)->Finish();
+  contents.cachable = false;
+  contents.heap_allocated = false;
+  return contents;
+}
+
+TEST(BlockTest, DataBlockHashIndex) {
+  InternalKeyComparator icmp(BytewiseComparator());
+  std::vector<std::string> user_keys;
+  std::vector<std::string> values;
+  // Even user keys are in the block, odd ones are not.
+  GenerateRandomKVs(&user_keys, &values, 0, 2000, 2 /* step */);
+  // Every user key has two versions, which may fall in different restart
+  // intervals.
+  std::vector<std::string> keys;
+  std::vector<std::string> versioned_values;
+  for (size_t i = 0; i < user_keys.size(); i++) {
+    keys.push_back(InternalKey(user_keys[i], 20, kTypeValue).Encode().ToString());
+    versioned_values.push_back(values[i]);
+    keys.push_back(InternalKey(user_keys[i], 10, kTypeValue).Encode().ToString());
+    versioned_values.push_back(values[i] + "_old");
+  }
+
+  std::unique_ptr<BlockBuilder> builder;
+  auto contents =
+      GetDataBlockContents(&builder, keys, versioned_values, &icmp, 8);
+  ASSERT_NE(0U, DecodeFixed32(contents.data.data() + contents.data.size() -
+                              sizeof(uint32_t)) & kDataBlockHashIndexFlag);
+  Block reader(contents);
+  ASSERT_EQ(keys.size() / 8, reader.NumRestarts());
+
+  std::unique_ptr<Iterator> iter(reader.NewIterator(&icmp, true));
+  for (size_t i = 0; i < user_keys.size(); i++) {
+    // The newest version at or before the snapshot.
+    iter->Seek(InternalKey(user_keys[i], 30, kValueTypeForSeek).Encode());
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(versioned_values[2 * i], iter->value().ToString());
+    iter->Seek(InternalKey(user_keys[i], 15, kValueTypeForSeek).Encode());
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(versioned_values[2 * i + 1], iter->value().ToString());
+    // All versions are newer than the snapshot.
+    iter->Seek(InternalKey(user_keys[i], 5, kValueTypeForSeek).Encode());
+    ASSERT_TRUE(!iter->Valid() ||
+                ExtractUserKey(iter->key()).compare(user_keys[i]) > 0);
+  }
+
+  // A user key that is not in the block never matches.
+  for (int i = 1; i < 4000; i += 2) {
+    const std::string user_key = GenerateKey(i, 0, 0, nullptr);
+    iter->Seek(InternalKey(user_key, 30, kValueTypeForSeek).Encode());
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(!iter->Valid() ||
+                ExtractUserKey(iter->key()).compare(user_key) > 0);
+  }
+
+  // Other iterators ignore the hash index.
+  iter.reset(reader.NewIterator(&icmp));
+  const std::string missing_user_key = GenerateKey(1, 0, 0, nullptr);
+  iter->Seek(InternalKey(missing_user_key, 30, kValueTypeForSeek).Encode());
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(keys[2], iter->key().ToString());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(keys[count++], iter->key().ToString());
+  }
+  ASSERT_EQ(static_cast<int>(keys.size()), count);
+}
+
+TEST(BlockTest, DataBlockHashIndexTooManyRestarts) {
+  InternalKeyComparator icmp(BytewiseComparator());
+  std::vector<std::string> user_keys;
+  std::vector<std::string> values;
+  GenerateRandomKVs(&user_keys, &values, 0, 300);
+  std::vector<std::string> keys;
+  for (const auto& user_key : user_keys) {
+    keys.push_back(InternalKey(user_key, 10, kTypeValue).Encode().ToString());
+  }
+
+  // 300 restart intervals cannot be indexed, so the block is written without
+  // the map and point lookups binary search it.
+  std::unique_ptr<BlockBuilder> builder;
+  auto contents = GetDataBlockContents(&builder, keys, values, &icmp, 1);
+  Block reader(contents);
+  ASSERT_EQ(300U, reader.NumRestarts());
+  ASSERT_EQ(300U, DecodeFixed32(contents.data.data() + contents.data.size() -
+                                sizeof(uint32_t)));
+  std::unique_ptr<Iterator> iter(reader.NewIterator(&icmp, true));
+  for (size_t i = 0; i < keys.size(); i++) {
+    iter->Seek(InternalKey(user_keys[i], 30, kValueTypeForSeek).Encode());
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(values[i], iter->value().ToString());
+  }
+}
+
 }  // namespace rocksdb
 
 int main(int argc, char** argv) {
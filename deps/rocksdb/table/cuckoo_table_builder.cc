@@ -0,0 +1,406 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef ROCKSDB_LITE
+#include "table/cuckoo_table_builder.h"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_set>
+
+#include "rocksdb/comparator.h"
+#include "rocksdb/env.h"
+#include "rocksdb/table.h"
+#include "table/cuckoo_table_factory.h"
+#include "table/format.h"
+#include "table/meta_blocks.h"
+
+namespace rocksdb {
+
+// kCuckooTableMagicNumber was picked by running
+//    echo rocksdb.table.cuckoo | sha1sum
+// and taking the leading 64 bits.
+extern const uint64_t kCuckooTableMagicNumber = 0x926789d0c5f17873ull;
+
+const std::string CuckooTablePropertyNames::kEmptyKey =
+    "rocksdb.cuckoo.bucket.empty.key";
+const std::string CuckooTablePropertyNames::kNumHashFunc =
+    "rocksdb.cuckoo.hash.num";
+const std::string CuckooTablePropertyNames::kHashTableSize =
+    "rocksdb.cuckoo.hash.size";
+const std::string CuckooTablePropertyNames::kValueLength =
+    "rocksdb.cuckoo.value.length";
+const std::string CuckooTablePropertyNames::kIsLastLevel =
+    "rocksdb.cuckoo.file.islastlevel";
+const std::string CuckooTablePropertyNames::kCuckooBlockSize =
+    "rocksdb.cuckoo.hash.cuckooblocksize";
+
+const uint64_t CuckooTableBuilder::kEmptyBucket;
+
+CuckooTableBuilder::CuckooTableBuilder(
+    const Options& options, const InternalKeyComparator& internal_comparator,
+    WritableFile* file, double hash_table_ratio, uint32_t max_search_depth,
+    uint32_t cuckoo_block_size, const TableFactory* fallback_factory,
+    CompressionType compression_type)
+    : options_(options),
+      internal_comparator_(internal_comparator),
+      user_comparator_(internal_comparator.user_comparator()),
+      file_(file),
+      hash_table_ratio_(hash_table_ratio),
+      max_search_depth_(max_search_depth),
+      cuckoo_block_size_(std::max(1U, cuckoo_block_size)),
+      fallback_factory_(fallback_factory),
+      compression_type_(compression_type) {
+  if (strcmp(user_comparator_->Name(), BytewiseComparator()->Name()) != 0) {
+    status_ = Status::NotSupported("Cuckoo table requires the bytewise "
+                                   "comparator");
+  } else if (hash_table_ratio <= 0 || hash_table_ratio > 1) {
+    status_ = Status::InvalidArgument("Cuckoo table hash_table_ratio must be "
+                                      "in (0, 1]");
+  }
+
+  int64_t creation_time = 0;
+  if (options.env->GetCurrentTime(&creation_time).ok()) {
+    properties_.creation_time = creation_time;
+  }
+  // The hash table is one big block without index or filter.
+  properties_.num_data_blocks = 1;
+  properties_.index_size = 0;
+  properties_.filter_size = 0;
+
+  for (auto& collector_factories :
+       options.table_properties_collector_factories) {
+    table_properties_collectors_.emplace_back(
+        collector_factories->CreateTablePropertiesCollector());
+  }
+}
+
+bool CuckooTableBuilder::CanAdd(const ParsedInternalKey& ikey,
+                                const Slice& value) const {
+  if (ikey.type != kTypeValue && ikey.type != kTypeDeletion) {
+    return false;
+  }
+  if (!kvs_.empty() &&
+      (ikey.user_key.size() != properties_.fixed_key_len ||
+       ikey.user_key == GetUserKey(kvs_.size() - 1))) {
+    return false;
+  }
+  return ikey.type != kTypeValue || !has_value_length_ ||
+         value.size() == value_length_;
+}
+
+void CuckooTableBuilder::StartFallback(const char* reason) {
+  Log(options_.info_log,
+      "Cuckoo table: %s, writing the file with %s instead", reason,
+      fallback_factory_->Name());
+  fallback_.reset(fallback_factory_->NewTableBuilder(
+      options_, internal_comparator_, file_, compression_type_));
+  for (const auto& kv : kvs_) {
+    fallback_->Add(kv.first, kv.second);
+  }
+  kvs_.clear();
+  kvs_.shrink_to_fit();
+}
+
+void CuckooTableBuilder::Add(const Slice& key, const Slice& value) {
+  assert(!closed_);
+  if (fallback_ != nullptr) {
+    fallback_->Add(key, value);
+    return;
+  }
+  if (!status_.ok()) {
+    return;
+  }
+  ParsedInternalKey ikey;
+  if (!ParseInternalKey(key, &ikey)) {
+    status_ = Status::Corruption("Unable to parse key into internal key.");
+    return;
+  }
+  if (!CanAdd(ikey, value)) {
+    StartFallback("entries of different lengths, several entries of a user "
+                  "key or merge operands");
+    fallback_->Add(key, value);
+    return;
+  }
+  if (ikey.type == kTypeValue && !has_value_length_) {
+    has_value_length_ = true;
+    value_length_ = value.size();
+  }
+  if (ikey.sequence != 0 || ikey.type != kTypeValue) {
+    is_last_level_ = false;
+  }
+
+  properties_.fixed_key_len = ikey.user_key.size();
+  properties_.num_entries++;
+  properties_.raw_key_size += key.size();
+  properties_.raw_value_size += value.size();
+  kvs_.emplace_back(key.ToString(), value.ToString());
+
+  NotifyCollectTableCollectorsOnAdd(key, value, table_properties_collectors_,
+                                    options_.info_log.get());
+}
+
+bool CuckooTableBuilder::MakeHashTable() {
+  buckets_.assign(hash_table_size_ + cuckoo_block_size_ - 1, kEmptyBucket);
+  std::vector<uint64_t> hash_vals(num_hash_func_);
+  for (uint64_t kv_idx = 0; kv_idx < kvs_.size(); kv_idx++) {
+    const Slice user_key = GetUserKey(kv_idx);
+    uint64_t bucket_id = kEmptyBucket;
+    for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; hash_cnt++) {
+      hash_vals[hash_cnt] = CuckooHash(user_key, hash_cnt, hash_table_size_);
+      for (uint32_t block_idx = 0;
+           bucket_id == kEmptyBucket && block_idx < cuckoo_block_size_;
+           block_idx++) {
+        if (buckets_[hash_vals[hash_cnt] + block_idx] == kEmptyBucket) {
+          bucket_id = hash_vals[hash_cnt] + block_idx;
+        }
+      }
+    }
+    if (bucket_id == kEmptyBucket &&
+        !MakeSpaceForKey(hash_vals, &bucket_id)) {
+      return false;
+    }
+    buckets_[bucket_id] = kv_idx;
+  }
+  return true;
+}
+
+bool CuckooTableBuilder::MakeSpaceForKey(
+    const std::vector<uint64_t>& hash_vals, uint64_t* bucket_id) {
+  // Breadth first search from the buckets of the new key. Every node is a
+  // full bucket whose entry could move to one of the buckets of its children.
+  struct CuckooNode {
+    uint64_t bucket_id;
+    uint32_t depth;
+    size_t parent_pos;
+  };
+  std::vector<CuckooNode> tree;
+  std::unordered_set<uint64_t> visited;
+  for (uint64_t hash_val : hash_vals) {
+    for (uint32_t block_idx = 0; block_idx < cuckoo_block_size_; block_idx++) {
+      if (visited.insert(hash_val + block_idx).second) {
+        tree.push_back(CuckooNode{hash_val + block_idx, 0, 0});
+      }
+    }
+  }
+  for (size_t pos = 0; pos < tree.size(); pos++) {
+    if (tree[pos].depth >= max_search_depth_) {
+      break;
+    }
+    const Slice user_key = GetUserKey(buckets_[tree[pos].bucket_id]);
+    for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; hash_cnt++) {
+      const uint64_t hash_val =
+          CuckooHash(user_key, hash_cnt, hash_table_size_);
+      for (uint32_t block_idx = 0; block_idx < cuckoo_block_size_;
+           block_idx++) {
+        const uint64_t child_id = hash_val + block_idx;
+        if (!visited.insert(child_id).second) {
+          continue;
+        }
+        tree.push_back(CuckooNode{child_id, tree[pos].depth + 1, pos});
+        if (buckets_[child_id] != kEmptyBucket) {
+          continue;
+        }
+        // Move every entry on the path one step towards the empty bucket.
+        size_t curr = tree.size() - 1;
+        while (tree[curr].depth > 0) {
+          const size_t parent = tree[curr].parent_pos;
+          buckets_[tree[curr].bucket_id] = buckets_[tree[parent].bucket_id];
+          curr = parent;
+        }
+        *bucket_id = tree[curr].bucket_id;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool CuckooTableBuilder::GetUnusedKey(std::string* unused_user_key) const {
+  // The entries are sorted, so a key before the first or after the last
+  // user key is not used.
+  std::string key = GetUserKey(0).ToString();
+  for (size_t i = key.size(); i > 0; i--) {
+    if (key[i - 1] != '\0') {
+      key[i - 1]--;
+      for (size_t j = i; j < key.size(); j++) {
+        key[j] = '\xff';
+      }
+      *unused_user_key = key;
+      return true;
+    }
+  }
+  key = GetUserKey(kvs_.size() - 1).ToString();
+  for (size_t i = key.size(); i > 0; i--) {
+    if (key[i - 1] != '\xff') {
+      key[i - 1]++;
+      for (size_t j = i; j < key.size(); j++) {
+        key[j] = '\0';
+      }
+      *unused_user_key = key;
+      return true;
+    }
+  }
+  return false;
+}
+
+Status CuckooTableBuilder::Finish() {
+  assert(!closed_);
+  closed_ = true;
+  if (fallback_ != nullptr) {
+    return fallback_->Finish();
+  }
+  if (!status_.ok()) {
+    return status_;
+  }
+
+  std::string unused_user_key;
+  if (!kvs_.empty()) {
+    if (!GetUnusedKey(&unused_user_key)) {
+      StartFallback("no unused key to mark empty buckets");
+      return fallback_->Finish();
+    }
+    hash_table_size_ = std::max<uint64_t>(
+        1, static_cast<uint64_t>(kvs_.size() / hash_table_ratio_));
+    num_hash_func_ = 2;
+    while (!MakeHashTable()) {
+      if (++num_hash_func_ > kMaxNumHashFunc) {
+        buckets_.clear();
+        StartFallback("too many collisions");
+        return fallback_->Finish();
+      }
+    }
+  }
+
+  // Write the buckets.
+  std::string empty_key;
+  if (is_last_level_) {
+    empty_key = unused_user_key;
+  } else {
+    AppendInternalKey(&empty_key,
+                      ParsedInternalKey(unused_user_key, 0, kTypeValue));
+  }
+  const std::string zero_value(value_length_, '\0');
+  std::string bucket;
+  Status s;
+  for (uint64_t bucket_id = 0; s.ok() && bucket_id < buckets_.size();
+       bucket_id++) {
+    const uint64_t kv_idx = buckets_[bucket_id];
+    bucket.clear();
+    if (kv_idx == kEmptyBucket) {
+      bucket.append(empty_key);
+      bucket.append(zero_value);
+    } else {
+      const std::string& key = kvs_[kv_idx].first;
+      if (is_last_level_) {
+        bucket.append(key.data(), key.size() - 8);
+      } else {
+        bucket.append(key);
+      }
+      const std::string& value = kvs_[kv_idx].second;
+      bucket.append(value.empty() ? zero_value : value);
+    }
+    s = file_->Append(bucket);
+    if (s.ok()) {
+      offset_ += bucket.size();
+    }
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  properties_.data_size = offset_;
+
+  // Write the following blocks
+  //  1. [meta block: properties]
+  //  2. [metaindex block]
+  //  3. [footer]
+  MetaIndexBuilder meta_index_builder;
+
+  PropertyBlockBuilder property_block_builder;
+  property_block_builder.AddTableProperty(properties_);
+  property_block_builder.Add(CuckooTablePropertyNames::kEmptyKey,
+                             unused_user_key);
+  property_block_builder.Add(CuckooTablePropertyNames::kNumHashFunc,
+                             num_hash_func_);
+  property_block_builder.Add(CuckooTablePropertyNames::kHashTableSize,
+                             hash_table_size_);
+  property_block_builder.Add(CuckooTablePropertyNames::kValueLength,
+                             value_length_);
+  property_block_builder.Add(CuckooTablePropertyNames::kIsLastLevel,
+                             is_last_level_ ? 1 : 0);
+  property_block_builder.Add(CuckooTablePropertyNames::kCuckooBlockSize,
+                             cuckoo_block_size_);
+  NotifyCollectTableCollectorsOnFinish(table_properties_collectors_,
+                                       options_.info_log.get(),
+                                       &property_block_builder);
+
+  BlockHandle property_block_handle;
+  property_block_handle.set_offset(offset_);
+  Slice property_block = property_block_builder.Finish();
+  property_block_handle.set_size(property_block.size());
+  s = file_->Append(property_block);
+  if (!s.ok()) {
+    return s;
+  }
+  offset_ += property_block.size();
+  meta_index_builder.Add(kPropertiesBlock, property_block_handle);
+
+  BlockHandle metaindex_block_handle;
+  metaindex_block_handle.set_offset(offset_);
+  Slice metaindex_block = meta_index_builder.Finish();
+  metaindex_block_handle.set_size(metaindex_block.size());
+  s = file_->Append(metaindex_block);
+  if (!s.ok()) {
+    return s;
+  }
+  offset_ += metaindex_block.size();
+
+  Footer footer(kCuckooTableMagicNumber);
+  footer.set_metaindex_handle(metaindex_block_handle);
+  footer.set_index_handle(BlockHandle::NullBlockHandle());
+  std::string footer_encoding;
+  footer.EncodeTo(&footer_encoding);
+  s = file_->Append(footer_encoding);
+  if (s.ok()) {
+    offset_ += footer_encoding.size();
+  }
+  return s;
+}
+
+void CuckooTableBuilder::Abandon() {
+  assert(!closed_);
+  closed_ = true;
+  if (fallback_ != nullptr) {
+    fallback_->Abandon();
+  }
+}
+
+uint64_t CuckooTableBuilder::FileSize() const {
+  if (fallback_ != nullptr) {
+    return fallback_->FileSize();
+  }
+  if (closed_) {
+    return offset_;
+  }
+  return static_cast<uint64_t>(
+      (properties_.raw_key_size + properties_.raw_value_size) /
+      hash_table_ratio_);
+}
+
+bool CuckooTableBuilder::NeedCompact() const {
+  if (fallback_ != nullptr) {
+    return fallback_->NeedCompact();
+  }
+  for (const auto& collector : table_properties_collectors_) {
+    if (collector->NeedCompact()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
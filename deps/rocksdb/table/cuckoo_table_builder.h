@@ -0,0 +1,145 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+#ifndef ROCKSDB_LITE
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "db/dbformat.h"
+#include "rocksdb/options.h"
+#include "rocksdb/status.h"
+#include "rocksdb/table_properties.h"
+#include "table/table_builder.h"
+
+namespace rocksdb {
+
+class TableFactory;
+class WritableFile;
+
+// Builds a cuckoo table, see the file format in cuckoo_table_factory.h. The
+// entries are kept in memory until Finish(), which places them in the hash
+// table and writes the file. If the entries cannot be stored in a cuckoo
+// table, the file is written with a builder of "fallback_factory" instead,
+// which is given compression_type.
+class CuckooTableBuilder: public TableBuilder {
+ public:
+  // Create a builder that will store the contents of the table it is
+  // building in *file.  Does not close the file.  It is up to the
+  // caller to close the file after calling Finish().
+  CuckooTableBuilder(const Options& options,
+                     const InternalKeyComparator& internal_comparator,
+                     WritableFile* file, double hash_table_ratio,
+                     uint32_t max_search_depth, uint32_t cuckoo_block_size,
+                     const TableFactory* fallback_factory,
+                     CompressionType compression_type);
+
+  // REQUIRES: Either Finish() or Abandon() has been called.
+  ~CuckooTableBuilder() {}
+
+  // Add key,value to the table being constructed. If the key or the value
+  // does not have the same length as the previous ones, the user key was
+  // already added or the entry is neither a value nor a deletion, this and
+  // all other entries go to the fallback builder.
+  // REQUIRES: key is after any previously added key according to comparator.
+  // REQUIRES: Finish(), Abandon() have not been called
+  void Add(const Slice& key, const Slice& value) override;
+
+  // Return non-ok iff some error has been detected.
+  Status status() const override {
+    return fallback_ != nullptr ? fallback_->status() : status_;
+  }
+
+  // Finish building the table.  Stops using the file passed to the
+  // constructor after this function returns.
+  // REQUIRES: Finish(), Abandon() have not been called
+  Status Finish() override;
+
+  // Indicate that the contents of this builder should be abandoned.  Stops
+  // using the file passed to the constructor after this function returns.
+  // If the caller is not going to call Finish(), it must call Abandon()
+  // before destroying this builder.
+  // REQUIRES: Finish(), Abandon() have not been called
+  void Abandon() override;
+
+  // Number of calls to Add() so far.
+  uint64_t NumEntries() const override {
+    return fallback_ != nullptr ? fallback_->NumEntries() : kvs_.size();
+  }
+
+  // Before Finish(), an estimate of the size of the file.
+  uint64_t FileSize() const override;
+
+  bool NeedCompact() const override;
+
+ private:
+  static const uint64_t kEmptyBucket = ~static_cast<uint64_t>(0);
+  static const uint32_t kMaxNumHashFunc = 64;
+
+  // Place all entries in buckets_ with num_hash_func_ hash functions.
+  // Returns false if some entry could not be placed.
+  bool MakeHashTable();
+
+  // Free one of the buckets of the blocks starting at "hash_vals" by moving
+  // the entries along a path of at most max_search_depth_ displacements.
+  // On success, stores the freed bucket in *bucket_id.
+  bool MakeSpaceForKey(const std::vector<uint64_t>& hash_vals,
+                       uint64_t* bucket_id);
+
+  // Find a key of the length of the user keys that is not used by any entry.
+  bool GetUnusedKey(std::string* unused_user_key) const;
+
+  Slice GetUserKey(uint64_t kv_idx) const {
+    return ExtractUserKey(kvs_[kv_idx].first);
+  }
+
+  // Whether the entry can be added to the cuckoo table
+  bool CanAdd(const ParsedInternalKey& ikey, const Slice& value) const;
+
+  // Create fallback_ and move the entries added so far to it.
+  void StartFallback(const char* reason);
+
+  Options options_;
+  std::vector<std::unique_ptr<TablePropertiesCollector>>
+      table_properties_collectors_;
+  const InternalKeyComparator& internal_comparator_;
+  const Comparator* const user_comparator_;
+  WritableFile* file_;
+  const double hash_table_ratio_;
+  const uint32_t max_search_depth_;
+  const uint32_t cuckoo_block_size_;
+  Status status_;
+  TableProperties properties_;
+  uint64_t offset_ = 0;
+  bool closed_ = false;  // Either Finish() or Abandon() has been called.
+
+  // The added entries, as internal keys and values
+  std::vector<std::pair<std::string, std::string>> kvs_;
+  // Whether all entries are values with sequence number 0
+  bool is_last_level_ = true;
+  // The length of the values that are not deletions, once one was added
+  bool has_value_length_ = false;
+  size_t value_length_ = 0;
+
+  uint32_t num_hash_func_ = 0;
+  uint64_t hash_table_size_ = 0;
+  // The index in kvs_ of the entry in every bucket, or kEmptyBucket
+  std::vector<uint64_t> buckets_;
+
+  const TableFactory* const fallback_factory_;
+  const CompressionType compression_type_;
+  // Set once the entries turned out not to fit in a cuckoo table; all calls
+  // are forwarded to it from then on.
+  std::unique_ptr<TableBuilder> fallback_;
+
+  // No copying allowed
+  CuckooTableBuilder(const CuckooTableBuilder&) = delete;
+  void operator=(const CuckooTableBuilder&) = delete;
+};
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
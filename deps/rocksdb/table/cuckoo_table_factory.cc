@@ -0,0 +1,56 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef ROCKSDB_LITE
+#include "table/cuckoo_table_factory.h"
+
+#include "db/dbformat.h"
+#include "table/cuckoo_table_builder.h"
+#include "table/cuckoo_table_reader.h"
+#include "table/format.h"
+
+namespace rocksdb {
+
+extern const uint64_t kBlockBasedTableMagicNumber;
+
+Status CuckooTableFactory::NewTableReader(const Options& options,
+                                          const EnvOptions& soptions,
+                                          const InternalKeyComparator& icomp,
+                                          unique_ptr<RandomAccessFile>&& file,
+                                          uint64_t file_size,
+                                          unique_ptr<TableReader>* table) const {
+  Footer footer;
+  Status s = ReadFooterFromFile(file.get(), file_size, &footer);
+  if (!s.ok()) {
+    return s;
+  }
+  if (footer.table_magic_number() == kBlockBasedTableMagicNumber) {
+    // Written by the fallback builder
+    return fallback_factory_->NewTableReader(options, soptions, icomp,
+                                             std::move(file), file_size,
+                                             table);
+  }
+  return CuckooTableReader::Open(options, soptions, icomp, std::move(file),
+                                 file_size, table);
+}
+
+TableBuilder* CuckooTableFactory::NewTableBuilder(
+    const Options& options, const InternalKeyComparator& internal_comparator,
+    WritableFile* file, CompressionType compression_type) const {
+  return new CuckooTableBuilder(options, internal_comparator, file,
+                                hash_table_ratio_, max_search_depth_,
+                                cuckoo_block_size_, fallback_factory_.get(),
+                                compression_type);
+}
+
+extern TableFactory* NewCuckooTableFactory(double hash_table_ratio,
+                                           uint32_t max_search_depth,
+                                           uint32_t cuckoo_block_size) {
+  return new CuckooTableFactory(hash_table_ratio, max_search_depth,
+                                cuckoo_block_size);
+}
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,82 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#ifndef ROCKSDB_LITE
+#include <stdint.h>
+#include <memory>
+
+#include "rocksdb/table.h"
+#include "util/hash.h"
+
+namespace rocksdb {
+
+const uint32_t kCuckooMurmurSeedMultiplier = 816922183;
+
+// The bucket of the hash table that "user_key" maps to with the hash
+// function number "hash_cnt".
+static inline uint64_t CuckooHash(const Slice& user_key, uint32_t hash_cnt,
+                                  uint64_t table_size) {
+  return Hash(user_key.data(), user_key.size(),
+              kCuckooMurmurSeedMultiplier * hash_cnt) % table_size;
+}
+
+// Cuckoo table file format:
+// +-----------------------------------+  <= offset 0
+// | key 0          | value 0          |
+// +-----------------------------------+
+// | key 1          | value 1          |
+// +-----------------------------------+
+// |        ......                     |
+// +-----------------------------------+  <= (table size + block size - 1)
+// | [meta block: properties]          |     buckets
+// | [metaindex block]                 |
+// | [footer]                          |
+// +-----------------------------------+
+// Every bucket has the same size. A key is stored in one of the
+// cuckoo_block_size buckets that start at each of its num_hash_func hash
+// values, so the trailing cuckoo_block_size - 1 buckets let the blocks of
+// the last hash values run past the end of the table. Empty buckets hold the
+// key CuckooTablePropertyNames::kEmptyKey, which is not used by any entry.
+// If all entries are values with sequence number 0, the buckets hold user
+// keys; otherwise they hold internal keys. The values of deletions are
+// zero-filled.
+//
+// Files whose entries cannot be stored in a cuckoo table are written as
+// block-based tables with the default BlockBasedTableOptions instead, and
+// the reader tells them apart by the magic number of their footer.
+class CuckooTableFactory : public TableFactory {
+ public:
+  CuckooTableFactory(double hash_table_ratio, uint32_t max_search_depth,
+                     uint32_t cuckoo_block_size)
+      : hash_table_ratio_(hash_table_ratio),
+        max_search_depth_(max_search_depth),
+        cuckoo_block_size_(cuckoo_block_size),
+        fallback_factory_(NewBlockBasedTableFactory()) {}
+  ~CuckooTableFactory() {}
+
+  const char* Name() const override { return "CuckooTable"; }
+
+  Status NewTableReader(const Options& options, const EnvOptions& soptions,
+                        const InternalKeyComparator& internal_comparator,
+                        unique_ptr<RandomAccessFile>&& file, uint64_t file_size,
+                        unique_ptr<TableReader>* table) const override;
+
+  TableBuilder* NewTableBuilder(const Options& options,
+                                const InternalKeyComparator& icomparator,
+                                WritableFile* file,
+                                CompressionType compression_type) const
+      override;
+
+ private:
+  const double hash_table_ratio_;
+  const uint32_t max_search_depth_;
+  const uint32_t cuckoo_block_size_;
+  const std::unique_ptr<TableFactory> fallback_factory_;
+};
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
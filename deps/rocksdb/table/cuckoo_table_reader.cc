@@ -0,0 +1,294 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef ROCKSDB_LITE
+#include "table/cuckoo_table_reader.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "rocksdb/comparator.h"
+#include "rocksdb/iterator.h"
+#include "rocksdb/table.h"
+#include "table/cuckoo_table_factory.h"
+#include "table/meta_blocks.h"
+#include "util/coding.h"
+
+namespace rocksdb {
+
+extern const uint64_t kCuckooTableMagicNumber;
+
+CuckooTableReader::CuckooTableReader(
+    const InternalKeyComparator& internal_comparator,
+    unique_ptr<RandomAccessFile>&& file,
+    const TableProperties* table_properties)
+    : file_(std::move(file)),
+      internal_comparator_(internal_comparator),
+      table_properties_(table_properties) {}
+
+Status CuckooTableReader::Open(const Options& options,
+                               const EnvOptions& soptions,
+                               const InternalKeyComparator& internal_comparator,
+                               unique_ptr<RandomAccessFile>&& file,
+                               uint64_t file_size,
+                               unique_ptr<TableReader>* table_reader) {
+  if (!options.allow_mmap_reads || !file->ReadsInPlace()) {
+    // The buckets are used straight from the mapping of the file.
+    return Status::NotSupported("Cuckoo table requires allow_mmap_reads");
+  }
+  if (strcmp(internal_comparator.user_comparator()->Name(),
+             BytewiseComparator()->Name()) != 0) {
+    return Status::NotSupported("Cuckoo table requires the bytewise "
+                                "comparator");
+  }
+
+  TableProperties* props = nullptr;
+  Status s = ReadTableProperties(file.get(), file_size,
+                                 kCuckooTableMagicNumber, options.env,
+                                 options.info_log.get(), &props);
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::unique_ptr<CuckooTableReader> new_reader(
+      new CuckooTableReader(internal_comparator, std::move(file), props));
+  s = new_reader->Init();
+  if (s.ok()) {
+    *table_reader = std::move(new_reader);
+  }
+  return s;
+}
+
+Status CuckooTableReader::Init() {
+  const UserCollectedProperties& user_props =
+      table_properties_->user_collected_properties;
+  auto get_property = [&user_props](const std::string& name, uint64_t* val) {
+    auto it = user_props.find(name);
+    if (it == user_props.end()) {
+      return false;
+    }
+    Slice raw_val(it->second);
+    return GetVarint64(&raw_val, val);
+  };
+
+  auto empty_key = user_props.find(CuckooTablePropertyNames::kEmptyKey);
+  uint64_t num_hash_func, hash_table_size, value_length, is_last_level,
+      cuckoo_block_size;
+  if (empty_key == user_props.end() ||
+      !get_property(CuckooTablePropertyNames::kNumHashFunc, &num_hash_func) ||
+      !get_property(CuckooTablePropertyNames::kHashTableSize,
+                    &hash_table_size) ||
+      !get_property(CuckooTablePropertyNames::kValueLength, &value_length) ||
+      !get_property(CuckooTablePropertyNames::kIsLastLevel, &is_last_level) ||
+      !get_property(CuckooTablePropertyNames::kCuckooBlockSize,
+                    &cuckoo_block_size)) {
+    return Status::Corruption("Cuckoo table properties are missing");
+  }
+  unused_key_ = empty_key->second;
+  num_hash_func_ = num_hash_func;
+  hash_table_size_ = hash_table_size;
+  cuckoo_block_size_ = cuckoo_block_size;
+  is_last_level_ = is_last_level != 0;
+  user_key_length_ = table_properties_->fixed_key_len;
+  key_length_ = is_last_level_ ? user_key_length_ : user_key_length_ + 8;
+  value_length_ = value_length;
+  bucket_length_ = key_length_ + value_length_;
+  num_buckets_ =
+      hash_table_size_ == 0 ? 0 : hash_table_size_ + cuckoo_block_size_ - 1;
+  if (num_buckets_ * bucket_length_ != table_properties_->data_size ||
+      unused_key_.size() != user_key_length_) {
+    return Status::Corruption("Cuckoo table has an unexpected data size");
+  }
+
+  // The buckets are read in place from the mmapped file, see Open().
+  return file_->Read(0, table_properties_->data_size, &file_data_, nullptr);
+}
+
+Status CuckooTableReader::Get(
+    const ReadOptions& readOptions, const Slice& key, void* handle_context,
+    bool (*result_handler)(void* arg, const ParsedInternalKey& k,
+                           const Slice& v, bool didIO),
+    void (*mark_key_may_exist_handler)(void* handle_context)) {
+  assert(key.size() >= 8);
+  const Slice user_key = ExtractUserKey(key);
+  if (hash_table_size_ == 0 || user_key.size() != user_key_length_ ||
+      user_key == Slice(unused_key_)) {
+    return Status::OK();
+  }
+  for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; hash_cnt++) {
+    const char* bucket =
+        GetBucket(CuckooHash(user_key, hash_cnt, hash_table_size_));
+    for (uint32_t block_idx = 0; block_idx < cuckoo_block_size_;
+         block_idx++, bucket += bucket_length_) {
+      if (memcmp(bucket, user_key.data(), user_key_length_) != 0) {
+        continue;
+      }
+      const Slice value(bucket + key_length_, value_length_);
+      if (is_last_level_) {
+        result_handler(handle_context,
+                       ParsedInternalKey(user_key, 0, kTypeValue), value,
+                       false);
+        return Status::OK();
+      }
+      const Slice full_key(bucket, key_length_);
+      // The entry is newer than the snapshot of the lookup.
+      if (internal_comparator_.Compare(full_key, key) < 0) {
+        return Status::OK();
+      }
+      ParsedInternalKey found_ikey;
+      if (!ParseInternalKey(full_key, &found_ikey)) {
+        return Status::Corruption("Unable to parse key into internal key.");
+      }
+      result_handler(handle_context, found_ikey,
+                     found_ikey.type == kTypeDeletion ? Slice() : value,
+                     false);
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
+class CuckooTableIterator : public Iterator {
+ public:
+  explicit CuckooTableIterator(CuckooTableReader* reader)
+      : reader_(reader), loaded_(false), curr_key_idx_(0) {}
+  ~CuckooTableIterator() {}
+
+  bool Valid() const override {
+    return curr_key_idx_ < sorted_bucket_ids_.size();
+  }
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  void Seek(const Slice& target) override;
+  void Next() override;
+  void Prev() override;
+  Slice key() const override;
+  Slice value() const override;
+  Status status() const override { return Status::OK(); }
+
+ private:
+  // Collect the full buckets and sort them by key.
+  void LoadKeys();
+  // Set curr_key_ and curr_value_ for the bucket at curr_key_idx_.
+  void PrepareKVAtCurrIdx();
+
+  Slice GetUserKey(uint64_t bucket_id) const {
+    return Slice(reader_->GetBucket(bucket_id), reader_->user_key_length_);
+  }
+
+  CuckooTableReader* reader_;
+  bool loaded_;
+  std::vector<uint64_t> sorted_bucket_ids_;
+  size_t curr_key_idx_;
+  std::string curr_key_;
+  Slice curr_value_;
+
+  // No copying allowed
+  CuckooTableIterator(const CuckooTableIterator&) = delete;
+  void operator=(const CuckooTableIterator&) = delete;
+};
+
+void CuckooTableIterator::LoadKeys() {
+  if (loaded_) {
+    return;
+  }
+  loaded_ = true;
+  const Slice unused_key(reader_->unused_key_);
+  for (uint64_t bucket_id = 0; bucket_id < reader_->num_buckets_;
+       bucket_id++) {
+    if (GetUserKey(bucket_id) != unused_key) {
+      sorted_bucket_ids_.push_back(bucket_id);
+    }
+  }
+  // Every user key is stored once, so the user keys decide the order.
+  std::sort(sorted_bucket_ids_.begin(), sorted_bucket_ids_.end(),
+            [this](uint64_t a, uint64_t b) {
+    return GetUserKey(a).compare(GetUserKey(b)) < 0;
+  });
+}
+
+void CuckooTableIterator::SeekToFirst() {
+  LoadKeys();
+  curr_key_idx_ = 0;
+  PrepareKVAtCurrIdx();
+}
+
+void CuckooTableIterator::SeekToLast() {
+  LoadKeys();
+  curr_key_idx_ = sorted_bucket_ids_.empty() ? 0 : sorted_bucket_ids_.size() - 1;
+  PrepareKVAtCurrIdx();
+}
+
+void CuckooTableIterator::Seek(const Slice& target) {
+  LoadKeys();
+  const Slice target_user_key = ExtractUserKey(target);
+  auto it = std::lower_bound(sorted_bucket_ids_.begin(),
+                             sorted_bucket_ids_.end(), target_user_key,
+                             [this](uint64_t bucket_id, const Slice& user_key) {
+    return GetUserKey(bucket_id).compare(user_key) < 0;
+  });
+  curr_key_idx_ = it - sorted_bucket_ids_.begin();
+  PrepareKVAtCurrIdx();
+  if (Valid() && reader_->internal_comparator_.Compare(curr_key_, target) < 0) {
+    Next();
+  }
+}
+
+void CuckooTableIterator::Next() {
+  assert(Valid());
+  curr_key_idx_++;
+  PrepareKVAtCurrIdx();
+}
+
+void CuckooTableIterator::Prev() {
+  assert(Valid());
+  if (curr_key_idx_ == 0) {
+    curr_key_idx_ = sorted_bucket_ids_.size();
+  } else {
+    curr_key_idx_--;
+  }
+  PrepareKVAtCurrIdx();
+}
+
+void CuckooTableIterator::PrepareKVAtCurrIdx() {
+  if (!Valid()) {
+    curr_key_.clear();
+    curr_value_.clear();
+    return;
+  }
+  const char* bucket = reader_->GetBucket(sorted_bucket_ids_[curr_key_idx_]);
+  if (reader_->is_last_level_) {
+    curr_key_.clear();
+    AppendInternalKey(
+        &curr_key_,
+        ParsedInternalKey(Slice(bucket, reader_->user_key_length_), 0,
+                          kTypeValue));
+  } else {
+    curr_key_.assign(bucket, reader_->key_length_);
+  }
+  if (ExtractValueType(curr_key_) == kTypeDeletion) {
+    curr_value_.clear();
+  } else {
+    curr_value_ = Slice(bucket + reader_->key_length_, reader_->value_length_);
+  }
+}
+
+Slice CuckooTableIterator::key() const {
+  assert(Valid());
+  return Slice(curr_key_);
+}
+
+Slice CuckooTableIterator::value() const {
+  assert(Valid());
+  return curr_value_;
+}
+
+Iterator* CuckooTableReader::NewIterator(const ReadOptions& options) {
+  return new CuckooTableIterator(this);
+}
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
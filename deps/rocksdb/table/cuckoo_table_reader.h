@@ -0,0 +1,88 @@
+//  Copyright (c) 2013, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+#ifndef ROCKSDB_LITE
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include "db/dbformat.h"
+#include "rocksdb/env.h"
+#include "rocksdb/options.h"
+#include "table/table_reader.h"
+
+namespace rocksdb {
+
+class TableReader;
+
+// Reads a cuckoo table, see the file format in cuckoo_table_factory.h.
+// Requires the file to be mmapped.
+class CuckooTableReader: public TableReader {
+ public:
+  static Status Open(const Options& options, const EnvOptions& soptions,
+                     const InternalKeyComparator& internal_comparator,
+                     unique_ptr<RandomAccessFile>&& file, uint64_t file_size,
+                     unique_ptr<TableReader>* table_reader);
+
+  // The iterator sorts the keys of the table when it is first positioned.
+  Iterator* NewIterator(const ReadOptions&) override;
+
+  Status Get(const ReadOptions& readOptions, const Slice& key,
+             void* handle_context,
+             bool (*result_handler)(void* arg, const ParsedInternalKey& k,
+                                    const Slice& v, bool didIO),
+             void (*mark_key_may_exist_handler)(void* handle_context) =
+                 nullptr) override;
+
+  // The entries are not stored in key order.
+  uint64_t ApproximateOffsetOf(const Slice& key) override { return 0; }
+
+  void SetupForCompaction() override {}
+
+  std::shared_ptr<const TableProperties> GetTableProperties() const override {
+    return table_properties_;
+  }
+
+  ~CuckooTableReader() {}
+
+ private:
+  friend class CuckooTableIterator;
+
+  CuckooTableReader(const InternalKeyComparator& internal_comparator,
+                    unique_ptr<RandomAccessFile>&& file,
+                    const TableProperties* table_properties);
+
+  // Parse the cuckoo table properties and map the buckets.
+  Status Init();
+
+  const char* GetBucket(uint64_t bucket_id) const {
+    return file_data_.data() + bucket_id * bucket_length_;
+  }
+
+  unique_ptr<RandomAccessFile> file_;
+  const InternalKeyComparator internal_comparator_;
+  std::shared_ptr<const TableProperties> table_properties_;
+
+  Slice file_data_;
+  std::string unused_key_;
+  bool is_last_level_;
+  uint32_t num_hash_func_;
+  uint64_t hash_table_size_;
+  uint32_t cuckoo_block_size_;
+  uint64_t num_buckets_;
+  // The length of the keys stored in the buckets
+  uint32_t key_length_;
+  uint32_t user_key_length_;
+  uint32_t value_length_;
+  uint32_t bucket_length_;
+
+  // No copying allowed
+  explicit CuckooTableReader(const TableReader&) = delete;
+  void operator=(const TableReader&) = delete;
+};
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
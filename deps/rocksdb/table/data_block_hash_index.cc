@@ -0,0 +1,94 @@
+// Copyright (c) 2013, Facebook, Inc. All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "table/data_block_hash_index.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace rocksdb {
+
+namespace {
+const uint32_t kHashSeed = 397;
+
+uint32_t HashUserKey(const Slice& user_key) {
+  return Hash(user_key.data(), user_key.size(), kHashSeed);
+}
+}  // namespace
+
+void DataBlockHashIndexBuilder::Add(const Slice& user_key,
+                                    uint32_t restart_index) {
+  if (restart_index >= kMaxRestartSupportedByHashIndex) {
+    valid_ = false;
+    return;
+  }
+  hash_and_restart_pairs_.emplace_back(HashUserKey(user_key),
+                                       static_cast<uint8_t>(restart_index));
+}
+
+uint32_t DataBlockHashIndexBuilder::NumBuckets() const {
+  uint32_t num_buckets =
+      static_cast<uint32_t>(hash_and_restart_pairs_.size() / util_ratio_);
+  // An odd number of buckets spreads hashes with common low bits better.
+  return std::max(num_buckets, 1u) | 1;
+}
+
+void DataBlockHashIndexBuilder::Finish(std::string* buffer) {
+  assert(valid_ && !hash_and_restart_pairs_.empty());
+  const uint32_t num_buckets = NumBuckets();
+  std::vector<uint8_t> buckets(num_buckets, kNoEntry);
+  for (const auto& pair : hash_and_restart_pairs_) {
+    uint8_t& bucket = buckets[pair.first % num_buckets];
+    if (bucket == kNoEntry) {
+      bucket = pair.second;
+    } else if (bucket != pair.second) {
+      bucket = kCollision;
+    }
+  }
+  buffer->append(reinterpret_cast<const char*>(buckets.data()), num_buckets);
+  PutFixed32(buffer, num_buckets);
+}
+
+size_t DataBlockHashIndexBuilder::EstimateSize() const {
+  if (!valid_ || hash_and_restart_pairs_.empty()) {
+    return 0;
+  }
+  return NumBuckets() + sizeof(uint32_t);
+}
+
+void DataBlockHashIndexBuilder::Reset() {
+  valid_ = true;
+  hash_and_restart_pairs_.clear();
+}
+
+bool DataBlockHashIndex::Initialize(const char* data, size_t size,
+                                    uint32_t num_restarts,
+                                    uint32_t* restart_offset) {
+  // The block ends with num_buckets and the num_restarts word.
+  if (size < 2 * sizeof(uint32_t)) {
+    return false;
+  }
+  const size_t map_end = size - 2 * sizeof(uint32_t);
+  num_buckets_ = DecodeFixed32(data + map_end);
+  if (num_buckets_ == 0 || num_buckets_ > map_end ||
+      num_restarts > (map_end - num_buckets_) / sizeof(uint32_t)) {
+    return false;
+  }
+  buckets_ = data + map_end - num_buckets_;
+  *restart_offset = static_cast<uint32_t>(map_end - num_buckets_ -
+                                          num_restarts * sizeof(uint32_t));
+  return true;
+}
+
+uint8_t DataBlockHashIndex::Lookup(const Slice& user_key) const {
+  assert(buckets_ != nullptr);
+  return static_cast<uint8_t>(
+      buckets_[HashUserKey(user_key) % num_buckets_]);
+}
+
+}  // namespace rocksdb
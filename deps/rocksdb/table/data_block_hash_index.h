@@ -0,0 +1,92 @@
+// Copyright (c) 2013, Facebook, Inc. All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/slice.h"
+
+namespace rocksdb {
+
+// A hash map from the user keys of a data block to the restart interval that
+// holds them, appended to the block by BlockBuilder. A point lookup hashes
+// its user key to a bucket and scans only the restart interval in it, instead
+// of binary searching the restart array.
+//
+// The map follows the restart array of the block:
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint32
+//     num_restarts | (1 << 31): uint32
+// The high bit of the last word tells the map is present; blocks without it
+// keep the plain "num_restarts" trailer.
+//
+// Each bucket holds the restart interval of the user keys hashed to it,
+// kNoEntry if there are none, or kCollision if they are in different
+// restart intervals. Blocks with more than kMaxRestartSupportedByHashIndex
+// restart intervals are written without the map.
+const uint8_t kNoEntry = 255;
+const uint8_t kCollision = 254;
+const uint8_t kMaxRestartSupportedByHashIndex = 253;
+
+const uint32_t kDataBlockHashIndexFlag = 1u << 31;
+
+class DataBlockHashIndexBuilder {
+ public:
+  // @util_ratio: the number of user keys per bucket. REQUIRES: > 0
+  explicit DataBlockHashIndexBuilder(double util_ratio = 0.75)
+      : util_ratio_(util_ratio) {
+    assert(util_ratio_ > 0);
+  }
+
+  // Add a user key of the restart interval "restart_index". A user key may be
+  // added several times, e.g. once per version.
+  void Add(const Slice& user_key, uint32_t restart_index);
+
+  // True iff the map can represent the keys added so far.
+  bool Valid() const { return valid_; }
+
+  // Append the buckets and num_buckets to "buffer".
+  // REQUIRES: Valid() and at least one key was added.
+  void Finish(std::string* buffer);
+
+  // The size the map would take if it were finished now.
+  size_t EstimateSize() const;
+
+  void Reset();
+
+ private:
+  uint32_t NumBuckets() const;
+
+  const double util_ratio_;
+  bool valid_ = true;
+  // The hashes of the added user keys and their restart intervals.
+  std::vector<std::pair<uint32_t, uint8_t>> hash_and_restart_pairs_;
+};
+
+// Read-only view of the map of a block.
+class DataBlockHashIndex {
+ public:
+  DataBlockHashIndex() : buckets_(nullptr), num_buckets_(0) {}
+
+  // "data" and "size" are those of the whole block and must outlive this
+  // object. On success, stores the offset of the restart array in
+  // *restart_offset and returns true.
+  bool Initialize(const char* data, size_t size, uint32_t num_restarts,
+                  uint32_t* restart_offset);
+
+  // Returns the restart interval of "user_key", kNoEntry if the key is not
+  // in the block or kCollision if the map cannot tell.
+  uint8_t Lookup(const Slice& user_key) const;
+
+ private:
+  const char* buckets_;
+  uint32_t num_buckets_;
+};
+
+}  // namespace rocksdb
@@ -50,6 +50,34 @@ Status BlockHandle::DecodeFrom(Slice* input) {
     return Status::Corruption("bad block handle");
   }
 }
+
+void BlockHandle::EncodeDeltaTo(std::string* dst,
+                                const BlockHandle& previous) const {
+  assert(IsFollowing(previous));
+  // zigzag encoding, so that small negative deltas take one byte too
+  const int64_t delta = static_cast<int64_t>(size_ - previous.size_);
+  PutVarint64(dst, (static_cast<uint64_t>(delta) << 1) ^
+                       static_cast<uint64_t>(delta >> 63));
+}
+
+Status BlockHandle::DecodeDeltaFrom(Slice* input,
+                                    const BlockHandle& previous) {
+  uint64_t zigzag;
+  if (!GetVarint64(input, &zigzag)) {
+    return Status::Corruption("bad block handle");
+  }
+  const uint64_t delta = (zigzag >> 1) ^ -(zigzag & 1);
+  // "previous" may be this handle
+  const uint64_t offset = previous.offset_ + previous.size_ + kBlockTrailerSize;
+  size_ = previous.size_ + delta;
+  offset_ = offset;
+  return Status::OK();
+}
+
+bool BlockHandle::IsFollowing(const BlockHandle& previous) const {
+  return offset_ == previous.offset_ + previous.size_ + kBlockTrailerSize;
+}
+
 const BlockHandle BlockHandle::kNullBlockHandle(0, 0);
 
 // legacy footer format:
@@ -209,15 +237,18 @@ Status ReadBlockContents(RandomAccessFile* file,
                          const BlockHandle& handle,
                          BlockContents* result,
                          Env* env,
-                         bool do_uncompress) {
+                         bool do_uncompress,
+                         const Slice& compression_dict,
+                         const port::ZSTDUncompressionDict* zstd_dict) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
 
   // Read the block contents as well as the type/crc footer.
   // See table_builder.cc for the code that built this structure.
+  // Files that read in place, i.e. from a memory mapping, need no buffer.
   size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
+  char* buf = file->ReadsInPlace() ? nullptr : new char[n + kBlockTrailerSize];
   Slice contents;
 
   PERF_TIMER_AUTO(block_read_time);
@@ -281,7 +312,7 @@ Status ReadBlockContents(RandomAccessFile* file,
     result->compression_type = compression_type;
     s = Status::OK();
   } else {
-    s = UncompressBlockContents(data, n, result);
+    s = UncompressBlockContents(data, n, result, compression_dict, zstd_dict);
     delete[] buf;
   }
   PERF_TIMER_STOP(block_decompress_time);
@@ -295,7 +326,9 @@ Status ReadBlockContents(RandomAccessFile* file,
 // buffer is returned via 'result' and it is upto the caller to
 // free this buffer.
 Status UncompressBlockContents(const char* data, size_t n,
-                               BlockContents* result) {
+                               BlockContents* result,
+                               const Slice& compression_dict,
+                               const port::ZSTDUncompressionDict* zstd_dict) {
   char* ubuf = nullptr;
   int decompress_size = 0;
   assert(data[n] != kNoCompression);
@@ -318,7 +351,8 @@ Status UncompressBlockContents(const char* data, size_t n,
       break;
     }
     case kZlibCompression:
-      ubuf = port::Zlib_Uncompress(data, n, &decompress_size);
+      ubuf = port::Zlib_Uncompress(data, n, &decompress_size,
+                                   compression_dict);
       static char zlib_corrupt_msg[] =
         "Zlib not supported or corrupted Zlib compressed block contents";
       if (!ubuf) {
@@ -361,6 +395,18 @@ Status UncompressBlockContents(const char* data, size_t n,
       result->heap_allocated = true;
       result->cachable = true;
       break;
+    case kZSTDCompression:
+      ubuf = port::ZSTD_Uncompress(data, n, &decompress_size,
+                                   compression_dict, zstd_dict);
+      static char zstd_corrupt_msg[] =
+          "ZSTD not supported or corrupted ZSTD compressed block contents";
+      if (!ubuf) {
+        return Status::Corruption(zstd_corrupt_msg);
+      }
+      result->data = Slice(ubuf, decompress_size);
+      result->heap_allocated = true;
+      result->cachable = true;
+      break;
     default:
       return Status::Corruption("bad block type");
   }
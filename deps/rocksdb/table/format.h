@@ -21,6 +21,10 @@ class Block;
 class RandomAccessFile;
 struct ReadOptions;
 
+namespace port {
+class ZSTDUncompressionDict;
+}  // namespace port
+
 // the length of the magic number in bytes.
 const int kMagicNumberLengthByte = 8;
 
@@ -42,6 +46,18 @@ class BlockHandle {
   void EncodeTo(std::string* dst) const;
   Status DecodeFrom(Slice* input);
 
+  // Encoding of a handle of the block that directly follows the block of
+  // "previous" in the file, used by delta encoded index blocks: the offset
+  // is left out and the size is stored as the difference to the previous
+  // size.
+  // REQUIRES: IsFollowing(previous)
+  void EncodeDeltaTo(std::string* dst, const BlockHandle& previous) const;
+  Status DecodeDeltaFrom(Slice* input, const BlockHandle& previous);
+
+  // Return true if this block starts right after the block of "previous"
+  // and its trailer.
+  bool IsFollowing(const BlockHandle& previous) const;
+
   // if the block handle's offset and size are both "0", we will view it
   // as a null block handle that points to no where.
   bool IsNull() const {
@@ -158,30 +174,31 @@ Status ReadFooterFromFile(RandomAccessFile* file,
 static const size_t kBlockTrailerSize = 5;
 
 struct BlockContents {
-  Slice data;           // Actual contents of data
-  bool cachable;        // True iff data can be cached
-  bool heap_allocated;  // True iff caller should delete[] data.data()
-  CompressionType compression_type;
+  Slice data;                   // Actual contents of data
+  bool cachable = false;        // True iff data can be cached
+  bool heap_allocated = false;  // True iff caller should delete[] data.data()
+  CompressionType compression_type = kNoCompression;
 };
 
 // Read the block identified by "handle" from "file".  On failure
 // return non-OK.  On success fill *result and return OK.
-extern Status ReadBlockContents(RandomAccessFile* file,
-                                const Footer& footer,
-                                const ReadOptions& options,
-                                const BlockHandle& handle,
-                                BlockContents* result,
-                                Env* env,
-                                bool do_uncompress);
+// compression_dict is the dictionary the block was compressed with, if any,
+// and zstd_dict the same dictionary digested by ZSTD, if any.
+extern Status ReadBlockContents(
+    RandomAccessFile* file, const Footer& footer, const ReadOptions& options,
+    const BlockHandle& handle, BlockContents* result, Env* env,
+    bool do_uncompress, const Slice& compression_dict = Slice(),
+    const port::ZSTDUncompressionDict* zstd_dict = nullptr);
 
 // The 'data' points to the raw block contents read in from file.
 // This method allocates a new heap buffer and the raw block
 // contents are uncompresed into this buffer. This buffer is
 // returned via 'result' and it is upto the caller to
 // free this buffer.
-extern Status UncompressBlockContents(const char* data,
-                                      size_t n,
-                                      BlockContents* result);
+extern Status UncompressBlockContents(
+    const char* data, size_t n, BlockContents* result,
+    const Slice& compression_dict = Slice(),
+    const port::ZSTDUncompressionDict* zstd_dict = nullptr);
 
 // Implementation details follow.  Clients should ignore,
 
@@ -128,4 +128,11 @@ Status FindMetaBlock(Iterator* meta_index_iter,
                      const std::string& meta_block_name,
                      BlockHandle* block_handle);
 
+// Find the meta block `meta_block_name` of a table file that is read without
+// a TableReader, e.g. a plain table, from its footer and meta index block.
+Status FindMetaBlock(RandomAccessFile* file, uint64_t file_size,
+                     uint64_t table_magic_number, Env* env,
+                     const std::string& meta_block_name,
+                     BlockHandle* block_handle);
+
 }  // namespace rocksdb
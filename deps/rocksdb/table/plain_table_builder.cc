@@ -8,10 +8,13 @@
 #include <assert.h>
 #include <map>
 
+#include "port/port.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/env.h"
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/options.h"
+#include "rocksdb/slice_transform.h"
+#include "rocksdb/table.h"
 #include "table/plain_table_factory.h"
 #include "db/dbformat.h"
 #include "table/block_builder.h"
@@ -52,20 +55,44 @@ Status WriteBlock(
 extern const uint64_t kPlainTableMagicNumber = 0x8242229663bf9564ull;
 extern const uint64_t kLegacyPlainTableMagicNumber = 0x4f3418eb7a8f13b8ull;
 
+const std::string PlainTablePropertyNames::kPrefixExtractorName =
+    "rocksdb.plain.prefix.extractor.name";
+const std::string PlainTablePropertyNames::kHashTableSize =
+    "rocksdb.plain.hash.table.size";
+const std::string PlainTablePropertyNames::kSubIndexSize =
+    "rocksdb.plain.sub.index.size";
+const std::string PlainTablePropertyNames::kBloomLocality =
+    "rocksdb.plain.bloom.locality";
+
 PlainTableBuilder::PlainTableBuilder(const Options& options,
                                      WritableFile* file,
-                                     uint32_t user_key_len) :
+                                     uint32_t user_key_len,
+                                     int bloom_bits_per_key,
+                                     double hash_table_ratio,
+                                     size_t index_sparseness) :
     options_(options), file_(file), user_key_len_(user_key_len) {
   properties_.fixed_key_len = user_key_len;
+  int64_t creation_time = 0;
+  if (options.env->GetCurrentTime(&creation_time).ok()) {
+    properties_.creation_time = creation_time;
+  }
 
   // for plain table, we put all the data in a big chuck.
   properties_.num_data_blocks = 1;
-  // emphasize that currently plain table doesn't have persistent index or
-  // filter block.
+  // the sizes of the index and the bloom filter, if any, are set by Finish()
   properties_.index_size = 0;
   properties_.filter_size = 0;
   properties_.format_version = 0;
 
+  // PlainTableReader needs a prefix extractor for a hash index, and it reads
+  // the index as it is in memory, which only little endian machines share.
+  if ((options_.prefix_extractor != nullptr || hash_table_ratio == 0) &&
+      port::kLittleEndian) {
+    index_builder_.reset(new PlainTableIndexBuilder(
+        &arena_, options_, bloom_bits_per_key, hash_table_ratio,
+        index_sparseness, 0));
+  }
+
   for (auto& collector_factories :
        options.table_properties_collector_factories) {
     table_properties_collectors_.emplace_back(
@@ -79,6 +106,7 @@ PlainTableBuilder::~PlainTableBuilder() {
 void PlainTableBuilder::Add(const Slice& key, const Slice& value) {
   size_t user_key_size = key.size() - 8;
   assert(user_key_len_ == 0 || user_key_size == user_key_len_);
+  uint32_t row_offset = offset_;
 
   if (!IsFixedLength()) {
     // Write key length
@@ -96,6 +124,9 @@ void PlainTableBuilder::Add(const Slice& key, const Slice& value) {
     status_ = Status::Corruption(Slice());
     return;
   }
+  if (index_builder_ != nullptr) {
+    index_builder_->AddRow(parsed_key.user_key, row_offset);
+  }
   // For value size as varint32 (up to 5 bytes).
   // If the row is of value type with seqId 0, flush the special flag together
   // in this buffer to safe one file append call, which takes 1 byte.
@@ -141,12 +172,59 @@ Status PlainTableBuilder::Finish() {
   properties_.data_size = offset_;
 
   // Write the following blocks
-  //  1. [meta block: properties]
-  //  2. [metaindex block]
-  //  3. [footer]
+  //  1. [meta block: index]
+  //  2. [meta block: bloom filter]
+  //  3. [meta block: properties]
+  //  4. [metaindex block]
+  //  5. [footer]
   MetaIndexBuilder meta_index_builer;
 
   PropertyBlockBuilder property_block_builder;
+  Status s;
+  if (index_builder_ != nullptr) {
+    index_builder_->Finish(properties_.data_size);
+
+    // -- Write index block
+    const size_t hash_table_size =
+        sizeof(uint32_t) * index_builder_->index_size();
+    BlockHandle index_block_handle;
+    s = WriteBlock(
+        Slice(reinterpret_cast<const char*>(index_builder_->index()),
+              hash_table_size + index_builder_->sub_index_size()),
+        file_, &offset_, &index_block_handle);
+    if (!s.ok()) {
+      return s;
+    }
+    meta_index_builer.Add(kPlainTableIndexBlock, index_block_handle);
+    properties_.index_size = index_block_handle.size();
+
+    // -- Write bloom block
+    DynamicBloom* bloom = index_builder_->bloom();
+    if (bloom != nullptr) {
+      BlockHandle bloom_block_handle;
+      s = WriteBlock(bloom->GetRawData(), file_, &offset_,
+                     &bloom_block_handle);
+      if (!s.ok()) {
+        return s;
+      }
+      meta_index_builer.Add(kPlainTableBloomBlock, bloom_block_handle);
+      properties_.filter_size = bloom_block_handle.size();
+    }
+
+    property_block_builder.Add(
+        PlainTablePropertyNames::kPrefixExtractorName,
+        options_.prefix_extractor != nullptr
+            ? std::string(options_.prefix_extractor->Name())
+            : std::string());
+    property_block_builder.Add(PlainTablePropertyNames::kHashTableSize,
+                               std::to_string(hash_table_size));
+    property_block_builder.Add(
+        PlainTablePropertyNames::kSubIndexSize,
+        std::to_string(index_builder_->sub_index_size()));
+    property_block_builder.Add(PlainTablePropertyNames::kBloomLocality,
+                               std::to_string(options_.bloom_locality));
+  }
+
   // -- Add basic properties
   property_block_builder.AddTableProperty(properties_);
 
@@ -157,7 +235,7 @@ Status PlainTableBuilder::Finish() {
 
   // -- Write property block
   BlockHandle property_block_handle;
-  auto s = WriteBlock(
+  s = WriteBlock(
       property_block_builder.Finish(),
       file_,
       &offset_,
@@ -207,5 +285,14 @@ uint64_t PlainTableBuilder::FileSize() const {
   return offset_;
 }
 
+bool PlainTableBuilder::NeedCompact() const {
+  for (const auto& collector : table_properties_collectors_) {
+    if (collector->NeedCompact()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace rocksdb
 #endif  // ROCKSDB_LITE
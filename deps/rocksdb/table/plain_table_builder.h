@@ -12,7 +12,9 @@
 #include "rocksdb/options.h"
 #include "rocksdb/status.h"
 #include "table/table_builder.h"
+#include "table/plain_table_index.h"
 #include "rocksdb/table_properties.h"
+#include "util/arena.h"
 
 namespace rocksdb {
 
@@ -28,8 +30,13 @@ public:
   // caller to close the file after calling Finish(). The output file
   // will be part of level specified by 'level'.  A value of -1 means
   // that the caller does not know which level the output file will reside.
+  // The index and the bloom filter that PlainTableReader needs are built
+  // with bloom_bits_per_key, hash_table_ratio and index_sparseness, and
+  // stored in the file.
   PlainTableBuilder(const Options& options, WritableFile* file,
-                    uint32_t user_key_size);
+                    uint32_t user_key_size, int bloom_bits_per_key = 0,
+                    double hash_table_ratio = 0,
+                    size_t index_sparseness = 16);
 
   // REQUIRES: Either Finish() or Abandon() has been called.
   ~PlainTableBuilder();
@@ -61,6 +68,8 @@ public:
   // Finish() call, returns the size of the final generated file.
   uint64_t FileSize() const override;
 
+  bool NeedCompact() const override;
+
 private:
   Options options_;
   std::vector<std::unique_ptr<TablePropertiesCollector>>
@@ -69,6 +78,9 @@ private:
   uint64_t offset_ = 0;
   Status status_;
   TableProperties properties_;
+  Arena arena_;
+  // nullptr if the file gets no index, see the constructor
+  std::unique_ptr<PlainTableIndexBuilder> index_builder_;
 
   const size_t user_key_len_;
   bool closed_ = false;  // Either Finish() or Abandon() has been called.
@@ -29,7 +29,9 @@ Status PlainTableFactory::NewTableReader(const Options& options,
 TableBuilder* PlainTableFactory::NewTableBuilder(
     const Options& options, const InternalKeyComparator& internal_comparator,
     WritableFile* file, CompressionType compression_type) const {
-  return new PlainTableBuilder(options, file, user_key_len_);
+  return new PlainTableBuilder(options, file, user_key_len_,
+                               bloom_bits_per_key_, hash_table_ratio_,
+                               index_sparseness_);
 }
 
 extern TableFactory* NewPlainTableFactory(uint32_t user_key_len,
@@ -0,0 +1,264 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef ROCKSDB_LITE
+#include "table/plain_table_index.h"
+
+#include "rocksdb/env.h"
+#include "rocksdb/slice_transform.h"
+#include "util/coding.h"
+#include "util/logging.h"
+
+namespace rocksdb {
+
+const std::string kPlainTableIndexBlock = "PlainTableIndexBlock";
+const std::string kPlainTableBloomBlock = "PlainTableBloomBlock";
+
+namespace {
+
+inline uint32_t GetBucketIdFromHash(uint32_t hash, uint32_t num_buckets) {
+  return hash % num_buckets;
+}
+
+}  // namespace
+
+struct PlainTableIndexBuilder::IndexRecord {
+  uint32_t hash; // hash of the prefix
+  uint32_t offset; // offset of a row
+  IndexRecord* next;
+};
+
+// Helper class to track all the index records
+class PlainTableIndexBuilder::IndexRecordList {
+ public:
+  explicit IndexRecordList(size_t num_records_per_group)
+      : kNumRecordsPerGroup(num_records_per_group),
+        current_group_(nullptr),
+        num_records_in_current_group_(num_records_per_group) {}
+
+  ~IndexRecordList() {
+    for (size_t i = 0; i < groups_.size(); i++) {
+      delete[] groups_[i];
+    }
+  }
+
+  void AddRecord(uint32_t hash, uint32_t offset) {
+    if (num_records_in_current_group_ == kNumRecordsPerGroup) {
+      current_group_ = AllocateNewGroup();
+      num_records_in_current_group_ = 0;
+    }
+    auto& new_record = current_group_[num_records_in_current_group_++];
+    new_record.hash = hash;
+    new_record.offset = offset;
+    new_record.next = nullptr;
+  }
+
+  size_t GetNumRecords() const {
+    if (groups_.empty()) {
+      return 0;
+    }
+    return (groups_.size() - 1) * kNumRecordsPerGroup +
+           num_records_in_current_group_;
+  }
+  IndexRecord* At(size_t index) {
+    return &(groups_[index / kNumRecordsPerGroup][index % kNumRecordsPerGroup]);
+  }
+
+ private:
+  IndexRecord* AllocateNewGroup() {
+    IndexRecord* result = new IndexRecord[kNumRecordsPerGroup];
+    groups_.push_back(result);
+    return result;
+  }
+
+  // Each group in `groups_` contains fix-sized records (determined by
+  // kNumRecordsPerGroup). Which can help us minimize the cost if resizing
+  // occurs.
+  const size_t kNumRecordsPerGroup;
+  IndexRecord* current_group_;
+  // List of arrays allocated
+  std::vector<IndexRecord*> groups_;
+  size_t num_records_in_current_group_;
+};
+
+PlainTableIndexBuilder::PlainTableIndexBuilder(
+    Arena* arena, const Options& options, int bloom_bits_per_key,
+    double hash_table_ratio, size_t index_sparseness,
+    size_t huge_page_tlb_size)
+    : arena_(arena),
+      options_(options),
+      kBloomBitsPerKey(bloom_bits_per_key),
+      kHashTableRatio(hash_table_ratio),
+      kIndexIntervalForSamePrefixKeys(index_sparseness),
+      huge_page_tlb_size_(huge_page_tlb_size),
+      record_list_(new IndexRecordList(kRecordsPerGroup)),
+      prev_key_prefix_hash_(0),
+      num_prefixes_(0),
+      num_keys_per_prefix_(0),
+      index_(nullptr),
+      index_size_(0),
+      sub_index_size_(0) {}
+
+PlainTableIndexBuilder::~PlainTableIndexBuilder() {}
+
+void PlainTableIndexBuilder::AddRow(const Slice& user_key, uint32_t offset) {
+  if (IsTotalOrderMode() && kBloomBitsPerKey > 0) {
+    // total order mode and bloom filter is enabled.
+    key_hashes_.push_back(GetPlainTableSliceHash(user_key));
+  }
+  Slice key_prefix_slice = IsTotalOrderMode()
+                               ? Slice()
+                               : options_.prefix_extractor->Transform(user_key);
+
+  if (num_prefixes_ == 0 || Slice(prev_key_prefix_) != key_prefix_slice) {
+    if (num_prefixes_ > 0) {
+      keys_per_prefix_hist_.Add(num_keys_per_prefix_);
+    }
+    ++num_prefixes_;
+    num_keys_per_prefix_ = 0;
+    prev_key_prefix_.assign(key_prefix_slice.data(), key_prefix_slice.size());
+    prev_key_prefix_hash_ = GetPlainTableSliceHash(key_prefix_slice);
+  }
+
+  if (kIndexIntervalForSamePrefixKeys == 0 ||
+      num_keys_per_prefix_++ % kIndexIntervalForSamePrefixKeys == 0) {
+    // Add an index key for every kIndexIntervalForSamePrefixKeys keys
+    record_list_->AddRecord(prev_key_prefix_hash_, offset);
+  }
+}
+
+void PlainTableIndexBuilder::Finish(uint32_t data_end_offset) {
+  keys_per_prefix_hist_.Add(num_keys_per_prefix_);
+  Log(options_.info_log, "Number of Keys per prefix Histogram: %s",
+      keys_per_prefix_hist_.ToString().c_str());
+
+  // Calculated hash table and bloom filter size and allocate memory for
+  // the bloom filter based on the number of prefixes.
+  AllocateIndexAndBloom();
+
+  // Bucketize all the index records to a temp data structure, in which for
+  // each bucket, we generate a linked list of IndexRecord, in reversed order.
+  std::vector<IndexRecord*> hash_to_offsets(index_size_, nullptr);
+  std::vector<uint32_t> entries_per_bucket(index_size_, 0);
+  sub_index_size_ =
+      BucketizeIndexesAndFillBloom(&hash_to_offsets, &entries_per_bucket);
+  // From the temp data structure, populate indexes.
+  FillIndexes(data_end_offset, hash_to_offsets, entries_per_bucket);
+  record_list_.reset();
+}
+
+void PlainTableIndexBuilder::AllocateIndexAndBloom() {
+  uint32_t bloom_total_bits = 0;
+  if (IsTotalOrderMode()) {
+    bloom_total_bits = key_hashes_.size() * kBloomBitsPerKey;
+  } else {
+    bloom_total_bits = num_prefixes_ * kBloomBitsPerKey;
+  }
+  if (bloom_total_bits > 0) {
+    bloom_.reset(new DynamicBloom(bloom_total_bits, options_.bloom_locality, 6,
+                                  nullptr, huge_page_tlb_size_,
+                                  options_.info_log.get()));
+    for (uint32_t hash : key_hashes_) {
+      bloom_->AddHash(hash);
+    }
+  }
+  key_hashes_.clear();
+
+  if (IsTotalOrderMode() || kHashTableRatio <= 0) {
+    // Fall back to pure binary search if the user fails to specify a prefix
+    // extractor.
+    index_size_ = 1;
+  } else {
+    double hash_table_size_multipier = 1.0 / kHashTableRatio;
+    index_size_ = num_prefixes_ * hash_table_size_multipier + 1;
+  }
+}
+
+size_t PlainTableIndexBuilder::BucketizeIndexesAndFillBloom(
+    std::vector<IndexRecord*>* hash_to_offsets,
+    std::vector<uint32_t>* entries_per_bucket) {
+  bool first = true;
+  uint32_t prev_hash = 0;
+  size_t num_records = record_list_->GetNumRecords();
+  for (size_t i = 0; i < num_records; i++) {
+    IndexRecord* index_record = record_list_->At(i);
+    uint32_t cur_hash = index_record->hash;
+    if (first || prev_hash != cur_hash) {
+      prev_hash = cur_hash;
+      first = false;
+      if (bloom_ && !IsTotalOrderMode()) {
+        bloom_->AddHash(cur_hash);
+      }
+    }
+    uint32_t bucket = GetBucketIdFromHash(cur_hash, index_size_);
+    IndexRecord* prev_bucket_head = (*hash_to_offsets)[bucket];
+    index_record->next = prev_bucket_head;
+    (*hash_to_offsets)[bucket] = index_record;
+    (*entries_per_bucket)[bucket]++;
+  }
+  size_t sub_index_size = 0;
+  for (auto entry_count : *entries_per_bucket) {
+    if (entry_count <= 1) {
+      continue;
+    }
+    // Only buckets with more than 1 entry will have subindex.
+    sub_index_size += VarintLength(entry_count);
+    // total bytes needed to store these entries' in-file offsets.
+    sub_index_size += entry_count * kOffsetLen;
+  }
+  return sub_index_size;
+}
+
+void PlainTableIndexBuilder::FillIndexes(
+    uint32_t data_end_offset,
+    const std::vector<IndexRecord*>& hash_to_offsets,
+    const std::vector<uint32_t>& entries_per_bucket) {
+  Log(options_.info_log, "Reserving %zu bytes for plain table's sub_index",
+      sub_index_size_);
+  auto total_allocate_size = sizeof(uint32_t) * index_size_ + sub_index_size_;
+  char* allocated = arena_->AllocateAligned(
+      total_allocate_size, huge_page_tlb_size_, options_.info_log.get());
+  index_ = reinterpret_cast<uint32_t*>(allocated);
+  char* sub_index = allocated + sizeof(uint32_t) * index_size_;
+
+  size_t sub_index_offset = 0;
+  for (int i = 0; i < index_size_; i++) {
+    uint32_t num_keys_for_bucket = entries_per_bucket[i];
+    switch (num_keys_for_bucket) {
+    case 0:
+      // No key for bucket
+      index_[i] = data_end_offset;
+      break;
+    case 1:
+      // point directly to the file offset
+      index_[i] = hash_to_offsets[i]->offset;
+      break;
+    default:
+      // point to second level indexes.
+      index_[i] = sub_index_offset | kSubIndexMask;
+      char* prev_ptr = &sub_index[sub_index_offset];
+      char* cur_ptr = EncodeVarint32(prev_ptr, num_keys_for_bucket);
+      sub_index_offset += (cur_ptr - prev_ptr);
+      char* sub_index_pos = &sub_index[sub_index_offset];
+      IndexRecord* record = hash_to_offsets[i];
+      int j;
+      for (j = num_keys_for_bucket - 1; j >= 0 && record;
+           j--, record = record->next) {
+        EncodeFixed32(sub_index_pos + j * sizeof(uint32_t), record->offset);
+      }
+      assert(j == -1 && record == nullptr);
+      sub_index_offset += kOffsetLen * num_keys_for_bucket;
+      assert(sub_index_offset <= sub_index_size_);
+      break;
+    }
+  }
+  assert(sub_index_offset == sub_index_size_);
+
+  Log(options_.info_log, "hash table size: %d, suffix_map length %zu",
+      index_size_, sub_index_size_);
+}
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,124 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#ifndef ROCKSDB_LITE
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+#include "util/arena.h"
+#include "util/dynamic_bloom.h"
+#include "util/hash.h"
+#include "util/histogram.h"
+
+namespace rocksdb {
+
+// Names of the meta blocks that store the index and the bloom filter of a
+// plain table.
+extern const std::string kPlainTableIndexBlock;
+extern const std::string kPlainTableBloomBlock;
+
+inline uint32_t GetPlainTableSliceHash(const Slice& s) {
+  return Hash(s.data(), s.size(), 397);
+}
+
+// Builds the index and the bloom filter of a plain table from its rows, in
+// the format described at PlainTableReader::PopulateIndex(). PlainTableBuilder
+// uses it to store them in the file, and PlainTableReader to build them when
+// it opens a file that does not have them.
+class PlainTableIndexBuilder {
+ public:
+  // The index is allocated from `arena`.
+  PlainTableIndexBuilder(Arena* arena, const Options& options,
+                         int bloom_bits_per_key, double hash_table_ratio,
+                         size_t index_sparseness, size_t huge_page_tlb_size);
+
+  ~PlainTableIndexBuilder();
+
+  // Add the row at `offset` of the file, whose user key is `user_key`.
+  // REQUIRES: rows are added in the order of the file
+  void AddRow(const Slice& user_key, uint32_t offset);
+
+  // Build the index and the bloom filter. The buckets of the index that have
+  // no rows hold data_end_offset.
+  void Finish(uint32_t data_end_offset);
+
+  // The index built by Finish(): index_size() buckets of 32 bits, followed
+  // by sub_index_size() bytes of sub index, in one allocation.
+  uint32_t* index() const { return index_; }
+  int index_size() const { return index_size_; }
+  size_t sub_index_size() const { return sub_index_size_; }
+
+  // The bloom filter built by Finish(), nullptr if it has none
+  DynamicBloom* bloom() const { return bloom_.get(); }
+  DynamicBloom* ReleaseBloom() { return bloom_.release(); }
+
+ private:
+  struct IndexRecord;
+  class IndexRecordList;
+
+  bool IsTotalOrderMode() const {
+    return options_.prefix_extractor.get() == nullptr;
+  }
+
+  // Internal helper function to allocate memory for the bloom filter and
+  // size the index based on the number of prefixes.
+  void AllocateIndexAndBloom();
+
+  // Internal helper function to bucket index record list to hash buckets.
+  // bucket_header is a vector of size hash_table_size_, with each entry
+  // containing a linklist of IndexRecord hashed to the same bucket, in reverse
+  // order.
+  // of offsets for the hash, in reversed order.
+  // entries_per_bucket is sized of index_size_. The value is how many index
+  // records are there in bucket_headers for the same bucket.
+  size_t BucketizeIndexesAndFillBloom(
+      std::vector<IndexRecord*>* bucket_headers,
+      std::vector<uint32_t>* entries_per_bucket);
+
+  // Internal helper class to fill the indexes and bloom filters to internal
+  // data structures. bucket_headers and entries_per_bucket are bucketized
+  // indexes and counts generated by BucketizeIndexesAndFillBloom().
+  void FillIndexes(uint32_t data_end_offset,
+                   const std::vector<IndexRecord*>& bucket_headers,
+                   const std::vector<uint32_t>& entries_per_bucket);
+
+  static const size_t kRecordsPerGroup = 256;
+  static const size_t kOffsetLen = sizeof(uint32_t);
+  static const uint32_t kSubIndexMask = 0x80000000;
+
+  Arena* arena_;
+  const Options& options_;
+  const int kBloomBitsPerKey;
+  const double kHashTableRatio;
+  const size_t kIndexIntervalForSamePrefixKeys;
+  const size_t huge_page_tlb_size_;
+
+  std::unique_ptr<IndexRecordList> record_list_;
+  // hashes of all the user keys in total order mode, for the bloom filter
+  std::vector<uint32_t> key_hashes_;
+  std::string prev_key_prefix_;
+  uint32_t prev_key_prefix_hash_;
+  int num_prefixes_;
+  int num_keys_per_prefix_;
+  HistogramImpl keys_per_prefix_hist_;
+
+  uint32_t* index_;
+  int index_size_;
+  size_t sub_index_size_;
+  std::unique_ptr<DynamicBloom> bloom_;
+
+  // No copying allowed
+  PlainTableIndexBuilder(const PlainTableIndexBuilder&) = delete;
+  void operator=(const PlainTableIndexBuilder&) = delete;
+};
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
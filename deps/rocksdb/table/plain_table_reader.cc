@@ -5,11 +5,14 @@
 #ifndef ROCKSDB_LITE
 #include "table/plain_table_reader.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include "db/dbformat.h"
 
+#include "port/port.h"
+
 #include "rocksdb/cache.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/env.h"
@@ -23,13 +26,13 @@
 #include "table/meta_blocks.h"
 #include "table/two_level_iterator.h"
 #include "table/plain_table_factory.h"
+#include "table/plain_table_index.h"
 
 #include "util/arena.h"
 #include "util/coding.h"
 #include "util/dynamic_bloom.h"
 #include "util/hash.h"
-#include "util/histogram.h"
-#include "util/murmurhash.h"
+#include "util/logging.h"
 #include "util/perf_context_imp.h"
 #include "util/stop_watch.h"
 
@@ -38,10 +41,6 @@ namespace rocksdb {
 
 namespace {
 
-inline uint32_t GetSliceHash(const Slice& s) {
-  return Hash(s.data(), s.size(), 397) ;
-}
-
 inline uint32_t GetBucketIdFromHash(uint32_t hash, uint32_t num_buckets) {
   return hash % num_buckets;
 }
@@ -57,7 +56,8 @@ inline uint32_t GetFixed32Element(const char* base, size_t offset) {
 // Iterator to iterate IndexedTable
 class PlainTableIterator : public Iterator {
  public:
-  explicit PlainTableIterator(PlainTableReader* table, bool use_prefix_seek);
+  PlainTableIterator(PlainTableReader* table, bool use_prefix_seek,
+                     bool fill_cache);
   ~PlainTableIterator();
 
   bool Valid() const;
@@ -81,6 +81,7 @@ class PlainTableIterator : public Iterator {
  private:
   PlainTableReader* table_;
   bool use_prefix_seek_;
+  PlainTableFileReader file_reader_;
   uint32_t offset_;
   uint32_t next_offset_;
   IterKey key_;
@@ -91,6 +92,156 @@ class PlainTableIterator : public Iterator {
   void operator=(const Iterator&) = delete;
 };
 
+namespace {
+void DeletePage(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+}  // namespace
+
+PlainTableFileReader::PlainTableFileReader(const PlainTableReader* table,
+                                           size_t min_read_size,
+                                           bool fill_cache)
+    : table_(table),
+      min_read_size_(min_read_size),
+      fill_cache_(fill_cache),
+      buf_capacity_(0),
+      page_handle_(nullptr),
+      buf_offset_(0) {}
+
+PlainTableFileReader::~PlainTableFileReader() { ReleasePage(); }
+
+void PlainTableFileReader::ReleasePage() {
+  if (page_handle_ != nullptr) {
+    table_->options_.block_cache->Release(page_handle_);
+    page_handle_ = nullptr;
+  }
+}
+
+Status PlainTableFileReader::GetPage(uint32_t page_offset,
+                                     Cache::Handle** handle) {
+  const uint32_t page_size =
+      std::min(static_cast<uint32_t>(PlainTableReader::kReadBufferSize),
+               table_->data_end_offset_ - page_offset);
+  Cache* cache = table_->options_.block_cache.get();
+  std::string key = table_->page_cache_key_prefix_;
+  PutVarint32(&key, page_offset / PlainTableReader::kReadBufferSize);
+  *handle = cache->Lookup(key);
+  if (*handle != nullptr || !fill_cache_) {
+    return Status::OK();
+  }
+
+  std::unique_ptr<std::string> page(new std::string(page_size, '\0'));
+  Slice data;
+  Status s = table_->file_->Read(page_offset, page_size, &data, &(*page)[0]);
+  if (s.ok() && data.size() < page_size) {
+    s = Status::Corruption("Unexpected EOF when reading a plain table");
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  if (data.data() != page->data()) {
+    page->assign(data.data(), data.size());
+  }
+  *handle = cache->Insert(key, page.get(), page_size, &DeletePage);
+  page.release();
+  return s;
+}
+
+Status PlainTableFileReader::ReadPages(uint32_t offset, uint32_t len,
+                                       Slice* out, bool* found) {
+  *found = false;
+  const uint32_t kPageSize = PlainTableReader::kReadBufferSize;
+  const uint32_t first_page = offset - offset % kPageSize;
+  const uint32_t last = offset + len - 1;
+  const uint32_t last_page = last - last % kPageSize;
+  Cache* cache = table_->options_.block_cache.get();
+  Cache::Handle* handle;
+  Status s = GetPage(first_page, &handle);
+  if (!s.ok() || handle == nullptr) {
+    return s;
+  }
+
+  if (first_page == last_page) {
+    // Hold on to the page while its data is used.
+    page_handle_ = handle;
+    buf_offset_ = first_page;
+    buf_data_ = Slice(*reinterpret_cast<std::string*>(cache->Value(handle)));
+  } else {
+    // The data of a read that spans pages is copied into buf_.
+    const size_t n =
+        std::min(last_page + kPageSize, table_->data_end_offset_) - offset;
+    if (buf_capacity_ < n) {
+      buf_.reset(new char[n]);
+      buf_capacity_ = n;
+    }
+    size_t copied = 0;
+    for (uint32_t page_offset = first_page; page_offset <= last_page;
+         page_offset += kPageSize) {
+      if (page_offset != first_page) {
+        s = GetPage(page_offset, &handle);
+        if (!s.ok() || handle == nullptr) {
+          return s;
+        }
+      }
+      Slice page(*reinterpret_cast<std::string*>(cache->Value(handle)));
+      if (page_offset == first_page) {
+        page.remove_prefix(offset - first_page);
+      }
+      memcpy(buf_.get() + copied, page.data(), page.size());
+      copied += page.size();
+      cache->Release(handle);
+    }
+    assert(copied == n);
+    buf_offset_ = offset;
+    buf_data_ = Slice(buf_.get(), n);
+  }
+  *out = Slice(buf_data_.data() + (offset - buf_offset_),
+               buf_data_.size() - (offset - buf_offset_));
+  *found = true;
+  return s;
+}
+
+Status PlainTableFileReader::Read(uint32_t offset, uint32_t len, Slice* out) {
+  const uint32_t end = table_->data_end_offset_;
+  assert(len > 0 && offset + len <= end);
+  if (table_->reads_in_place_) {
+    *out = Slice(table_->file_data_.data() + offset, end - offset);
+    return Status::OK();
+  }
+
+  const uint32_t buf_end = buf_offset_ + buf_data_.size();
+  if (offset >= buf_offset_ && offset + len <= buf_end) {
+    *out = Slice(buf_data_.data() + (offset - buf_offset_), buf_end - offset);
+    return Status::OK();
+  }
+  ReleasePage();
+  buf_data_ = Slice();
+  if (!table_->page_cache_key_prefix_.empty()) {
+    bool found;
+    Status s = ReadPages(offset, len, out, &found);
+    if (!s.ok() || found) {
+      return s;
+    }
+  }
+  size_t n = std::min(std::max(static_cast<size_t>(len), min_read_size_),
+                      static_cast<size_t>(end - offset));
+  if (buf_capacity_ < n) {
+    buf_.reset(new char[n]);
+    buf_capacity_ = n;
+  }
+  Status s = table_->file_->Read(offset, n, &buf_data_, buf_.get());
+  if (s.ok() && buf_data_.size() < len) {
+    s = Status::Corruption("Unexpected EOF when reading a plain table");
+  }
+  if (!s.ok()) {
+    buf_data_ = Slice();
+    return s;
+  }
+  buf_offset_ = offset;
+  *out = buf_data_;
+  return s;
+}
+
 extern const uint64_t kPlainTableMagicNumber;
 PlainTableReader::PlainTableReader(
     const Options& options, unique_ptr<RandomAccessFile>&& file,
@@ -102,6 +253,7 @@ PlainTableReader::PlainTableReader(
       soptions_(storage_options),
       file_(std::move(file)),
       internal_comparator_(icomparator),
+      reads_in_place_(false),
       file_size_(file_size),
       kHashTableRatio(hash_table_ratio),
       kBloomBitsPerKey(bloom_bits_per_key),
@@ -125,8 +277,6 @@ Status PlainTableReader::Open(const Options& options,
                               const int bloom_bits_per_key,
                               double hash_table_ratio, size_t index_sparseness,
                               size_t huge_page_tlb_size) {
-  assert(options.allow_mmap_reads);
-
   if (file_size > kMaxFileSize) {
     return Status::NotSupported("File is too large for PlainTableReader!");
   }
@@ -157,282 +307,186 @@ void PlainTableReader::SetupForCompaction() {
 }
 
 Iterator* PlainTableReader::NewIterator(const ReadOptions& options) {
-  return new PlainTableIterator(this, options_.prefix_extractor != nullptr);
+  return new PlainTableIterator(this, options_.prefix_extractor != nullptr,
+                                options.fill_cache);
 }
 
-struct PlainTableReader::IndexRecord {
-  uint32_t hash; // hash of the prefix
-  uint32_t offset; // offset of a row
-  IndexRecord* next;
-};
-
-// Helper class to track all the index records
-class PlainTableReader::IndexRecordList {
- public:
-  explicit IndexRecordList(size_t num_records_per_group)
-      : kNumRecordsPerGroup(num_records_per_group),
-        current_group_(nullptr),
-        num_records_in_current_group_(num_records_per_group) {}
-
-  ~IndexRecordList() {
-    for (size_t i = 0; i < groups_.size(); i++) {
-      delete[] groups_[i];
-    }
-  }
-
-  void AddRecord(murmur_t hash, uint32_t offset) {
-    if (num_records_in_current_group_ == kNumRecordsPerGroup) {
-      current_group_ = AllocateNewGroup();
-      num_records_in_current_group_ = 0;
-    }
-    auto& new_record = current_group_[num_records_in_current_group_++];
-    new_record.hash = hash;
-    new_record.offset = offset;
-    new_record.next = nullptr;
-  }
+Status PlainTableReader::PopulateIndex(TableProperties* props) {
+  assert(props != nullptr);
+  table_properties_.reset(props);
 
-  size_t GetNumRecords() const {
-    return (groups_.size() - 1) * kNumRecordsPerGroup +
-           num_records_in_current_group_;
-  }
-  IndexRecord* At(size_t index) {
-    return &(groups_[index / kNumRecordsPerGroup][index % kNumRecordsPerGroup]);
+  // options.prefix_extractor is requried for a hash-based look-up.
+  if (options_.prefix_extractor.get() == nullptr && kHashTableRatio != 0) {
+    return Status::NotSupported(
+        "PlainTable requires a prefix extractor enable prefix hash mode.");
   }
 
- private:
-  IndexRecord* AllocateNewGroup() {
-    IndexRecord* result = new IndexRecord[kNumRecordsPerGroup];
-    groups_.push_back(result);
-    return result;
-  }
-
-  // Each group in `groups_` contains fix-sized records (determined by
-  // kNumRecordsPerGroup). Which can help us minimize the cost if resizing
-  // occurs.
-  const size_t kNumRecordsPerGroup;
-  IndexRecord* current_group_;
-  // List of arrays allocated
-  std::vector<IndexRecord*> groups_;
-  size_t num_records_in_current_group_;
-};
-
-Status PlainTableReader::PopulateIndexRecordList(IndexRecordList* record_list,
-                                                 int* num_prefixes) const {
-  Slice prev_key_prefix_slice;
-  uint32_t prev_key_prefix_hash = 0;
-  uint32_t pos = data_start_offset_;
-  int num_keys_per_prefix = 0;
-  bool is_first_record = true;
-  HistogramImpl keys_per_prefix_hist;
-  // Need map to be ordered to make sure sub indexes generated
-  // are in order.
-
-  *num_prefixes = 0;
-  while (pos < data_end_offset_) {
-    uint32_t key_offset = pos;
-    ParsedInternalKey key;
-    Slice value_slice;
-    Status s = Next(&pos, &key, &value_slice);
+  // Use the rows of a memory mapped file in place; other files are read
+  // piece by piece, in pages kept in the block cache if there is one.
+  Status s;
+  if (file_->ReadsInPlace()) {
+    s = file_->Read(0, file_size_, &file_data_, nullptr);
     if (!s.ok()) {
       return s;
     }
-    if (bloom_) {
-      // total order mode and bloom filter is enabled.
-      bloom_->AddHash(GetSliceHash(key.user_key));
+    reads_in_place_ = true;
+  } else if (options_.block_cache != nullptr) {
+    char buf[kMaxVarint64Length * 3 + 1];
+    size_t size = file_->GetUniqueId(buf, sizeof(buf));
+    if (size == 0) {
+      size = EncodeVarint64(buf, options_.block_cache->NewId()) - buf;
     }
-    Slice key_prefix_slice = GetPrefix(key);
-
-    if (is_first_record || prev_key_prefix_slice != key_prefix_slice) {
-      ++(*num_prefixes);
-      if (!is_first_record) {
-        keys_per_prefix_hist.Add(num_keys_per_prefix);
-      }
-      num_keys_per_prefix = 0;
-      prev_key_prefix_slice = key_prefix_slice;
-      prev_key_prefix_hash = GetSliceHash(key_prefix_slice);
-    }
-
-    if (kIndexIntervalForSamePrefixKeys == 0 ||
-        num_keys_per_prefix++ % kIndexIntervalForSamePrefixKeys == 0) {
-      // Add an index key for every kIndexIntervalForSamePrefixKeys keys
-      record_list->AddRecord(prev_key_prefix_hash, key_offset);
-    }
-    is_first_record = false;
+    page_cache_key_prefix_.assign(buf, size);
   }
 
-  keys_per_prefix_hist.Add(num_keys_per_prefix);
-  Log(options_.info_log, "Number of Keys per prefix Histogram: %s",
-      keys_per_prefix_hist.ToString().c_str());
-
-  return Status::OK();
+  bool loaded = false;
+  s = LoadIndexAndBloom(*props, &loaded);
+  if (!s.ok() || loaded) {
+    return s;
+  }
+  return BuildIndexAndBloom(props);
 }
 
-void PlainTableReader::AllocateIndexAndBloom(int num_prefixes) {
-  if (options_.prefix_extractor.get() != nullptr) {
-    uint32_t bloom_total_bits = num_prefixes * kBloomBitsPerKey;
-    if (bloom_total_bits > 0) {
-      bloom_.reset(new DynamicBloom(bloom_total_bits, options_.bloom_locality,
-                                    6, nullptr, huge_page_tlb_size_,
-                                    options_.info_log.get()));
-    }
+Status PlainTableReader::LoadIndexAndBloom(const TableProperties& props,
+                                           bool* loaded) {
+  *loaded = false;
+  // The index is stored as it is in memory, in little endian byte order.
+  if (!port::kLittleEndian) {
+    return Status::OK();
   }
-
-  if (options_.prefix_extractor.get() == nullptr || kHashTableRatio <= 0) {
-    // Fall back to pure binary search if the user fails to specify a prefix
-    // extractor.
-    index_size_ = 1;
-  } else {
-    double hash_table_size_multipier = 1.0 / kHashTableRatio;
-    index_size_ = num_prefixes * hash_table_size_multipier + 1;
-  }
-}
-
-size_t PlainTableReader::BucketizeIndexesAndFillBloom(
-    IndexRecordList* record_list, std::vector<IndexRecord*>* hash_to_offsets,
-    std::vector<uint32_t>* entries_per_bucket) {
-  bool first = true;
-  uint32_t prev_hash = 0;
-  size_t num_records = record_list->GetNumRecords();
-  for (size_t i = 0; i < num_records; i++) {
-    IndexRecord* index_record = record_list->At(i);
-    uint32_t cur_hash = index_record->hash;
-    if (first || prev_hash != cur_hash) {
-      prev_hash = cur_hash;
-      first = false;
-      if (bloom_ && !IsTotalOrderMode()) {
-        bloom_->AddHash(cur_hash);
-      }
-    }
-    uint32_t bucket = GetBucketIdFromHash(cur_hash, index_size_);
-    IndexRecord* prev_bucket_head = (*hash_to_offsets)[bucket];
-    index_record->next = prev_bucket_head;
-    (*hash_to_offsets)[bucket] = index_record;
-    (*entries_per_bucket)[bucket]++;
-  }
-  size_t sub_index_size = 0;
-  for (auto entry_count : *entries_per_bucket) {
-    if (entry_count <= 1) {
-      continue;
-    }
-    // Only buckets with more than 1 entry will have subindex.
-    sub_index_size += VarintLength(entry_count);
-    // total bytes needed to store these entries' in-file offsets.
-    sub_index_size += entry_count * kOffsetLen;
+  const auto& user_props = props.user_collected_properties;
+  auto prefix_extractor_name =
+      user_props.find(PlainTablePropertyNames::kPrefixExtractorName);
+  auto hash_table_size =
+      user_props.find(PlainTablePropertyNames::kHashTableSize);
+  auto sub_index_size = user_props.find(PlainTablePropertyNames::kSubIndexSize);
+  if (prefix_extractor_name == user_props.end() ||
+      hash_table_size == user_props.end() ||
+      sub_index_size == user_props.end()) {
+    return Status::OK();
   }
-  return sub_index_size;
-}
-
-void PlainTableReader::FillIndexes(
-    const size_t kSubIndexSize,
-    const std::vector<IndexRecord*>& hash_to_offsets,
-    const std::vector<uint32_t>& entries_per_bucket) {
-  Log(options_.info_log, "Reserving %zu bytes for plain table's sub_index",
-      kSubIndexSize);
-  auto total_allocate_size = sizeof(uint32_t) * index_size_ + kSubIndexSize;
-  char* allocated = arena_.AllocateAligned(
-      total_allocate_size, huge_page_tlb_size_, options_.info_log.get());
-  index_ = reinterpret_cast<uint32_t*>(allocated);
-  sub_index_ = allocated + sizeof(uint32_t) * index_size_;
-
-  size_t sub_index_offset = 0;
-  for (int i = 0; i < index_size_; i++) {
-    uint32_t num_keys_for_bucket = entries_per_bucket[i];
-    switch (num_keys_for_bucket) {
-    case 0:
-      // No key for bucket
-      index_[i] = data_end_offset_;
-      break;
-    case 1:
-      // point directly to the file offset
-      index_[i] = hash_to_offsets[i]->offset;
-      break;
-    default:
-      // point to second level indexes.
-      index_[i] = sub_index_offset | kSubIndexMask;
-      char* prev_ptr = &sub_index_[sub_index_offset];
-      char* cur_ptr = EncodeVarint32(prev_ptr, num_keys_for_bucket);
-      sub_index_offset += (cur_ptr - prev_ptr);
-      char* sub_index_pos = &sub_index_[sub_index_offset];
-      IndexRecord* record = hash_to_offsets[i];
-      int j;
-      for (j = num_keys_for_bucket - 1; j >= 0 && record;
-           j--, record = record->next) {
-        EncodeFixed32(sub_index_pos + j * sizeof(uint32_t), record->offset);
-      }
-      assert(j == -1 && record == nullptr);
-      sub_index_offset += kOffsetLen * num_keys_for_bucket;
-      assert(sub_index_offset <= kSubIndexSize);
-      break;
-    }
+  // Files of the same DB may have been written with another prefix
+  // extractor, whose index does not fit the lookups of this one.
+  if (prefix_extractor_name->second !=
+      (IsTotalOrderMode() ? "" : options_.prefix_extractor->Name())) {
+    return Status::OK();
   }
-  assert(sub_index_offset == kSubIndexSize);
-
-  Log(options_.info_log, "hash table size: %d, suffix_map length %zu",
-      index_size_, kSubIndexSize);
-}
-
-Status PlainTableReader::PopulateIndex(TableProperties* props) {
-  assert(props != nullptr);
-  table_properties_.reset(props);
 
-  // options.prefix_extractor is requried for a hash-based look-up.
-  if (options_.prefix_extractor.get() == nullptr && kHashTableRatio != 0) {
-    return Status::NotSupported(
-        "PlainTable requires a prefix extractor enable prefix hash mode.");
+  BlockHandle bloom_handle;
+  bool has_bloom =
+      FindMetaBlock(file_.get(), file_size_, kPlainTableMagicNumber,
+                    options_.env, kPlainTableBloomBlock, &bloom_handle).ok();
+  if (kBloomBitsPerKey > 0 && !has_bloom && props.num_entries > 0) {
+    // The file was written without a bloom filter; build one.
+    return Status::OK();
   }
 
-  // Get mmapped memory to file_data_.
-  Status s = file_->Read(0, file_size_, &file_data_, nullptr);
+  BlockHandle index_handle;
+  Status s = FindMetaBlock(file_.get(), file_size_, kPlainTableMagicNumber,
+                           options_.env, kPlainTableIndexBlock, &index_handle);
   if (!s.ok()) {
     return s;
   }
+  uint64_t hash_table_bytes = 0;
+  uint64_t sub_index_bytes = 0;
+  Slice hash_table_size_value = hash_table_size->second;
+  Slice sub_index_size_value = sub_index_size->second;
+  if (!ConsumeDecimalNumber(&hash_table_size_value, &hash_table_bytes) ||
+      !ConsumeDecimalNumber(&sub_index_size_value, &sub_index_bytes) ||
+      hash_table_bytes == 0 || hash_table_bytes % sizeof(uint32_t) != 0 ||
+      index_handle.size() != hash_table_bytes + sub_index_bytes) {
+    return Status::Corruption("Bad size of the plain table index");
+  }
 
-  IndexRecordList record_list(kRecordsPerGroup);
-  // First, read the whole file, for every kIndexIntervalForSamePrefixKeys rows
-  // for a prefix (starting from the first one), generate a record of (hash,
-  // offset) and append it to IndexRecordList, which is a data structure created
-  // to store them.
-  int num_prefixes;
+  // -- Read the index
+  size_t index_block_size = static_cast<size_t>(index_handle.size());
+  char* allocated = arena_.AllocateAligned(
+      index_block_size, huge_page_tlb_size_, options_.info_log.get());
+  Slice index_data;
+  s = file_->Read(index_handle.offset(), index_block_size, &index_data,
+                  allocated);
+  if (!s.ok()) {
+    return s;
+  }
+  if (index_data.size() != index_block_size) {
+    return Status::Corruption("Truncated plain table index");
+  }
+  if (index_data.data() != allocated) {
+    memcpy(allocated, index_data.data(), index_block_size);
+  }
 
-  // Allocate bloom filter here for total order mode.
-  if (IsTotalOrderMode()) {
-    uint32_t num_bloom_bits = table_properties_->num_entries * kBloomBitsPerKey;
-    if (num_bloom_bits > 0) {
-      bloom_.reset(new DynamicBloom(num_bloom_bits, options_.bloom_locality, 6,
-                                    nullptr, huge_page_tlb_size_,
-                                    options_.info_log.get()));
+  // -- Read the bloom filter
+  unique_ptr<DynamicBloom> bloom;
+  if (kBloomBitsPerKey > 0 && has_bloom) {
+    uint64_t bloom_locality = options_.bloom_locality;
+    auto locality = user_props.find(PlainTablePropertyNames::kBloomLocality);
+    if (locality != user_props.end()) {
+      Slice locality_value = locality->second;
+      ConsumeDecimalNumber(&locality_value, &bloom_locality);
+    }
+    size_t bloom_size = static_cast<size_t>(bloom_handle.size());
+    unique_ptr<char[]> buf(new char[bloom_size]);
+    Slice bloom_data;
+    s = file_->Read(bloom_handle.offset(), bloom_size, &bloom_data, buf.get());
+    if (!s.ok()) {
+      return s;
+    }
+    bloom.reset(new DynamicBloom(bloom_size * 8, bloom_locality, 6, nullptr,
+                                 huge_page_tlb_size_,
+                                 options_.info_log.get()));
+    if (bloom_data.size() != bloom_size ||
+        bloom->GetRawData().size() != bloom_size) {
+      return Status::Corruption("Bad size of the plain table bloom filter");
     }
+    bloom->SetRawData(bloom_data);
   }
 
-  s = PopulateIndexRecordList(&record_list, &num_prefixes);
-  if (!s.ok()) {
-    return s;
+  index_ = reinterpret_cast<uint32_t*>(allocated);
+  index_size_ = hash_table_bytes / sizeof(uint32_t);
+  sub_index_ = allocated + hash_table_bytes;
+  bloom_ = std::move(bloom);
+  *loaded = true;
+  return s;
+}
+
+Status PlainTableReader::BuildIndexAndBloom(TableProperties* props) {
+  // Read the whole file, for every kIndexIntervalForSamePrefixKeys rows
+  // for a prefix (starting from the first one), add an index record.
+  PlainTableIndexBuilder index_builder(&arena_, options_, kBloomBitsPerKey,
+                                       kHashTableRatio,
+                                       kIndexIntervalForSamePrefixKeys,
+                                       huge_page_tlb_size_);
+  PlainTableFileReader reader(this, kIndexScanBufferSize,
+                              false /* fill_cache */);
+  uint32_t pos = data_start_offset_;
+  while (pos < data_end_offset_) {
+    uint32_t key_offset = pos;
+    ParsedInternalKey key;
+    Slice value_slice;
+    Status s = Next(&reader, &pos, &key, &value_slice);
+    if (!s.ok()) {
+      return s;
+    }
+    index_builder.AddRow(key.user_key, key_offset);
   }
-  // Calculated hash table and bloom filter size and allocate memory for indexes
-  // and bloom filter based on the number of prefixes.
-  AllocateIndexAndBloom(num_prefixes);
-
-  // Bucketize all the index records to a temp data structure, in which for
-  // each bucket, we generate a linked list of IndexRecord, in reversed order.
-  std::vector<IndexRecord*> hash_to_offsets(index_size_, nullptr);
-  std::vector<uint32_t> entries_per_bucket(index_size_, 0);
-  size_t sub_index_size_needed = BucketizeIndexesAndFillBloom(
-      &record_list, &hash_to_offsets, &entries_per_bucket);
-  // From the temp data structure, populate indexes.
-  FillIndexes(sub_index_size_needed, hash_to_offsets, entries_per_bucket);
-
-  // Fill two table properties.
-  // TODO(sdong): after we have the feature of storing index in file, this
-  // properties need to be populated to index_size instead.
-  props->user_collected_properties["plain_table_hash_table_size"] =
+  index_builder.Finish(data_end_offset_);
+
+  index_ = index_builder.index();
+  index_size_ = index_builder.index_size();
+  sub_index_ = reinterpret_cast<char*>(index_) + sizeof(uint32_t) * index_size_;
+  bloom_.reset(index_builder.ReleaseBloom());
+
+  // Fill the two table properties that the builder stores with the index.
+  props->user_collected_properties[PlainTablePropertyNames::kHashTableSize] =
       std::to_string(index_size_ * 4U);
-  props->user_collected_properties["plain_table_sub_index_size"] =
-      std::to_string(sub_index_size_needed);
+  props->user_collected_properties[PlainTablePropertyNames::kSubIndexSize] =
+      std::to_string(index_builder.sub_index_size());
 
   return Status::OK();
 }
 
-Status PlainTableReader::GetOffset(const Slice& target, const Slice& prefix,
+Status PlainTableReader::GetOffset(PlainTableFileReader* reader,
+                                   const Slice& target, const Slice& prefix,
                                    uint32_t prefix_hash, bool& prefix_matched,
                                    uint32_t* offset) const {
   prefix_matched = false;
@@ -456,6 +510,7 @@ Status PlainTableReader::GetOffset(const Slice& target, const Slice& prefix,
   const char* base_ptr = GetVarint32Ptr(index_ptr, index_ptr + 4, &upper_bound);
   uint32_t high = upper_bound;
   ParsedInternalKey mid_key;
+  Slice unused_value;
   ParsedInternalKey parsed_target;
   if (!ParseInternalKey(target, &parsed_target)) {
     return Status::Corruption(Slice());
@@ -465,8 +520,8 @@ Status PlainTableReader::GetOffset(const Slice& target, const Slice& prefix,
   while (high - low > 1) {
     uint32_t mid = (high + low) / 2;
     uint32_t file_offset = GetFixed32Element(base_ptr, mid);
-    size_t tmp;
-    Status s = ReadKey(file_data_.data() + file_offset, &mid_key, &tmp);
+    uint32_t next_offset = file_offset;
+    Status s = Next(reader, &next_offset, &mid_key, &unused_value);
     if (!s.ok()) {
       return s;
     }
@@ -489,9 +544,12 @@ Status PlainTableReader::GetOffset(const Slice& target, const Slice& prefix,
   // prefix as target. We need to rule out one of them to avoid to go
   // to the wrong prefix.
   ParsedInternalKey low_key;
-  size_t tmp;
   uint32_t low_key_offset = GetFixed32Element(base_ptr, low);
-  Status s = ReadKey(file_data_.data() + low_key_offset, &low_key, &tmp);
+  uint32_t next_offset = low_key_offset;
+  Status s = Next(reader, &next_offset, &low_key, &unused_value);
+  if (!s.ok()) {
+    return s;
+  }
   if (GetPrefix(low_key) == prefix) {
     prefix_matched = true;
     *offset = low_key_offset;
@@ -515,7 +573,8 @@ Slice PlainTableReader::GetPrefix(const ParsedInternalKey& target) const {
   return GetPrefixFromUserKey(target.user_key);
 }
 
-Status PlainTableReader::ReadKey(const char* start, ParsedInternalKey* key,
+Status PlainTableReader::ReadKey(const char* start, const char* limit,
+                                 ParsedInternalKey* key,
                                  size_t* bytes_read) const {
   const char* key_ptr = nullptr;
   *bytes_read = 0;
@@ -525,8 +584,7 @@ Status PlainTableReader::ReadKey(const char* start, ParsedInternalKey* key,
     key_ptr = start;
   } else {
     uint32_t tmp_size = 0;
-    key_ptr =
-        GetVarint32Ptr(start, file_data_.data() + data_end_offset_, &tmp_size);
+    key_ptr = GetVarint32Ptr(start, limit, &tmp_size);
     if (key_ptr == nullptr) {
       return Status::Corruption(
           "Unexpected EOF when reading the next key's size");
@@ -534,7 +592,7 @@ Status PlainTableReader::ReadKey(const char* start, ParsedInternalKey* key,
     user_key_size = (size_t)tmp_size;
     *bytes_read = key_ptr - start;
   }
-  if (key_ptr + user_key_size + 1 >= file_data_.data() + data_end_offset_) {
+  if (key_ptr + user_key_size + 1 >= limit) {
     return Status::Corruption("Unexpected EOF when reading the next key");
   }
 
@@ -545,7 +603,7 @@ Status PlainTableReader::ReadKey(const char* start, ParsedInternalKey* key,
     key->type = kTypeValue;
     *bytes_read += user_key_size + 1;
   } else {
-    if (start + user_key_size + 8 >= file_data_.data() + data_end_offset_) {
+    if (key_ptr + user_key_size + 8 >= limit) {
       return Status::Corruption(
           "Unexpected EOF when reading internal bytes of the next key");
     }
@@ -559,8 +617,8 @@ Status PlainTableReader::ReadKey(const char* start, ParsedInternalKey* key,
   return Status::OK();
 }
 
-Status PlainTableReader::Next(uint32_t* offset, ParsedInternalKey* key,
-                              Slice* value) const {
+Status PlainTableReader::Next(PlainTableFileReader* reader, uint32_t* offset,
+                              ParsedInternalKey* key, Slice* value) const {
   if (*offset == data_end_offset_) {
     *offset = data_end_offset_;
     return Status::OK();
@@ -570,26 +628,42 @@ Status PlainTableReader::Next(uint32_t* offset, ParsedInternalKey* key,
     return Status::Corruption("Offset is out of file size");
   }
 
-  const char* start = file_data_.data() + *offset;
-  size_t bytes_for_key;
-  Status s = ReadKey(start, key, &bytes_for_key);
-  if (!s.ok()) {
-    return s;
-  }
-  uint32_t value_size;
-  const char* value_ptr = GetVarint32Ptr(
-      start + bytes_for_key, file_data_.data() + data_end_offset_, &value_size);
-  if (value_ptr == nullptr) {
-    return Status::Corruption(
-        "Unexpected EOF when reading the next value's size.");
-  }
-  *offset = *offset + (value_ptr - start) + value_size;
-  if (*offset > data_end_offset_) {
-    return Status::Corruption("Unexpected EOF when reading the next value. ");
+  // The row is parsed from the data the reader has at hand. If it goes past
+  // that data, it is read again with twice as much, until the data reaches
+  // the end of the rows.
+  const uint32_t max_len = data_end_offset_ - *offset;
+  uint32_t len = 1;
+  while (true) {
+    Slice data;
+    Status s = reader->Read(*offset, len, &data);
+    if (!s.ok()) {
+      return s;
+    }
+    const char* start = data.data();
+    const char* limit = start + data.size();
+    size_t bytes_for_key;
+    s = ReadKey(start, limit, key, &bytes_for_key);
+    if (s.ok()) {
+      uint32_t value_size;
+      const char* value_ptr =
+          GetVarint32Ptr(start + bytes_for_key, limit, &value_size);
+      if (value_ptr == nullptr) {
+        s = Status::Corruption(
+            "Unexpected EOF when reading the next value's size.");
+      } else if (value_ptr + value_size > limit) {
+        s = Status::Corruption("Unexpected EOF when reading the next value. ");
+      } else {
+        *offset = *offset + (value_ptr - start) + value_size;
+        *value = Slice(value_ptr, value_size);
+        return s;
+      }
+    }
+    if (data.size() >= max_len) {
+      return s;
+    }
+    len = static_cast<uint32_t>(
+        std::min(2 * data.size(), static_cast<size_t>(max_len)));
   }
-  *value = Slice(value_ptr, value_size);
-
-  return Status::OK();
 }
 
 Status PlainTableReader::Get(const ReadOptions& ro, const Slice& target,
@@ -602,7 +676,7 @@ Status PlainTableReader::Get(const ReadOptions& ro, const Slice& target,
   uint32_t prefix_hash;
   if (IsTotalOrderMode()) {
     // Match whole user key for bloom filter check.
-    if (!MatchBloom(GetSliceHash(GetUserKey(target)))) {
+    if (!MatchBloom(GetPlainTableSliceHash(GetUserKey(target)))) {
       return Status::OK();
     }
     // in total order mode, there is only one bucket 0, and we always use empty
@@ -611,15 +685,16 @@ Status PlainTableReader::Get(const ReadOptions& ro, const Slice& target,
     prefix_hash = 0;
   } else {
     prefix_slice = GetPrefix(target);
-    prefix_hash = GetSliceHash(prefix_slice);
+    prefix_hash = GetPlainTableSliceHash(prefix_slice);
     if (!MatchBloom(prefix_hash)) {
       return Status::OK();
     }
   }
+  PlainTableFileReader reader(this, kReadBufferSize, ro.fill_cache);
   uint32_t offset;
   bool prefix_match;
-  Status s =
-      GetOffset(target, prefix_slice, prefix_hash, prefix_match, &offset);
+  Status s = GetOffset(&reader, target, prefix_slice, prefix_hash,
+                       prefix_match, &offset);
   if (!s.ok()) {
     return s;
   }
@@ -631,7 +706,7 @@ Status PlainTableReader::Get(const ReadOptions& ro, const Slice& target,
 
   Slice found_value;
   while (offset < data_end_offset_) {
-    Status s = Next(&offset, &found_key, &found_value);
+    Status s = Next(&reader, &offset, &found_key, &found_value);
     if (!s.ok()) {
       return s;
     }
@@ -657,8 +732,10 @@ uint64_t PlainTableReader::ApproximateOffsetOf(const Slice& key) {
 }
 
 PlainTableIterator::PlainTableIterator(PlainTableReader* table,
-                                       bool use_prefix_seek)
-    : table_(table), use_prefix_seek_(use_prefix_seek) {
+                                       bool use_prefix_seek, bool fill_cache)
+    : table_(table),
+      use_prefix_seek_(use_prefix_seek),
+      file_reader_(table, PlainTableReader::kReadBufferSize, fill_cache) {
   next_offset_ = offset_ = table_->data_end_offset_;
 }
 
@@ -699,15 +776,15 @@ void PlainTableIterator::Seek(const Slice& target) {
   uint32_t prefix_hash = 0;
   // Bloom filter is ignored in total-order mode.
   if (!table_->IsTotalOrderMode()) {
-    prefix_hash = GetSliceHash(prefix_slice);
+    prefix_hash = GetPlainTableSliceHash(prefix_slice);
     if (!table_->MatchBloom(prefix_hash)) {
       offset_ = next_offset_ = table_->data_end_offset_;
       return;
     }
   }
   bool prefix_match;
-  status_ = table_->GetOffset(target, prefix_slice, prefix_hash, prefix_match,
-                              &next_offset_);
+  status_ = table_->GetOffset(&file_reader_, target, prefix_slice,
+                              prefix_hash, prefix_match, &next_offset_);
   if (!status_.ok()) {
     offset_ = next_offset_ = table_->data_end_offset_;
     return;
@@ -737,7 +814,7 @@ void PlainTableIterator::Next() {
   if (offset_ < table_->data_end_offset_) {
     Slice tmp_slice;
     ParsedInternalKey parsed_key;
-    status_ = table_->Next(&next_offset_, &parsed_key, &value_);
+    status_ = table_->Next(&file_reader_, &next_offset_, &parsed_key, &value_);
     if (status_.ok()) {
       // Make a copy in this case. TODO optimize.
       key_.SetInternalKey(parsed_key);
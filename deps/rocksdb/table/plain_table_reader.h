@@ -12,6 +12,7 @@
 #include <stdint.h>
 
 #include "db/dbformat.h"
+#include "rocksdb/cache.h"
 #include "rocksdb/env.h"
 #include "rocksdb/iterator.h"
 #include "rocksdb/slice_transform.h"
@@ -38,6 +39,55 @@ using std::unique_ptr;
 using std::unordered_map;
 extern const uint32_t kPlainTableVariableLength;
 
+class PlainTableReader;
+
+// Reads the rows of a plain table file. If the file is read in place from a
+// memory mapping, the data is used where it is. Otherwise the reads are
+// served from the pages of the file kept in Options::block_cache, which all
+// the lookups and iterators of the table share; a page missing from it is
+// read and, if fill_cache is true, added. Without a block cache, or if a
+// page is missing and not to be added, the file is read with
+// RandomAccessFile::Read() into a buffer of at least min_read_size bytes,
+// which serves the reads that fall within it. The data returned
+// stays valid until the next Read() that misses the page or the buffer.
+// Not thread-safe: every Get() and iterator uses its own.
+class PlainTableFileReader {
+ public:
+  PlainTableFileReader(const PlainTableReader* table, size_t min_read_size,
+                       bool fill_cache);
+  ~PlainTableFileReader();
+
+  // Set *out to the data of the file at [offset, offset + len), followed
+  // by the rest of the data at hand, up to the end of the rows.
+  // REQUIRES: offset + len <= end of the rows
+  Status Read(uint32_t offset, uint32_t len, Slice* out);
+
+ private:
+  // Serve the read from the cached pages that hold it. Sets *found to false
+  // if one of them is neither cached nor to be added to the cache.
+  Status ReadPages(uint32_t offset, uint32_t len, Slice* out, bool* found);
+  // Set *handle to the page of the file at page_offset in the block cache,
+  // which is read and added to it if fill_cache_, or else to nullptr if it
+  // is not there.
+  Status GetPage(uint32_t page_offset, Cache::Handle** handle);
+  void ReleasePage();
+
+  const PlainTableReader* table_;
+  const size_t min_read_size_;
+  const bool fill_cache_;
+  unique_ptr<char[]> buf_;
+  size_t buf_capacity_;
+  // The cached page buf_data_ is in, if it is not in buf_
+  Cache::Handle* page_handle_;
+  // offset in the file of buf_data_
+  uint32_t buf_offset_;
+  Slice buf_data_;
+
+  // No copying allowed
+  PlainTableFileReader(const PlainTableFileReader&) = delete;
+  void operator=(const PlainTableFileReader&) = delete;
+};
+
 // Based on following output file format shown in plain_table_factory.h
 // When opening the output file, IndexedTableReader creates a hash table
 // from key prefixes to offset of the output file. IndexedTable will decide
@@ -45,7 +95,9 @@ extern const uint32_t kPlainTableVariableLength;
 // or the offset of it. If there are too many keys share this prefix, it will
 // create a binary search-able index from the suffix to offset on disk.
 //
-// The implementation of IndexedTableReader requires output file is mmaped
+// If the file is mmaped, its rows are read in place; otherwise they are read
+// in pages that are kept in the block cache, so the tables of a DB need not
+// fit in memory.
 class PlainTableReader: public TableReader {
  public:
   static Status Open(const Options& options, const EnvOptions& soptions,
@@ -85,8 +137,9 @@ class PlainTableReader: public TableReader {
   // too.
   virtual bool MatchBloom(uint32_t hash) const;
 
-  // PopulateIndex() builds index of keys. It must be called before any query
-  // to the table.
+  // PopulateIndex() loads the index of keys and the bloom filter from the
+  // file, or builds them from its rows if the file has none that fit the
+  // options of the reader. It must be called before any query to the table.
   //
   // props: the table properties object that need to be stored. Ownership of
   //        the object will be passed.
@@ -126,11 +179,13 @@ class PlainTableReader: public TableReader {
   //    ....
   //   record N file offset:  fixedint32
   // <end>
+  //
+  // PlainTableBuilder stores index_ followed by sub_index_ in the meta block
+  // kPlainTableIndexBlock, and the bits of the bloom filter in the meta block
+  // kPlainTableBloomBlock.
   Status PopulateIndex(TableProperties* props);
 
  private:
-  struct IndexRecord;
-  class IndexRecordList;
 
   // Plain table maintains an index and a sub index.
   // index is implemented by a hash table.
@@ -150,8 +205,13 @@ class PlainTableReader: public TableReader {
   // represents plain table's current status.
   Status status_;
 
+  // the whole file if it is read in place, see reads_in_place_
   Slice file_data_;
+  bool reads_in_place_;
   uint32_t file_size_;
+  // Prefix of the block cache keys of the pages of the file, empty if they
+  // are not cached
+  std::string page_cache_key_prefix_;
 
   const double kHashTableRatio;
   const int kBloomBitsPerKey;
@@ -173,9 +233,12 @@ class PlainTableReader: public TableReader {
 
   static const size_t kNumInternalBytes = 8;
   static const uint32_t kSubIndexMask = 0x80000000;
-  static const size_t kOffsetLen = sizeof(uint32_t);
   static const uint64_t kMaxFileSize = 1u << 31;
-  static const size_t kRecordsPerGroup = 256;
+  // Buffer sizes of the PlainTableFileReaders of lookups and iterators, and
+  // of the scan of the file that builds the index. Pages of the file in the
+  // block cache are kReadBufferSize bytes.
+  static const size_t kReadBufferSize = 4096;
+  static const size_t kIndexScanBufferSize = 256 * 1024;
 
   bool IsFixedLength() const {
     return user_key_len_ != kPlainTableVariableLength;
@@ -187,49 +250,34 @@ class PlainTableReader: public TableReader {
 
   friend class TableCache;
   friend class PlainTableIterator;
-
-  // Internal helper function to generate an IndexRecordList object from all
-  // the rows, which contains index records as a list.
-  // If bloom_ is not null, all the keys' full-key hash will be added to the
-  // bloom filter.
-  Status PopulateIndexRecordList(IndexRecordList* record_list,
-                                 int* num_prefixes) const;
-
-  // Internal helper function to allocate memory for indexes and bloom filters
-  void AllocateIndexAndBloom(int num_prefixes);
-
-  // Internal helper function to bucket index record list to hash buckets.
-  // bucket_header is a vector of size hash_table_size_, with each entry
-  // containing a linklist of IndexRecord hashed to the same bucket, in reverse
-  // order.
-  // of offsets for the hash, in reversed order.
-  // entries_per_bucket is sized of index_size_. The value is how many index
-  // records are there in bucket_headers for the same bucket.
-  size_t BucketizeIndexesAndFillBloom(
-      IndexRecordList* record_list, std::vector<IndexRecord*>* bucket_headers,
-      std::vector<uint32_t>* entries_per_bucket);
-
-  // Internal helper class to fill the indexes and bloom filters to internal
-  // data structures. bucket_headers and entries_per_bucket are bucketized
-  // indexes and counts generated by BucketizeIndexesAndFillBloom().
-  void FillIndexes(const size_t kSubIndexSize,
-                   const std::vector<IndexRecord*>& bucket_headers,
-                   const std::vector<uint32_t>& entries_per_bucket);
-
-  // Read a plain table key from the position `start`. The read content
-  // will be written to `key` and the size of read bytes will be populated
-  // in `bytes_read`.
-  Status ReadKey(const char* row_ptr, ParsedInternalKey* key,
-                 size_t* bytes_read) const;
-  // Read the key and value at `offset` to parameters `key` and `value`.
+  friend class PlainTableFileReader;
+
+  // Internal helper function to load the index and the bloom filter stored
+  // in the file. Sets *loaded to false, and leaves them alone, if the file
+  // has none or they were built for another prefix extractor, or the reader
+  // needs a bloom filter that the file does not have.
+  Status LoadIndexAndBloom(const TableProperties& props, bool* loaded);
+
+  // Internal helper function to build the index and the bloom filter from
+  // all the rows of the file.
+  Status BuildIndexAndBloom(TableProperties* props);
+
+  // Read a plain table key from the position `start`, whose data ends at
+  // `limit`. The read content will be written to `key` and the size of read
+  // bytes will be populated in `bytes_read`.
+  Status ReadKey(const char* row_ptr, const char* limit,
+                 ParsedInternalKey* key, size_t* bytes_read) const;
+  // Read the key and value at `offset` with `reader` to parameters `key` and
+  // `value`, which point into the data of the reader.
   // On success, `offset` will be updated as the offset for the next key.
-  Status Next(uint32_t* offset, ParsedInternalKey* key, Slice* value) const;
+  Status Next(PlainTableFileReader* reader, uint32_t* offset,
+              ParsedInternalKey* key, Slice* value) const;
   // Get file offset for key target.
   // return value prefix_matched is set to true if the offset is confirmed
   // for a key with the same prefix as target.
-  Status GetOffset(const Slice& target, const Slice& prefix,
-                   uint32_t prefix_hash, bool& prefix_matched,
-                   uint32_t* offset) const;
+  Status GetOffset(PlainTableFileReader* reader, const Slice& target,
+                   const Slice& prefix, uint32_t prefix_hash,
+                   bool& prefix_matched, uint32_t* offset) const;
 
   Slice GetUserKey(const Slice& key) const {
     return Slice(key.data(), key.size() - 8);
@@ -9,10 +9,12 @@
 
 #pragma once
 
+#include "rocksdb/status.h"
+
 namespace rocksdb {
 
 class Slice;
-class Status;
+struct RangeTombstone;
 
 // TableBuilder provides the interface used to build a Table
 // (an immutable and sorted map from keys to values).
@@ -31,6 +33,14 @@ class TableBuilder {
   // REQUIRES: Finish(), Abandon() have not been called
   virtual void Add(const Slice& key, const Slice& value) = 0;
 
+  // Store a range tombstone in the table.  Tombstones may be added in any
+  // order.
+  // REQUIRES: Finish(), Abandon() have not been called
+  virtual Status AddRangeTombstone(const RangeTombstone& tombstone) {
+    return Status::NotSupported("range tombstones are not supported by this "
+                                "table format");
+  }
+
   // Return non-ok iff some error has been detected.
   virtual Status status() const = 0;
 
@@ -50,6 +60,10 @@ class TableBuilder {
   // Size of the file generated so far.  If invoked after a successful
   // Finish() call, returns the size of the final generated file.
   virtual uint64_t FileSize() const = 0;
+
+  // If the table properties collectors ask for the table to be compacted.
+  // REQUIRES: Finish() has been called
+  virtual bool NeedCompact() const { return false; }
 };
 
 }  // namespace rocksdb
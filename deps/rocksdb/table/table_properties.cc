@@ -63,6 +63,9 @@ std::string TableProperties::ToString(
   AppendProperty(result, "(estimated) table size",
                  data_size + index_size + filter_size, prop_delim, kv_delim);
 
+  AppendProperty(result, "creation time", creation_time, prop_delim,
+                 kv_delim);
+
   AppendProperty(
       result, "filter policy name",
       filter_policy_name.empty() ? std::string("N/A") : filter_policy_name,
@@ -91,6 +94,8 @@ const std::string TablePropertiesNames::kFormatVersion =
     "rocksdb.format.version";
 const std::string TablePropertiesNames::kFixedKeyLen =
     "rocksdb.fixed.key.length";
+const std::string TablePropertiesNames::kCreationTime =
+    "rocksdb.creation.time";
 
 extern const std::string kPropertiesBlock = "rocksdb.properties";
 // Old property block name for backward compatibility
@@ -9,12 +9,16 @@
 
 #pragma once
 #include <memory>
+#include <vector>
+
+#include "rocksdb/slice.h"
+#include "rocksdb/status.h"
 
 namespace rocksdb {
 
 class Iterator;
 struct ParsedInternalKey;
-class Slice;
+struct RangeTombstone;
 struct ReadOptions;
 struct TableProperties;
 
@@ -44,6 +48,12 @@ class TableReader {
 
   virtual std::shared_ptr<const TableProperties> GetTableProperties() const = 0;
 
+  // The range tombstones stored in the table, or nullptr if there are none.
+  virtual std::shared_ptr<const std::vector<RangeTombstone>>
+  GetRangeTombstones() const {
+    return nullptr;
+  }
+
   // Calls (*result_handler)(handle_context, ...) repeatedly, starting with
   // the entry found after a call to Seek(key), until result_handler returns
   // false, where k is the actual internal key for a row found and v as the
@@ -61,6 +71,24 @@ class TableReader {
       bool (*result_handler)(void* arg, const ParsedInternalKey& k,
                              const Slice& v, bool didIO),
       void (*mark_key_may_exist_handler)(void* handle_context) = nullptr) = 0;
+
+  // Batched version of Get(). keys[0,num_keys-1] must be sorted in
+  // ascending internal key order. For every i, behaves like
+  //   statuses[i] = Get(readOptions, keys[i], handle_contexts[i], ...)
+  // but lets the implementation share index lookups and block reads among
+  // keys that live close to each other.
+  virtual void MultiGet(
+      const ReadOptions& readOptions, size_t num_keys, const Slice* keys,
+      void* const* handle_contexts,
+      bool (*result_handler)(void* arg, const ParsedInternalKey& k,
+                             const Slice& v, bool didIO),
+      void (*mark_key_may_exist_handler)(void* handle_context),
+      Status* statuses) {
+    for (size_t i = 0; i < num_keys; ++i) {
+      statuses[i] = Get(readOptions, keys[i], handle_contexts[i],
+                        result_handler, mark_key_may_exist_handler);
+    }
+  }
 };
 
 }  // namespace rocksdb
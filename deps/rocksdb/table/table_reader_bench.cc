@@ -238,6 +238,7 @@ DEFINE_bool(through_db, false, "If enable, a DB instance will be created and "
             "the query will be against DB. Otherwise, will be directly against "
             "a table reader.");
 DEFINE_bool(plain_table, false, "Use PlainTable");
+DEFINE_bool(cuckoo_table, false, "Use CuckooTable");
 DEFINE_string(time_unit, "microsecond",
               "The time unit used for measuring performance. User can specify "
               "`microsecond` (default) or `nanosecond`");
@@ -265,6 +266,10 @@ int main(int argc, char** argv) {
                                         0.75);
     options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(
         FLAGS_prefix_len));
+  } else if (FLAGS_cuckoo_table) {
+    options.allow_mmap_reads = true;
+    env_options.use_mmap_reads = true;
+    tf = rocksdb::NewCuckooTableFactory();
   } else {
     tf = new rocksdb::BlockBasedTableFactory();
   }
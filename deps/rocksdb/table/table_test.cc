@@ -135,7 +135,8 @@ class StringSource: public RandomAccessFile {
  public:
   StringSource(const Slice& contents, uint64_t uniq_id, bool mmap)
       : contents_(contents.data(), contents.size()), uniq_id_(uniq_id),
-        mmap_(mmap) {
+        mmap_(mmap), prefetch_supported_(true), num_prefetches_(0),
+        num_reads_(0), num_multi_reads_(0) {
   }
 
   virtual ~StringSource() { }
@@ -150,6 +151,7 @@ class StringSource: public RandomAccessFile {
     if (offset + n > contents_.size()) {
       n = contents_.size() - offset;
     }
+    ++num_reads_;
     if (!mmap_) {
       memcpy(scratch, &contents_[offset], n);
       *result = Slice(scratch, n);
@@ -159,6 +161,41 @@ class StringSource: public RandomAccessFile {
     return Status::OK();
   }
 
+  virtual bool ReadsInPlace() const { return mmap_; }
+
+  virtual Status Prefetch(uint64_t offset, size_t n) {
+    ++num_prefetches_;
+    return prefetch_supported_ ? Status::OK()
+                               : Status::NotSupported("Prefetch");
+  }
+
+  virtual void MultiRead(ReadRequest* reqs, size_t num_reqs) {
+    ++num_multi_reads_;
+    for (size_t i = 0; i < num_reqs; ++i) {
+      size_t n = 0;
+      if (reqs[i].offset < contents_.size()) {
+        n = std::min(reqs[i].len,
+                     static_cast<size_t>(contents_.size() - reqs[i].offset));
+        memcpy(reqs[i].scratch, &contents_[reqs[i].offset], n);
+      }
+      reqs[i].result = Slice(reqs[i].scratch, n);
+      reqs[i].status = Status::OK();
+    }
+  }
+
+  void set_prefetch_supported(bool supported) {
+    prefetch_supported_ = supported;
+  }
+  int num_prefetches() const { return num_prefetches_; }
+  // Read() calls, MultiRead() calls
+  int num_reads() const { return num_reads_; }
+  int num_multi_reads() const { return num_multi_reads_; }
+
+  bool Contains(const Slice& data) const {
+    return data.data() >= contents_.data() &&
+           data.data() + data.size() <= contents_.data() + contents_.size();
+  }
+
   virtual size_t GetUniqueId(char* id, size_t max_size) const {
     if (max_size < 20) {
       return 0;
@@ -174,6 +211,10 @@ class StringSource: public RandomAccessFile {
   std::string contents_;
   uint64_t uniq_id_;
   bool mmap_;
+  bool prefetch_supported_;
+  int num_prefetches_;
+  mutable int num_reads_;
+  int num_multi_reads_;
 };
 
 typedef std::map<std::string, std::string, STLLessThan> KVMap;
@@ -314,7 +355,8 @@ class TableConstructor: public Constructor {
   explicit TableConstructor(const Comparator* cmp,
                             bool convert_to_internal_key = false)
       : Constructor(cmp),
-        convert_to_internal_key_(convert_to_internal_key) {}
+        convert_to_internal_key_(convert_to_internal_key),
+        table_source_(nullptr) {}
   ~TableConstructor() { Reset(); }
 
   virtual Status FinishImpl(const Options& options,
@@ -348,6 +390,7 @@ class TableConstructor: public Constructor {
     uniq_id_ = cur_uniq_id_++;
     source_.reset(new StringSource(sink_->contents(), uniq_id_,
                                    options.allow_mmap_reads));
+    table_source_ = source_.get();
     return options.table_factory->NewTableReader(
         options, soptions, internal_comparator, std::move(source_),
         sink_->contents().size(), &table_reader_);
@@ -371,6 +414,7 @@ class TableConstructor: public Constructor {
     source_.reset(
         new StringSource(sink_->contents(), uniq_id_,
                          options.allow_mmap_reads));
+    table_source_ = source_.get();
     return options.table_factory->NewTableReader(
         options, soptions, *last_internal_key_, std::move(source_),
         sink_->contents().size(), &table_reader_);
@@ -380,18 +424,23 @@ class TableConstructor: public Constructor {
     return table_reader_.get();
   }
 
+  // The file the current table reader was opened on; owned by the reader.
+  StringSource* table_source() const { return table_source_; }
+
  private:
   void Reset() {
     uniq_id_ = 0;
     table_reader_.reset();
     sink_.reset();
     source_.reset();
+    table_source_ = nullptr;
   }
   bool convert_to_internal_key_;
 
   uint64_t uniq_id_;
   unique_ptr<StringSink> sink_;
   unique_ptr<StringSource> source_;
+  StringSource* table_source_;
   unique_ptr<TableReader> table_reader_;
 
   TableConstructor();
@@ -552,8 +601,20 @@ static bool LZ4HCCompressionSupported() {
 #endif
 }
 
+static bool ZSTDCompressionSupported() {
+#ifdef ZSTD
+  std::string out;
+  Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  return port::ZSTD_Compress(Options().compression_opts, in.data(), in.size(),
+                             &out);
+#else
+  return false;
+#endif
+}
+
 enum TestType {
   BLOCK_BASED_TABLE_TEST,
+  BLOCK_BASED_TABLE_DELTA_ENCODED_INDEX_TEST,
   PLAIN_TABLE_SEMI_FIXED_PREFIX,
   PLAIN_TABLE_FULL_STR_PREFIX,
   PLAIN_TABLE_TOTAL_ORDER,
@@ -572,10 +633,10 @@ struct TestArgs {
 static std::vector<TestArgs> GenerateArgList() {
   std::vector<TestArgs> test_args;
   std::vector<TestType> test_types = {
-      BLOCK_BASED_TABLE_TEST,      PLAIN_TABLE_SEMI_FIXED_PREFIX,
-      PLAIN_TABLE_FULL_STR_PREFIX, PLAIN_TABLE_TOTAL_ORDER,
-      BLOCK_TEST,                  MEMTABLE_TEST,
-      DB_TEST};
+      BLOCK_BASED_TABLE_TEST,      BLOCK_BASED_TABLE_DELTA_ENCODED_INDEX_TEST,
+      PLAIN_TABLE_SEMI_FIXED_PREFIX, PLAIN_TABLE_FULL_STR_PREFIX,
+      PLAIN_TABLE_TOTAL_ORDER,     BLOCK_TEST,
+      MEMTABLE_TEST,               DB_TEST};
   std::vector<bool> reverse_compare_types = {false, true};
   std::vector<int> restart_intervals = {16, 1, 1024};
 
@@ -597,6 +658,9 @@ static std::vector<TestArgs> GenerateArgList() {
   if (LZ4HCCompressionSupported()) {
     compression_types.push_back(kLZ4HCCompression);
   }
+  if (ZSTDCompressionSupported()) {
+    compression_types.push_back(kZSTDCompression);
+  }
 
   for (auto test_type : test_types) {
     for (auto reverse_compare : reverse_compare_types) {
@@ -692,6 +756,13 @@ class Harness {
         options_.table_factory.reset(new BlockBasedTableFactory(table_options));
         constructor_ = new TableConstructor(options_.comparator);
         break;
+      case BLOCK_BASED_TABLE_DELTA_ENCODED_INDEX_TEST:
+        table_options.index_type =
+            BlockBasedTableOptions::kDeltaEncodedBinarySearch;
+        table_options.index_block_restart_interval = args.restart_interval;
+        options_.table_factory.reset(new BlockBasedTableFactory(table_options));
+        constructor_ = new TableConstructor(options_.comparator);
+        break;
       case PLAIN_TABLE_SEMI_FIXED_PREFIX:
         support_prev_ = false;
         only_support_prefix_seek_ = true;
@@ -1023,6 +1094,7 @@ TEST(BlockBasedTableTest, BasicBlockBasedTableProperties) {
   ASSERT_EQ(raw_value_size, props.raw_value_size);
   ASSERT_EQ(1ul, props.num_data_blocks);
   ASSERT_EQ("", props.filter_policy_name);  // no filter policy is used
+  ASSERT_GT(props.creation_time, 0U);
 
   // Verify data size.
   BlockBuilder block_builder(options, options.comparator);
@@ -1202,6 +1274,94 @@ TEST(BlockBasedTableTest, IndexSizeStat) {
   }
 }
 
+TEST(BlockBasedTableTest, DeltaEncodedIndex) {
+  Random rnd(301);
+  KVMap kvmap;
+  std::vector<std::string> keys;
+  uint64_t index_size[2];
+  std::unique_ptr<TableConstructor> c[2];
+  for (int i = 0; i < 2; ++i) {
+    c[i].reset(new TableConstructor(BytewiseComparator()));
+    for (int k = 0; k < 1000; ++k) {
+      char key[20];
+      snprintf(key, sizeof(key), "key%06d", k * 7);
+      c[i]->Add(key, RandomString(&rnd, 200));
+    }
+    Options options;
+    options.compression = kNoCompression;
+    options.block_size = 1000;
+    BlockBasedTableOptions table_options;
+    if (i == 1) {
+      table_options.index_type =
+          BlockBasedTableOptions::kDeltaEncodedBinarySearch;
+    }
+    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    c[i]->Finish(options, GetPlainInternalComparator(options.comparator),
+                 &keys, &kvmap);
+    index_size[i] = c[i]->table_reader()->GetTableProperties()->index_size;
+  }
+  ASSERT_GT(c[1]->table_reader()->GetTableProperties()->num_data_blocks, 100U);
+  ASSERT_LT(index_size[1] * 2, index_size[0]);
+
+  // Both indexes lead to the same blocks.
+  std::unique_ptr<Iterator> iter(c[1]->NewIterator());
+  for (int k = 0; k < 7000; k += 3) {
+    char key[20];
+    snprintf(key, sizeof(key), "key%06d", k);
+    ASSERT_EQ(c[0]->ApproximateOffsetOf(key), c[1]->ApproximateOffsetOf(key));
+    iter->Seek(key);
+    auto it = kvmap.lower_bound(key);
+    if (it == kvmap.end()) {
+      ASSERT_TRUE(!iter->Valid());
+    } else {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+    }
+  }
+
+  // Scan backwards across all blocks.
+  auto it = kvmap.rbegin();
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev(), ++it) {
+    ASSERT_EQ(it->first, iter->key().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_TRUE(it == kvmap.rend());
+}
+
+TEST(BlockBasedTableTest, DataBlockHashIndexInvalidUtilRatio) {
+  // Non-positive ratios are replaced by the default.
+  const double kRatios[] = {0, -1};
+  for (double ratio : kRatios) {
+    Random rnd(301);
+    TableConstructor c(BytewiseComparator());
+    for (int k = 0; k < 100; ++k) {
+      char key[20];
+      snprintf(key, sizeof(key), "key%06d", k);
+      c.Add(key, RandomString(&rnd, 100));
+    }
+    Options options;
+    options.compression = kNoCompression;
+    BlockBasedTableOptions table_options;
+    table_options.data_block_index_type =
+        BlockBasedTableOptions::kDataBlockBinaryAndHash;
+    table_options.data_block_hash_table_util_ratio = ratio;
+    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    std::vector<std::string> keys;
+    KVMap kvmap;
+    c.Finish(options, GetPlainInternalComparator(options.comparator), &keys,
+             &kvmap);
+
+    std::unique_ptr<Iterator> iter(c.NewIterator());
+    for (const auto& kv : kvmap) {
+      iter->Seek(kv.first);
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(kv.first, iter->key().ToString());
+      ASSERT_EQ(kv.second, iter->value().ToString());
+    }
+  }
+}
+
 TEST(BlockBasedTableTest, NumBlockStat) {
   Random rnd(test::RandomSeed());
   TableConstructor c(BytewiseComparator());
@@ -1224,6 +1384,103 @@ TEST(BlockBasedTableTest, NumBlockStat) {
             c.table_reader()->GetTableProperties()->num_data_blocks);
 }
 
+TEST(BlockBasedTableTest, IteratorReadahead) {
+  Random rnd(test::RandomSeed());
+  TableConstructor c(BytewiseComparator());
+  Options options;
+  options.compression = kNoCompression;
+  options.block_size = 1000;
+
+  for (int i = 0; i < 200; ++i) {
+    c.Add(RandomString(&rnd, 16), RandomString(&rnd, 900));
+  }
+  std::vector<std::string> ks;
+  KVMap kvmap;
+  c.Finish(options, GetPlainInternalComparator(options.comparator), &ks,
+           &kvmap);
+  TableReader* reader = c.table_reader();
+
+  // Short scans never prefetch.
+  {
+    std::unique_ptr<Iterator> iter(reader->NewIterator(ReadOptions()));
+    iter->SeekToFirst();
+    iter->Next();
+    ASSERT_TRUE(iter->Valid());
+  }
+  ASSERT_EQ(0, c.table_source()->num_prefetches());
+
+  // A full scan ramps the readahead window up, so it needs far fewer
+  // prefetches than there are data blocks.
+  int count = 0;
+  {
+    std::unique_ptr<Iterator> iter(reader->NewIterator(ReadOptions()));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ++count;
+    }
+    ASSERT_OK(iter->status());
+  }
+  ASSERT_EQ(200, count);
+  int auto_prefetches = c.table_source()->num_prefetches();
+  ASSERT_GT(auto_prefetches, 0);
+  ASSERT_LT(auto_prefetches, 20);
+
+  // An explicit readahead size prefetches starting from the first block.
+  ReadOptions ro;
+  ro.readahead_size = 64 * 1024;
+  {
+    std::unique_ptr<Iterator> iter(reader->NewIterator(ro));
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+  }
+  ASSERT_EQ(auto_prefetches + 1, c.table_source()->num_prefetches());
+
+  // Nothing is read from the file with kBlockCacheTier.
+  ro.read_tier = kBlockCacheTier;
+  {
+    std::unique_ptr<Iterator> iter(reader->NewIterator(ro));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    }
+  }
+  ASSERT_EQ(auto_prefetches + 1, c.table_source()->num_prefetches());
+}
+
+TEST(BlockBasedTableTest, IteratorReadaheadWithoutPrefetch) {
+  Random rnd(test::RandomSeed());
+  TableConstructor c(BytewiseComparator());
+  Options options;
+  options.compression = kNoCompression;
+  options.block_size = 1000;
+
+  for (int i = 0; i < 200; ++i) {
+    c.Add(RandomString(&rnd, 16), RandomString(&rnd, 900));
+  }
+  std::vector<std::string> ks;
+  KVMap kvmap;
+  c.Finish(options, GetPlainInternalComparator(options.comparator), &ks,
+           &kvmap);
+  TableReader* reader = c.table_reader();
+
+  // The file cannot prefetch, so the iterator reads ahead into its own
+  // buffer: most data blocks are served from it instead of being read one
+  // at a time.
+  c.table_source()->set_prefetch_supported(false);
+  const int reads_before_scan = c.table_source()->num_reads();
+  {
+    std::unique_ptr<Iterator> iter(reader->NewIterator(ReadOptions()));
+    auto kv = kvmap.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++kv) {
+      ASSERT_TRUE(kv != kvmap.end());
+      ASSERT_EQ(kv->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(kv == kvmap.end());
+  }
+  ASSERT_EQ(1, c.table_source()->num_prefetches());
+  ASSERT_GT(c.table_source()->num_multi_reads(), 0);
+  ASSERT_LT(c.table_source()->num_multi_reads(), 20);
+  ASSERT_LT(c.table_source()->num_reads() - reads_before_scan, 10);
+}
+
 // A simple tool that takes the snapshot of block cache statistics.
 class BlockCachePropertiesSnapshot {
  public:
@@ -1277,6 +1534,52 @@ class BlockCachePropertiesSnapshot {
   int64_t filter_block_cache_hit = 0;
 };
 
+TEST(BlockBasedTableTest, MmapReadsInPlace) {
+  Random rnd(301);
+  TableConstructor c(BytewiseComparator());
+  for (int i = 0; i < 100; ++i) {
+    char key[20];
+    snprintf(key, sizeof(key), "key%06d", i);
+    c.Add(key, RandomString(&rnd, 200));
+  }
+  Options options;
+  options.compression = kNoCompression;
+  options.block_size = 1000;
+  options.allow_mmap_reads = true;
+  options.block_cache = NewLRUCache(1 << 20);
+  options.statistics = CreateDBStatistics();
+  std::vector<std::string> keys;
+  KVMap kvmap;
+  c.Finish(options, GetPlainInternalComparator(options.comparator), &keys,
+           &kvmap);
+
+  // The values point into the file contents, and the blocks are not cached.
+  auto ScanAll = [&]() {
+    std::unique_ptr<Iterator> iter(c.NewIterator());
+    auto it = kvmap.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+      ASSERT_TRUE(c.table_source()->Contains(iter->value()));
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(it == kvmap.end());
+  };
+  ScanAll();
+  ASSERT_EQ(0U, options.block_cache->GetUsage());
+  const long misses = options.statistics->getTickerCount(BLOCK_CACHE_DATA_MISS);
+  ASSERT_GT(misses, 0);
+
+  // With bypass_block_cache_for_mmap_reads the block cache is not consulted.
+  BlockBasedTableOptions table_options;
+  table_options.bypass_block_cache_for_mmap_reads = true;
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  ASSERT_OK(c.Reopen(options));
+  ScanAll();
+  ASSERT_EQ(0U, options.block_cache->GetUsage());
+  ASSERT_EQ(misses, options.statistics->getTickerCount(BLOCK_CACHE_DATA_MISS));
+}
+
 // Make sure, by default, index/filter blocks were pre-loaded (meaning we won't
 // use block cache to store them).
 TEST(BlockBasedTableTest, BlockCacheDisabledTest) {
@@ -1500,8 +1803,10 @@ TEST(PlainTableTest, BasicPlainTableProperties) {
   std::unique_ptr<TableProperties> props_guard(props);
   ASSERT_OK(s);
 
-  ASSERT_EQ(0ul, props->index_size);
-  ASSERT_EQ(0ul, props->filter_size);
+  // The index is one hash bucket whose sub index has two of the rows (one
+  // in 16), and the bloom filter has 8 bits for each key.
+  ASSERT_EQ(4ul + 1 + 2 * 4, props->index_size);
+  ASSERT_EQ(26ul, props->filter_size);
   ASSERT_EQ(16ul * 26, props->raw_key_size);
   ASSERT_EQ(28ul * 26, props->raw_value_size);
   ASSERT_EQ(26ul, props->num_entries);
@@ -1538,6 +1843,176 @@ TEST(GeneralTableTest, ApproximateOffsetOfPlain) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"),  610000, 612000));
 }
 
+// Compressing the data blocks on parallel threads must produce the same
+// file as compressing them one by one.
+TEST(BlockBasedTableTest, ParallelCompression) {
+  if (!ZlibCompressionSupported()) {
+    fprintf(stderr, "skipping zlib compression tests\n");
+    return;
+  }
+  Random rnd(301);
+  std::vector<std::pair<std::string, std::string>> kvs;
+  std::string tmp;
+  for (int i = 0; i < 2000; i++) {
+    char user_key[20];
+    snprintf(user_key, sizeof(user_key), "k%06d", i);
+    InternalKey ikey(user_key, i + 1, kTypeValue);
+    // Random values do not compress well enough and are stored raw.
+    std::string value = (i % 7 == 0)
+        ? RandomString(&rnd, 300)
+        : test::CompressibleString(&rnd, 0.25, 300, &tmp).ToString();
+    kvs.emplace_back(ikey.Encode().ToString(), value);
+  }
+
+  // The files record their creation time, which must be the same for all
+  // builds.
+  class FixedTimeEnv : public EnvWrapper {
+   public:
+    explicit FixedTimeEnv(Env* target) : EnvWrapper(target) {}
+    virtual Status GetCurrentTime(int64_t* unix_time) override {
+      *unix_time = 1;
+      return Status::OK();
+    }
+  };
+  FixedTimeEnv env(Env::Default());
+
+  Options options;
+  options.env = &env;
+  options.compression = kZlibCompression;
+  options.block_size = 1024;
+  std::unique_ptr<const FilterPolicy> filter_policy(NewBloomFilterPolicy(10));
+  options.filter_policy = filter_policy.get();
+  InternalKeyComparator ikc(options.comparator);
+
+  auto build = [&](int threads, std::string* contents) {
+    options.compression_opts.parallel_threads = threads;
+    StringSink sink;
+    std::unique_ptr<TableBuilder> builder(
+        options.table_factory->NewTableBuilder(options, ikc, &sink,
+                                               options.compression));
+    for (const auto& kv : kvs) {
+      builder->Add(kv.first, kv.second);
+      ASSERT_OK(builder->status());
+    }
+    ASSERT_OK(builder->Finish());
+    ASSERT_EQ(sink.contents().size(), builder->FileSize());
+    *contents = sink.contents();
+  };
+
+  std::string sequential;
+  build(1, &sequential);
+  for (int threads : {2, 4}) {
+    std::string parallel;
+    build(threads, &parallel);
+    ASSERT_TRUE(parallel == sequential);
+  }
+
+  // Abandoning the builder with blocks in flight.
+  options.compression_opts.parallel_threads = 4;
+  StringSink sink;
+  std::unique_ptr<TableBuilder> builder(options.table_factory->NewTableBuilder(
+      options, ikc, &sink, options.compression));
+  for (size_t i = 0; i < kvs.size() / 2; i++) {
+    builder->Add(kvs[i].first, kvs[i].second);
+  }
+  builder->Abandon();
+}
+
+static void DoCompressionDictionaryTest(CompressionType type) {
+  // Small records that share their field names but little else, so each
+  // block alone compresses poorly.
+  Random rnd(301);
+  KVMap kvmap;
+  for (int i = 0; i < 5000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "k%06d", i);
+    char value[200];
+    snprintf(value, sizeof(value),
+             "{\"user_name\": \"%s\", \"account_balance\": %u, "
+             "\"last_login_timestamp\": %u, \"preferred_language\": \"%s\"}",
+             RandomString(&rnd, 8).c_str(), rnd.Next(), rnd.Next(),
+             i % 2 ? "english" : "french");
+    kvmap[key] = value;
+  }
+
+  Options options;
+  options.compression = type;
+  options.block_size = 512;
+  InternalKeyComparator ikc(options.comparator);
+
+  auto build = [&](int max_dict_bytes, int threads,
+                   std::unique_ptr<TableConstructor>* c) {
+    options.compression_opts.max_dict_bytes = max_dict_bytes;
+    options.compression_opts.parallel_threads = threads;
+    c->reset(new TableConstructor(BytewiseComparator(),
+                                  true /* convert_to_internal_key_ */));
+    for (const auto& kv : kvmap) {
+      (*c)->Add(kv.first, kv.second);
+    }
+    std::vector<std::string> keys;
+    KVMap unused;
+    (*c)->Finish(options, ikc, &keys, &unused);
+    return (*c)->table_reader()->GetTableProperties()->data_size;
+  };
+  auto verify = [&](TableConstructor* c) {
+    std::unique_ptr<Iterator> iter(c->NewIterator());
+    auto expected = kvmap.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++expected) {
+      ASSERT_TRUE(expected != kvmap.end());
+      ASSERT_EQ(expected->first, iter->key().ToString());
+      ASSERT_EQ(expected->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(expected == kvmap.end());
+  };
+
+  std::unique_ptr<TableConstructor> c;
+  const uint64_t plain_size = build(0, 1, &c);
+  // The dictionary is sampled from the first 100 * 1KB of data, and the
+  // later blocks are compressed with it as they come.
+  for (int threads : {1, 2}) {
+    const uint64_t dict_size = build(1024, threads, &c);
+    ASSERT_LT(dict_size, plain_size * 3 / 4);
+    verify(c.get());
+  }
+
+  // The dictionary is also used to uncompress the blocks of the compressed
+  // block cache.
+  options.block_cache_compressed = NewLRUCache(8 << 20);
+  build(16 << 10, 1, &c);
+  verify(c.get());
+  verify(c.get());
+  options.block_cache_compressed.reset();
+
+  // zlib only keeps a window's worth of the dictionary, so a small window
+  // caps the dictionary, and the buffering for it, below max_dict_bytes.
+  if (type == kZlibCompression) {
+    options.compression_opts.window_bits = -9;
+    build(16 << 10, 1, &c);
+    verify(c.get());
+    options.compression_opts.window_bits = -14;
+  }
+
+  // A table with too little data to fill the buffer is held back in full.
+  kvmap.erase(kvmap.begin(), std::next(kvmap.begin(), 4900));
+  build(16 << 10, 1, &c);
+  verify(c.get());
+}
+
+TEST(BlockBasedTableTest, CompressionDictionary) {
+  if (!ZlibCompressionSupported()) {
+    fprintf(stderr, "skipping zlib compression tests\n");
+  } else {
+    DoCompressionDictionaryTest(kZlibCompression);
+  }
+
+  if (!ZSTDCompressionSupported()) {
+    fprintf(stderr, "skipping zstd compression tests\n");
+  } else {
+    DoCompressionDictionaryTest(kZSTDCompression);
+  }
+}
+
 static void DoCompressionTest(CompressionType comp) {
   Random rnd(301);
   TableConstructor c(BytewiseComparator());
@@ -1597,6 +2072,12 @@ TEST(GeneralTableTest, ApproximateOffsetOfCompressed) {
     compression_state.push_back(kLZ4HCCompression);
   }
 
+  if (!ZSTDCompressionSupported()) {
+    fprintf(stderr, "skipping zstd compression tests\n");
+  } else {
+    compression_state.push_back(kZSTDCompression);
+  }
+
   for (auto state : compression_state) {
     DoCompressionTest(state);
   }
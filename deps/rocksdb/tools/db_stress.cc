@@ -297,6 +297,8 @@ enum rocksdb::CompressionType StringToCompressionType(const char* ctype) {
     return rocksdb::kLZ4Compression;
   else if (!strcasecmp(ctype, "lz4hc"))
     return rocksdb::kLZ4HCCompression;
+  else if (!strcasecmp(ctype, "zstd"))
+    return rocksdb::kZSTDCompression;
 
   fprintf(stdout, "Cannot parse compression type '%s'\n", ctype);
   return rocksdb::kSnappyCompression; //default value
@@ -1464,6 +1466,9 @@ class StressTest {
       case rocksdb::kLZ4HCCompression:
         compression = "lz4hc";
         break;
+      case rocksdb::kZSTDCompression:
+        compression = "zstd";
+        break;
       }
 
     fprintf(stdout, "Compression         : %s\n", compression);
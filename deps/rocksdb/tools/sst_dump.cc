@@ -81,6 +81,7 @@ SstFileReader::SstFileReader(const std::string& file_path,
 
 extern uint64_t kBlockBasedTableMagicNumber;
 extern uint64_t kPlainTableMagicNumber;
+extern uint64_t kCuckooTableMagicNumber;
 
 Status SstFileReader::NewTableReader(const std::string& file_path) {
   uint64_t magic_number;
@@ -102,7 +103,8 @@ Status SstFileReader::NewTableReader(const std::string& file_path) {
   }
 
   if (s.ok()) {
-    if (magic_number == kPlainTableMagicNumber) {
+    if (magic_number == kPlainTableMagicNumber ||
+        magic_number == kCuckooTableMagicNumber) {
       soptions_.use_mmap_reads = true;
     }
     options_.comparator = &internal_comparator_;
@@ -138,6 +140,10 @@ Status SstFileReader::SetTableOptionsByMagicNumber(uint64_t table_magic_number,
         table_properties->fixed_key_len, 2, 0.8);
     options_.prefix_extractor.reset(NewNoopTransform());
     fprintf(stdout, "Sst file format: plain table\n");
+  } else if (table_magic_number == kCuckooTableMagicNumber) {
+    options_.allow_mmap_reads = true;
+    options_.table_factory.reset(NewCuckooTableFactory());
+    fprintf(stdout, "Sst file format: cuckoo table\n");
   } else {
     char error_msg_buffer[80];
     snprintf(error_msg_buffer, sizeof(error_msg_buffer) - 1,
@@ -10,6 +10,7 @@
 #include "rocksdb/filter_policy.h"
 
 #include "rocksdb/slice.h"
+#include "util/coding.h"
 #include "util/hash.h"
 
 namespace rocksdb {
@@ -102,10 +103,112 @@ class BloomFilterPolicy : public FilterPolicy {
     return true;
   }
 };
+
+// A bloom filter that is split into 64-byte blocks. The first hash picks a
+// block and all k probes are done inside it, so a query costs one cache
+// miss regardless of k. The probe sequence is the same double hashing used
+// by BloomFilterPolicy and DynamicBloom's blocked mode.
+//
+// Filter layout:
+//   [block 0] ... [block num_blocks-1]  (kBytesPerBlock bytes each)
+//   num_probes: uint8
+//   num_blocks: fixed32
+//
+// The block size is part of the on-disk format and so is fixed at 64 bytes
+// instead of following the platform's CACHE_LINE_SIZE.
+class BlockedBloomFilterPolicy : public FilterPolicy {
+ private:
+  static const uint32_t kBytesPerBlock = 64;
+  static const uint32_t kBitsPerBlock = kBytesPerBlock * 8;
+  static const size_t kTrailerSize = 1 + sizeof(uint32_t);
+
+  size_t bits_per_key_;
+  size_t k_;
+  uint32_t (*hash_func_)(const Slice& key);
+
+  static uint32_t BlockIndex(uint32_t h, uint32_t num_blocks) {
+    return (h >> 11 | (h << 21)) % num_blocks;
+  }
+
+ public:
+  explicit BlockedBloomFilterPolicy(int bits_per_key)
+      : bits_per_key_(bits_per_key), hash_func_(BloomHash) {
+    // Same choice of k as BloomFilterPolicy. Blocking costs a little false
+    // positive rate but a larger k does not win it back at these sizes.
+    k_ = static_cast<size_t>(bits_per_key_ * 0.69);  // 0.69 =~ ln(2)
+    if (k_ < 1) k_ = 1;
+    if (k_ > 30) k_ = 30;
+  }
+
+  virtual const char* Name() const {
+    return "rocksdb.BuiltinBlockedBloomFilter";
+  }
+
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    size_t bits = n * bits_per_key_;
+    uint32_t num_blocks =
+        static_cast<uint32_t>((bits + kBitsPerBlock - 1) / kBitsPerBlock);
+    if (num_blocks == 0) num_blocks = 1;
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + num_blocks * kBytesPerBlock, 0);
+    dst->push_back(static_cast<char>(k_));  // Remember # of probes in filter
+    PutFixed32(dst, num_blocks);
+    char* array = &(*dst)[init_size];
+    for (size_t i = 0; i < (size_t)n; i++) {
+      uint32_t h = hash_func_(keys[i]);
+      const uint32_t delta = (h >> 17) | (h << 15);  // Rotate right 17 bits
+      char* block = array + BlockIndex(h, num_blocks) * kBytesPerBlock;
+      for (size_t j = 0; j < k_; j++) {
+        const uint32_t bitpos = h % kBitsPerBlock;
+        block[bitpos / 8] |= (1 << (bitpos % 8));
+        h += delta;
+      }
+    }
+  }
+
+  virtual bool KeyMayMatch(const Slice& key, const Slice& bloom_filter) const {
+    const size_t len = bloom_filter.size();
+    if (len < kTrailerSize) return false;
+
+    const char* array = bloom_filter.data();
+    const size_t k = static_cast<unsigned char>(array[len - kTrailerSize]);
+    const uint32_t num_blocks = DecodeFixed32(array + len - sizeof(uint32_t));
+    if (k < 1 || k > 30 || num_blocks == 0 ||
+        len != num_blocks * kBytesPerBlock + kTrailerSize) {
+      // Unknown or corrupted encoding. Consider it a match.
+      return true;
+    }
+
+    uint32_t h = hash_func_(key);
+    const uint32_t delta = (h >> 17) | (h << 15);  // Rotate right 17 bits
+    const char* block = array + BlockIndex(h, num_blocks) * kBytesPerBlock;
+
+    // Build the probe mask for the whole block first and then compare it
+    // against the block in one pass. Neither loop has a data dependent
+    // branch, so the check is a few (vectorizable) and/xor instructions on
+    // a single cache line instead of k dependent loads.
+    unsigned char mask[kBytesPerBlock] = {0};
+    for (size_t j = 0; j < k; j++) {
+      const uint32_t bitpos = h % kBitsPerBlock;
+      mask[bitpos / 8] |= (1 << (bitpos % 8));
+      h += delta;
+    }
+    unsigned char missing = 0;
+    for (uint32_t i = 0; i < kBytesPerBlock; i++) {
+      missing |= (block[i] & mask[i]) ^ mask[i];
+    }
+    return missing == 0;
+  }
+};
 }
 
 const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
   return new BloomFilterPolicy(bits_per_key);
 }
 
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key);
+}
+
 }  // namespace rocksdb
@@ -16,7 +16,10 @@ int main() {
 #else
 
 #include <gflags/gflags.h>
+#include <memory>
+#include <vector>
 
+#include "rocksdb/env.h"
 #include "rocksdb/filter_policy.h"
 
 #include "util/logging.h"
@@ -26,6 +29,12 @@ int main() {
 using GFLAGS::ParseCommandLineFlags;
 
 DEFINE_int32(bits_per_key, 10, "");
+DEFINE_bool(run_probe_benchmark, false,
+            "Run the probe benchmark, which is too slow for every test run");
+DEFINE_int32(bench_num_keys, 1000000,
+             "Number of keys in the filter used by the probe benchmark");
+DEFINE_int32(bench_num_probes, 1000000,
+             "Number of lookups done by the probe benchmark");
 
 namespace rocksdb {
 
@@ -44,6 +53,7 @@ class BloomTest {
 
  public:
   BloomTest() : policy_(NewBloomFilterPolicy(FLAGS_bits_per_key)) { }
+  explicit BloomTest(const FilterPolicy* policy) : policy_(policy) { }
 
   ~BloomTest() {
     delete policy_;
@@ -169,6 +179,112 @@ TEST(BloomTest, VaryingLengths) {
   ASSERT_LE(mediocre_filters, good_filters/5);
 }
 
+class BlockedBloomTest : public BloomTest {
+ public:
+  BlockedBloomTest()
+      : BloomTest(NewBlockedBloomFilterPolicy(FLAGS_bits_per_key)) { }
+};
+
+TEST(BlockedBloomTest, BlockedEmptyFilter) {
+  ASSERT_TRUE(! Matches("hello"));
+  ASSERT_TRUE(! Matches("world"));
+}
+
+TEST(BlockedBloomTest, BlockedSmall) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(! Matches("x"));
+  ASSERT_TRUE(! Matches("foo"));
+}
+
+TEST(BlockedBloomTest, BlockedVaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Count number of filters that significantly exceed the false positive rate
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // Filters are rounded up to whole 64-byte blocks plus a 5-byte trailer.
+    ASSERT_LE(FilterSize(), (size_t)((length * 10 / 8) + 64 + 5)) << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    // Check false positive rate
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      fprintf(stderr, "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+              rate*100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.03);   // Must not be over 3%
+    if (rate > 0.02) mediocre_filters++;  // Allowed, but not too often
+    else good_filters++;
+  }
+  if (kVerbose >= 1) {
+    fprintf(stderr, "Filters: %d good, %d mediocre\n",
+            good_filters, mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters/5);
+}
+
+// Compare false positive rate and probe cost of the two builtin policies on
+// a filter much larger than the CPU caches.
+static void BenchmarkPolicy(const char* name, const FilterPolicy* policy) {
+  const int num_keys = FLAGS_bench_num_keys;
+  const int num_probes = FLAGS_bench_num_probes;
+  std::vector<std::string> keys;
+  keys.reserve(num_keys);
+  char buffer[sizeof(int)];
+  for (int i = 0; i < num_keys; i++) {
+    keys.push_back(Key(i, buffer).ToString());
+  }
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  std::string filter;
+  policy->CreateFilter(&key_slices[0], num_keys, &filter);
+
+  Env* env = Env::Default();
+  uint64_t start = env->NowNanos();
+  int matches = 0;
+  for (int i = 0; i < num_probes; i++) {
+    if (policy->KeyMayMatch(Key(i + 1000000000, buffer), filter)) {
+      matches++;
+    }
+  }
+  uint64_t elapsed = env->NowNanos() - start;
+  if (kVerbose >= 1) {
+    fprintf(stderr,
+            "%-14s bytes = %9d ; false positives = %5.2f%% ; "
+            "%6.1f ns/probe\n",
+            name, static_cast<int>(filter.size()),
+            matches * 100.0 / num_probes,
+            static_cast<double>(elapsed) / num_probes);
+  }
+}
+
+TEST(BloomTest, ProbeBenchmark) {
+  if (!FLAGS_run_probe_benchmark) {
+    return;
+  }
+  std::unique_ptr<const FilterPolicy> bloom(
+      NewBloomFilterPolicy(FLAGS_bits_per_key));
+  std::unique_ptr<const FilterPolicy> blocked(
+      NewBlockedBloomFilterPolicy(FLAGS_bits_per_key));
+  BenchmarkPolicy("bloom", bloom.get());
+  BenchmarkPolicy("blocked bloom", blocked.get());
+}
+
 // Different bits-per-byte
 
 }  // namespace rocksdb
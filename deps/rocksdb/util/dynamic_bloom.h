@@ -5,14 +5,15 @@
 
 #pragma once
 
+#include <string.h>
 #include <atomic>
 #include <memory>
 
+#include "rocksdb/slice.h"
 #include <util/arena.h>
 
 namespace rocksdb {
 
-class Slice;
 class Logger;
 
 class DynamicBloom {
@@ -47,6 +48,14 @@ class DynamicBloom {
   // Multithreaded access to this function is OK
   bool MayContainHash(uint32_t hash);
 
+  // The bits of the filter, to store it.
+  Slice GetRawData() const;
+
+  // Replace the bits of the filter with `raw`, the GetRawData() of a filter
+  // of the same size, cl_per_block and num_probes.
+  // Assuming single threaded access to this function.
+  void SetRawData(const Slice& raw);
+
  private:
   const bool kBlocked;
   const uint32_t kBitsPerBlock;
@@ -61,6 +70,15 @@ class DynamicBloom {
   Arena arena_;
 };
 
+inline Slice DynamicBloom::GetRawData() const {
+  return Slice(reinterpret_cast<const char*>(data_), kTotalBits / 8);
+}
+
+inline void DynamicBloom::SetRawData(const Slice& raw) {
+  assert(raw.size() == kTotalBits / 8);
+  memcpy(data_, raw.data(), raw.size());
+}
+
 inline void DynamicBloom::Add(const Slice& key) { AddHash(hash_func_(key)); }
 
 inline bool DynamicBloom::MayContain(const Slice& key) {
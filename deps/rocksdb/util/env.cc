@@ -224,18 +224,26 @@ void AssignEnvOptions(EnvOptions* env_options, const DBOptions& options) {
   env_options->use_os_buffer = options.allow_os_buffer;
   env_options->use_mmap_reads = options.allow_mmap_reads;
   env_options->use_mmap_writes = options.allow_mmap_writes;
+  env_options->use_direct_reads = options.use_direct_reads;
+  env_options->use_direct_writes = options.use_direct_writes;
   env_options->set_fd_cloexec = options.is_fd_close_on_exec;
   env_options->bytes_per_sync = options.bytes_per_sync;
 }
 
 }
 
+// Log and manifest files are appended in small records and synced often;
+// they are not worth the alignment overhead of direct I/O.
 EnvOptions Env::OptimizeForLogWrite(const EnvOptions& env_options) const {
-  return env_options;
+  EnvOptions optimized = env_options;
+  optimized.use_direct_writes = false;
+  return optimized;
 }
 
 EnvOptions Env::OptimizeForManifestWrite(const EnvOptions& env_options) const {
-  return env_options;
+  EnvOptions optimized = env_options;
+  optimized.use_direct_writes = false;
+  return optimized;
 }
 
 EnvOptions::EnvOptions(const DBOptions& options) {
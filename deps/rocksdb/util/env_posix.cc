@@ -7,6 +7,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <algorithm>
 #include <deque>
 #include <set>
 #include <dirent.h>
@@ -33,6 +34,10 @@
 #if defined(LEVELDB_PLATFORM_ANDROID)
 #include <sys/stat.h>
 #endif
+#ifdef ROCKSDB_IOURING_PRESENT
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
 #include "rocksdb/env.h"
 #include "rocksdb/slice.h"
 #include "port/port.h"
@@ -40,6 +45,7 @@
 #include "util/logging.h"
 #include "util/posix_logger.h"
 #include "util/random.h"
+#include "util/thread_local.h"
 #include <signal.h>
 
 // Get nano time for mach systems
@@ -94,6 +100,280 @@ static Status IOError(const std::string& context, int err_number) {
   return Status::IOError(context, strerror(err_number));
 }
 
+// O_DIRECT requires the file offset, the transfer size and the memory buffer
+// to be multiples of the logical block size of the device. 4KB satisfies
+// both 512-byte and 4KB sector devices.
+static const size_t kDirectIOAlignment = 4096;
+
+// Size of the write buffer of files opened with O_DIRECT
+static const size_t kDirectIOBufferSize = 1 << 20;
+
+static inline size_t RoundUpToAlignment(size_t n) {
+  return (n + kDirectIOAlignment - 1) & ~(kDirectIOAlignment - 1);
+}
+
+// Returns kDirectIOAlignment-aligned memory, to be released with free().
+static char* NewAlignedBuffer(size_t size) {
+  void* buf = nullptr;
+  if (posix_memalign(&buf, kDirectIOAlignment, size) != 0) {
+    return nullptr;
+  }
+  return static_cast<char*>(buf);
+}
+
+struct AlignedBuffer {
+  char* data = nullptr;
+  size_t capacity = 0;
+};
+
+static void DeleteAlignedBuffer(void* ptr) {
+  AlignedBuffer* buf = static_cast<AlignedBuffer*>(ptr);
+  free(buf->data);
+  delete buf;
+}
+
+// Returns an aligned buffer of at least "size" bytes that belongs to the
+// calling thread and is reused by its later direct reads, or nullptr if it
+// cannot be allocated. Only sizes up to kDirectIOBufferSize are kept.
+static char* GetThreadLocalAlignedBuffer(size_t size) {
+  assert(size <= kDirectIOBufferSize);
+  // Never deleted: threads may still exit after static destruction
+  static ThreadLocalPtr* const tls_buffer =
+      new ThreadLocalPtr(&DeleteAlignedBuffer);
+
+  AlignedBuffer* buf = static_cast<AlignedBuffer*>(tls_buffer->Get());
+  if (buf == nullptr) {
+    buf = new AlignedBuffer;
+    tls_buffer->Reset(buf);
+  }
+  if (buf->capacity < size) {
+    // Grow geometrically so that a thread reading ever larger blocks does
+    // not reallocate on every read.
+    const size_t capacity =
+        std::min(std::max(size, 2 * buf->capacity), kDirectIOBufferSize);
+    char* data = NewAlignedBuffer(capacity);
+    if (data == nullptr) {
+      return nullptr;
+    }
+    free(buf->data);
+    buf->data = data;
+    buf->capacity = capacity;
+  }
+  return buf->data;
+}
+
+#ifdef ROCKSDB_IOURING_PRESENT
+// Maximum number of reads a thread keeps in flight with io_uring
+static const unsigned kIOUringDepth = 64;
+
+// A minimal io_uring instance that issues reads through the raw system
+// calls. Each instance is only used by the thread that created it.
+class IOUring {
+ public:
+  // Returns nullptr if the kernel does not support io_uring.
+  static IOUring* Create(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+      return nullptr;
+    }
+    std::unique_ptr<IOUring> ring(new IOUring(fd));
+    if (!ring->MapRings(params)) {
+      return nullptr;
+    }
+    return ring.release();
+  }
+
+  ~IOUring() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    close(fd_);
+  }
+
+  unsigned depth() const { return sq_entries_; }
+
+  // Queues a read of "len" bytes at "offset" of "fd" into "buf". Up to
+  // depth() reads can be queued before SubmitAndWait().
+  void PrepareRead(int fd, char* buf, size_t len, uint64_t offset,
+                   uint64_t tag) {
+    assert(queued_ < sq_entries_);
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & *sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->off = offset;
+    sqe->user_data = tag;
+    sq_array_[index] = index;
+    // publish the entry before the kernel can see the new tail
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++queued_;
+  }
+
+  // Submits the queued reads and waits for all of them. The outcome of the
+  // read tagged t (bytes read or -errno) goes to results[t]. Returns false
+  // if some reads could not be submitted; their results are left alone and
+  // the ring must not be used anymore. Either way, no submitted read is
+  // still in flight on return, since they all read into the callers'
+  // buffers.
+  bool SubmitAndWait(int* results) {
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    bool ok = true;
+    while (completed < submitted || (ok && submitted < queued_)) {
+      int r = 0;
+      if (ok) {
+        r = syscall(__NR_io_uring_enter, fd_, queued_ - submitted, 1,
+                    IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (r < 0) {
+          // EBUSY means the completion ring is full: reap it before retrying
+          if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            ok = false;
+          }
+          r = 0;
+        }
+      } else {
+        // io_uring_enter() failed for good. The completion ring needs no
+        // system call, so poll it until the reads in flight are done.
+        usleep(kPollMicros);
+      }
+      submitted += r;
+
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+        const struct io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+        results[cqe->user_data] = cqe->res;
+        ++completed;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    queued_ = 0;
+    return ok;
+  }
+
+ private:
+  // How often SubmitAndWait() polls for the reads in flight once
+  // io_uring_enter() fails for good
+  static const unsigned kPollMicros = 1000;
+
+  explicit IOUring(int fd)
+      : fd_(fd),
+        sq_ring_(MAP_FAILED),
+        cq_ring_(MAP_FAILED),
+        sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+        queued_(0) {}
+
+  bool MapRings(const struct io_uring_params& params) {
+    sq_entries_ = params.sq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    if (single_mmap) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED) {
+        return false;
+      }
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe*>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  int fd_;
+  void* sq_ring_;
+  void* cq_ring_;
+  struct io_uring_sqe* sqes_;
+  size_t sq_ring_size_;
+  size_t cq_ring_size_;
+  size_t sqes_size_;
+  unsigned sq_entries_;
+  unsigned queued_;
+
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  struct io_uring_cqe* cqes_;
+};
+
+static void DeleteIOUring(void* ptr) {
+  delete static_cast<IOUring*>(ptr);
+}
+
+// Every thread gets its own io_uring instance on first use, and it is
+// destroyed when the thread exits.
+static ThreadLocalPtr* ThreadLocalIOUring() {
+  // Never deleted: threads may still exit after static destruction
+  static ThreadLocalPtr* const tls_ring = new ThreadLocalPtr(&DeleteIOUring);
+  return tls_ring;
+}
+
+// Returns the io_uring instance of this thread, or nullptr if io_uring
+// cannot be used, in which case callers fall back to synchronous reads.
+static IOUring* GetThreadLocalIOUring() {
+  static std::atomic<bool> io_uring_unsupported(false);
+
+  IOUring* ring = static_cast<IOUring*>(ThreadLocalIOUring()->Get());
+  if (ring == nullptr &&
+      !io_uring_unsupported.load(std::memory_order_relaxed)) {
+    ring = IOUring::Create(kIOUringDepth);
+    if (ring == nullptr) {
+      io_uring_unsupported.store(true, std::memory_order_relaxed);
+    } else {
+      ThreadLocalIOUring()->Reset(ring);
+    }
+  }
+  return ring;
+}
+
+// Destroys the io_uring instance of this thread after it failed; the next
+// GetThreadLocalIOUring() creates a new one.
+static void ResetThreadLocalIOUring() {
+  delete static_cast<IOUring*>(ThreadLocalIOUring()->Swap(nullptr));
+}
+#endif  // ROCKSDB_IOURING_PRESENT
+
 #ifdef NDEBUG
 // empty in release build
 #define TEST_KILL_RANDOM(rocksdb_kill_odds)
@@ -225,17 +505,22 @@ class PosixRandomAccessFile: public RandomAccessFile {
   std::string filename_;
   int fd_;
   bool use_os_buffer_;
+  bool use_direct_io_;
 
  public:
   PosixRandomAccessFile(const std::string& fname, int fd,
                         const EnvOptions& options)
-      : filename_(fname), fd_(fd), use_os_buffer_(options.use_os_buffer) {
+      : filename_(fname), fd_(fd), use_os_buffer_(options.use_os_buffer),
+        use_direct_io_(options.use_direct_reads) {
     assert(!options.use_mmap_reads);
   }
   virtual ~PosixRandomAccessFile() { close(fd_); }
 
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const {
+    if (use_direct_io_) {
+      return DirectRead(offset, n, result, scratch);
+    }
     Status s;
     ssize_t r = -1;
     do {
@@ -283,6 +568,99 @@ class PosixRandomAccessFile: public RandomAccessFile {
     }
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t n) {
+    if (!use_os_buffer_ || use_direct_io_) {
+      // Pages are dropped after every read or never cached at all,
+      // prefetching would be wasted.
+      return Status::NotSupported("no page cache to prefetch into");
+    }
+    // The kernel starts the reads and returns without waiting for them.
+    Fadvise(fd_, static_cast<off_t>(offset), n, POSIX_FADV_WILLNEED);
+    return Status::OK();
+  }
+
+#ifdef ROCKSDB_IOURING_PRESENT
+  // Submits the reads to the io_uring instance of the calling thread, up to
+  // kIOUringDepth at a time, so that the device works on all of them at
+  // once instead of one pread() after the other.
+  virtual void MultiRead(ReadRequest* reqs, size_t num_reqs) {
+    IOUring* ring = num_reqs > 1 ? GetThreadLocalIOUring() : nullptr;
+    if (ring == nullptr) {
+      RandomAccessFile::MultiRead(reqs, num_reqs);
+      return;
+    }
+    const size_t depth = std::min<size_t>(ring->depth(), kIOUringDepth);
+
+    for (size_t start = 0; start < num_reqs; start += depth) {
+      ReadRequest* batch = reqs + start;
+      const size_t n = std::min(depth, num_reqs - start);
+
+      // With O_DIRECT, every read covers the enclosing aligned range and
+      // lands in an aligned bounce buffer, as in DirectRead().
+      size_t skip[kIOUringDepth];
+      size_t buf_offset[kIOUringDepth];
+      std::unique_ptr<char, void (*)(void*)> bounce(nullptr, free);
+      if (use_direct_io_) {
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i) {
+          skip[i] = static_cast<size_t>(batch[i].offset &
+                                        (kDirectIOAlignment - 1));
+          buf_offset[i] = total;
+          total += RoundUpToAlignment(skip[i] + batch[i].len);
+        }
+        bounce.reset(NewAlignedBuffer(total));
+        if (bounce == nullptr) {
+          RandomAccessFile::MultiRead(batch, n);
+          continue;
+        }
+      }
+
+      for (size_t i = 0; i < n; ++i) {
+        if (use_direct_io_) {
+          ring->PrepareRead(fd_, bounce.get() + buf_offset[i],
+                            RoundUpToAlignment(skip[i] + batch[i].len),
+                            batch[i].offset - skip[i], i);
+        } else {
+          ring->PrepareRead(fd_, batch[i].scratch, batch[i].len,
+                            batch[i].offset, i);
+        }
+      }
+      int results[kIOUringDepth];
+      if (!ring->SubmitAndWait(results)) {
+        // Give up on io_uring for this thread and read the rest one by one
+        ResetThreadLocalIOUring();
+        RandomAccessFile::MultiRead(batch, num_reqs - start);
+        return;
+      }
+
+      for (size_t i = 0; i < n; ++i) {
+        ReadRequest& req = batch[i];
+        if (results[i] == -EINVAL) {
+          // IORING_OP_READ is missing before Linux 5.6
+          req.status = Read(req.offset, req.len, &req.result, req.scratch);
+          continue;
+        }
+        if (results[i] < 0) {
+          req.result = Slice(req.scratch, 0);
+          req.status = IOError(filename_, -results[i]);
+          continue;
+        }
+        size_t got = static_cast<size_t>(results[i]);
+        if (use_direct_io_) {
+          // A short read means the range extends past the end of the file.
+          got = got > skip[i] ? std::min(got - skip[i], req.len) : 0;
+          memcpy(req.scratch, bounce.get() + buf_offset[i] + skip[i], got);
+        }
+        req.result = Slice(req.scratch, got);
+        req.status = Status::OK();
+      }
+    }
+    if (!use_os_buffer_ && !use_direct_io_) {
+      Fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED); // free OS pages
+    }
+  }
+#endif
+
   virtual Status InvalidateCache(size_t offset, size_t length) {
 #ifndef OS_LINUX
     return Status::OK();
@@ -295,6 +673,54 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return IOError(filename_, errno);
 #endif
   }
+
+ private:
+  // Reads the aligned range that covers [offset, offset + n) into a bounce
+  // buffer and copies the requested bytes to scratch. The bounce buffer of
+  // the calling thread is reused across reads, and it is skipped entirely
+  // when the request itself is aligned.
+  Status DirectRead(uint64_t offset, size_t n, Slice* result,
+                    char* scratch) const {
+    const uint64_t aligned_offset =
+        offset & ~static_cast<uint64_t>(kDirectIOAlignment - 1);
+    const size_t skip = static_cast<size_t>(offset - aligned_offset);
+    const size_t aligned_n = RoundUpToAlignment(skip + n);
+    char* buf = nullptr;
+    std::unique_ptr<char, void (*)(void*)> large_buf(nullptr, free);
+    if (skip == 0 && aligned_n == n &&
+        (reinterpret_cast<uintptr_t>(scratch) & (kDirectIOAlignment - 1)) ==
+            0) {
+      buf = scratch;
+    } else if (aligned_n <= kDirectIOBufferSize) {
+      buf = GetThreadLocalAlignedBuffer(aligned_n);
+    } else {
+      large_buf.reset(NewAlignedBuffer(aligned_n));
+      buf = large_buf.get();
+    }
+    if (buf == nullptr) {
+      *result = Slice(scratch, 0);
+      return Status::IOError(filename_, "cannot allocate aligned buffer");
+    }
+
+    ssize_t r = -1;
+    do {
+      r = pread(fd_, buf, aligned_n, static_cast<off_t>(aligned_offset));
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) {
+      *result = Slice(scratch, 0);
+      return IOError(filename_, errno);
+    }
+    // A short read means the range extends past the end of the file.
+    size_t got = static_cast<size_t>(r) > skip ? r - skip : 0;
+    if (got > n) {
+      got = n;
+    }
+    if (buf != scratch) {
+      memcpy(scratch, buf + skip, got);
+    }
+    *result = Slice(scratch, got);
+    return Status::OK();
+  }
 };
 
 // mmap() based random-access
@@ -334,6 +760,12 @@ class PosixMmapReadableFile: public RandomAccessFile {
     }
     return s;
   }
+  virtual bool ReadsInPlace() const { return true; }
+  virtual Status Prefetch(uint64_t offset, size_t n) {
+    // Populate the page cache so that touching the mapping does not block.
+    Fadvise(fd_, static_cast<off_t>(offset), n, POSIX_FADV_WILLNEED);
+    return Status::OK();
+  }
   virtual Status InvalidateCache(size_t offset, size_t length) {
 #ifndef OS_LINUX
     return Status::OK();
@@ -834,6 +1266,195 @@ class PosixWritableFile : public WritableFile {
 #endif
 };
 
+// Writable file opened with O_DIRECT. Appends are gathered in an aligned
+// buffer and written a whole buffer at a time, without going through the OS
+// page cache. A partial block at the end of the buffer is padded with zeroes
+// when it has to be written out early (by Sync or Close); it stays in the
+// buffer and is rewritten at the same offset as more data arrives. Close()
+// truncates the padding away.
+class PosixDirectWritableFile : public WritableFile {
+ private:
+  const std::string filename_;
+  int fd_;
+  char* buf_;            // kDirectIOBufferSize bytes, aligned
+  size_t cursize_;       // current size of buffered data in buf_
+  uint64_t buf_offset_;  // file offset of buf_[0], always aligned
+  uint64_t filesize_;
+  bool buf_dirty_;       // buf_ holds data that was not written out yet
+  bool pending_sync_;
+  bool pending_fsync_;
+#ifdef ROCKSDB_FALLOCATE_PRESENT
+  bool fallocate_with_keep_size_;
+#endif
+
+ public:
+  PosixDirectWritableFile(const std::string& fname, int fd, char* buf,
+                          const EnvOptions& options)
+      : filename_(fname),
+        fd_(fd),
+        buf_(buf),
+        cursize_(0),
+        buf_offset_(0),
+        filesize_(0),
+        buf_dirty_(false),
+        pending_sync_(false),
+        pending_fsync_(false) {
+#ifdef ROCKSDB_FALLOCATE_PRESENT
+    fallocate_with_keep_size_ = options.fallocate_with_keep_size;
+#endif
+    assert(options.use_direct_writes);
+  }
+
+  ~PosixDirectWritableFile() {
+    if (fd_ >= 0) {
+      PosixDirectWritableFile::Close();
+    }
+    free(buf_);
+  }
+
+  virtual Status Append(const Slice& data) {
+    const char* src = data.data();
+    size_t left = data.size();
+    pending_sync_ = true;
+    pending_fsync_ = true;
+
+    TEST_KILL_RANDOM(rocksdb_kill_odds * REDUCE_ODDS2);
+
+    PrepareWrite(GetFileSize(), left);
+    while (left != 0) {
+      size_t n = std::min(left, kDirectIOBufferSize - cursize_);
+      memcpy(buf_ + cursize_, src, n);
+      cursize_ += n;
+      src += n;
+      left -= n;
+      buf_dirty_ = true;
+      if (cursize_ == kDirectIOBufferSize) {
+        Status s = WriteBuffer();
+        if (!s.ok()) {
+          return s;
+        }
+      }
+    }
+    filesize_ += data.size();
+    return Status::OK();
+  }
+
+  virtual Status Close() {
+    Status s = WriteBuffer();
+
+    TEST_KILL_RANDOM(rocksdb_kill_odds);
+
+    // trim the padding of the last block and any preallocated space
+    if (s.ok() && ftruncate(fd_, filesize_) < 0) {
+      s = IOError(filename_, errno);
+    }
+    if (close(fd_) < 0) {
+      if (s.ok()) {
+        s = IOError(filename_, errno);
+      }
+    }
+    fd_ = -1;
+    return s;
+  }
+
+  // There is no OS cache to hand the data to; it is written out when the
+  // buffer fills up, or on Sync(), Fsync() and Close().
+  virtual Status Flush() {
+    return Status::OK();
+  }
+
+  virtual Status Sync() {
+    Status s = WriteBuffer();
+    if (!s.ok()) {
+      return s;
+    }
+    TEST_KILL_RANDOM(rocksdb_kill_odds);
+    // O_DIRECT does not persist the file size and allocation metadata
+    if (pending_sync_ && fdatasync(fd_) < 0) {
+      return IOError(filename_, errno);
+    }
+    TEST_KILL_RANDOM(rocksdb_kill_odds);
+    pending_sync_ = false;
+    return Status::OK();
+  }
+
+  virtual Status Fsync() {
+    Status s = WriteBuffer();
+    if (!s.ok()) {
+      return s;
+    }
+    TEST_KILL_RANDOM(rocksdb_kill_odds);
+    if (pending_fsync_ && fsync(fd_) < 0) {
+      return IOError(filename_, errno);
+    }
+    TEST_KILL_RANDOM(rocksdb_kill_odds);
+    pending_fsync_ = false;
+    pending_sync_ = false;
+    return Status::OK();
+  }
+
+  virtual uint64_t GetFileSize() {
+    return filesize_;
+  }
+
+  virtual Status InvalidateCache(size_t offset, size_t length) {
+    // nothing of this file is in the OS cache
+    return Status::OK();
+  }
+
+#ifdef ROCKSDB_FALLOCATE_PRESENT
+  virtual Status Allocate(off_t offset, off_t len) {
+    TEST_KILL_RANDOM(rocksdb_kill_odds);
+    int alloc_status = fallocate(
+        fd_, fallocate_with_keep_size_ ? FALLOC_FL_KEEP_SIZE : 0, offset, len);
+    if (alloc_status == 0) {
+      return Status::OK();
+    } else {
+      return IOError(filename_, errno);
+    }
+  }
+
+  virtual size_t GetUniqueId(char* id, size_t max_size) const {
+    return GetUniqueIdFromFile(fd_, id, max_size);
+  }
+#endif
+
+ private:
+  // Writes the buffered data, padded to whole blocks, at buf_offset_. The
+  // blocks that are complete are dropped from the buffer; a trailing
+  // partial block is moved to the front of buf_.
+  Status WriteBuffer() {
+    if (!buf_dirty_) {
+      return Status::OK();
+    }
+    TEST_KILL_RANDOM(rocksdb_kill_odds * REDUCE_ODDS2);
+    const size_t aligned_size = RoundUpToAlignment(cursize_);
+    memset(buf_ + cursize_, 0, aligned_size - cursize_);
+    size_t done = 0;
+    while (done < aligned_size) {
+      ssize_t r = pwrite(fd_, buf_ + done, aligned_size - done,
+                         static_cast<off_t>(buf_offset_ + done));
+      if (r < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return IOError(filename_, errno);
+      }
+      done += r;
+    }
+    TEST_KILL_RANDOM(rocksdb_kill_odds * REDUCE_ODDS2);
+
+    const size_t full_blocks = cursize_ & ~(kDirectIOAlignment - 1);
+    if (full_blocks < cursize_) {
+      memmove(buf_, buf_ + full_blocks, cursize_ - full_blocks);
+    }
+    buf_offset_ += full_blocks;
+    cursize_ -= full_blocks;
+    buf_dirty_ = false;
+    return Status::OK();
+  }
+};
+
 class PosixRandomRWFile : public RandomRWFile {
  private:
   const std::string filename_;
@@ -1049,10 +1670,19 @@ class PosixEnv : public Env {
                                      const EnvOptions& options) {
     result->reset();
     Status s;
-    int fd = open(fname.c_str(), O_RDONLY);
+    int flags = O_RDONLY;
+    if (options.use_direct_reads) {
+      s = GetDirectIOFlag(options.use_mmap_reads, &flags);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    int fd = open(fname.c_str(), flags);
     SetFD_CLOEXEC(fd, &options);
     if (fd < 0) {
       s = IOError(fname, errno);
+    } else if (options.use_direct_reads) {
+      result->reset(new PosixRandomAccessFile(fname, fd, options));
     } else if (options.use_mmap_reads && sizeof(void*) >= 8) {
       // Use of mmap for random reads has been removed because it
       // kills performance when storage is fast.
@@ -1080,12 +1710,27 @@ class PosixEnv : public Env {
                                  const EnvOptions& options) {
     result->reset();
     Status s;
+    int flags = O_CREAT | O_RDWR | O_TRUNC;
+    if (options.use_direct_writes) {
+      s = GetDirectIOFlag(options.use_mmap_writes, &flags);
+      if (!s.ok()) {
+        return s;
+      }
+    }
     int fd = -1;
     do {
-      fd = open(fname.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+      fd = open(fname.c_str(), flags, 0644);
     } while (fd < 0 && errno == EINTR);
     if (fd < 0) {
       s = IOError(fname, errno);
+    } else if (options.use_direct_writes) {
+      SetFD_CLOEXEC(fd, &options);
+      char* buf = NewAlignedBuffer(kDirectIOBufferSize);
+      if (buf == nullptr) {
+        close(fd);
+        return Status::IOError(fname, "cannot allocate aligned buffer");
+      }
+      result->reset(new PosixDirectWritableFile(fname, fd, buf, options));
     } else {
       SetFD_CLOEXEC(fd, &options);
       if (options.use_mmap_writes) {
@@ -1392,9 +2037,25 @@ class PosixEnv : public Env {
     return dummy;
   }
 
+  // Adds O_DIRECT to the open(2) flags, if the platform has it. mmap and
+  // direct I/O are mutually exclusive.
+  static Status GetDirectIOFlag(bool use_mmap, int* flags) {
+    if (use_mmap) {
+      return Status::InvalidArgument(
+          "direct I/O cannot be combined with mmap");
+    }
+#ifdef O_DIRECT
+    *flags |= O_DIRECT;
+    return Status::OK();
+#else
+    return Status::NotSupported("O_DIRECT is not supported on this platform");
+#endif
+  }
+
   EnvOptions OptimizeForLogWrite(const EnvOptions& env_options) const {
     EnvOptions optimized = env_options;
     optimized.use_mmap_writes = false;
+    optimized.use_direct_writes = false;
     // TODO(icanadi) it's faster if fallocate_with_keep_size is false, but it
     // breaks TransactionLogIteratorStallAtLastRecord unit test. Fix the unit
     // test and make this false
@@ -1405,6 +2066,7 @@ class PosixEnv : public Env {
   EnvOptions OptimizeForManifestWrite(const EnvOptions& env_options) const {
     EnvOptions optimized = env_options;
     optimized.use_mmap_writes = false;
+    optimized.use_direct_writes = false;
     optimized.fallocate_with_keep_size = true;
     return optimized;
   }
@@ -22,7 +22,9 @@
 #include "util/coding.h"
 #include "util/log_buffer.h"
 #include "util/mutexlock.h"
+#include "util/random.h"
 #include "util/testharness.h"
+#include "util/testutil.h"
 
 namespace rocksdb {
 
@@ -447,8 +449,129 @@ TEST(EnvPosixTest, InvalidateCache) {
   // Delete the file
   ASSERT_OK(env_->DeleteFile(fname));
 }
+
+TEST(EnvPosixTest, DirectIO) {
+  EnvOptions soptions;
+  soptions.use_mmap_writes = soptions.use_mmap_reads = false;
+  soptions.use_direct_writes = soptions.use_direct_reads = true;
+  std::string fname = GetOnDiskTestDir() + "/" + "testfile";
+
+  Random rnd(301);
+  std::string data;
+  {
+    unique_ptr<WritableFile> wfile;
+    Status s = env_->NewWritableFile(fname, &wfile, soptions);
+    if (!s.ok()) {
+      fprintf(stderr, "Direct I/O is not available: %s, skipping\n",
+              s.ToString().c_str());
+      return;
+    }
+    // Unaligned appends that cross the write buffer, with syncs that
+    // write out a partial last block in the middle.
+    const size_t kSizes[] = {7, 5000, 4089, 1500000, 1, 600000, 4096, 333};
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+      std::string piece;
+      test::RandomString(&rnd, kSizes[i], &piece);
+      ASSERT_OK(wfile->Append(piece));
+      data.append(piece);
+      ASSERT_EQ(data.size(), wfile->GetFileSize());
+      if (i % 3 == 1) {
+        ASSERT_OK(wfile->Sync());
+      }
+    }
+    ASSERT_OK(wfile->Close());
+  }
+  uint64_t file_size;
+  ASSERT_OK(env_->GetFileSize(fname, &file_size));
+  ASSERT_EQ(data.size(), file_size);
+
+  std::unique_ptr<char[]> scratch(new char[data.size()]);
+  for (int use_direct_reads = 0; use_direct_reads <= 1; ++use_direct_reads) {
+    soptions.use_direct_reads = use_direct_reads;
+    unique_ptr<RandomAccessFile> file;
+    ASSERT_OK(env_->NewRandomAccessFile(fname, &file, soptions));
+    Slice result;
+    ASSERT_OK(file->Read(0, data.size(), &result, scratch.get()));
+    ASSERT_TRUE(result == Slice(data));
+    for (int i = 0; i < 100; ++i) {
+      uint64_t offset = rnd.Uniform(data.size());
+      size_t n = rnd.Uniform(20000);
+      ASSERT_OK(file->Read(offset, n, &result, scratch.get()));
+      ASSERT_EQ(data.substr(offset, n), result.ToString());
+    }
+    // Reads past the end of the file return what is there
+    ASSERT_OK(file->Read(data.size() - 10, 100, &result, scratch.get()));
+    ASSERT_EQ(10U, result.size());
+    // Aligned reads into aligned memory
+    void* aligned = nullptr;
+    ASSERT_EQ(0, posix_memalign(&aligned, 4096, 8192));
+    ASSERT_OK(file->Read(4096, 8192, &result, static_cast<char*>(aligned)));
+    ASSERT_EQ(data.substr(4096, 8192), result.ToString());
+    free(aligned);
+  }
+
+  // mmap and direct I/O cannot be combined
+  soptions.use_mmap_reads = true;
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_TRUE(env_->NewRandomAccessFile(fname, &file, soptions)
+                  .IsInvalidArgument());
+
+  ASSERT_OK(env_->DeleteFile(fname));
+}
 #endif
 
+TEST(EnvPosixTest, MultiRead) {
+  EnvOptions soptions;
+  soptions.use_mmap_writes = soptions.use_mmap_reads = false;
+  std::string fname = test::TmpDir() + "/" + "testfile";
+
+  Random rnd(301);
+  std::string data;
+  test::RandomString(&rnd, 1000000, &data);
+  {
+    unique_ptr<WritableFile> wfile;
+    ASSERT_OK(env_->NewWritableFile(fname, &wfile, soptions));
+    ASSERT_OK(wfile->Append(data));
+    ASSERT_OK(wfile->Close());
+  }
+
+  for (int use_direct_reads = 0; use_direct_reads <= 1; ++use_direct_reads) {
+    soptions.use_direct_reads = use_direct_reads;
+    unique_ptr<RandomAccessFile> file;
+    Status s = env_->NewRandomAccessFile(fname, &file, soptions);
+    if (use_direct_reads && !s.ok()) {
+      fprintf(stderr, "Direct I/O is not available: %s, skipping\n",
+              s.ToString().c_str());
+      break;
+    }
+    ASSERT_OK(s);
+
+    // More requests than one batch of the io_uring implementation, some
+    // of them running past the end of the file.
+    for (size_t num_reqs : {1, 2, 200}) {
+      std::vector<ReadRequest> reqs(num_reqs);
+      std::vector<std::string> scratch(num_reqs);
+      for (size_t i = 0; i < num_reqs; ++i) {
+        reqs[i].offset = rnd.Uniform(data.size() + 100);
+        reqs[i].len = 1 + rnd.Uniform(20000);
+        scratch[i].resize(reqs[i].len);
+        reqs[i].scratch = &scratch[i][0];
+      }
+      file->MultiRead(&reqs[0], reqs.size());
+      for (size_t i = 0; i < num_reqs; ++i) {
+        ASSERT_OK(reqs[i].status);
+        std::string expected;
+        if (reqs[i].offset < data.size()) {
+          expected = data.substr(reqs[i].offset, reqs[i].len);
+        }
+        ASSERT_EQ(expected, reqs[i].result.ToString());
+      }
+    }
+  }
+
+  ASSERT_OK(env_->DeleteFile(fname));
+}
+
 TEST(EnvPosixTest, PosixRandomRWFileTest) {
   EnvOptions soptions;
   soptions.use_mmap_writes = soptions.use_mmap_reads = false;
@@ -40,6 +40,7 @@ ColumnFamilyOptions::ColumnFamilyOptions()
       min_write_buffer_number_to_merge(1),
       block_cache(nullptr),
       block_cache_compressed(nullptr),
+      persistent_cache(nullptr),
       block_size(4096),
       block_restart_interval(16),
       compression(kSnappyCompression),
@@ -55,6 +56,7 @@ ColumnFamilyOptions::ColumnFamilyOptions()
       target_file_size_multiplier(1),
       max_bytes_for_level_base(10 * 1048576),
       max_bytes_for_level_multiplier(10),
+      level_compaction_dynamic_level_bytes(false),
       max_bytes_for_level_multiplier_additional(num_levels, 1),
       expanded_compaction_factor(25),
       source_compaction_factor(1),
@@ -69,6 +71,10 @@ ColumnFamilyOptions::ColumnFamilyOptions()
       purge_redundant_kvs_while_flush(true),
       block_size_deviation(10),
       compaction_style(kCompactionStyleLevel),
+      compaction_pri(kByLargestSize),
+      deletion_compaction_window(0),
+      deletion_compaction_trigger(0),
+      periodic_compaction_seconds(0),
       verify_checksums_in_compaction(true),
       filter_deletes(false),
       max_sequential_skip_in_iterations(8),
@@ -99,10 +105,12 @@ ColumnFamilyOptions::ColumnFamilyOptions(const Options& options)
           options.min_write_buffer_number_to_merge),
       block_cache(options.block_cache),
       block_cache_compressed(options.block_cache_compressed),
+      persistent_cache(options.persistent_cache),
       block_size(options.block_size),
       block_restart_interval(options.block_restart_interval),
       compression(options.compression),
       compression_per_level(options.compression_per_level),
+      compression_level_per_level(options.compression_level_per_level),
       compression_opts(options.compression_opts),
       filter_policy(options.filter_policy),
       prefix_extractor(options.prefix_extractor),
@@ -117,6 +125,8 @@ ColumnFamilyOptions::ColumnFamilyOptions(const Options& options)
       target_file_size_multiplier(options.target_file_size_multiplier),
       max_bytes_for_level_base(options.max_bytes_for_level_base),
       max_bytes_for_level_multiplier(options.max_bytes_for_level_multiplier),
+      level_compaction_dynamic_level_bytes(
+          options.level_compaction_dynamic_level_bytes),
       max_bytes_for_level_multiplier_additional(
           options.max_bytes_for_level_multiplier_additional),
       expanded_compaction_factor(options.expanded_compaction_factor),
@@ -133,6 +143,10 @@ ColumnFamilyOptions::ColumnFamilyOptions(const Options& options)
       purge_redundant_kvs_while_flush(options.purge_redundant_kvs_while_flush),
       block_size_deviation(options.block_size_deviation),
       compaction_style(options.compaction_style),
+      compaction_pri(options.compaction_pri),
+      deletion_compaction_window(options.deletion_compaction_window),
+      deletion_compaction_trigger(options.deletion_compaction_trigger),
+      periodic_compaction_seconds(options.periodic_compaction_seconds),
       verify_checksums_in_compaction(options.verify_checksums_in_compaction),
       compaction_options_universal(options.compaction_options_universal),
       filter_deletes(options.filter_deletes),
@@ -160,9 +174,12 @@ DBOptions::DBOptions()
       error_if_exists(false),
       paranoid_checks(true),
       env(Env::Default()),
+      rate_limiter(nullptr),
       info_log(nullptr),
       info_log_level(INFO_LEVEL),
       max_open_files(5000),
+      preload_table_files_on_open(false),
+      max_file_opening_threads(1),
       max_total_wal_size(0),
       statistics(nullptr),
       disableDataSync(false),
@@ -172,6 +189,8 @@ DBOptions::DBOptions()
       wal_dir(""),
       delete_obsolete_files_period_micros(6 * 60 * 60 * 1000000UL),
       max_background_compactions(1),
+      max_subcompactions(1),
+      parallel_manual_compaction(false),
       max_background_flushes(1),
       max_log_file_size(0),
       log_file_time_to_roll(0),
@@ -185,6 +204,8 @@ DBOptions::DBOptions()
       allow_os_buffer(true),
       allow_mmap_reads(false),
       allow_mmap_writes(false),
+      use_direct_reads(false),
+      use_direct_writes(false),
       is_fd_close_on_exec(true),
       skip_log_error_on_recovery(false),
       stats_dump_period_sec(3600),
@@ -199,9 +220,12 @@ DBOptions::DBOptions(const Options& options)
       error_if_exists(options.error_if_exists),
       paranoid_checks(options.paranoid_checks),
       env(options.env),
+      rate_limiter(options.rate_limiter),
       info_log(options.info_log),
       info_log_level(options.info_log_level),
       max_open_files(options.max_open_files),
+      preload_table_files_on_open(options.preload_table_files_on_open),
+      max_file_opening_threads(options.max_file_opening_threads),
       max_total_wal_size(options.max_total_wal_size),
       statistics(options.statistics),
       disableDataSync(options.disableDataSync),
@@ -212,6 +236,8 @@ DBOptions::DBOptions(const Options& options)
       delete_obsolete_files_period_micros(
           options.delete_obsolete_files_period_micros),
       max_background_compactions(options.max_background_compactions),
+      max_subcompactions(options.max_subcompactions),
+      parallel_manual_compaction(options.parallel_manual_compaction),
       max_background_flushes(options.max_background_flushes),
       max_log_file_size(options.max_log_file_size),
       log_file_time_to_roll(options.log_file_time_to_roll),
@@ -226,6 +252,8 @@ DBOptions::DBOptions(const Options& options)
       allow_os_buffer(options.allow_os_buffer),
       allow_mmap_reads(options.allow_mmap_reads),
       allow_mmap_writes(options.allow_mmap_writes),
+      use_direct_reads(options.use_direct_reads),
+      use_direct_writes(options.use_direct_writes),
       is_fd_close_on_exec(options.is_fd_close_on_exec),
       skip_log_error_on_recovery(options.skip_log_error_on_recovery),
       stats_dump_period_sec(options.stats_dump_period_sec),
@@ -244,8 +272,13 @@ void DBOptions::Dump(Logger* log) const {
     Log(log,"       Options.create_if_missing: %d", create_if_missing);
     Log(log,"         Options.paranoid_checks: %d", paranoid_checks);
     Log(log,"                     Options.env: %p", env);
+    Log(log,"            Options.rate_limiter: %p", rate_limiter.get());
     Log(log,"                Options.info_log: %p", info_log.get());
     Log(log,"          Options.max_open_files: %d", max_open_files);
+    Log(log,"  Options.preload_table_files_on_open: %d",
+        preload_table_files_on_open);
+    Log(log,"     Options.max_file_opening_threads: %d",
+        max_file_opening_threads);
     Log(log,"      Options.max_total_wal_size: %" PRIu64, max_total_wal_size);
     Log(log, "       Options.disableDataSync: %d", disableDataSync);
     Log(log, "             Options.use_fsync: %d", use_fsync);
@@ -270,6 +303,10 @@ void DBOptions::Dump(Logger* log) const {
         (unsigned long)delete_obsolete_files_period_micros);
     Log(log, "             Options.max_background_compactions: %d",
         max_background_compactions);
+    Log(log, "                     Options.max_subcompactions: %d",
+        max_subcompactions);
+    Log(log, "             Options.parallel_manual_compaction: %d",
+        parallel_manual_compaction);
     Log(log, "                 Options.max_background_flushes: %d",
         max_background_flushes);
     Log(log, "                        Options.WAL_ttl_seconds: %lu",
@@ -284,6 +321,10 @@ void DBOptions::Dump(Logger* log) const {
         allow_mmap_reads);
     Log(log, "                       Options.allow_mmap_writes: %d",
         allow_mmap_writes);
+    Log(log, "                        Options.use_direct_reads: %d",
+        use_direct_reads);
+    Log(log, "                       Options.use_direct_writes: %d",
+        use_direct_writes);
     Log(log, "                     Options.is_fd_close_on_exec: %d",
         is_fd_close_on_exec);
     Log(log, "              Options.skip_log_error_on_recovery: %d",
@@ -315,6 +356,7 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
     Log(log,"             Options.block_cache: %p", block_cache.get());
     Log(log,"  Options.block_cache_compressed: %p",
         block_cache_compressed.get());
+    Log(log,"        Options.persistent_cache: %p", persistent_cache.get());
     if (block_cache) {
       Log(log,"        Options.block_cache_size: %zd",
           block_cache->GetCapacity());
@@ -333,6 +375,10 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
     } else {
       Log(log,"         Options.compression: %d", compression);
     }
+    for (unsigned int i = 0; i < compression_level_per_level.size(); i++) {
+      Log(log,"       Options.compression_level[%d]: %d",
+          i, compression_level_per_level[i]);
+    }
     Log(log,"         Options.filter_policy: %s",
         filter_policy == nullptr ? "nullptr" : filter_policy->Name());
     Log(log,"      Options.prefix_extractor: %s",
@@ -349,6 +395,10 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
         compression_opts.level);
     Log(log,"              Options.compression_opts.strategy: %d",
         compression_opts.strategy);
+    Log(log,"      Options.compression_opts.parallel_threads: %d",
+        compression_opts.parallel_threads);
+    Log(log,"        Options.compression_opts.max_dict_bytes: %d",
+        compression_opts.max_dict_bytes);
     Log(log,"     Options.level0_file_num_compaction_trigger: %d",
         level0_file_num_compaction_trigger);
     Log(log,"         Options.level0_slowdown_writes_trigger: %d",
@@ -365,6 +415,8 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
         (unsigned long)max_bytes_for_level_base);
     Log(log,"         Options.max_bytes_for_level_multiplier: %d",
         max_bytes_for_level_multiplier);
+    Log(log,"   Options.level_compaction_dynamic_level_bytes: %d",
+        level_compaction_dynamic_level_bytes);
     for (int i = 0; i < num_levels; i++) {
       Log(log,"Options.max_bytes_for_level_multiplier_addtl[%d]: %d",
           i, max_bytes_for_level_multiplier_additional[i]);
@@ -401,6 +453,14 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
         verify_checksums_in_compaction);
     Log(log,"                        Options.compaction_style: %d",
         compaction_style);
+    Log(log,"                          Options.compaction_pri: %d",
+        compaction_pri);
+    Log(log,"              Options.deletion_compaction_window: %u",
+        deletion_compaction_window);
+    Log(log,"             Options.deletion_compaction_trigger: %u",
+        deletion_compaction_trigger);
+    Log(log,"             Options.periodic_compaction_seconds: %" PRIu64,
+        periodic_compaction_seconds);
     Log(log," Options.compaction_options_universal.size_ratio: %u",
         compaction_options_universal.size_ratio);
     Log(log,"Options.compaction_options_universal.min_merge_width: %u",
@@ -413,6 +473,8 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
     Log(log,
         "Options.compaction_options_universal.compression_size_percent: %u",
         compaction_options_universal.compression_size_percent);
+    Log(log,"Options.compaction_options_universal.partitioned_runs: %d",
+        compaction_options_universal.partitioned_runs);
     std::string collector_names;
     for (const auto& collector_factory : table_properties_collector_factories) {
       collector_names.append(collector_factory->Name());
@@ -0,0 +1,277 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "util/persistent_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "util/crc32c.h"
+#include "util/mutexlock.h"
+
+namespace rocksdb {
+
+namespace {
+// The cache is split into this many files, so that dropping the oldest one
+// frees an eighth of it.
+const uint64_t kNumCacheFiles = 8;
+// Insert() drops entries while this many bytes wait to be written.
+const uint64_t kMaxPendingBytes = 4 << 20;
+const char kCacheFileSuffix[] = ".pcache";
+
+bool IsCacheFile(const std::string& fname) {
+  const size_t suffix_len = sizeof(kCacheFileSuffix) - 1;
+  return fname.size() > suffix_len &&
+         fname.compare(fname.size() - suffix_len, suffix_len,
+                       kCacheFileSuffix) == 0;
+}
+
+EnvOptions CacheFileEnvOptions() {
+  // Lookups read the entries with pread() as soon as they are flushed.
+  EnvOptions env_options;
+  env_options.use_mmap_reads = false;
+  env_options.use_mmap_writes = false;
+  return env_options;
+}
+}  // namespace
+
+LogPersistentCache::LogPersistentCache(Env* env, const std::string& path,
+                                       uint64_t capacity)
+    : env_(env),
+      path_(path),
+      capacity_(capacity),
+      file_size_(
+          std::max(capacity / kNumCacheFiles, static_cast<uint64_t>(1))),
+      last_id_(0),
+      cv_(&mutex_),
+      next_file_number_(1),
+      usage_(0),
+      pending_bytes_(0),
+      shutdown_(false),
+      writer_thread_(&LogPersistentCache::WriteEntries, this) {}
+
+LogPersistentCache::~LogPersistentCache() {
+  {
+    MutexLock l(&mutex_);
+    shutdown_ = true;
+    cv_.SignalAll();
+  }
+  writer_thread_.join();
+  writer_.reset();
+  for (const auto& file : files_) {
+    env_->DeleteFile(CacheFileName(file.number));
+  }
+}
+
+std::string LogPersistentCache::CacheFileName(uint64_t number) const {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "/%06llu%s",
+           static_cast<unsigned long long>(number), kCacheFileSuffix);
+  return path_ + buf;
+}
+
+Status LogPersistentCache::Open() {
+  Status s = env_->CreateDirIfMissing(path_);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<std::string> children;
+  s = env_->GetChildren(path_, &children);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const auto& child : children) {
+    if (IsCacheFile(child)) {
+      s = env_->DeleteFile(path_ + "/" + child);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  return s;
+}
+
+Status LogPersistentCache::NewCacheFile() {
+  mutex_.AssertHeld();
+  if (writer_ != nullptr) {
+    writer_->Close();
+    writer_.reset();
+  }
+  while (!files_.empty() && usage_ + file_size_ > capacity_) {
+    const CacheFile& oldest = files_.front();
+    for (const auto& key : oldest.keys) {
+      index_.erase(key);
+    }
+    usage_ -= oldest.size;
+    // Lookups that are still reading the file keep it open.
+    env_->DeleteFile(CacheFileName(oldest.number));
+    files_.pop_front();
+  }
+
+  const uint64_t number = next_file_number_++;
+  const std::string fname = CacheFileName(number);
+  const EnvOptions env_options = CacheFileEnvOptions();
+  unique_ptr<WritableFile> writer;
+  Status s = env_->NewWritableFile(fname, &writer, env_options);
+  if (!s.ok()) {
+    return s;
+  }
+  unique_ptr<RandomAccessFile> reader;
+  s = env_->NewRandomAccessFile(fname, &reader, env_options);
+  if (!s.ok()) {
+    writer.reset();
+    env_->DeleteFile(fname);
+    return s;
+  }
+  CacheFile file;
+  file.number = number;
+  file.reader.reset(reader.release());
+  file.size = 0;
+  files_.push_back(std::move(file));
+  writer_ = std::move(writer);
+  return s;
+}
+
+Status LogPersistentCache::Insert(const Slice& key, const char* data,
+                                  size_t size) {
+  MutexLock l(&mutex_);
+  const std::string key_str = key.ToString();
+  if (index_.find(key_str) != index_.end() ||
+      pending_.find(key_str) != pending_.end()) {
+    return Status::OK();
+  }
+  if (size > file_size_) {
+    return Status::Incomplete("entry is larger than a cache file");
+  }
+  if (pending_bytes_ + size > kMaxPendingBytes) {
+    return Status::Incomplete("too many entries waiting to be written");
+  }
+  pending_.insert(std::make_pair(key_str, std::string(data, size)));
+  pending_keys_.push_back(key_str);
+  pending_bytes_ += size;
+  cv_.SignalAll();
+  return Status::OK();
+}
+
+void LogPersistentCache::WriteEntries() {
+  MutexLock l(&mutex_);
+  while (true) {
+    while (pending_keys_.empty() && !shutdown_) {
+      cv_.Wait();
+    }
+    if (shutdown_) {
+      return;
+    }
+    const std::string& key = pending_keys_.front();
+    const std::string& data = pending_.find(key)->second;
+
+    Status s;
+    if (writer_ == nullptr || files_.back().size + data.size() > file_size_) {
+      s = NewCacheFile();
+    }
+    if (s.ok()) {
+      // Only this thread appends to the files, and changes files_ and the
+      // entries in pending_, so the write needs no lock. Flush the entry so
+      // that lookups can read it from the file once it is in index_.
+      mutex_.Unlock();
+      s = writer_->Append(data);
+      if (s.ok()) {
+        s = writer_->Flush();
+      }
+      mutex_.Lock();
+    }
+
+    if (s.ok()) {
+      CacheFile& file = files_.back();
+      Location location;
+      location.reader = file.reader;
+      location.offset = file.size;
+      location.size = data.size();
+      location.crc = crc32c::Value(data.data(), data.size());
+      file.size += data.size();
+      file.keys.push_back(key);
+      usage_ += data.size();
+      index_.insert(std::make_pair(key, location));
+    } else {
+      // The entry is dropped. The file may end with part of it; the next
+      // entry starts a new one.
+      writer_.reset();
+    }
+    pending_bytes_ -= data.size();
+    pending_.erase(key);
+    pending_keys_.pop_front();
+    cv_.SignalAll();
+  }
+}
+
+void LogPersistentCache::TEST_WaitForPendingWrites() {
+  MutexLock l(&mutex_);
+  while (!pending_keys_.empty()) {
+    cv_.Wait();
+  }
+}
+
+Status LogPersistentCache::Lookup(const Slice& key,
+                                  std::unique_ptr<char[]>* data,
+                                  size_t* size) {
+  Location location;
+  {
+    MutexLock l(&mutex_);
+    const std::string key_str = key.ToString();
+    auto it = index_.find(key_str);
+    if (it == index_.end()) {
+      auto pending = pending_.find(key_str);
+      if (pending == pending_.end()) {
+        return Status::NotFound(Slice());
+      }
+      const std::string& value = pending->second;
+      data->reset(new char[value.size()]);
+      memcpy(data->get(), value.data(), value.size());
+      *size = value.size();
+      return Status::OK();
+    }
+    location = it->second;
+  }
+
+  // Read without the lock; the location holds the file open even if the
+  // entry is dropped meanwhile.
+  std::unique_ptr<char[]> buf(new char[location.size]);
+  Slice result;
+  Status s = location.reader->Read(location.offset, location.size, &result,
+                                   buf.get());
+  if (!s.ok()) {
+    return s;
+  }
+  if (result.size() != location.size ||
+      crc32c::Value(result.data(), result.size()) != location.crc) {
+    return Status::Corruption("persistent cache entry", path_);
+  }
+  if (result.data() != buf.get()) {
+    memcpy(buf.get(), result.data(), result.size());
+  }
+  *data = std::move(buf);
+  *size = location.size;
+  return s;
+}
+
+uint64_t LogPersistentCache::GetUsage() const {
+  MutexLock l(&mutex_);
+  return usage_;
+}
+
+Status NewPersistentCache(Env* env, const std::string& path,
+                          uint64_t capacity,
+                          std::shared_ptr<PersistentCache>* cache) {
+  std::shared_ptr<LogPersistentCache> log_cache(
+      new LogPersistentCache(env, path, capacity));
+  Status s = log_cache->Open();
+  if (s.ok()) {
+    *cache = log_cache;
+  }
+  return s;
+}
+
+}  // namespace rocksdb
@@ -0,0 +1,105 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/persistent_cache.h"
+
+namespace rocksdb {
+
+// A PersistentCache that appends its entries to a log of cache files and
+// keeps their locations in an in-memory index. The cache files are written
+// in turn, each up to file_size bytes, and the oldest one is deleted with
+// all of its entries when the cache holds more than its capacity.
+// Insert() only queues the entry; a background thread writes the queued
+// entries to the files, so that the readers that fill the cache do not wait
+// for the writes, or for each other's. Lookups find the queued entries in
+// memory until they are written.
+class LogPersistentCache : public PersistentCache {
+ public:
+  LogPersistentCache(Env* env, const std::string& path, uint64_t capacity);
+
+  virtual ~LogPersistentCache();
+
+  // Delete the cache files left in the directory by an earlier instance.
+  Status Open();
+
+  virtual Status Insert(const Slice& key, const char* data,
+                        size_t size) override;
+
+  virtual Status Lookup(const Slice& key, std::unique_ptr<char[]>* data,
+                        size_t* size) override;
+
+  virtual uint64_t NewId() override { return ++last_id_; }
+
+  virtual uint64_t GetUsage() const override;
+
+  // Wait until the queued entries are written.
+  void TEST_WaitForPendingWrites();
+
+ private:
+  struct CacheFile {
+    uint64_t number;
+    std::shared_ptr<RandomAccessFile> reader;
+    uint64_t size;
+    // keys of the entries of the file, to drop them from the index with it
+    std::vector<std::string> keys;
+  };
+
+  struct Location {
+    // CacheFile::reader of the file the entry is in
+    std::shared_ptr<RandomAccessFile> reader;
+    uint64_t offset;
+    size_t size;
+    uint32_t crc;  // crc32c of the data
+  };
+
+  std::string CacheFileName(uint64_t number) const;
+
+  // Body of writer_thread_: writes the queued entries until shutdown_.
+  void WriteEntries();
+
+  // Finish the current cache file, start a new one and delete the oldest
+  // files until there is room for it.
+  // REQUIRES: mutex_ held, called by writer_thread_
+  Status NewCacheFile();
+
+  Env* const env_;
+  const std::string path_;
+  const uint64_t capacity_;
+  const uint64_t file_size_;
+
+  std::atomic<uint64_t> last_id_;
+
+  mutable port::Mutex mutex_;
+  // Signalled when an entry is queued, written, or on shutdown
+  port::CondVar cv_;
+  // cache files from the oldest to the one being written
+  std::deque<CacheFile> files_;
+  // Only used by writer_thread_
+  std::unique_ptr<WritableFile> writer_;
+  uint64_t next_file_number_;
+  uint64_t usage_;
+  std::unordered_map<std::string, Location> index_;
+  // Entries queued by Insert(), by key, and their keys in insertion order.
+  // An entry stays in pending_ while it is written.
+  std::unordered_map<std::string, std::string> pending_;
+  std::deque<std::string> pending_keys_;
+  uint64_t pending_bytes_;
+  bool shutdown_;
+  std::thread writer_thread_;
+};
+
+}  // namespace rocksdb
@@ -0,0 +1,145 @@
+//  Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <string>
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "rocksdb/persistent_cache.h"
+#include "util/logging.h"
+#include "util/persistent_cache.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace rocksdb {
+
+class PersistentCacheTest {
+ public:
+  PersistentCacheTest()
+      : env_(Env::Default()),
+        path_(test::TmpDir() + "/persistent_cache_test") {}
+
+  Status Open(uint64_t capacity) {
+    cache_.reset();
+    return NewPersistentCache(env_, path_, capacity, &cache_);
+  }
+
+  std::string Lookup(const std::string& key) {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    Status s = cache_->Lookup(key, &data, &size);
+    if (!s.ok()) {
+      return s.IsNotFound() ? "NOT_FOUND" : s.ToString();
+    }
+    return std::string(data.get(), size);
+  }
+
+  void WaitForPendingWrites() {
+    static_cast<LogPersistentCache*>(cache_.get())
+        ->TEST_WaitForPendingWrites();
+  }
+
+  std::string Value(int i) {
+    return std::string(100, static_cast<char>('a' + i % 26)) +
+           NumberToString(i);
+  }
+
+  Env* env_;
+  std::string path_;
+  std::shared_ptr<PersistentCache> cache_;
+};
+
+TEST(PersistentCacheTest, InsertAndLookup) {
+  ASSERT_OK(Open(1 << 20));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(cache_->Insert("key" + NumberToString(i), Value(i).data(),
+                             Value(i).size()));
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(Value(i), Lookup("key" + NumberToString(i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Lookup("key100"));
+
+  // The entries are found the same once they are written.
+  WaitForPendingWrites();
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(Value(i), Lookup("key" + NumberToString(i)));
+  }
+
+  // An existing entry is kept.
+  ASSERT_OK(cache_->Insert("key0", "other", 5));
+  ASSERT_EQ(Value(0), Lookup("key0"));
+  WaitForPendingWrites();
+
+  uint64_t usage = 0;
+  for (int i = 0; i < 100; i++) {
+    usage += Value(i).size();
+  }
+  ASSERT_EQ(usage, cache_->GetUsage());
+  ASSERT_NE(cache_->NewId(), cache_->NewId());
+}
+
+TEST(PersistentCacheTest, Eviction) {
+  // Eight cache files of 2KB each
+  ASSERT_OK(Open(16 << 10));
+  const int kNumEntries = 1000;
+  for (int i = 0; i < kNumEntries; i++) {
+    ASSERT_OK(cache_->Insert("key" + NumberToString(i), Value(i).data(),
+                             Value(i).size()));
+    WaitForPendingWrites();
+    ASSERT_LE(cache_->GetUsage(), 16U << 10);
+  }
+
+  // The oldest entries were dropped with their files, the newest are kept.
+  ASSERT_EQ("NOT_FOUND", Lookup("key0"));
+  ASSERT_EQ("NOT_FOUND", Lookup("key" + NumberToString(kNumEntries / 2)));
+  for (int i = kNumEntries - 50; i < kNumEntries; i++) {
+    ASSERT_EQ(Value(i), Lookup("key" + NumberToString(i)));
+  }
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(path_, &children));
+  int num_files = 0;
+  for (const auto& child : children) {
+    if (child != "." && child != "..") {
+      num_files++;
+    }
+  }
+  ASSERT_LE(num_files, 8);
+
+  // Entries larger than a cache file are not stored.
+  std::string large(4 << 10, 'x');
+  ASSERT_TRUE(cache_->Insert("large", large.data(), large.size())
+                  .IsIncomplete());
+  ASSERT_EQ("NOT_FOUND", Lookup("large"));
+}
+
+TEST(PersistentCacheTest, OpenDeletesOldCacheFiles) {
+  ASSERT_OK(env_->CreateDirIfMissing(path_));
+  unique_ptr<WritableFile> file;
+  ASSERT_OK(env_->NewWritableFile(path_ + "/000001.pcache", &file,
+                                  EnvOptions()));
+  file.reset();
+  ASSERT_OK(env_->NewWritableFile(path_ + "/other_file", &file,
+                                  EnvOptions()));
+  file.reset();
+
+  ASSERT_OK(Open(1 << 20));
+  ASSERT_TRUE(!env_->FileExists(path_ + "/000001.pcache"));
+  ASSERT_TRUE(env_->FileExists(path_ + "/other_file"));
+  ASSERT_OK(env_->DeleteFile(path_ + "/other_file"));
+
+  // The cache deletes its files when it is destroyed.
+  ASSERT_OK(cache_->Insert("key", "value", 5));
+  WaitForPendingWrites();
+  ASSERT_TRUE(env_->FileExists(path_ + "/000001.pcache"));
+  cache_.reset();
+  ASSERT_TRUE(!env_->FileExists(path_ + "/000001.pcache"));
+}
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  return rocksdb::test::RunAllTests();
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/rate_limiter.h"
+
+#include <algorithm>
+
+#include "util/mutexlock.h"
+#include "util/statistics.h"
+
+namespace rocksdb {
+
+GenericRateLimiter::GenericRateLimiter(int64_t rate_bytes_per_sec,
+                                       int64_t refill_period_us, Env* env)
+    : refill_period_us_(refill_period_us),
+      refill_bytes_per_period_(
+          std::max(rate_bytes_per_sec * refill_period_us / 1000000,
+                   static_cast<int64_t>(1))),
+      env_(env),
+      available_bytes_(0),
+      next_refill_us_(env->NowMicros()),
+      num_high_pri_waiting_(0) {
+  assert(rate_bytes_per_sec > 0);
+  assert(refill_period_us > 0);
+  for (int i = 0; i < Env::TOTAL; i++) {
+    total_bytes_through_[i] = 0;
+  }
+}
+
+void GenericRateLimiter::Refill() {
+  mutex_.AssertHeld();
+  uint64_t now = env_->NowMicros();
+  if (now < next_refill_us_) {
+    return;
+  }
+  uint64_t periods = (now - next_refill_us_) / refill_period_us_ + 1;
+  next_refill_us_ += periods * refill_period_us_;
+  // Unused tokens do not pile up beyond one period, so an idle limiter
+  // does not allow a burst above the configured rate afterwards.
+  available_bytes_ = std::min(
+      available_bytes_ + static_cast<int64_t>(periods) *
+                             refill_bytes_per_period_,
+      refill_bytes_per_period_);
+}
+
+void GenericRateLimiter::Request(int64_t bytes, Env::Priority pri,
+                                 Statistics* stats) {
+  assert(bytes <= refill_bytes_per_period_);
+  assert(pri == Env::LOW || pri == Env::HIGH);
+  MutexLock l(&mutex_);
+  if (pri == Env::HIGH) {
+    ++num_high_pri_waiting_;
+  }
+  bool throttled = false;
+  while (true) {
+    Refill();
+    // A low-priority request also yields to waiting high-priority ones.
+    if (available_bytes_ >= bytes &&
+        (pri == Env::HIGH || num_high_pri_waiting_ == 0)) {
+      break;
+    }
+    throttled = true;
+    uint64_t now = env_->NowMicros();
+    uint64_t wait_us = next_refill_us_ > now ? next_refill_us_ - now : 0;
+    mutex_.Unlock();
+    env_->SleepForMicroseconds(static_cast<int>(wait_us));
+    mutex_.Lock();
+  }
+  if (pri == Env::HIGH) {
+    --num_high_pri_waiting_;
+  }
+  available_bytes_ -= bytes;
+  total_bytes_through_[pri] += bytes;
+  if (throttled) {
+    RecordTick(stats, RATE_LIMITER_THROTTLED_BYTES, bytes);
+  }
+}
+
+int64_t GenericRateLimiter::GetTotalBytesThrough(Env::Priority pri) const {
+  MutexLock l(&mutex_);
+  if (pri == Env::TOTAL) {
+    return total_bytes_through_[Env::LOW] + total_bytes_through_[Env::HIGH];
+  }
+  return total_bytes_through_[pri];
+}
+
+Status RateLimitedWritableFile::Append(const Slice& data) {
+  // Larger writes are requested in pieces of at most one burst.
+  const int64_t burst = rate_limiter_->GetSingleBurstBytes();
+  size_t left = data.size();
+  while (left > 0) {
+    int64_t bytes = std::min(static_cast<int64_t>(left), burst);
+    rate_limiter_->Request(bytes, pri_, stats_);
+    left -= bytes;
+  }
+  return file_->Append(data);
+}
+
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                   int64_t refill_period_us) {
+  return new GenericRateLimiter(rate_bytes_per_sec, refill_period_us,
+                                Env::Default());
+}
+
+}  // namespace rocksdb
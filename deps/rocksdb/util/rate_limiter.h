@@ -0,0 +1,95 @@
+// Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#pragma once
+
+#include <memory>
+
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/rate_limiter.h"
+
+namespace rocksdb {
+
+class GenericRateLimiter : public RateLimiter {
+ public:
+  GenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us,
+                     Env* env);
+
+  virtual ~GenericRateLimiter() {}
+
+  virtual void Request(int64_t bytes, Env::Priority pri,
+                       Statistics* stats) override;
+
+  virtual int64_t GetSingleBurstBytes() const override {
+    return refill_bytes_per_period_;
+  }
+
+  virtual int64_t GetTotalBytesThrough(
+      Env::Priority pri = Env::TOTAL) const override;
+
+ private:
+  // Add the tokens of all refill periods that have passed.
+  // REQUIRES: mutex_ held
+  void Refill();
+
+  const int64_t refill_period_us_;
+  const int64_t refill_bytes_per_period_;
+  Env* const env_;
+
+  mutable port::Mutex mutex_;
+  int64_t available_bytes_;
+  uint64_t next_refill_us_;
+  int num_high_pri_waiting_;
+  int64_t total_bytes_through_[Env::TOTAL];
+};
+
+// A WritableFile that requests every append from a RateLimiter before
+// passing it on to the file it wraps. Every other call is forwarded as is.
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(std::unique_ptr<WritableFile>&& file,
+                          RateLimiter* rate_limiter, Env::Priority pri,
+                          Statistics* stats)
+      : file_(std::move(file)),
+        rate_limiter_(rate_limiter),
+        pri_(pri),
+        stats_(stats) {}
+
+  virtual Status Append(const Slice& data);
+  virtual Status Close() { return file_->Close(); }
+  virtual Status Flush() { return file_->Flush(); }
+  virtual Status Sync() { return file_->Sync(); }
+  virtual Status Fsync() { return file_->Fsync(); }
+  virtual uint64_t GetFileSize() { return file_->GetFileSize(); }
+  virtual void GetPreallocationStatus(size_t* block_size,
+                                      size_t* last_allocated_block) {
+    file_->GetPreallocationStatus(block_size, last_allocated_block);
+  }
+  virtual size_t GetUniqueId(char* id, size_t max_size) const {
+    return file_->GetUniqueId(id, max_size);
+  }
+  virtual Status InvalidateCache(size_t offset, size_t length) {
+    return file_->InvalidateCache(offset, length);
+  }
+  virtual Status Allocate(off_t offset, off_t len) {
+    return file_->Allocate(offset, len);
+  }
+  virtual Status RangeSync(off_t offset, off_t nbytes) {
+    return file_->RangeSync(offset, nbytes);
+  }
+
+ private:
+  std::unique_ptr<WritableFile> file_;
+  RateLimiter* rate_limiter_;
+  Env::Priority pri_;
+  Statistics* stats_;
+};
+
+}  // namespace rocksdb
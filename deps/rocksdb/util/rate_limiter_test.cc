@@ -0,0 +1,156 @@
+//  Copyright (c) 2014, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "rocksdb/statistics.h"
+#include "util/rate_limiter.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace rocksdb {
+
+class RateLimiterTest {};
+
+TEST(RateLimiterTest, SingleBurst) {
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(200, 1000 * 1000));
+  ASSERT_EQ(limiter->GetSingleBurstBytes(), 200);
+  limiter.reset(NewGenericRateLimiter(1000 * 1000, 100 * 1000));
+  ASSERT_EQ(limiter->GetSingleBurstBytes(), 100 * 1000);
+}
+
+TEST(RateLimiterTest, Rate) {
+  Env* env = Env::Default();
+  const int64_t kRate = 1 << 20;  // 1MB/s
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(kRate, 10 * 1000));
+  const int64_t kRequest = limiter->GetSingleBurstBytes() / 4;
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    Env::Priority pri = (i % 2 == 0) ? Env::LOW : Env::HIGH;
+    threads.emplace_back([&, pri]() {
+      while (!done.load()) {
+        limiter->Request(kRequest, pri, nullptr);
+      }
+    });
+  }
+  const uint64_t start = env->NowMicros();
+  env->SleepForMicroseconds(1000 * 1000);
+  done.store(true);
+  for (auto& t : threads) {
+    t.join();
+  }
+  const uint64_t elapsed = env->NowMicros() - start;
+
+  // At most one period's worth of tokens can be handed out up front.
+  const int64_t allowed = static_cast<int64_t>(kRate * elapsed / 1000000) +
+                          limiter->GetSingleBurstBytes() + 4 * kRequest;
+  int64_t through = limiter->GetTotalBytesThrough();
+  ASSERT_LE(through, allowed);
+  ASSERT_GE(through, kRate / 2);
+  ASSERT_EQ(through, limiter->GetTotalBytesThrough(Env::LOW) +
+                         limiter->GetTotalBytesThrough(Env::HIGH));
+  // Flushes are served ahead of compactions.
+  ASSERT_GT(limiter->GetTotalBytesThrough(Env::HIGH),
+            limiter->GetTotalBytesThrough(Env::LOW));
+}
+
+TEST(RateLimiterTest, WritableFile) {
+  Env* env = Env::Default();
+  std::string fname = test::TmpDir() + "/rate_limiter_test_file";
+  std::shared_ptr<Statistics> stats = CreateDBStatistics();
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(100 * 1024, 100 * 1000));
+
+  unique_ptr<WritableFile> base;
+  ASSERT_OK(env->NewWritableFile(fname, &base, EnvOptions()));
+  RateLimitedWritableFile file(std::move(base), limiter.get(), Env::LOW,
+                               stats.get());
+  // The append is larger than a single burst, so it is requested in
+  // several pieces and has to wait for refills.
+  std::string data(50 * 1024, 'x');
+  ASSERT_OK(file.Append(data));
+  ASSERT_OK(file.Close());
+  ASSERT_EQ(limiter->GetTotalBytesThrough(Env::LOW),
+            static_cast<int64_t>(data.size()));
+  ASSERT_GT(stats->getTickerCount(RATE_LIMITER_THROTTLED_BYTES), 0);
+
+  uint64_t size;
+  ASSERT_OK(env->GetFileSize(fname, &size));
+  ASSERT_EQ(size, data.size());
+  ASSERT_OK(env->DeleteFile(fname));
+}
+
+// Records which calls reach it
+class CallRecordingFile : public WritableFile {
+ public:
+  explicit CallRecordingFile(std::string* calls) : calls_(calls) {}
+  virtual Status Append(const Slice& data) { return Record("Append"); }
+  virtual Status Close() { return Record("Close"); }
+  virtual Status Flush() { return Record("Flush"); }
+  virtual Status Sync() { return Record("Sync"); }
+  virtual Status Fsync() { return Record("Fsync"); }
+  virtual uint64_t GetFileSize() {
+    Record("GetFileSize");
+    return 7;
+  }
+  virtual size_t GetUniqueId(char* id, size_t max_size) const {
+    calls_->append("GetUniqueId,");
+    return 0;
+  }
+  virtual Status InvalidateCache(size_t offset, size_t length) {
+    return Record("InvalidateCache");
+  }
+  virtual Status Allocate(off_t offset, off_t len) {
+    return Record("Allocate");
+  }
+  virtual Status RangeSync(off_t offset, off_t nbytes) {
+    return Record("RangeSync");
+  }
+
+ private:
+  Status Record(const char* call) {
+    calls_->append(call);
+    calls_->append(",");
+    return Status::OK();
+  }
+
+  std::string* calls_;
+};
+
+TEST(RateLimiterTest, WritableFileForwardsCalls) {
+  std::unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(1 << 20, 100 * 1000));
+  std::string calls;
+  RateLimitedWritableFile file(
+      std::unique_ptr<WritableFile>(new CallRecordingFile(&calls)),
+      limiter.get(), Env::LOW, nullptr);
+  ASSERT_OK(file.Append("x"));
+  ASSERT_OK(file.Allocate(0, 4096));
+  ASSERT_OK(file.RangeSync(0, 4096));
+  ASSERT_OK(file.Flush());
+  ASSERT_OK(file.Sync());
+  ASSERT_OK(file.Fsync());
+  ASSERT_EQ(file.GetFileSize(), 7U);
+  char id[16];
+  file.GetUniqueId(id, sizeof(id));
+  ASSERT_OK(file.InvalidateCache(0, 0));
+  ASSERT_OK(file.Close());
+  ASSERT_EQ(calls,
+            "Append,Allocate,RangeSync,Flush,Sync,Fsync,GetFileSize,"
+            "GetUniqueId,InvalidateCache,Close,");
+}
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  return rocksdb::test::RunAllTests();
+}
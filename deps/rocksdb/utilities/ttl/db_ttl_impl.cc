@@ -261,6 +261,12 @@ Status DBWithTTLImpl::Write(const WriteOptions& opts, WriteBatch* updates) {
       WriteBatchInternal::Delete(&updates_ttl, column_family_id, key);
       return Status::OK();
     }
+    virtual Status DeleteRangeCF(uint32_t column_family_id,
+                                 const Slice& begin_key, const Slice& end_key) {
+      WriteBatchInternal::DeleteRange(&updates_ttl, column_family_id,
+                                      begin_key, end_key);
+      return Status::OK();
+    }
     virtual void LogData(const Slice& blob) { updates_ttl.PutLogData(blob); }
 
    private: